@@ -379,6 +379,75 @@ Matrix4f Matrix4f::Inverse() const
 }
 
 
+Matrix4f Matrix4f::AffineInverse() const
+{
+    assert((m[3][0] == 0.0f) && (m[3][1] == 0.0f) && (m[3][2] == 0.0f) && (m[3][3] == 1.0f));
+
+    // Inverse of the top left 3x3 using the cofactors
+    float c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+    float c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+    float c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+
+    float det = m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02;
+
+    if (det == 0.0f) {
+        assert(0);
+        return *this;
+    }
+
+    float invdet = 1.0f / det;
+
+    Matrix4f res;
+    res.m[0][0] = c00 * invdet;
+    res.m[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * invdet;
+    res.m[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * invdet;
+    res.m[1][0] = c01 * invdet;
+    res.m[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * invdet;
+    res.m[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * invdet;
+    res.m[2][0] = c02 * invdet;
+    res.m[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * invdet;
+    res.m[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * invdet;
+
+    // The translation is the original translation rotated and scaled back
+    for (int i = 0 ; i < 3 ; i++) {
+        res.m[i][3] = -(res.m[i][0] * m[0][3] + res.m[i][1] * m[1][3] + res.m[i][2] * m[2][3]);
+    }
+
+    res.m[3][0] = 0.0f;
+    res.m[3][1] = 0.0f;
+    res.m[3][2] = 0.0f;
+    res.m[3][3] = 1.0f;
+
+    return res;
+}
+
+
+void Matrix4f::TransformVectors(const Vector4f* pIn, Vector4f* pOut, uint Count) const
+{
+#ifdef OGLDEV_SIMD_SCALAR
+    for (uint i = 0 ; i < Count ; i++) {
+        pOut[i] = *this * pIn[i];
+    }
+#else
+    Float4 c0 = Load4(m[0]);
+    Float4 c1 = Load4(m[1]);
+    Float4 c2 = Load4(m[2]);
+    Float4 c3 = Load4(m[3]);
+
+    Transpose4(c0, c1, c2, c3);
+
+    for (uint i = 0 ; i < Count ; i++) {
+        const Vector4f& v = pIn[i];
+        Float4 Res = Mul4(c0, Set4(v.x));
+        Res = MulAdd4(c1, Set4(v.y), Res);
+        Res = MulAdd4(c2, Set4(v.z), Res);
+        Res = MulAdd4(c3, Set4(v.w), Res);
+        Store4(&pOut[i].x, Res);
+    }
+#endif
+}
+
+
 void Matrix4f::CalcClipPlanes(Vector4f& l, Vector4f& r, Vector4f& b, Vector4f& t, Vector4f& n, Vector4f& f) const
 {
     Vector4f Row1(m[0][0], m[0][1], m[0][2], m[0][3]);
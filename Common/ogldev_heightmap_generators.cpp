@@ -0,0 +1,366 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+
+#include "ogldev_math_3d.h"
+#include "ogldev_heightmap_generators.h"
+#include "ogldev_counter_rng.h"
+#include "ogldev_parallel_for.h"
+#include "ogldev_simd.h"
+
+
+/////////////////////////////////////
+// Midpoint displacement
+/////////////////////////////////////
+
+//
+// Every vertex gets its value exactly once - in the diamond step of the level where
+// it is the center of a square or in the square step where it is the middle of an
+// edge. Both steps only read vertices from previous steps, so the rows of a step can
+// be split between threads freely and the index of the vertex is a unique counter
+// for the random number generator.
+//
+static void DiamondStep(float* pHeights, int GridSize, int RectSize, float CurHeight, const CounterRNG& Rng, int NumThreads)
+{
+    int HalfRectSize = RectSize / 2;
+    int NumRows = (GridSize - 1) / RectSize;
+
+    ParallelFor(NumRows, [&](int Begin, int End) {
+        for (int r = Begin ; r < End ; r++) {
+            int y = r * RectSize + HalfRectSize;
+            float* pRow = pHeights + (size_t)y * GridSize;
+            const float* pTop = pRow - (size_t)HalfRectSize * GridSize;
+            const float* pBottom = pRow + (size_t)HalfRectSize * GridSize;
+
+            for (int x = HalfRectSize ; x < GridSize ; x += RectSize) {
+                float Corners = pTop[x - HalfRectSize] + pTop[x + HalfRectSize] +
+                                pBottom[x - HalfRectSize] + pBottom[x + HalfRectSize];
+
+                size_t Index = (size_t)y * GridSize + x;
+
+                pRow[x] = Corners / 4.0f + Rng.GetFloatRange(Index, -CurHeight, CurHeight);
+            }
+        }
+    }, NumThreads);
+}
+
+
+static void SquareStep(float* pHeights, int GridSize, int RectSize, float CurHeight, const CounterRNG& Rng, int NumThreads)
+{
+    int HalfRectSize = RectSize / 2;
+    int NumRows = (GridSize - 1) / HalfRectSize + 1;
+
+    ParallelFor(NumRows, [&](int Begin, int End) {
+        for (int r = Begin ; r < End ; r++) {
+            int y = r * HalfRectSize;
+            float* pRow = pHeights + (size_t)y * GridSize;
+
+            // The rows of the corners need the middle of the horizontal edges, the rows
+            // of the centers need the middle of the vertical edges
+            int StartX = (r % 2 == 0) ? HalfRectSize : 0;
+
+            for (int x = StartX ; x < GridSize ; x += RectSize) {
+                float Sum = 0.0f;
+                int Count = 0;
+
+                if (x >= HalfRectSize) {
+                    Sum += pRow[x - HalfRectSize];
+                    Count++;
+                }
+
+                if (x + HalfRectSize < GridSize) {
+                    Sum += pRow[x + HalfRectSize];
+                    Count++;
+                }
+
+                if (y >= HalfRectSize) {
+                    Sum += pRow[x - (size_t)HalfRectSize * GridSize];
+                    Count++;
+                }
+
+                if (y + HalfRectSize < GridSize) {
+                    Sum += pRow[x + (size_t)HalfRectSize * GridSize];
+                    Count++;
+                }
+
+                size_t Index = (size_t)y * GridSize + x;
+
+                pRow[x] = Sum / (float)Count + Rng.GetFloatRange(Index, -CurHeight, CurHeight);
+            }
+        }
+    }, NumThreads);
+}
+
+
+static void MidpointDisplacement(float* pHeights, int GridSize, float Roughness, unsigned int Seed, int NumThreads)
+{
+    CounterRNG Rng(Seed);
+
+    int RectSize = GridSize - 1;
+    float CurHeight = (float)RectSize / 2.0f;
+    float HeightReduce = powf(2.0f, -Roughness);
+
+    while (RectSize > 1) {
+        DiamondStep(pHeights, GridSize, RectSize, CurHeight, Rng, NumThreads);
+
+        SquareStep(pHeights, GridSize, RectSize, CurHeight, Rng, NumThreads);
+
+        RectSize /= 2;
+        CurHeight *= HeightReduce;
+    }
+}
+
+
+void GenerateMidpointDisplacement(Array2D<float>& HeightMap, int Size, float Roughness, unsigned int Seed, int NumThreads)
+{
+    if (Size < 2) {
+        printf("%s:%d - invalid terrain size %d\n", __FILE__, __LINE__, Size);
+        exit(0);
+    }
+
+    if (Roughness < 0.0f) {
+        printf("%s: roughness must be positive - %f\n", __FUNCTION__, Roughness);
+        exit(0);
+    }
+
+    int GridSize = CalcNextPowerOfTwo(Size - 1) + 1;
+
+    HeightMap.InitArray2D(Size, Size, 0.0f);
+
+    if (GridSize == Size) {
+        MidpointDisplacement(HeightMap.GetBaseAddr(), GridSize, Roughness, Seed, NumThreads);
+        return;
+    }
+
+    std::vector<float> Grid((size_t)GridSize * GridSize, 0.0f);
+
+    MidpointDisplacement(Grid.data(), GridSize, Roughness, Seed, NumThreads);
+
+    for (int y = 0 ; y < Size ; y++) {
+        memcpy(HeightMap.GetAddr(0, y), &Grid[(size_t)y * GridSize], Size * sizeof(float));
+    }
+}
+
+
+/////////////////////////////////////
+// Fault formation
+/////////////////////////////////////
+
+struct Fault {
+    int x = 0;      // first point on the fault line
+    int z = 0;
+    int DirX = 0;   // from the first point to the second one
+    int DirZ = 0;
+    float Height = 0.0f;
+};
+
+
+static long long FloorDiv(long long a, long long b)
+{
+    long long q = a / b;
+
+    if (((a % b) != 0) && ((a < 0) != (b < 0))) {
+        q--;
+    }
+
+    return q;
+}
+
+
+static void GenFaults(std::vector<Fault>& Faults, int Size, int Iterations, float MinHeight, float MaxHeight, unsigned int Seed)
+{
+    CounterRNG Rng(Seed);
+
+    float DeltaHeight = MaxHeight - MinHeight;
+
+    Faults.resize(Iterations);
+
+    for (int CurIter = 0 ; CurIter < Iterations ; CurIter++) {
+        Fault& f = Faults[CurIter];
+
+        float IterationRatio = ((float)CurIter / (float)Iterations);
+        f.Height = MaxHeight - IterationRatio * DeltaHeight;
+
+        // Four numbers per attempt, retry until the two points are different
+        unsigned long long Counter = (unsigned long long)CurIter << 32;
+        int x2 = 0, z2 = 0;
+        int Attempt = 0;
+
+        do {
+            f.x = Rng.GetUInt(Counter++) % Size;
+            f.z = Rng.GetUInt(Counter++) % Size;
+            x2 = Rng.GetUInt(Counter++) % Size;
+            z2 = Rng.GetUInt(Counter++) % Size;
+
+            if (Attempt++ == 1000) {
+                printf("Endless loop detected in %s:%d\n", __FILE__, __LINE__);
+                exit(0);
+            }
+        } while ((f.x == x2) && (f.z == z2));
+
+        f.DirX = x2 - f.x;
+        f.DirZ = z2 - f.z;
+    }
+}
+
+
+//
+// A cell is raised when it is on the positive side of the fault line:
+//
+//     (x - p1.x) * DirZ - DirX * (z - p1.z) > 0
+//
+// Along a row this is linear in x so the raised cells are a prefix or a suffix of the row.
+// Each fault adds its height at the start of the range and subtracts it after the end
+// and a running sum over the row gives the final heights - O(Size) per fault per row
+// instead of testing every cell.
+//
+static void AddFaultsToRow(float* pRow, int z, int Size, const std::vector<Fault>& Faults, std::vector<float>& Delta)
+{
+    Delta.assign(Size + 1, 0.0f);
+
+    for (const Fault& f : Faults) {
+        // Cross = x * DirZ + C
+        long long C = -(long long)f.x * f.DirZ - (long long)f.DirX * (z - f.z);
+
+        int Start = 0;
+        int End = 0;
+
+        if (f.DirZ > 0) {
+            // x > -C / DirZ
+            Start = (int)std::min(std::max(FloorDiv(-C, f.DirZ) + 1, 0ll), (long long)Size);
+            End = Size;
+        } else if (f.DirZ < 0) {
+            // x < C / -DirZ
+            Start = 0;
+            End = (int)std::min(std::max(-FloorDiv(-C, -f.DirZ), 0ll), (long long)Size);
+        } else if (C > 0) {
+            Start = 0;
+            End = Size;
+        }
+
+        if (Start < End) {
+            Delta[Start] += f.Height;
+            Delta[End] -= f.Height;
+        }
+    }
+
+    float Sum = 0.0f;
+
+    for (int x = 0 ; x < Size ; x++) {
+        Sum += Delta[x];
+        pRow[x] += Sum;
+    }
+}
+
+
+//
+// The horizontal passes run each row on a single thread. The vertical passes run
+// along the rows for a band of columns at a time so they can use the SIMD lanes.
+// The bands are multiples of four so the same columns always take the scalar path.
+//
+static void ApplyFIRFilter(float* pHeights, int Size, float Filter, int NumThreads)
+{
+    float OneMinusFilter = 1.0f - Filter;
+
+    ParallelFor(Size, [&](int Begin, int End) {
+        for (int z = Begin ; z < End ; z++) {
+            float* pRow = pHeights + (size_t)z * Size;
+
+            // left to right
+            float PrevVal = pRow[0];
+
+            for (int x = 1 ; x < Size ; x++) {
+                PrevVal = Filter * PrevVal + OneMinusFilter * pRow[x];
+                pRow[x] = PrevVal;
+            }
+
+            // right to left
+            PrevVal = pRow[Size - 1];
+
+            for (int x = Size - 2 ; x >= 0 ; x--) {
+                PrevVal = Filter * PrevVal + OneMinusFilter * pRow[x];
+                pRow[x] = PrevVal;
+            }
+        }
+    }, NumThreads);
+
+    int NumGroups = (Size + 3) / 4;
+
+    ParallelFor(NumGroups, [&](int Begin, int End) {
+        int StartX = Begin * 4;
+        int EndX = std::min(End * 4, Size);
+        int EndSimdX = StartX + ((EndX - StartX) / 4) * 4;
+
+        Float4 VecFilter = Set4(Filter);
+        Float4 VecOneMinusFilter = Set4(OneMinusFilter);
+
+        // bottom to top, then top to bottom. The previous value is the row that was just written.
+        for (int Pass = 0 ; Pass < 2 ; Pass++) {
+            for (int i = 1 ; i < Size ; i++) {
+                int z = (Pass == 0) ? i : Size - 1 - i;
+                int PrevZ = (Pass == 0) ? z - 1 : z + 1;
+
+                float* pRow = pHeights + (size_t)z * Size;
+                const float* pPrevRow = pHeights + (size_t)PrevZ * Size;
+
+                int x = StartX;
+
+                for ( ; x < EndSimdX ; x += 4) {
+                    Float4 Val = Add4(Mul4(VecFilter, Load4(pPrevRow + x)), Mul4(VecOneMinusFilter, Load4(pRow + x)));
+                    Store4(pRow + x, Val);
+                }
+
+                for ( ; x < EndX ; x++) {
+                    pRow[x] = Filter * pPrevRow[x] + OneMinusFilter * pRow[x];
+                }
+            }
+        }
+    }, NumThreads);
+}
+
+
+void GenerateFaultFormation(Array2D<float>& HeightMap, int Size, int Iterations, float MinHeight, float MaxHeight,
+                            float Filter, unsigned int Seed, int NumThreads)
+{
+    if (Size < 2) {
+        printf("%s:%d - invalid terrain size %d\n", __FILE__, __LINE__, Size);
+        exit(0);
+    }
+
+    HeightMap.InitArray2D(Size, Size, 0.0f);
+
+    std::vector<Fault> Faults;
+    GenFaults(Faults, Size, Iterations, MinHeight, MaxHeight, Seed);
+
+    float* pHeights = HeightMap.GetBaseAddr();
+
+    ParallelFor(Size, [&](int Begin, int End) {
+        std::vector<float> Delta;
+
+        for (int z = Begin ; z < End ; z++) {
+            AddFaultsToRow(pHeights + (size_t)z * Size, z, Size, Faults, Delta);
+        }
+    }, NumThreads);
+
+    ApplyFIRFilter(pHeights, Size, Filter, NumThreads);
+}
@@ -0,0 +1,176 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include <algorithm>
+
+#include "ogldev_heightmap_sampling.h"
+#include "ogldev_parallel_for.h"
+#include "ogldev_simd.h"
+
+
+static inline Vector3f NormalFromSlopes(float SlopeX, float SlopeZ)
+{
+    Vector3f Normal(-SlopeX, 1.0f, -SlopeZ);
+    float InvLength = 1.0f / sqrtf(SlopeX * SlopeX + 1.0f + SlopeZ * SlopeZ);
+
+    return Normal * InvLength;
+}
+
+
+// Normalizes (-SlopeX, 1, -SlopeZ) for four samples and writes them into pNormals
+static inline void StoreNormals4(Float4 SlopeX, Float4 SlopeZ, Vector3f* pNormals)
+{
+    Float4 One = Set4(1.0f);
+    Float4 LengthSq = MulAdd4(SlopeX, SlopeX, MulAdd4(SlopeZ, SlopeZ, One));
+    Float4 InvLength = Div4(One, Sqrt4(LengthSq));
+
+    float x[4], y[4], z[4];
+    Store4(x, Mul4(Sub4(Set4(0.0f), SlopeX), InvLength));
+    Store4(y, InvLength);
+    Store4(z, Mul4(Sub4(Set4(0.0f), SlopeZ), InvLength));
+
+    for (int i = 0 ; i < 4 ; i++) {
+        pNormals[i] = Vector3f(x[i], y[i], z[i]);
+    }
+}
+
+
+static void CalcNormalsRow(const Array2D<float>& HeightMap, float WorldScale, int z, Vector3f* pNormals)
+{
+    int Width = HeightMap.GetWidth();
+    int Depth = HeightMap.GetHeight();
+
+    int zPrev = std::max(z - 1, 0);
+    int zNext = std::min(z + 1, Depth - 1);
+
+    const float* pRow = HeightMap.GetAddr(0, z);
+    const float* pRowPrev = HeightMap.GetAddr(0, zPrev);
+    const float* pRowNext = HeightMap.GetAddr(0, zNext);
+
+    float InvDistX = 1.0f / (2.0f * WorldScale);
+    float InvDistZ = (zNext > zPrev) ? 1.0f / ((float)(zNext - zPrev) * WorldScale) : 0.0f;
+
+    Vector3f* pRowNormals = pNormals + (size_t)z * Width;
+
+    if (Width < 2) {
+        for (int x = 0 ; x < Width ; x++) {
+            pRowNormals[x] = NormalFromSlopes(0.0f, (pRowNext[x] - pRowPrev[x]) * InvDistZ);
+        }
+        return;
+    }
+
+    // One sided differences on the left and right columns
+    pRowNormals[0] = NormalFromSlopes((pRow[1] - pRow[0]) / WorldScale, (pRowNext[0] - pRowPrev[0]) * InvDistZ);
+
+    int Last = Width - 1;
+    pRowNormals[Last] = NormalFromSlopes((pRow[Last] - pRow[Last - 1]) / WorldScale,
+                                         (pRowNext[Last] - pRowPrev[Last]) * InvDistZ);
+
+    Float4 InvDistX4 = Set4(InvDistX);
+    Float4 InvDistZ4 = Set4(InvDistZ);
+
+    int x = 1;
+
+    for ( ; x + 4 <= Last ; x += 4) {
+        Float4 SlopeX = Mul4(Sub4(Load4(pRow + x + 1), Load4(pRow + x - 1)), InvDistX4);
+        Float4 SlopeZ = Mul4(Sub4(Load4(pRowNext + x), Load4(pRowPrev + x)), InvDistZ4);
+        StoreNormals4(SlopeX, SlopeZ, pRowNormals + x);
+    }
+
+    for ( ; x < Last ; x++) {
+        pRowNormals[x] = NormalFromSlopes((pRow[x + 1] - pRow[x - 1]) * InvDistX, (pRowNext[x] - pRowPrev[x]) * InvDistZ);
+    }
+}
+
+
+void CalcHeightMapNormals(const Array2D<float>& HeightMap, float WorldScale, Vector3f* pNormals, int NumThreads)
+{
+    ParallelFor(HeightMap.GetHeight(), [&](int Begin, int End) {
+        for (int z = Begin ; z < End ; z++) {
+            CalcNormalsRow(HeightMap, WorldScale, z, pNormals);
+        }
+    }, NumThreads);
+}
+
+
+void GetHeightsAndNormals(const Array2D<float>& HeightMap, float WorldScale, int Count,
+                          const Vector2f* pPositions, float* pHeights, Vector3f* pNormals)
+{
+    int MaxX = HeightMap.GetWidth() - 1;
+    int MaxZ = HeightMap.GetHeight() - 1;
+    float InvWorldScale = 1.0f / WorldScale;
+    Float4 InvWorldScale4 = Set4(InvWorldScale);
+
+    for (int Base = 0 ; Base < Count ; Base += 4) {
+        int n = std::min(Count - Base, 4);
+
+        // Gather the four corners of the cell of every query. The unused lanes
+        // of the last group repeat the first query.
+        float h00[4], h10[4], h01[4], h11[4], FactorX[4], FactorZ[4];
+
+        for (int i = 0 ; i < 4 ; i++) {
+            const Vector2f& Pos = pPositions[Base + ((i < n) ? i : 0)];
+
+            float x = std::min(std::max(Pos.x * InvWorldScale, 0.0f), (float)MaxX);
+            float z = std::min(std::max(Pos.y * InvWorldScale, 0.0f), (float)MaxZ);
+
+            int x0 = std::min((int)x, std::max(MaxX - 1, 0));
+            int z0 = std::min((int)z, std::max(MaxZ - 1, 0));
+            int x1 = std::min(x0 + 1, MaxX);
+            int z1 = std::min(z0 + 1, MaxZ);
+
+            h00[i] = HeightMap.Get(x0, z0);
+            h10[i] = HeightMap.Get(x1, z0);
+            h01[i] = HeightMap.Get(x0, z1);
+            h11[i] = HeightMap.Get(x1, z1);
+            FactorX[i] = x - (float)x0;
+            FactorZ[i] = z - (float)z0;
+        }
+
+        Float4 H00 = Load4(h00);
+        Float4 H10 = Load4(h10);
+        Float4 H01 = Load4(h01);
+        Float4 H11 = Load4(h11);
+        Float4 Fx = Load4(FactorX);
+        Float4 Fz = Load4(FactorZ);
+
+        Float4 Bottom = Lerp4(H00, H10, Fx);
+        Float4 Top = Lerp4(H01, H11, Fx);
+
+        float Heights[4];
+        Store4(Heights, Lerp4(Bottom, Top, Fz));
+
+        for (int i = 0 ; i < n ; i++) {
+            pHeights[Base + i] = Heights[i];
+        }
+
+        if (pNormals) {
+            // The derivatives of the bilinear surface along X and Z
+            Float4 SlopeX = Mul4(Lerp4(Sub4(H10, H00), Sub4(H11, H01), Fz), InvWorldScale4);
+            Float4 SlopeZ = Mul4(Sub4(Top, Bottom), InvWorldScale4);
+
+            Vector3f Normals[4];
+            StoreNormals4(SlopeX, SlopeZ, Normals);
+
+            for (int i = 0 ; i < n ; i++) {
+                pNormals[Base + i] = Normals[i];
+            }
+        }
+    }
+}
@@ -113,6 +113,96 @@ void Texture::LoadRaw(int Width, int Height, int BPP, const unsigned char* pImag
 }
 
 
+void Texture::LoadRawMipmaps(int Width, int Height, int BPP, int NumLevels, const unsigned char* const* ppLevels)
+{
+    m_imageWidth = Width;
+    m_imageHeight = Height;
+    m_imageBPP = BPP;
+
+    if (m_textureTarget != GL_TEXTURE_2D) {
+        printf("Support for texture target %x is not implemented\n", m_textureTarget);
+        exit(1);
+    }
+
+    GLenum InternalFormat, Format;
+    GetRawFormat(InternalFormat, Format);
+
+    // The rows of the small mipmaps of an RGB image are not aligned to four bytes
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    if (IsGLVersionHigher(4, 5)) {
+        glCreateTextures(m_textureTarget, 1, &m_textureObj);
+        glTextureStorage2D(m_textureObj, NumLevels, InternalFormat, Width, Height);
+
+        for (int Level = 0 ; Level < NumLevels ; Level++) {
+            int LevelWidth = std::max(Width >> Level, 1);
+            int LevelHeight = std::max(Height >> Level, 1);
+            glTextureSubImage2D(m_textureObj, Level, 0, 0, LevelWidth, LevelHeight, Format, GL_UNSIGNED_BYTE, ppLevels[Level]);
+        }
+
+        glTextureParameteri(m_textureObj, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTextureParameteri(m_textureObj, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(m_textureObj, GL_TEXTURE_BASE_LEVEL, 0);
+        glTextureParameteri(m_textureObj, GL_TEXTURE_MAX_LEVEL, NumLevels - 1);
+        glTextureParameteri(m_textureObj, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTextureParameteri(m_textureObj, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTextureParameteri(m_textureObj, GL_TEXTURE_MAX_ANISOTROPY, 16);
+
+        m_bindlessHandle = glGetTextureHandleARB(m_textureObj);
+        glMakeTextureHandleResidentARB(m_bindlessHandle);
+    } else {
+        glGenTextures(1, &m_textureObj);
+        glBindTexture(m_textureTarget, m_textureObj);
+
+        for (int Level = 0 ; Level < NumLevels ; Level++) {
+            int LevelWidth = std::max(Width >> Level, 1);
+            int LevelHeight = std::max(Height >> Level, 1);
+            glTexImage2D(m_textureTarget, Level, InternalFormat, LevelWidth, LevelHeight, 0, Format, GL_UNSIGNED_BYTE, ppLevels[Level]);
+        }
+
+        glTexParameteri(m_textureTarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(m_textureTarget, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(m_textureTarget, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(m_textureTarget, GL_TEXTURE_MAX_LEVEL, NumLevels - 1);
+        glTexParameteri(m_textureTarget, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(m_textureTarget, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+        glBindTexture(m_textureTarget, 0);
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+
+void Texture::GetRawFormat(GLenum& InternalFormat, GLenum& Format) const
+{
+    switch (m_imageBPP) {
+    case 1:
+        InternalFormat = GL_R8;
+        Format = GL_RED;
+        break;
+
+    case 2:
+        InternalFormat = GL_RG8;
+        Format = GL_RG;
+        break;
+
+    case 3:
+        InternalFormat = GL_RGB8;
+        Format = GL_RGB;
+        break;
+
+    case 4:
+        InternalFormat = GL_RGBA8;
+        Format = GL_RGBA;
+        break;
+
+    default:
+        NOT_IMPLEMENTED;
+    }
+}
+
+
 void Texture::LoadInternal(const void* pImageData)
 {
     if (IsGLVersionHigher(4, 5)) {
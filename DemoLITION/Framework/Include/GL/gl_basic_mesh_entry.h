@@ -20,6 +20,7 @@
 #pragma once
 
 #include "ogldev_math_3d.h"
+#include "Int/core_culling.h"
 
 struct BasicMeshEntry {
     uint NumIndices = 0;
@@ -28,4 +29,5 @@ struct BasicMeshEntry {
     uint ValidFaces = 0;
     uint MaterialIndex = 0xFFFFFFFF;
     Matrix4f Transformation;
+    BoundingVolume Bounds;      // in the local space of the mesh (before Transformation)
 };
@@ -33,6 +33,7 @@
 #include "GL/gl_picking_technique.h"
 #include "GL/gl_infinite_grid.h"
 #include "GL/gl_skybox.h"
+#include "Int/core_culling.h"
 
 
 enum RENDER_PASS {
@@ -43,7 +44,8 @@ enum RENDER_PASS {
     RENDER_PASS_SHADOW_DIR = 4,    
     RENDER_PASS_SHADOW_SPOT = 5,
     RENDER_PASS_SHADOW_POINT = 6,
-    RENDER_PASS_PICKING = 7
+    RENDER_PASS_PICKING = 7,
+    NUM_RENDER_PASSES = 8
 };
 
 
@@ -90,6 +92,13 @@ class ForwardRenderer : public DemolitionRenderCallbacks {
 
     void Render(void* pWindow, GLScene* pScene, GameCallbacks* pGameCallbacks, long long TotalRuntimeMillis, long long DeltaTimeMillis);
 
+    // Frustum culling results of the last frame. Objects are tested against the frustum
+    // of the camera or the light and meshes are tested only when their object is visible
+    // (and only when indirect rendering is disabled).
+    const CullingStats& GetObjectCullingStats(RENDER_PASS RenderPass) const { return m_objectCullingStats[RenderPass]; }
+
+    const CullingStats& GetMeshCullingStats(RENDER_PASS RenderPass) const { return m_meshCullingStats[RenderPass]; }
+
    // void RenderAnimation(SkinnedMesh* pMesh, float AnimationTimeSec, int AnimationIndex = 0);
 
  /*   void RenderAnimationBlended(SkinnedMesh* pMesh,
@@ -108,19 +117,23 @@ class ForwardRenderer : public DemolitionRenderCallbacks {
     virtual void SetMaterial_CB(const Material& material);
 
     virtual void SetWorldMatrix_CB(const Matrix4f& World);
+
+    virtual bool IsMeshVisible_CB(uint MeshIndex);
  
 private:
 
+    void CPUPicking(void* pWindow, GLScene* pScene);
     void PickingPass(void* pWindow, GLScene* pScene);
     void PickingRenderScene(GLScene* pScene);
     int GetPickedObjectIndex(void* pWindow, GLScene* pScene);
     void PostPickingPass(void* pWindow, GLScene* pScene);
     void SavePickedObject(GLScene* pScene, int ObjectIndex);
     void ShadowMapPass(GLScene* pScene);
-    void ShadowMapPassPoint(const std::list<CoreSceneObject*>& RenderList, const std::vector<PointLight>& PointLights);
-    void ShadowMapPassDirAndSpot(const std::list<CoreSceneObject*>& RenderList);
+    void ShadowMapPassPoint(GLScene* pScene, const std::vector<PointLight>& PointLights);
+    void ShadowMapPassDirAndSpot(GLScene* pScene);
     void LightingPass(GLScene* pScene, long long TotalRuntimeMillis);
-    void RenderWithForwardLighting(CoreSceneObject* pSceneObject, long long TotalRuntimeMillis);
+    void CalcBoneTransforms(long long TotalRuntimeMillis);
+    void RenderWithForwardLighting(CoreSceneObject* pSceneObject, const Matrix4f* pBoneTransforms);
     void RenderWithFlatColor(CoreSceneObject* pSceneObject);
     void StartRenderWithForwardLighting(GLScene* pScene, CoreSceneObject* pSceneObject, long long TotalRuntimeMillis);
     void RenderInfiniteGrid(GLScene* pScene);
@@ -135,9 +148,11 @@ private:
     void SetWorldMatrix_CB_ShadowPassPoint(const Matrix4f& World);
     void SetWorldMatrix_CB_LightingPass(const Matrix4f& World);
     void SetWorldMatrix_CB_PickingPass(const Matrix4f& World);
-    void RenderEntireRenderList(const std::list<CoreSceneObject*>& RenderList);
+    void RenderVisibleObjects();
     Matrix4f GetViewProjectionMatrix();
     void RenderSingleObject(CoreSceneObject* pSceneObject);
+    void StartCulling(GLScene* pScene);
+    void CullRenderList(GLScene* pScene, const Matrix4f& VP);
 
     int m_windowWidth = -1;
     int m_windowHeight = -1;
@@ -168,5 +183,21 @@ private:
     InfiniteGrid m_infiniteGrid;
 
     SkyBox m_skybox;
+
+    // Culling stuff
+    bool m_cullingEnabled = true;
+    ViewFrustum m_cullingFrustum;
+    std::vector<CoreSceneObject*> m_visibleObjects;
+    CullingStats m_objectCullingStats[NUM_RENDER_PASSES];
+    CullingStats m_meshCullingStats[NUM_RENDER_PASSES];
+
+    // Bone transforms of the visible animated objects of the lighting pass. The bone
+    // transforms of m_visibleObjects[i] start at m_boneTransforms[m_boneTransformsOffsets[i]].
+    std::vector<Matrix4f> m_boneTransforms;
+    std::vector<int> m_boneTransformsOffsets;
+    std::vector<int> m_animatedObjects;        // indices into m_visibleObjects sorted by model
+    std::vector<uint> m_batchAnimationIndices;
+    std::vector<float> m_batchTimes;
+    std::vector<AnimationSamplingState*> m_batchStates;
 };
 
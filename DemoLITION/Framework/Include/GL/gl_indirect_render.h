@@ -35,7 +35,8 @@ public:
 
     void Init(const std::vector<BasicMeshEntry>& Meshes, std::vector<Material>& Materials);
 
-    void Render(const Matrix4f& ObjectMatrix);
+    // NormalMatrix is the inverse transpose of ObjectMatrix
+    void Render(const Matrix4f& ObjectMatrix, const Matrix4f& NormalMatrix);
 
 private:
 
@@ -45,7 +46,7 @@ private:
 
     void AllocPerObjectBuffer(const std::vector<BasicMeshEntry>& Meshes);
 
-    void UpdatePerObjectData(const Matrix4f& ObjectMatrix);
+    void UpdatePerObjectData(const Matrix4f& ObjectMatrix, const Matrix4f& NormalMatrix);
 
     void PrepareIndirectRenderMaterials(std::vector<Material>& Materials);
 
@@ -67,6 +68,7 @@ private:
 
     struct Mesh {
         Matrix4f m_transformation;
+        Matrix4f m_normalTransformation;    // inverse transpose of m_transformation
         int m_materialIndex = 0;
     };
 
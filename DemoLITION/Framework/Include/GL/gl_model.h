@@ -44,7 +44,7 @@ public:
 
     virtual Texture* AllocTexture2D();
 
-    void RenderIndirect(const Matrix4f& ObjectMatrix);
+    void RenderIndirect(const Matrix4f& ObjectMatrix, const Matrix4f& NormalMatrix);
 
     Texture* GetNormalMap() const { return m_pNormalMap; }
 
@@ -54,25 +54,25 @@ protected:
 
     virtual void AllocBuffers();
 
-    virtual void PopulateBuffersSkinned(vector<SkinnedVertex>& Vertices);
+    virtual void PopulateBuffersSkinned(const SkinnedVertex* pVertices, uint NumVertices, const uint* pIndices, uint NumIndices);
 
-    virtual void PopulateBuffers(vector<Vertex>& Vertices);
+    virtual void PopulateBuffers(const Vertex* pVertices, uint NumVertices, const uint* pIndices, uint NumIndices);
 
     virtual void InitGeometryPost();
 
 private:
 
     template<typename VertexType>
-    void PopulateBuffersInternal(vector<VertexType>& Vertices);
+    void PopulateBuffersInternal(const VertexType* pVertices, uint NumVertices, const uint* pIndices, uint NumIndices);
 
     template<typename VertexType>
-    void PopulateBuffersPVP(vector<VertexType>& Vertices);
+    void PopulateBuffersPVP(const VertexType* pVertices, uint NumVertices, const uint* pIndices, uint NumIndices);
 
     template<typename VertexType>
-    void PopulateBuffersNonDSA(vector<VertexType>& Vertices);
+    void PopulateBuffersNonDSA(const VertexType* pVertices, uint NumVertices, const uint* pIndices, uint NumIndices);
 
     template<typename VertexType>
-    void PopulateBuffersDSA(vector<VertexType>& Vertices);
+    void PopulateBuffersDSA(const VertexType* pVertices, uint NumVertices, const uint* pIndices, uint NumIndices);
 
     void SetupRenderMaterialsPBR();
 
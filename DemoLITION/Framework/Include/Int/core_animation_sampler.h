@@ -0,0 +1,103 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <assert.h>
+#include <algorithm>
+#include <vector>
+
+#include "ogldev_types.h"
+#include "ogldev_math_3d.h"
+
+
+// The last key segment used on each of the key arrays of an animation channel
+struct KeyframeCursor
+{
+    uint Position = 0;
+    uint Rotation = 0;
+    uint Scaling = 0;
+};
+
+
+// Animation sampling state of a single animated instance. Between frames the
+// animation time usually moves forward by less than a key segment so
+// remembering where we were makes finding the current key O(1). Instances
+// that share a model should each have their own state and then they can be
+// sampled on different threads.
+struct AnimationSamplingState
+{
+    std::vector<KeyframeCursor> Cursors;        // one per skeleton node per animation
+    std::vector<Matrix4f> GlobalTransforms;     // scratch, one per skeleton node
+};
+
+
+template<typename KeyType>
+bool IsTimeInKeySegment(const KeyType* pKeys, uint Segment, float AnimationTimeTicks)
+{
+    // The first segment also covers the time before the first key
+    return ((Segment == 0) || (AnimationTimeTicks >= (float)pKeys[Segment].mTime)) &&
+           (AnimationTimeTicks < (float)pKeys[Segment + 1].mTime);
+}
+
+
+#define KEYFRAME_CURSOR_MAX_STEPS 4
+
+
+// Returns the first index i for which AnimationTimeTicks < pKeys[i + 1].mTime, or zero
+// if there is no such key. The cursor is checked first along with the few segments that
+// follow it and if the time is in none of them we fall back to binary search (after a seek
+// or when the animation loops). KeyType is aiVectorKey or aiQuatKey.
+template<typename KeyType>
+uint FindKeyframe(const KeyType* pKeys, uint NumKeys, float AnimationTimeTicks, uint& Cursor)
+{
+    assert(NumKeys > 1);
+
+    uint LastSegment = NumKeys - 2;
+
+    if (Cursor <= LastSegment) {
+        // Dense clips can advance by a few keys per frame so we walk forward
+        // a bit before giving up on the cursor
+        uint LastCandidate = std::min(Cursor + KEYFRAME_CURSOR_MAX_STEPS, LastSegment);
+
+        for (uint i = Cursor ; i <= LastCandidate ; i++) {
+            if (IsTimeInKeySegment(pKeys, i, AnimationTimeTicks)) {
+                Cursor = i;
+                return Cursor;
+            }
+        }
+    }
+
+    // Find the first key after the time
+    uint Low = 1;
+    uint High = NumKeys;
+
+    while (Low < High) {
+        uint Mid = (Low + High) / 2;
+
+        if (AnimationTimeTicks < (float)pKeys[Mid].mTime) {
+            High = Mid;
+        } else {
+            Low = Mid + 1;
+        }
+    }
+
+    Cursor = (Low < NumKeys) ? Low - 1 : 0;
+
+    return Cursor;
+}
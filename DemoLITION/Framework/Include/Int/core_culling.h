@@ -0,0 +1,134 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <algorithm>
+
+#include "ogldev_math_3d.h"
+
+//
+// CPU side visibility tests. Nothing here depends on the graphics API so it can be
+// used by the renderers and tested on its own.
+//
+
+// Axis aligned box plus the sphere around it. The sphere is used for a cheap
+// first test and the box only when the sphere intersects a frustum plane.
+struct BoundingVolume
+{
+    Vector3f Min = Vector3f(FLT_MAX, FLT_MAX, FLT_MAX);
+    Vector3f Max = Vector3f(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+    bool IsValid() const { return (Min.x <= Max.x) && (Min.y <= Max.y) && (Min.z <= Max.z); }
+
+    void Add(const Vector3f& p)
+    {
+        Min.x = std::min(Min.x, p.x);
+        Min.y = std::min(Min.y, p.y);
+        Min.z = std::min(Min.z, p.z);
+
+        Max.x = std::max(Max.x, p.x);
+        Max.y = std::max(Max.y, p.y);
+        Max.z = std::max(Max.z, p.z);
+    }
+
+    // An invalid (empty) volume has Min > Max so this works for it as well
+    void Add(const BoundingVolume& Volume)
+    {
+        Min.x = std::min(Min.x, Volume.Min.x);
+        Min.y = std::min(Min.y, Volume.Min.y);
+        Min.z = std::min(Min.z, Volume.Min.z);
+
+        Max.x = std::max(Max.x, Volume.Max.x);
+        Max.y = std::max(Max.y, Volume.Max.y);
+        Max.z = std::max(Max.z, Volume.Max.z);
+    }
+
+    Vector3f GetCenter() const { return (Min + Max) * 0.5f; }
+
+    Vector3f GetExtents() const { return (Max - Min) * 0.5f; }
+
+    float GetRadius() const { return GetExtents().Length(); }
+
+    float GetSurfaceArea() const;
+
+    bool Contains(const BoundingVolume& Volume) const;
+
+    bool Overlaps(const BoundingVolume& Volume) const;
+
+    bool OverlapsSphere(const Vector3f& Center, float Radius) const;
+
+    // Slab test. InvDir is 1/Dir per component. On a hit Distance is the entry
+    // point along the ray (zero when the origin is inside the box).
+    bool IntersectsRay(const Vector3f& Origin, const Vector3f& InvDir, float MaxDistance, float& Distance) const;
+
+    // Returns the box that contains this box after the transformation
+    BoundingVolume Transform(const Matrix4f& m) const;
+};
+
+
+// Visible/culled counters of a single render pass
+struct CullingStats
+{
+    uint NumVisible = 0;
+    uint NumCulled = 0;
+
+    void Reset() { NumVisible = 0; NumCulled = 0; }
+};
+
+
+enum FRUSTUM_TEST {
+    FRUSTUM_OUTSIDE = 0,
+    FRUSTUM_INTERSECTS = 1,
+    FRUSTUM_INSIDE = 2
+};
+
+
+class ViewFrustum
+{
+public:
+    ViewFrustum() {}
+
+    ViewFrustum(const Matrix4f& ViewProj) { Update(ViewProj); }
+
+    // Extracts the six planes from a view projection matrix (OpenGL clip space)
+    void Update(const Matrix4f& ViewProj);
+
+    bool IsSphereVisible(const Vector3f& Center, float Radius) const;
+
+    bool IsBoxVisible(const BoundingVolume& Box) const;
+
+    // Like IsBoxVisible but also tells whether the box is entirely inside.
+    // Used by the hierarchical queries to stop testing a whole subtree.
+    FRUSTUM_TEST ClassifyBox(const BoundingVolume& Box) const;
+
+    // Volume is in world space
+    bool IsVisible(const BoundingVolume& Volume) const;
+
+    // Volume is in local space and World takes it to world space
+    bool IsVisible(const BoundingVolume& Volume, const Matrix4f& World) const;
+
+    // Same as above and updates the counters
+    bool IsVisible(const BoundingVolume& Volume, const Matrix4f& World, CullingStats& Stats) const;
+
+private:
+    enum { NUM_PLANES = 6 };
+
+    // xyz is the normal (pointing into the frustum) and w is the distance
+    Vector4f m_planes[NUM_PLANES];
+};
@@ -19,6 +19,7 @@
 #pragma once
 
 #include <map>
+#include <memory>
 #include <vector>
 
 #include <assimp/Importer.hpp>      // C++ importer interface
@@ -29,6 +30,9 @@
 #include "ogldev_glm_camera.h"
 #include "demolition_lights.h"
 #include "demolition_model.h"
+#include "Int/core_model_cache.h"
+#include "Int/core_animation_sampler.h"
+#include "Int/core_triangle_bvh.h"
 #include "GL\gl_basic_mesh_entry.h"
 
 
@@ -42,10 +46,21 @@ public:
     virtual void SetMaterial_CB(const Material& material) = 0;
 
     virtual void SetWorldMatrix_CB(const Matrix4f& World) = 0;
+
+    // Called before each mesh is drawn. Returning false skips the mesh.
+    virtual bool IsMeshVisible_CB(uint MeshIndex) { return true; }
 };
 
 class CoreRenderingSystem;
 
+struct LaneMatrix;     // see core_animation_batch.cpp
+
+struct ModelRayHit {
+    uint MeshIndex = 0;
+    uint Triangle = 0;          // index of the triangle inside the mesh
+    float Distance = FLT_MAX;   // in units of the length of the ray direction
+};
+
 class CoreModel : public Model
 {
 public:
@@ -65,6 +80,8 @@ public:
 
     uint NumBones() const { return (uint)m_BoneNameToIndexMap.size(); }
 
+    uint GetNumAnimations() const { return (uint)m_animations.size(); }
+
     // This is the main function to drive the animation. It receives the animation time
     // in seconds and a reference to a vector of transformation matrices (one matrix per bone).
     // It calculates the current transformation for each bone according to the current time
@@ -80,6 +97,30 @@ public:
                                   unsigned int EndAnimIndex,
                                   float BlendFactor);
 
+    // The versions above share a single sampling state inside the model. When several
+    // instances of the model are animated independently each should use its own state.
+    void GetBoneTransforms(float AnimationTimeSec, vector<Matrix4f>& Transforms, unsigned int AnimationIndex, AnimationSamplingState& State);
+
+    void GetBoneTransformsBlended(float AnimationTimeSec,
+                                  vector<Matrix4f>& Transforms,
+                                  unsigned int StartAnimIndex,
+                                  unsigned int EndAnimIndex,
+                                  float BlendFactor,
+                                  AnimationSamplingState& State);
+
+    // Calculates the bone transforms of many instances of the model in one call. Instance i
+    // plays animation pAnimationIndices[i] at time pTimesInSeconds[i] and its NumBones()
+    // matrices are written starting at pTransforms[i * NumBones()]. ppStates is optional
+    // (one state per instance so the states can live with the instances). The instances
+    // are processed in SIMD groups and optionally split between threads (see
+    // core_animation_batch.cpp).
+    void GetBoneTransformsBatch(uint NumInstances,
+                                const uint* pAnimationIndices,
+                                const float* pTimesInSeconds,
+                                Matrix4f* pTransforms,
+                                AnimationSamplingState** ppStates = NULL,
+                                bool Multithreaded = true);
+
     const std::vector<DirectionalLight>& GetDirLights() const { return m_dirLights; }
     const std::vector<SpotLight>& GetSpotLights() const { return m_spotLights; }
     const std::vector<PointLight>& GetPointLights() const { return m_pointLights; }
@@ -90,6 +131,21 @@ public:
 
     const Material* GetMaterialForMesh(int MeshIndex) const;
 
+    // Bounds of the entire model in model space (the mesh transformations are included)
+    const BoundingVolume& GetBounds() const { return m_bounds; }
+
+    uint GetNumMeshes() const { return (uint)m_Meshes.size(); }
+
+    // Bounds of a single mesh in its local space
+    const BoundingVolume& GetMeshBounds(uint MeshIndex) const { return m_Meshes[MeshIndex].Bounds; }
+
+    const Matrix4f& GetMeshTransformation(uint MeshIndex) const { return m_Meshes[MeshIndex].Transformation; }
+
+    // Casts a world space ray against the triangles of all the meshes of a model placed
+    // by ObjectMatrix. The hit distance is in units of the length of Dir so it can be
+    // compared between models. Animated models are tested in the bind pose.
+    bool RayCast(const Matrix4f& ObjectMatrix, const Vector3f& Origin, const Vector3f& Dir, float MaxDistance, ModelRayHit& Hit) const;
+
 protected:
 
     virtual void AllocBuffers() = 0;
@@ -185,15 +241,29 @@ private:
     template<typename VertexType>
     void ReserveSpace(std::vector<VertexType>& Vertices, uint NumVertices, uint NumIndices);
 
+    // Per-mesh output of the geometry processing. Each mesh is processed into
+    // its own staging buffer (possibly on a worker thread) and the buffers are
+    // then concatenated in mesh order.
     template<typename VertexType>
-    void InitSingleMesh(vector<VertexType>& Vertices, uint MeshIndex, const aiMesh* paiMesh);
+    struct MeshStagingBuffer {
+        std::vector<VertexType> Vertices;
+        std::vector<uint> Indices;
+        uint NumSourceIndices = 0;
+        Vector3f MinPos = Vector3f(FLT_MAX, FLT_MAX, FLT_MAX);
+        Vector3f MaxPos = Vector3f(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    };
 
     template<typename VertexType>
-    void InitSingleMeshOpt(vector<VertexType>& Vertices, uint MeshIndex, const aiMesh* paiMesh);
+    void InitSingleMesh(MeshStagingBuffer<VertexType>& Staging, const aiMesh* paiMesh) const;
 
-    virtual void PopulateBuffersSkinned(vector<SkinnedVertex>& Vertices) = 0;
+    template<typename VertexType>
+    void InitSingleMeshOpt(MeshStagingBuffer<VertexType>& Staging, const aiMesh* paiMesh) const;
 
-    virtual void PopulateBuffers(vector<Vertex>& Vertices) = 0;
+    // The vertices and indices are passed as raw arrays so that they can be
+    // uploaded directly from the memory mapped model cache
+    virtual void PopulateBuffersSkinned(const SkinnedVertex* pVertices, uint NumVertices, const uint* pIndices, uint NumIndices) = 0;
+
+    virtual void PopulateBuffers(const Vertex* pVertices, uint NumVertices, const uint* pIndices, uint NumIndices) = 0;
 
     uint CountValidFaces(const aiMesh& Mesh);
 
@@ -220,9 +290,19 @@ private:
     void InitAllMeshes(const aiScene* pScene, std::vector<VertexType>& Vertices);
 
     template<typename VertexType>
-    void OptimizeMesh(int MeshIndex, std::vector<uint>& Indices, std::vector<VertexType>& Vertices, std::vector<VertexType>& AllVertices);
+    void ProcessMeshes(const aiScene* pScene, std::vector<MeshStagingBuffer<VertexType>>& StagingBuffers) const;
+
+    template<typename VertexType>
+    void ProcessSingleMesh(MeshStagingBuffer<VertexType>& Staging, const aiMesh* paiMesh) const;
+
+    template<typename VertexType>
+    void OptimizeMesh(MeshStagingBuffer<VertexType>& Staging) const;
 
     void CalculateMeshTransformations(const aiScene* pScene);
+    void CalcModelBounds();
+
+    template<typename VertexType>
+    void BuildMeshBVHs(const VertexType* pVertices, const uint* pIndices);
     void TraverseNodeHierarchy(Matrix4f ParentTransformation, aiNode* pNode);
 
     bool InitMaterials(const aiScene* pScene, const std::string& Filename);
@@ -247,7 +327,64 @@ private:
 
     void InitSingleCamera(int Index, const aiScene* pScene);
 
-    const aiScene* m_pScene = NULL;
+    /////////////////////////////////////
+    // Model cache
+    /////////////////////////////////////
+
+    bool LoadModelCache(const std::string& CacheFilename, u64 SourceHash);
+
+    void SaveModelCache(const std::string& CacheFilename, u64 SourceHash);
+
+    void SaveMaterialsToCache(ModelCacheWriter& Writer);
+
+    void LoadMaterialsFromCache(ModelCacheReader& Reader);
+
+    void SaveAnimationsToCache(ModelCacheWriter& Writer);
+
+    bool LoadAnimationsFromCache(ModelCacheReader& Reader);
+
+    void LoadCachedTextures();
+
+    enum TEXTURE_SOURCE_TYPE {
+        TEXTURE_SOURCE_DIFFUSE = 0,
+        TEXTURE_SOURCE_SPECULAR = 1,
+        TEXTURE_SOURCE_NORMAL = 2,
+        NUM_TEXTURE_SOURCES = 3
+    };
+
+    // Where a material texture came from. Embedded data points either into the
+    // aiScene (when saving) or into the memory mapped cache (when loading).
+    struct TextureSource {
+        std::string FilePath;
+        const void* pEmbeddedData = NULL;
+        uint EmbeddedSize = 0;
+    };
+
+    struct MaterialTextureSources {
+        TextureSource Sources[NUM_TEXTURE_SOURCES];
+    };
+
+    // Parameters of GLMCameraFirstPerson::Init for each camera in the model
+    struct CameraInitInfo {
+        Vector3f Pos;
+        Vector3f Target;
+        Vector3f Up;
+        PersProjInfo persProjInfo;
+    };
+
+    // Everything below is only kept between the Assimp import and the
+    // writing of the model cache
+    std::vector<MaterialTextureSources> m_textureSources;
+    std::vector<CameraInitInfo> m_cameraInitInfo;
+    std::vector<char> m_vertexCacheData;
+    std::vector<std::string> m_importedFiles;   // everything Assimp opened except the source file
+
+    const aiScene* m_pScene = NULL;     // NULL when the model was loaded from the cache
+
+    // Points into the aiScene after an import or into m_cachedAnimations when the
+    // model was loaded from the cache. Nothing after the initialization may use m_pScene.
+    std::vector<const aiAnimation*> m_animations;
+    std::vector<std::unique_ptr<aiAnimation>> m_cachedAnimations;
 
     Matrix4f m_GlobalInverseTransform;
 
@@ -261,24 +398,23 @@ private:
 
     Vector3f m_minPos = Vector3f(FLT_MAX, FLT_MAX, FLT_MAX);
     Vector3f m_maxPos = Vector3f(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    BoundingVolume m_bounds;
+    std::vector<TriangleBVH> m_meshBVHs;   // one per mesh, in the local space of the mesh
 
     /////////////////////////////////////
 	// Skeletal animation stuff
     /////////////////////////////////////
 
-    void LoadMeshBones(vector<SkinnedVertex>& SkinnedVertices, uint MeshIndex, const aiMesh* paiMesh);
-    void LoadSingleBone(vector<SkinnedVertex>& SkinnedVertices, uint MeshIndex, const aiBone* pBone);
+    void RegisterMeshBones(const aiMesh* paiMesh);
+    void LoadMeshBones(vector<SkinnedVertex>& SkinnedVertices, const aiMesh* paiMesh) const;
+    void LoadSingleBone(vector<SkinnedVertex>& SkinnedVertices, const aiBone* pBone) const;
     int GetBoneId(const aiBone* pBone);
-    void CalcInterpolatedScaling(aiVector3D& Out, float AnimationTime, const aiNodeAnim* pNodeAnim);
-    void CalcInterpolatedRotation(aiQuaternion& Out, float AnimationTime, const aiNodeAnim* pNodeAnim);
-    void CalcInterpolatedPosition(aiVector3D& Out, float AnimationTime, const aiNodeAnim* pNodeAnim);
-    uint FindScaling(float AnimationTime, const aiNodeAnim* pNodeAnim);
-    uint FindRotation(float AnimationTime, const aiNodeAnim* pNodeAnim);
-    uint FindPosition(float AnimationTime, const aiNodeAnim* pNodeAnim);
-    const aiNodeAnim* FindNodeAnim(const aiAnimation& Animation, const string& NodeName);
-    void ReadNodeHierarchy(float AnimationTime, const aiNode* pNode, const Matrix4f& ParentTransform, const aiAnimation& Animation);
-    void ReadNodeHierarchyBlended(float StartAnimationTimeTicksm, float EndAnimationTimeTicks, const aiNode* pNode, const Matrix4f& ParentTransform,
-                                  const aiAnimation& StartAnimation, const aiAnimation& EndAnimation, float BlendFactor);
+    void CalcInterpolatedScaling(aiVector3D& Out, float AnimationTime, const aiNodeAnim* pNodeAnim, uint& Cursor);
+    void CalcInterpolatedRotation(aiQuaternion& Out, float AnimationTime, const aiNodeAnim* pNodeAnim, uint& Cursor);
+    void CalcInterpolatedPosition(aiVector3D& Out, float AnimationTime, const aiNodeAnim* pNodeAnim, uint& Cursor);
+    uint FindScaling(float AnimationTime, const aiNodeAnim* pNodeAnim, uint& Cursor);
+    uint FindRotation(float AnimationTime, const aiNodeAnim* pNodeAnim, uint& Cursor);
+    uint FindPosition(float AnimationTime, const aiNodeAnim* pNodeAnim, uint& Cursor);
     void MarkRequiredNodesForBone(const aiBone* pBone);
     void InitializeRequiredNodeMap(const aiNode* pNode);
     float CalcAnimationTimeTicks(float TimeInSeconds, unsigned int AnimationIndex);
@@ -289,19 +425,18 @@ private:
         aiVector3D Translation;
     };
 
-    void CalcLocalTransform(LocalTransform& Transform, float AnimationTimeTicks, const aiNodeAnim* pNodeAnim);
+    void CalcLocalTransform(LocalTransform& Transform, float AnimationTimeTicks, const aiNodeAnim* pNodeAnim, KeyframeCursor& Cursor);
+    Matrix4f CalcNodeTransformation(const LocalTransform& Transform) const;
 
     map<string,uint> m_BoneNameToIndexMap;
 
     struct BoneInfo
     {
         Matrix4f OffsetMatrix;
-        Matrix4f FinalTransformation;
 
         BoneInfo(const Matrix4f& Offset)
         {
             OffsetMatrix = Offset;
-            FinalTransformation.SetZero();
         }
     };
 
@@ -318,5 +453,40 @@ private:
     };
 
     map<string,NodeInfo> m_requiredNodeMap;
+
+    /////////////////////////////////////
+    // Compiled skeleton
+    /////////////////////////////////////
+
+    // The required nodes of the hierarchy flattened in depth first order so a
+    // parent always comes before its children. The bone transforms are calculated
+    // in a single pass over this array without touching the aiNode tree.
+    struct SkeletonNode {
+        int ParentIndex = -1;       // -1 for the root
+        int BoneIndex = -1;         // -1 if the node doesn't drive a bone
+        Matrix4f Transformation;    // used when the node has no channel in the animation
+    };
+
+    void CompileSkeleton(const aiScene* pScene);
+    void CompileSkeletonNode(const aiNode* pNode, int ParentIndex, std::vector<string>& NodeNames);
+
+    const int* GetSkeletonChannels(uint AnimationIndex) const { return &m_skeletonChannels[AnimationIndex * m_skeleton.size()]; }
+
+    vector<SkeletonNode> m_skeleton;
+
+    // Index of the aiNodeAnim of every skeleton node in every animation (-1 if the
+    // node is not animated). Laid out as [AnimationIndex * m_skeleton.size() + NodeIndex].
+    vector<int> m_skeletonChannels;
+
+    // Used by the versions of GetBoneTransforms that don't get a state from the caller
+    AnimationSamplingState m_samplingState;
+
+    void GetBoneTransformsBatchRange(uint FirstInstance,
+                                     uint NumInstances,
+                                     const uint* pAnimationIndices,
+                                     const float* pTimesInSeconds,
+                                     Matrix4f* pTransforms,
+                                     AnimationSamplingState** ppStates,
+                                     LaneMatrix* pGlobalTransforms);
 };
 
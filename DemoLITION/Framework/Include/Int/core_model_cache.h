@@ -0,0 +1,185 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "ogldev_types.h"
+
+//
+// The model cache is a binary dump of everything CoreModel extracts from Assimp
+// (optimized vertices and indices, mesh entries, materials, lights and cameras).
+// It is written next to the source file after the first load and on the next run
+// it is memory mapped and uploaded directly to the GPU. The cache is not portable
+// between machines - it uses the in-memory layout of the structures.
+//
+// The cache is out of date when the contents of the source file change or when
+// any of the files the model was built from (.mtl, .bin, textures) changes its
+// size or modification time. The names of these files follow the header.
+//
+
+#define MODEL_CACHE_MAGIC     0x434C4D44   // 'DMLC'
+#define MODEL_CACHE_VERSION   3
+#define MODEL_CACHE_EXTENSION ".dlcache"
+#define MODEL_CACHE_ALIGNMENT 16           // large arrays start on this boundary
+
+// Header flags
+#define MODEL_CACHE_FLAG_MESH_OPTIMIZER 0x1
+
+struct ModelCacheHeader
+{
+    u32 Magic = MODEL_CACHE_MAGIC;
+    u32 Version = MODEL_CACHE_VERSION;
+    u64 SourceHash = 0;     // hash of the contents of the source model file
+    u64 DependencyHash = 0; // see HashFileStamps
+    u32 VertexSize = 0;     // sizeof(Vertex) or sizeof(SkinnedVertex)
+    u32 Flags = 0;          // loader configuration that affects the cached data
+};
+
+
+// Read only memory mapping of an entire file
+class MappedFile
+{
+public:
+    MappedFile() {}
+
+    ~MappedFile();
+
+    bool Map(const std::string& Filename);
+
+    void Unmap();
+
+    const char* GetData() const { return m_pData; }
+
+    size_t GetSize() const { return m_size; }
+
+private:
+    const char* m_pData = NULL;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void* m_hFile = NULL;
+    void* m_hMapping = NULL;
+#endif
+};
+
+
+// 64 bit FNV-1a hash of the contents of a file
+bool HashFile(const std::string& Filename, u64& Hash);
+
+// Returns false if the file doesn't exist
+bool GetFileStamp(const std::string& Filename, u64& Size, u64& ModTime);
+
+// Hash of the names, sizes and modification times of the files. A missing file
+// hashes differently from an existing one.
+u64 HashFileStamps(const std::vector<std::string>& Filenames);
+
+
+class ModelCacheWriter
+{
+public:
+    ModelCacheWriter() {}
+
+    template<typename T>
+    void Write(const T& t)
+    {
+        WriteArray(&t, sizeof(T));
+    }
+
+    void WriteArray(const void* pData, size_t Size);
+
+    void WriteString(const std::string& s);
+
+    // Element count followed by the raw elements. T must be trivially copyable.
+    template<typename T>
+    void WriteVector(const std::vector<T>& v)
+    {
+        Write<u32>((u32)v.size());
+        WriteArray(v.data(), v.size() * sizeof(T));
+    }
+
+    void Align();
+
+    bool Save(const std::string& Filename);
+
+private:
+    std::vector<char> m_data;
+};
+
+
+class ModelCacheReader
+{
+public:
+    ModelCacheReader(const char* pData, size_t Size)
+    {
+        m_pStart = pData;
+        m_pCur = pData;
+        m_pEnd = pData + Size;
+    }
+
+    // Returns a default constructed T on overflow
+    template<typename T>
+    T Read()
+    {
+        T t = T();
+        const char* p = ReadArray(sizeof(T));
+
+        if (p) {
+            memcpy(&t, p, sizeof(T));
+        }
+
+        return t;
+    }
+
+    // Returns a pointer into the cache or NULL if there are not enough bytes
+    // left. After the first failure every read fails and IsOK() returns false.
+    const char* ReadArray(size_t Size);
+
+    // Reads an element count and checks that the rest of the file can hold that many
+    // elements of at least MinElementSize bytes. Returns zero on failure so that a
+    // corrupted count never turns into a huge allocation.
+    u32 ReadCount(size_t MinElementSize);
+
+    // See ModelCacheWriter::WriteVector
+    template<typename T>
+    void ReadVector(std::vector<T>& v)
+    {
+        u32 Count = ReadCount(sizeof(T));
+        const char* p = ReadArray(Count * sizeof(T));
+
+        v.resize(p ? Count : 0);
+
+        if (p && (Count > 0)) {
+            memcpy(v.data(), p, Count * sizeof(T));
+        }
+    }
+
+    std::string ReadString();
+
+    void Align();
+
+    bool IsOK() const { return m_isOK; }
+
+private:
+    const char* m_pStart = NULL;
+    const char* m_pCur = NULL;
+    const char* m_pEnd = NULL;
+    bool m_isOK = true;
+};
@@ -24,7 +24,9 @@
 #include "demolition_scene.h"
 #include "demolition_object.h"
 #include "Int/core_model.h"
+#include "Int/core_scene_bvh.h"
 
+class CoreScene;
 
 class CoreSceneObject : public SceneObject {
 public:
@@ -46,9 +48,42 @@ public:
 
     int GetId() const { return m_id; }
 
+    void SetScene(CoreScene* pScene) { m_pScene = pScene; }
+
+    // Spatial index bookkeeping (owned by CoreScene)
+    void SetBVHProxy(int Proxy) { m_bvhProxy = Proxy; }
+    int GetBVHProxy() const { return m_bvhProxy; }
+    void SetInDirtyList(bool InDirtyList) { m_inDirtyList = InDirtyList; }
+    bool IsInDirtyList() const { return m_inDirtyList; }
+
+    // Keyframe cursors of the animation that this object plays
+    AnimationSamplingState& GetAnimationSamplingState() { return m_animationSamplingState; }
+
+protected:
+    virtual void OnTransformChanged();
+
 private:
     CoreModel* m_pModel = NULL;
     int m_id = -1;
+    CoreScene* m_pScene = NULL;
+    int m_bvhProxy = -1;
+    bool m_inDirtyList = false;
+    AnimationSamplingState m_animationSamplingState;
+};
+
+
+struct SceneObjectHit {
+    CoreSceneObject* pSceneObject = NULL;
+    float Distance = 0.0f;
+};
+
+
+struct SceneRayHit {
+    CoreSceneObject* pSceneObject = NULL;
+    uint MeshIndex = 0;
+    uint Triangle = 0;
+    Vector3f Point;             // world space
+    float Distance = FLT_MAX;   // in units of the length of the ray direction
 };
 
 
@@ -102,8 +137,37 @@ public:
 
     SceneObject* GetPickedSceneObject() const { return m_pPickedSceneObject; }
 
+    // Details of the last pick (only with CPU picking)
+    void SetPickResult(const SceneRayHit& Hit) { m_pickResult = Hit; }
+
+    const SceneRayHit& GetPickResult() const { return m_pickResult; }
+
     SceneConfig* GetConfig() { return &m_config; }
 
+    CoreSceneObject* GetSceneObjectById(int Id);
+
+    //
+    // Spatial queries over the render list. Objects that cannot be bounded
+    // (animated models, models without geometry) are always included.
+    //
+    void QueryFrustum(const ViewFrustum& Frustum, std::vector<CoreSceneObject*>& Result);
+
+    void QueryBox(const BoundingVolume& Box, std::vector<CoreSceneObject*>& Result);
+
+    void QuerySphere(const Vector3f& Center, float Radius, std::vector<CoreSceneObject*>& Result);
+
+    // Hits are sorted by the distance to the bounding box of the object
+    void QueryRay(const Vector3f& Origin, const Vector3f& Dir, float MaxDistance, std::vector<SceneObjectHit>& Result);
+
+    // Finds the closest triangle along a world space ray
+    bool RayCast(const Vector3f& Origin, const Vector3f& Dir, float MaxDistance, SceneRayHit& Hit);
+
+    // Brings the BVH up to date with the objects that moved since the last call.
+    // The queries call it so there is usually no need to call it directly.
+    void UpdateSpatialIndex();
+
+    void OnSceneObjectMoved(CoreSceneObject* pSceneObject);
+
 protected:
     CoreRenderingSystem* m_pCoreRenderingSystem = NULL;
     std::list<CoreSceneObject*> m_renderList;
@@ -111,10 +175,22 @@ protected:
 private:
     void CreateDefaultCamera();
     CoreSceneObject* CreateSceneObjectInternal(CoreModel* pModel);
+    void AddToSpatialIndex(CoreSceneObject* pSceneObject);
+    void RemoveFromSpatialIndex(CoreSceneObject* pSceneObject);
+    BoundingVolume CalcWorldBounds(CoreSceneObject* pSceneObject) const;
+    void AppendQueryResult(std::vector<CoreSceneObject*>& Result);
 
     GLMCameraFirstPerson m_defaultCamera;
     std::vector<CoreSceneObject> m_sceneObjects;
     int m_numSceneObjects = 0;
     CoreSceneObject* m_pPickedSceneObject = NULL;
+    SceneRayHit m_pickResult;
     SceneConfig m_config;
+
+    // Spatial index
+    SceneBVH m_bvh;
+    std::vector<CoreSceneObject*> m_dirtyObjects;
+    std::vector<CoreSceneObject*> m_unboundedObjects;
+    std::vector<void*> m_queryResult;
+    std::vector<SceneObjectHit> m_rayQueryResult;
 };
@@ -0,0 +1,111 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "Int/core_culling.h"
+
+//
+// Dynamic bounding volume hierarchy over world space boxes.
+//
+// Every leaf holds a "fat" box - the real box enlarged by a margin. As long as
+// the real box stays inside the fat box an update is free. Only when it escapes
+// is the leaf removed and inserted again, and the insertion rebalances the path
+// to the root with tree rotations so that the height stays O(log n).
+//
+// The tree knows nothing about scene objects - a leaf carries an opaque pointer.
+//
+
+class SceneBVH
+{
+public:
+    // The margin is relative to the largest extent of the box
+    SceneBVH(float MarginRatio = 0.1f) { m_marginRatio = MarginRatio; }
+
+    // Returns the proxy id of the new leaf
+    int Insert(const BoundingVolume& Box, void* pUserData);
+
+    void Remove(int Proxy);
+
+    // Returns true if the leaf had to be reinserted
+    bool Update(int Proxy, const BoundingVolume& Box);
+
+    void Clear();
+
+    void* GetUserData(int Proxy) const { return m_nodes[Proxy].pUserData; }
+
+    const BoundingVolume& GetFatBox(int Proxy) const { return m_nodes[Proxy].Box; }
+
+    int GetNumLeaves() const { return m_numLeaves; }
+
+    int GetHeight() const { return (m_root == NULL_NODE) ? 0 : m_nodes[m_root].Height; }
+
+    // Checks the structure of the tree (parent links, heights, boxes). For debugging.
+    bool Validate() const;
+
+    //
+    // Queries. The results are appended to the vector.
+    //
+    void QueryFrustum(const ViewFrustum& Frustum, std::vector<void*>& Result) const;
+
+    void QueryBox(const BoundingVolume& Box, std::vector<void*>& Result) const;
+
+    void QuerySphere(const Vector3f& Center, float Radius, std::vector<void*>& Result) const;
+
+    struct RayHit {
+        void* pUserData = NULL;
+        float Distance = 0.0f;      // distance along the ray to the fat box
+    };
+
+    // Dir does not have to be normalized (distances are in units of its length).
+    // The hits are sorted by distance.
+    void QueryRay(const Vector3f& Origin, const Vector3f& Dir, float MaxDistance, std::vector<RayHit>& Result) const;
+
+private:
+    enum { NULL_NODE = -1 };
+
+    struct Node {
+        BoundingVolume Box;         // fat box for leaves
+        BoundingVolume LeafBox;     // the real box, leaves only
+        void* pUserData = NULL;
+        int Parent = NULL_NODE;     // next free node when the node is on the free list
+        int Child1 = NULL_NODE;
+        int Child2 = NULL_NODE;
+        int Height = -1;            // zero for leaves, -1 for free nodes
+
+        bool IsLeaf() const { return Child1 == NULL_NODE; }
+    };
+
+    int AllocNode();
+    void FreeNode(int NodeIndex);
+    void InsertLeaf(int Leaf);
+    void RemoveLeaf(int Leaf);
+    int Balance(int NodeIndex);
+    void FixUpwards(int NodeIndex);
+    BoundingVolume CalcFatBox(const BoundingVolume& Box) const;
+    void CollectLeaves(int NodeIndex, std::vector<void*>& Result, std::vector<int>& Stack) const;
+    bool ValidateNode(int NodeIndex) const;
+
+    std::vector<Node> m_nodes;
+    int m_root = NULL_NODE;
+    int m_freeList = NULL_NODE;
+    int m_numLeaves = 0;
+    float m_marginRatio = 0.1f;
+};
@@ -0,0 +1,77 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "Int/core_culling.h"
+
+struct TriangleHit {
+    float Distance = FLT_MAX;   // in units of the length of the ray direction
+    uint Triangle = 0;          // index of the triangle in the original index buffer
+    float u = 0.0f;             // barycentrics of the hit point (relative to vertex 1 and 2)
+    float v = 0.0f;
+};
+
+
+//
+// Static BVH over the triangles of a single mesh for CPU ray casts (picking etc).
+// Built once top down with a binned SAH and never changed. The tree keeps its own
+// copy of the positions so it does not depend on the vertex buffer staying around.
+//
+class TriangleBVH
+{
+public:
+    TriangleBVH() {}
+
+    // pIndices holds NumIndices / 3 triangles that index into pPositions
+    void Build(const Vector3f* pPositions, uint NumPositions, const uint* pIndices, uint NumIndices);
+
+    bool IsEmpty() const { return m_nodes.empty(); }
+
+    // Finds the closest hit along the ray that is nearer than MaxDistance
+    bool RayCast(const Vector3f& Origin, const Vector3f& Dir, float MaxDistance, TriangleHit& Hit) const;
+
+    // Same as above with the ray in world space. World takes the mesh to world space
+    // and must be affine so the hit distance does not change in the local space.
+    bool RayCast(const Matrix4f& World, const Vector3f& Origin, const Vector3f& Dir, float MaxDistance, TriangleHit& Hit) const;
+
+    size_t GetMemoryUsage() const;
+
+private:
+    struct Node {
+        BoundingVolume Box;
+        uint First = 0;     // first triangle for leaves, left child for inner nodes (right is left + 1)
+        uint Count = 0;     // zero for inner nodes
+    };
+
+    struct BuildTriangle {
+        BoundingVolume Box;
+        Vector3f Centroid;
+    };
+
+    void Subdivide(uint NodeIndex, std::vector<BuildTriangle>& Triangles);
+    bool FindSplit(const Node& n, const std::vector<BuildTriangle>& Triangles, int& Axis, float& SplitPos) const;
+    bool IntersectTriangle(uint Tri, const Vector3f& Origin, const Vector3f& Dir, float MaxDistance, TriangleHit& Hit) const;
+
+    std::vector<Node> m_nodes;
+    std::vector<Vector3f> m_positions;
+    std::vector<uint> m_triIndices;     // three per triangle, in tree order
+    std::vector<uint> m_triIds;         // original index of each triangle, in tree order
+};
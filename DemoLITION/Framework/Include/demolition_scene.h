@@ -20,6 +20,7 @@
 #pragma once
 
 #include <list>
+#include <vector>
 
 #include "ogldev_glm_camera.h"
 #include "demolition_lights.h"
@@ -30,20 +31,38 @@
 
 class SceneObject : public Object {
 public:
-    void SetPosition(float x, float y, float z) { m_pos.x = x; m_pos.y = y; m_pos.z = z; }
+    void SetPosition(float x, float y, float z) { m_pos.x = x; m_pos.y = y; m_pos.z = z; MarkTransformDirty(); }
     void SetRotation(float x, float y, float z);
-    void SetScale(float x, float y, float z) { m_scale.x = x; m_scale.y = y; m_scale.z = z; }    
+    void SetScale(float x, float y, float z) { m_scale.x = x; m_scale.y = y; m_scale.z = z; MarkTransformDirty(); }
 
-    void SetPosition(const Vector3f& Pos) { m_pos = Pos; }
+    void SetPosition(const Vector3f& Pos) { m_pos = Pos; MarkTransformDirty(); }
     const Vector3f& GetPosition() const { return m_pos; }
     void SetRotation(const Vector3f& Rot);
     void PushRotation(const Vector3f& Rot);
-    void ResetRotations() { m_numRotations = 0; }
-    void SetScale(const Vector3f& Scale) { m_scale = Scale; }
+    void ResetRotations() { m_numRotations = 0; MarkTransformDirty(); }
+    void SetScale(const Vector3f& Scale) { m_scale = Scale; MarkTransformDirty(); }
 
     void RotateBy(float x, float y, float z);
 
-    Matrix4f GetMatrix() const;
+    // World matrix (the parent's world matrix times the local transformation).
+    // Cached and recalculated only after one of the setters above was called
+    // on this object or on one of its ancestors.
+    const Matrix4f& GetMatrix() const;
+
+    const Matrix4f& GetInverseMatrix() const;
+
+    // Inverse transpose of the world matrix for transforming normals
+    const Matrix4f& GetNormalMatrix() const;
+
+    // The position, rotation and scale of a child are relative to its parent.
+    // Pass NULL to detach.
+    void SetParent(SceneObject* pParent);
+    SceneObject* GetParent() const { return m_pParent; }
+    const std::vector<SceneObject*>& GetChildren() const { return m_children; }
+
+    // Brings the matrices of the object and all its descendants up to date in
+    // one top down pass (parents are always calculated before their children)
+    void UpdateTransforms();
 
     void SetFlatColor(const Vector4f Col) { m_flatColor = Col; }
     const Vector4f& GetFlatColor() const { return m_flatColor; }
@@ -51,22 +70,47 @@ public:
     void SetColorMod(float r, float g, float b) { m_colorMod.r = r; m_colorMod.g = g; m_colorMod.b = b; }
     Vector3f GetColorMod() const { return m_colorMod; }
 
-    void SetQuaternion(const glm::quat& q) { m_quaternion = q; }
+    void SetQuaternion(const glm::quat& q) { m_quaternion = q; MarkTransformDirty(); }
+
+    // The animation that is played when the model is animated. Objects that share
+    // a model can play different animations or the same one at different times.
+    void SetAnimation(unsigned int AnimationIndex, float TimeOffsetSec = 0.0f) { m_animationIndex = AnimationIndex; m_animationTimeOffset = TimeOffsetSec; }
+    unsigned int GetAnimationIndex() const { return m_animationIndex; }
+    float GetAnimationTimeOffset() const { return m_animationTimeOffset; }
 
 protected:
     SceneObject();
     void CalcRotationStack(Matrix4f& Rot) const;
+    Matrix4f CalcLocalMatrix() const;
+
+    // Called whenever the world matrix becomes dirty, including when the
+    // reason is a change in one of the ancestors
+    virtual void OnTransformChanged() {}
 
     Vector3f m_pos = Vector3f(0.0f, 0.0f, 0.0f);
     Vector3f m_scale = Vector3f(1.0f, 1.0f, 1.0f);
 
 private:
+    void MarkTransformDirty();
    
     Vector3f m_rotations[MAX_NUM_ROTATIONS];
     int m_numRotations = 0;
     Vector4f m_flatColor = Vector4f(-1.0f, -1.0f, -1.0f, -1.0f);
     Vector3f m_colorMod = Vector3f(1.0f, 1.0f, 1.0f);
     glm::quat m_quaternion = glm::quat(0.0f, 0.0f, 0.0f, 0.0f);
+    unsigned int m_animationIndex = 0;
+    float m_animationTimeOffset = 0.0f;
+
+    SceneObject* m_pParent = NULL;
+    std::vector<SceneObject*> m_children;
+
+    // Cached matrices. The world matrix and the inverse have separate flags
+    // because most objects never need the inverse.
+    mutable Matrix4f m_worldMatrix;
+    mutable Matrix4f m_inverseMatrix;
+    mutable Matrix4f m_normalMatrix;
+    mutable bool m_worldDirty = true;
+    mutable bool m_inverseDirty = true;
 };
 
 
@@ -92,16 +136,27 @@ public:
     void ControlPicking(bool EnablePicking) { m_pickingEnabled = EnablePicking; }
     bool IsPickingEnabled() const { return m_pickingEnabled; }
 
+    // CPU picking casts the mouse ray against the scene BVH and the triangles of the
+    // models. GPU picking renders the scene into the picking texture and reads it back.
+    // Off by default since CPU picking tests animated models in the bind pose.
+    void ControlCPUPicking(bool EnableCPUPicking) { m_cpuPickingEnabled = EnableCPUPicking; }
+    bool IsCPUPickingEnabled() const { return m_cpuPickingEnabled; }
+
     void ControlSkybox(bool EnableSkybox) { m_skyboxEnabled = EnableSkybox; }
     bool IsSkyboxEnabled() const { return m_skyboxEnabled; }
 
+    void ControlFrustumCulling(bool EnableFrustumCulling) { m_frustumCullingEnabled = EnableFrustumCulling; }
+    bool IsFrustumCullingEnabled() const { return m_frustumCullingEnabled; }
+
     InfiniteGridConfig& GetInfiniteGrid() { return m_infiniteGridConfig;  }
 
 private:
 
     bool m_shadowMappingEnabled = true;
     bool m_pickingEnabled = false;
+    bool m_cpuPickingEnabled = false;
     bool m_skyboxEnabled = false;
+    bool m_frustumCullingEnabled = true;
     InfiniteGridConfig m_infiniteGridConfig;
 };
 
@@ -231,8 +231,14 @@ void ForwardRenderer::Render(void* pWindow, GLScene* pScene, GameCallbacks* pGam
         return;
     }
 
+    StartCulling(pScene);
+
     if (pScene->GetConfig()->IsPickingEnabled()) {
-        PickingPass(pWindow, pScene);
+        if (pScene->GetConfig()->IsCPUPickingEnabled()) {
+            CPUPicking(pWindow, pScene);
+        } else {
+            PickingPass(pWindow, pScene);
+        }
         // The render loop may be called multiple time before picking
         // is again disabled so we do it explicitly
         pScene->GetConfig()->ControlPicking(false);
@@ -290,6 +296,37 @@ void ForwardRenderer::ApplyLighting(GLScene* pScene)
     m_pCurLightingTech->SetCameraWorldPos(m_pCurCamera->GetPos());
 }
 
+// Casts the ray under the mouse through the scene instead of rendering the picking pass
+void ForwardRenderer::CPUPicking(void* pWindow, GLScene* pScene)
+{
+    int MousePosX = 0, MousePosY = 0;
+    m_pRenderingSystemGL->GetMousePos(pWindow, MousePosX, MousePosY);
+
+    // Unproject the mouse position on the near and far planes
+    float x = (2.0f * (MousePosX + 0.5f)) / m_windowWidth - 1.0f;
+    float y = 1.0f - (2.0f * (MousePosY + 0.5f)) / m_windowHeight;
+
+    Matrix4f InvVP = GetViewProjectionMatrix().Inverse();
+
+    Vector4f Near = InvVP * Vector4f(x, y, -1.0f, 1.0f);
+    Vector4f Far = InvVP * Vector4f(x, y, 1.0f, 1.0f);
+
+    Vector3f Origin = Near.to3f() / Near.w;
+    Vector3f Dir = Far.to3f() / Far.w - Origin;
+
+    // Dir spans the entire frustum so the max distance is one
+    SceneRayHit Hit;
+
+    if (pScene->RayCast(Origin, Dir, 1.0f, Hit)) {
+        pScene->SetPickedSceneObject(Hit.pSceneObject);
+    } else {
+        pScene->SetPickedSceneObject(NULL);
+    }
+
+    pScene->SetPickResult(Hit);
+}
+
+
 void ForwardRenderer::PickingPass(void* pWindow, GLScene* pScene)
 {
     m_curRenderPass = RENDER_PASS_PICKING;
@@ -302,6 +339,8 @@ void ForwardRenderer::PickingPass(void* pWindow, GLScene* pScene)
 
     m_pickingTech.Enable();
 
+    CullRenderList(pScene, GetViewProjectionMatrix());
+
     PickingRenderScene(pScene);
 
     m_pickingTexture.DisableWriting();
@@ -312,13 +351,12 @@ void ForwardRenderer::PickingPass(void* pWindow, GLScene* pScene)
 
 void ForwardRenderer::PickingRenderScene(GLScene* pScene)
 {
-    const std::list<CoreSceneObject*>& RenderList = pScene->GetRenderList();
+    for (int i = 0 ; i < (int)m_visibleObjects.size() ; i++) {
+        m_pcurSceneObject = m_visibleObjects[i];
 
-    for (std::list<CoreSceneObject*>::const_iterator it = RenderList.begin(); it != RenderList.end(); it++) {
-        int ObjectIndex = (*it)->GetId() + 1;  // Background is zero, the real objects start at 1
+        int ObjectIndex = m_pcurSceneObject->GetId() + 1;  // Background is zero, the real objects start at 1
         m_pickingTech.SetObjectIndex(ObjectIndex);
 
-        m_pcurSceneObject = *it;
         RenderSingleObject(m_pcurSceneObject);
     }
 }
@@ -347,17 +385,12 @@ int ForwardRenderer::GetPickedObjectIndex(void* pWindow, GLScene* pScene)
 
 void ForwardRenderer::SavePickedObject(GLScene* pScene, int ObjectIndex)
 {
-    const std::list<CoreSceneObject*>& RenderList = pScene->GetRenderList();
-
-    for (std::list<CoreSceneObject*>::const_iterator it = RenderList.begin(); it != RenderList.end(); it++) {
-        if (((*it)->GetId() + 1) == ObjectIndex) {
-            pScene->SetPickedSceneObject(*it);
-            return;
-        }
-    }
+    CoreSceneObject* pSceneObject = pScene->GetSceneObjectById(ObjectIndex - 1);
 
     // should never get here
-    assert(0);
+    assert(pSceneObject);
+
+    pScene->SetPickedSceneObject(pSceneObject);
 }
 
 
@@ -397,18 +430,18 @@ void ForwardRenderer::ShadowMapPass(GLScene* pScene)
 
     if (NumDirLights > 0) {
         m_curRenderPass = RENDER_PASS_SHADOW_DIR;
-        ShadowMapPassDirAndSpot(pScene->GetRenderList());
+        ShadowMapPassDirAndSpot(pScene);
     } else if (NumPointLights > 0) {
         m_curRenderPass = RENDER_PASS_SHADOW_POINT;
-        ShadowMapPassPoint(pScene->GetRenderList(), pScene->GetPointLights());
+        ShadowMapPassPoint(pScene, pScene->GetPointLights());
     } else {  
         m_curRenderPass = RENDER_PASS_SHADOW_SPOT;
-        ShadowMapPassDirAndSpot(pScene->GetRenderList());
+        ShadowMapPassDirAndSpot(pScene);
     }
 }
 
 
-void ForwardRenderer::ShadowMapPassPoint(const std::list<CoreSceneObject*>& RenderList, const std::vector<PointLight>& PointLights)
+void ForwardRenderer::ShadowMapPassPoint(GLScene* pScene, const std::vector<PointLight>& PointLights)
 {
     m_shadowMapPointLightTech.Enable();
     m_shadowMapPointLightTech.SetLightWorldPos(PointLights[0].WorldPosition);
@@ -420,12 +453,13 @@ void ForwardRenderer::ShadowMapPassPoint(const std::list<CoreSceneObject*>& Rend
         glViewport(0, 0, SHADOW_MAP_WIDTH, SHADOW_MAP_HEIGHT);
         glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
         m_lightViewMatrix.InitCameraTransform(PointLights[0].WorldPosition, gCameraDirections[i].Target, gCameraDirections[i].Up);
-        RenderEntireRenderList(RenderList);
+        CullRenderList(pScene, m_lightPersProjMatrix * m_lightViewMatrix);
+        RenderVisibleObjects();
     }
 }
 
 
-void ForwardRenderer::ShadowMapPassDirAndSpot(const std::list<CoreSceneObject*>& RenderList)
+void ForwardRenderer::ShadowMapPassDirAndSpot(GLScene* pScene)
 {
     m_shadowMapFBO.BindForWriting();
     glClear(GL_DEPTH_BUFFER_BIT);
@@ -436,14 +470,22 @@ void ForwardRenderer::ShadowMapPassDirAndSpot(const std::list<CoreSceneObject*>&
     }
     m_shadowMapTech.ControlIndirectRender(UseIndirectRender);   // TODO: same for point
     m_shadowMapTech.ControlPVP(UsePVP);                         // TODO: same for point
-    RenderEntireRenderList(RenderList);
+
+    // Must match the projection used by the shadow technique
+    if ((m_curRenderPass == RENDER_PASS_SHADOW_DIR) && !UseIndirectRender) {
+        CullRenderList(pScene, m_lightOrthoProjMatrix * m_lightViewMatrix);
+    } else {
+        CullRenderList(pScene, m_lightPersProjMatrix * m_lightViewMatrix);
+    }
+
+    RenderVisibleObjects();
 }
 
 
-void ForwardRenderer::RenderEntireRenderList(const std::list<CoreSceneObject*>& RenderList)
+void ForwardRenderer::RenderVisibleObjects()
 {
-    for (std::list<CoreSceneObject*>::const_iterator it = RenderList.begin(); it != RenderList.end(); it++) {
-        m_pcurSceneObject = *it;
+    for (int i = 0 ; i < (int)m_visibleObjects.size() ; i++) {
+        m_pcurSceneObject = m_visibleObjects[i];
         RenderSingleObject(m_pcurSceneObject);
     }
 }
@@ -482,10 +524,12 @@ void ForwardRenderer::LightingPass(GLScene* pScene, long long TotalRuntimeMillis
 
     bool FirstTimeForwardLighting = true;
 
-    const std::list<CoreSceneObject*>& RenderList = pScene->GetRenderList();
+    CullRenderList(pScene, GetViewProjectionMatrix());
 
-    for (std::list<CoreSceneObject*>::const_iterator it = RenderList.begin(); it != RenderList.end(); it++) {        
-        m_pcurSceneObject = *it;
+    CalcBoneTransforms(TotalRuntimeMillis);
+
+    for (int i = 0 ; i < (int)m_visibleObjects.size() ; i++) {
+        m_pcurSceneObject = m_visibleObjects[i];
 
         const Vector4f& FlatColor = m_pcurSceneObject->GetFlatColor();
 
@@ -494,7 +538,13 @@ void ForwardRenderer::LightingPass(GLScene* pScene, long long TotalRuntimeMillis
                 StartRenderWithForwardLighting(pScene, m_pcurSceneObject, TotalRuntimeMillis);
               //  FirstTimeForwardLighting = false; TODO: currently disabled
             }
-            RenderWithForwardLighting(m_pcurSceneObject, TotalRuntimeMillis);
+            const Matrix4f* pBoneTransforms = NULL;
+
+            if (m_boneTransformsOffsets[i] >= 0) {
+                pBoneTransforms = &m_boneTransforms[m_boneTransformsOffsets[i]];
+            }
+
+            RenderWithForwardLighting(m_pcurSceneObject, pBoneTransforms);
         }
         else {
             RenderWithFlatColor(m_pcurSceneObject);
@@ -503,6 +553,111 @@ void ForwardRenderer::LightingPass(GLScene* pScene, long long TotalRuntimeMillis
 }
 
 
+// Calculates the bone transforms of the visible animated objects. The objects that
+// share a model are evaluated together in one call to GetBoneTransformsBatch.
+void ForwardRenderer::CalcBoneTransforms(long long TotalRuntimeMillis)
+{
+    float AnimationTimeSec = (float)TotalRuntimeMillis / 1000.0f;
+
+    m_boneTransformsOffsets.assign(m_visibleObjects.size(), -1);
+    m_animatedObjects.clear();
+
+    uint NumTransforms = 0;
+
+    for (int i = 0 ; i < (int)m_visibleObjects.size() ; i++) {
+        CoreModel* pModel = m_visibleObjects[i]->GetModel();
+
+        if (pModel->IsAnimated()) {
+            m_animatedObjects.push_back(i);
+            NumTransforms += pModel->NumBones();
+        }
+    }
+
+    if (m_animatedObjects.empty()) {
+        return;
+    }
+
+    std::sort(m_animatedObjects.begin(), m_animatedObjects.end(), [this](int a, int b) {
+        return std::less<CoreModel*>()(m_visibleObjects[a]->GetModel(), m_visibleObjects[b]->GetModel());
+    });
+
+    m_boneTransforms.resize(NumTransforms);
+
+    uint Offset = 0;
+    uint First = 0;
+
+    while (First < m_animatedObjects.size()) {
+        CoreModel* pModel = m_visibleObjects[m_animatedObjects[First]]->GetModel();
+        uint NumBones = pModel->NumBones();
+
+        m_batchAnimationIndices.clear();
+        m_batchTimes.clear();
+        m_batchStates.clear();
+
+        uint Last = First;
+
+        while ((Last < m_animatedObjects.size()) && (m_visibleObjects[m_animatedObjects[Last]]->GetModel() == pModel)) {
+            CoreSceneObject* pSceneObject = m_visibleObjects[m_animatedObjects[Last]];
+
+            m_batchAnimationIndices.push_back(pSceneObject->GetAnimationIndex());
+            m_batchTimes.push_back(AnimationTimeSec + pSceneObject->GetAnimationTimeOffset());
+            m_batchStates.push_back(&pSceneObject->GetAnimationSamplingState());
+            m_boneTransformsOffsets[m_animatedObjects[Last]] = Offset + (Last - First) * NumBones;
+
+            Last++;
+        }
+
+        uint NumInstances = Last - First;
+
+        // Single threaded. The threaded path starts and joins its threads on every call
+        // which is not worth it on the render thread until it has been measured there
+        // (see Sandbox/AnimationBatchBenchmark).
+        bool Multithreaded = false;
+
+        pModel->GetBoneTransformsBatch(NumInstances,
+                                       m_batchAnimationIndices.data(),
+                                       m_batchTimes.data(),
+                                       &m_boneTransforms[Offset],
+                                       m_batchStates.data(),
+                                       Multithreaded);
+
+        Offset += NumInstances * NumBones;
+        First = Last;
+    }
+}
+
+
+void ForwardRenderer::StartCulling(GLScene* pScene)
+{
+    m_cullingEnabled = pScene->GetConfig()->IsFrustumCullingEnabled();
+
+    for (int i = 0 ; i < NUM_RENDER_PASSES ; i++) {
+        m_objectCullingStats[i].Reset();
+        m_meshCullingStats[i].Reset();
+    }
+}
+
+
+// Builds the list of objects for the current pass from the BVH of the scene
+void ForwardRenderer::CullRenderList(GLScene* pScene, const Matrix4f& VP)
+{
+    const std::list<CoreSceneObject*>& RenderList = pScene->GetRenderList();
+
+    m_visibleObjects.clear();
+
+    if (m_cullingEnabled) {
+        m_cullingFrustum.Update(VP);
+        pScene->QueryFrustum(m_cullingFrustum, m_visibleObjects);
+    } else {
+        m_visibleObjects.assign(RenderList.begin(), RenderList.end());
+    }
+
+    CullingStats& Stats = m_objectCullingStats[m_curRenderPass];
+    Stats.NumVisible += (uint)m_visibleObjects.size();
+    Stats.NumCulled += (uint)(RenderList.size() - m_visibleObjects.size());
+}
+
+
 void ForwardRenderer::StartRenderWithForwardLighting(GLScene* pScene, CoreSceneObject* pSceneObject, long long TotalRuntimeMillis)
 {
     if (pSceneObject->GetModel()->IsAnimated()) {
@@ -527,18 +682,16 @@ void ForwardRenderer::StartRenderWithForwardLighting(GLScene* pScene, CoreSceneO
 }
 
 
-void ForwardRenderer::RenderWithForwardLighting(CoreSceneObject* pSceneObject, long long TotalRuntimeMillis)
+// pBoneTransforms points to the bone transforms of an animated object (see CalcBoneTransforms)
+void ForwardRenderer::RenderWithForwardLighting(CoreSceneObject* pSceneObject, const Matrix4f* pBoneTransforms)
 {
     if (pSceneObject->GetModel()->IsAnimated()) {
         SwitchToLightingTech(FORWARD_SKINNING);  // TODO: do we need this?
 
-        float AnimationTimeSec = (float)TotalRuntimeMillis / 1000.0f;
-        int AnimationIndex = 0;
-        vector<Matrix4f> Transforms;
-        pSceneObject->GetModel()->GetBoneTransforms(AnimationTimeSec, Transforms, AnimationIndex);
+        uint NumBones = pSceneObject->GetModel()->NumBones();
 
-        for (uint i = 0; i < Transforms.size(); i++) {
-            m_skinningTech.SetBoneTransform(i, Transforms[i]);
+        for (uint i = 0; i < NumBones; i++) {
+            m_skinningTech.SetBoneTransform(i, pBoneTransforms[i]);
         }
     }
     else {
@@ -572,8 +725,7 @@ void ForwardRenderer::RenderSingleObject(CoreSceneObject* pSceneObject)
     }
 
     if (UseIndirectRender) {
-        Matrix4f ObjectMatrix = m_pcurSceneObject->GetMatrix();
-        pModel->RenderIndirect(ObjectMatrix);
+        pModel->RenderIndirect(m_pcurSceneObject->GetMatrix(), m_pcurSceneObject->GetNormalMatrix());
     }
     else {
         pModel->Render(this);
@@ -809,10 +961,29 @@ void ForwardRenderer::SetWorldMatrix_CB(const Matrix4f& World)
 }
 
 
+bool ForwardRenderer::IsMeshVisible_CB(uint MeshIndex)
+{
+    CullingStats& Stats = m_meshCullingStats[m_curRenderPass];
+    CoreModel* pModel = m_pcurSceneObject->GetModel();
+
+    // Single mesh models were already tested by IsObjectVisible
+    if (!m_cullingEnabled || pModel->IsAnimated() || (pModel->GetNumMeshes() == 1)) {
+        Stats.NumVisible++;
+        return true;
+    }
+
+    // Same order as the model bounds and the SetWorldMatrix_CB_* functions: the mesh
+    // transformation takes the mesh to model space and the object matrix to world space
+    Matrix4f World = m_pcurSceneObject->GetMatrix() * pModel->GetMeshTransformation(MeshIndex);
+
+    return m_cullingFrustum.IsVisible(pModel->GetMeshBounds(MeshIndex), World, Stats);
+}
+
+
 void ForwardRenderer::SetWorldMatrix_CB_ShadowPassDir(const Matrix4f& World)
 {
     Matrix4f ObjectMatrix = m_pcurSceneObject->GetMatrix();
-    Matrix4f WVP = m_lightOrthoProjMatrix * m_lightViewMatrix * World * ObjectMatrix;
+    Matrix4f WVP = m_lightOrthoProjMatrix * m_lightViewMatrix * ObjectMatrix * World;
     m_shadowMapTech.SetWVP(WVP);
 }
 
@@ -825,7 +996,7 @@ void ForwardRenderer::SetWorldMatrix_CB_ShadowPassSpot(const Matrix4f& World)
     m_lightViewMatrix.Print();
     m_lightPersProjMatrix.Print();
     exit(0);*/
-    Matrix4f WVP = m_lightPersProjMatrix * m_lightViewMatrix * World * ObjectMatrix;
+    Matrix4f WVP = m_lightPersProjMatrix * m_lightViewMatrix * ObjectMatrix * World;
     m_shadowMapTech.SetWVP(WVP);
 }
 
@@ -833,8 +1004,9 @@ void ForwardRenderer::SetWorldMatrix_CB_ShadowPassSpot(const Matrix4f& World)
 void ForwardRenderer::SetWorldMatrix_CB_ShadowPassPoint(const Matrix4f& World)
 {
     Matrix4f ObjectMatrix = m_pcurSceneObject->GetMatrix();
-    Matrix4f WVP = m_lightPersProjMatrix * m_lightViewMatrix * World * ObjectMatrix;
-    m_shadowMapPointLightTech.SetWorld(World);
+    Matrix4f FinalWorldMatrix = ObjectMatrix * World;
+    Matrix4f WVP = m_lightPersProjMatrix * m_lightViewMatrix * FinalWorldMatrix;
+    m_shadowMapPointLightTech.SetWorld(FinalWorldMatrix);
     m_shadowMapPointLightTech.SetWVP(WVP);
 }
 
@@ -842,7 +1014,7 @@ void ForwardRenderer::SetWorldMatrix_CB_ShadowPassPoint(const Matrix4f& World)
 void ForwardRenderer::SetWorldMatrix_CB_LightingPass(const Matrix4f& World)
 {
     Matrix4f ObjectMatrix = m_pcurSceneObject->GetMatrix();
-    Matrix4f FinalWorldMatrix = World * ObjectMatrix;
+    Matrix4f FinalWorldMatrix = ObjectMatrix * World;
     m_pCurLightingTech->SetWorldMatrix(FinalWorldMatrix);
 
     Matrix4f View = m_pCurCamera->GetViewMatrix();// TODO: use VP matrix from camera
@@ -885,7 +1057,7 @@ void ForwardRenderer::SetWorldMatrix_CB_PickingPass(const Matrix4f& World)
 {
     Matrix4f ObjectMatrix = m_pcurSceneObject->GetMatrix();
     Matrix4f ProjView = GetViewProjectionMatrix();
-    Matrix4f WVP = ProjView * World * ObjectMatrix;
+    Matrix4f WVP = ProjView * ObjectMatrix * World;
    // printf("Picking pass\n"); WVP.Print();
 
     m_pickingTech.SetWVP(WVP);
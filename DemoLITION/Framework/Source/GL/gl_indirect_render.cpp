@@ -54,6 +54,7 @@ void IndirectRender::InitMeshes(const std::vector<BasicMeshEntry>& Meshes)
 
     for (int i = 0; i < Meshes.size(); i++) {
         m_meshes[i].m_transformation = Meshes[i].Transformation;
+        m_meshes[i].m_normalTransformation = Meshes[i].Transformation.Inverse().Transpose();
         m_meshes[i].m_materialIndex = Meshes[i].MaterialIndex;
     }
 }
@@ -123,9 +124,9 @@ void IndirectRender::PrepareIndirectRenderMaterials(std::vector<Material>& Mater
 
 
 
-void IndirectRender::Render(const Matrix4f& ObjectMatrix)
+void IndirectRender::Render(const Matrix4f& ObjectMatrix, const Matrix4f& NormalMatrix)
 {
-    UpdatePerObjectData(ObjectMatrix);
+    UpdatePerObjectData(ObjectMatrix, NormalMatrix);
 
     glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_drawCmdBuffer);
 
@@ -136,19 +137,15 @@ void IndirectRender::Render(const Matrix4f& ObjectMatrix)
 }
 
 
-void IndirectRender::UpdatePerObjectData(const Matrix4f& ObjectMatrix)
+void IndirectRender::UpdatePerObjectData(const Matrix4f& ObjectMatrix, const Matrix4f& NormalMatrix)
 {
     std::vector<PerObjectData> PerObjectDataVector;
     PerObjectDataVector.resize(m_meshes.size());
 
     for (int i = 0; i < m_meshes.size(); i++) {
-        // TODO: move to math3d
-        Matrix4f FinalWorldMatrix = ObjectMatrix * m_meshes[i].m_transformation;
-        Matrix4f WorldInverse = FinalWorldMatrix.Inverse();
-        Matrix4f WorldInverseTranspose = WorldInverse.Transpose();
-
-        PerObjectDataVector[i].WorldMatrix = FinalWorldMatrix;
-        PerObjectDataVector[i].NormalMatrix = WorldInverseTranspose;
+        // (A * B)^-T = A^-T * B^-T so the normal matrix needs no inversion here
+        Matrix4f::Multiply(ObjectMatrix, m_meshes[i].m_transformation, PerObjectDataVector[i].WorldMatrix);
+        Matrix4f::Multiply(NormalMatrix, m_meshes[i].m_normalTransformation, PerObjectDataVector[i].NormalMatrix);
         PerObjectDataVector[i].MaterialIndex.x = m_meshes[i].m_materialIndex;
     }
 
@@ -66,15 +66,15 @@ void GLModel::AllocBuffers()
 }
 
 
-void GLModel::PopulateBuffersSkinned(std::vector<SkinnedVertex>& Vertices)
+void GLModel::PopulateBuffersSkinned(const SkinnedVertex* pVertices, uint NumVertices, const uint* pIndices, uint NumIndices)
 {
-    PopulateBuffersInternal<SkinnedVertex>(Vertices);
+    PopulateBuffersInternal<SkinnedVertex>(pVertices, NumVertices, pIndices, NumIndices);
 }
 
 
-void GLModel::PopulateBuffers(std::vector<Vertex>& Vertices)
+void GLModel::PopulateBuffers(const Vertex* pVertices, uint NumVertices, const uint* pIndices, uint NumIndices)
 {
-    PopulateBuffersInternal<Vertex>(Vertices);
+    PopulateBuffersInternal<Vertex>(pVertices, NumVertices, pIndices, NumIndices);
 }
 
 
@@ -88,11 +88,11 @@ void GLModel::InitGeometryPost()
 
 
 template<typename VertexType>
-void GLModel::PopulateBuffersInternal(std::vector<VertexType>& Vertices)
+void GLModel::PopulateBuffersInternal(const VertexType* pVertices, uint NumVertices, const uint* pIndices, uint NumIndices)
 {
     if (UsePVP) {
         if (IsGLVersionHigher(4, 5)) {
-            PopulateBuffersPVP(Vertices);
+            PopulateBuffersPVP(pVertices, NumVertices, pIndices, NumIndices);
         }
         else {
             printf("Programmable vertex pulling but OpenGL version is less than 4.5\n");
@@ -101,20 +101,20 @@ void GLModel::PopulateBuffersInternal(std::vector<VertexType>& Vertices)
     }
     else {
         if (IsGLVersionHigher(4, 5)) {
-            PopulateBuffersDSA(Vertices);
+            PopulateBuffersDSA(pVertices, NumVertices, pIndices, NumIndices);
         }
         else {
-            PopulateBuffersNonDSA(Vertices);
+            PopulateBuffersNonDSA(pVertices, NumVertices, pIndices, NumIndices);
         }
     }
 }
 
 
 template<typename VertexType>
-void GLModel::PopulateBuffersPVP(std::vector<VertexType>& Vertices)
+void GLModel::PopulateBuffersPVP(const VertexType* pVertices, uint NumVertices, const uint* pIndices, uint NumIndices)
 {
-    glNamedBufferStorage(m_Buffers[VERTEX_BUFFER], sizeof(VertexType) * Vertices.size(), Vertices.data(), 0);
-    glNamedBufferStorage(m_Buffers[INDEX_BUFFER], sizeof(m_Indices[0]) * m_Indices.size(), m_Indices.data(), 0);
+    glNamedBufferStorage(m_Buffers[VERTEX_BUFFER], sizeof(VertexType) * NumVertices, pVertices, 0);
+    glNamedBufferStorage(m_Buffers[INDEX_BUFFER], sizeof(uint) * NumIndices, pIndices, 0);
 
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SSBO_INDEX_VERTICES, m_Buffers[VERTEX_BUFFER]);
 
@@ -123,13 +123,13 @@ void GLModel::PopulateBuffersPVP(std::vector<VertexType>& Vertices)
 
 
 template<typename VertexType>
-void GLModel::PopulateBuffersNonDSA(std::vector<VertexType>& Vertices)
+void GLModel::PopulateBuffersNonDSA(const VertexType* pVertices, uint NumVertices, const uint* pIndices, uint NumIndices)
 {
     glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[VERTEX_BUFFER]);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_Buffers[INDEX_BUFFER]);
 
-    glBufferData(GL_ARRAY_BUFFER, sizeof(VertexType) * Vertices.size(), Vertices.data(), GL_STATIC_DRAW);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(m_Indices[0]) * m_Indices.size(), &m_Indices[0], GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(VertexType) * NumVertices, pVertices, GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint) * NumIndices, pIndices, GL_STATIC_DRAW);
 
     size_t NumFloats = 0;
 
@@ -173,13 +173,13 @@ void GLModel::PopulateBuffersNonDSA(std::vector<VertexType>& Vertices)
 
 
 template<typename VertexType>
-void GLModel::PopulateBuffersDSA(std::vector<VertexType>& Vertices)
+void GLModel::PopulateBuffersDSA(const VertexType* pVertices, uint NumVertices, const uint* pIndices, uint NumIndices)
 {
     // for (int i = 0; i < Vertices.size(); i++) {
     //     Vertices[i].Print();
    //  }
-    glNamedBufferStorage(m_Buffers[VERTEX_BUFFER], sizeof(VertexType) * Vertices.size(), Vertices.data(), 0);
-    glNamedBufferStorage(m_Buffers[INDEX_BUFFER], sizeof(m_Indices[0]) * m_Indices.size(), m_Indices.data(), 0);
+    glNamedBufferStorage(m_Buffers[VERTEX_BUFFER], sizeof(VertexType) * NumVertices, pVertices, 0);
+    glNamedBufferStorage(m_Buffers[INDEX_BUFFER], sizeof(uint) * NumIndices, pIndices, 0);
 
     glVertexArrayVertexBuffer(m_VAO, 0, m_Buffers[VERTEX_BUFFER], 0, sizeof(VertexType));
     glVertexArrayElementBuffer(m_VAO, m_Buffers[INDEX_BUFFER]);
@@ -247,6 +247,10 @@ void GLModel::Render(DemolitionRenderCallbacks* pRenderCallbacks)
     }
 
     for (unsigned int i = 0; i < m_Meshes.size(); i++) {
+        if (pRenderCallbacks && !pRenderCallbacks->IsMeshVisible_CB(i)) {
+            continue;
+        }
+
         RenderMesh(i, pRenderCallbacks);
     }
 
@@ -371,7 +375,7 @@ void GLModel::Render(unsigned int NumInstances, const Matrix4f* WVPMats, const M
 }
 
 
-void GLModel::RenderIndirect(const Matrix4f& ObjectMatrix)
+void GLModel::RenderIndirect(const Matrix4f& ObjectMatrix, const Matrix4f& NormalMatrix)
 {
     assert(UseIndirectRender);
 
@@ -381,7 +385,7 @@ void GLModel::RenderIndirect(const Matrix4f& ObjectMatrix)
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SSBO_INDEX_VERTICES, m_Buffers[VERTEX_BUFFER]);
     }
 
-    m_indirectRender.Render(ObjectMatrix);
+    m_indirectRender.Render(ObjectMatrix, NormalMatrix);
 
     // Make sure the VAO is not changed from the outside
     glBindVertexArray(0);
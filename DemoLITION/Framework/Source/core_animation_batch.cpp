@@ -0,0 +1,760 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//
+// Batched evaluation of the bone transforms of many instances of the same model.
+//
+// The instances are processed in groups of BATCH_LANES (8 with AVX2, 4 otherwise).
+// For every skeleton node the keys of all the instances in the group are gathered
+// into a structure of arrays (one lane per instance). The interpolation of the keys,
+// the TRS composition and the multiplication with the parent node are then done on
+// all the lanes together. The node transforms of a group stay in SoA form until the
+// final bone matrices are written out.
+//
+// The node and bone matrices are assumed to be affine (the bottom row is 0 0 0 1)
+// which is always the case for the matrices that come out of Assimp.
+//
+
+#include <thread>
+#include <atomic>
+
+#include "Int/core_model.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#define BATCH_GROUPS_PER_JOB 4      // number of lane groups a worker thread takes at a time
+
+// config flags
+static uint MinInstancesPerThread = 32;
+
+
+/////////////////////////////////////
+// Lane operations
+/////////////////////////////////////
+
+#ifdef __AVX2__
+
+#define BATCH_LANES 8
+
+typedef __m256 Lanes;
+
+inline Lanes LoadLanes(const float* p)              { return _mm256_loadu_ps(p); }
+inline void StoreLanes(float* p, Lanes a)           { _mm256_storeu_ps(p, a); }
+inline Lanes SetLanes(float f)                      { return _mm256_set1_ps(f); }
+inline Lanes AddLanes(Lanes a, Lanes b)             { return _mm256_add_ps(a, b); }
+inline Lanes SubLanes(Lanes a, Lanes b)             { return _mm256_sub_ps(a, b); }
+inline Lanes MulLanes(Lanes a, Lanes b)             { return _mm256_mul_ps(a, b); }
+inline Lanes DivLanes(Lanes a, Lanes b)             { return _mm256_div_ps(a, b); }
+inline Lanes SqrtLanes(Lanes a)                     { return _mm256_sqrt_ps(a); }
+
+inline void TransposeLanes(Lanes r[BATCH_LANES])
+{
+    Lanes t0 = _mm256_unpacklo_ps(r[0], r[1]);
+    Lanes t1 = _mm256_unpackhi_ps(r[0], r[1]);
+    Lanes t2 = _mm256_unpacklo_ps(r[2], r[3]);
+    Lanes t3 = _mm256_unpackhi_ps(r[2], r[3]);
+    Lanes t4 = _mm256_unpacklo_ps(r[4], r[5]);
+    Lanes t5 = _mm256_unpackhi_ps(r[4], r[5]);
+    Lanes t6 = _mm256_unpacklo_ps(r[6], r[7]);
+    Lanes t7 = _mm256_unpackhi_ps(r[6], r[7]);
+
+    Lanes s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    Lanes s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    Lanes s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    Lanes s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    Lanes s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+    Lanes s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+    Lanes s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+    Lanes s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+    r[0] = _mm256_permute2f128_ps(s0, s4, 0x20);
+    r[1] = _mm256_permute2f128_ps(s1, s5, 0x20);
+    r[2] = _mm256_permute2f128_ps(s2, s6, 0x20);
+    r[3] = _mm256_permute2f128_ps(s3, s7, 0x20);
+    r[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+    r[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+    r[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+    r[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+}
+
+// Loads 4 floats from every lane and returns them as 4 vectors (one per element)
+inline void LoadRowsTransposed(const float* const pRows[BATCH_LANES], Lanes& c0, Lanes& c1, Lanes& c2, Lanes& c3)
+{
+    Lanes r0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(pRows[0])), _mm_loadu_ps(pRows[4]), 1);
+    Lanes r1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(pRows[1])), _mm_loadu_ps(pRows[5]), 1);
+    Lanes r2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(pRows[2])), _mm_loadu_ps(pRows[6]), 1);
+    Lanes r3 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(pRows[3])), _mm_loadu_ps(pRows[7]), 1);
+
+    Lanes t0 = _mm256_unpacklo_ps(r0, r1);
+    Lanes t1 = _mm256_unpacklo_ps(r2, r3);
+    Lanes t2 = _mm256_unpackhi_ps(r0, r1);
+    Lanes t3 = _mm256_unpackhi_ps(r2, r3);
+
+    c0 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+    c1 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+    c2 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    c3 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+#define BATCH_LANE_MASKS
+
+inline Lanes AndLanes(Lanes a, Lanes b)             { return _mm256_and_ps(a, b); }
+inline Lanes AndNotLanes(Lanes a, Lanes b)          { return _mm256_andnot_ps(a, b); }
+inline Lanes OrLanes(Lanes a, Lanes b)              { return _mm256_or_ps(a, b); }
+inline Lanes XorLanes(Lanes a, Lanes b)             { return _mm256_xor_ps(a, b); }
+inline Lanes GreaterLanes(Lanes a, Lanes b)         { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+
+#else
+
+#define BATCH_LANES 4
+
+typedef Float4 Lanes;
+
+inline Lanes LoadLanes(const float* p)              { return Load4(p); }
+inline void StoreLanes(float* p, Lanes a)           { Store4(p, a); }
+inline Lanes SetLanes(float f)                      { return Set4(f); }
+inline Lanes AddLanes(Lanes a, Lanes b)             { return Add4(a, b); }
+inline Lanes SubLanes(Lanes a, Lanes b)             { return Sub4(a, b); }
+inline Lanes MulLanes(Lanes a, Lanes b)             { return Mul4(a, b); }
+inline Lanes DivLanes(Lanes a, Lanes b)             { return Div4(a, b); }
+inline Lanes SqrtLanes(Lanes a)                     { return Sqrt4(a); }
+
+inline void TransposeLanes(Lanes r[BATCH_LANES])
+{
+    Transpose4(r[0], r[1], r[2], r[3]);
+}
+
+// Loads 4 floats from every lane and returns them as 4 vectors (one per element)
+inline void LoadRowsTransposed(const float* const pRows[BATCH_LANES], Lanes& c0, Lanes& c1, Lanes& c2, Lanes& c3)
+{
+    c0 = Load4(pRows[0]);
+    c1 = Load4(pRows[1]);
+    c2 = Load4(pRows[2]);
+    c3 = Load4(pRows[3]);
+    Transpose4(c0, c1, c2, c3);
+}
+
+#ifdef OGLDEV_SIMD_SSE
+
+#define BATCH_LANE_MASKS
+
+inline Lanes AndLanes(Lanes a, Lanes b)             { return _mm_and_ps(a, b); }
+inline Lanes AndNotLanes(Lanes a, Lanes b)          { return _mm_andnot_ps(a, b); }
+inline Lanes OrLanes(Lanes a, Lanes b)              { return _mm_or_ps(a, b); }
+inline Lanes XorLanes(Lanes a, Lanes b)             { return _mm_xor_ps(a, b); }
+inline Lanes GreaterLanes(Lanes a, Lanes b)         { return _mm_cmpgt_ps(a, b); }
+
+#endif
+
+#endif
+
+
+// a * b + c
+inline Lanes MulAddLanes(Lanes a, Lanes b, Lanes c)
+{
+    return AddLanes(MulLanes(a, b), c);
+}
+
+
+inline Lanes LerpLanes(Lanes Start, Lanes End, Lanes Factor)
+{
+    return MulAddLanes(Factor, SubLanes(End, Start), Start);
+}
+
+
+// The affine part of a matrix for all the lanes of a group. Element [i][j] of lane
+// k is m[i][j][k] so every element is a single vector load.
+struct LaneMatrix
+{
+    float m[3][4][BATCH_LANES];
+};
+
+
+/////////////////////////////////////
+// Key gathering
+/////////////////////////////////////
+
+// The keys of one skeleton node for all the lanes of a group. The keys are not
+// copied. Every lane points to the values inside the aiVectorKey/aiQuatKey arrays
+// and the values are transposed while they are loaded. aiVector3D is followed by
+// padding inside aiVectorKey so it is safe to load 4 floats from it.
+struct LaneSamples
+{
+    const float* pPos0[BATCH_LANES];
+    const float* pPos1[BATCH_LANES];
+    float PosFactor[BATCH_LANES];
+
+    const float* pRot0[BATCH_LANES];       // w x y z
+    const float* pRot1[BATCH_LANES];
+    float RotFactor[BATCH_LANES];
+
+    const float* pScale0[BATCH_LANES];
+    const float* pScale1[BATCH_LANES];
+    float ScaleFactor[BATCH_LANES];
+};
+
+static_assert(sizeof(aiVector3D) == 3 * sizeof(float), "the batch sampler requires single precision keys");
+static_assert(sizeof(aiVectorKey) >= offsetof(aiVectorKey, mValue) + 4 * sizeof(float), "unexpected aiVectorKey layout");
+static_assert(sizeof(aiQuaternion) == 4 * sizeof(float), "the batch sampler requires single precision keys");
+
+
+// Finds the keys on both sides of the time and the interpolation factor between
+// them the same way as CoreModel::CalcInterpolatedPosition & co.
+template<typename KeyType>
+static void FindKeyPair(const KeyType* pKeys, uint NumKeys, float AnimationTimeTicks, uint& Cursor,
+                        uint& Start, uint& End, float& Factor)
+{
+    Start = End = 0;
+    Factor = 0.0f;
+
+    if (NumKeys == 1) {
+        return;
+    }
+
+    uint Index = FindKeyframe(pKeys, NumKeys, AnimationTimeTicks, Cursor);
+
+    Start = End = Index;
+
+    float t1 = (float)pKeys[Index].mTime;
+
+    if (t1 <= AnimationTimeTicks) {
+        float t2 = (float)pKeys[Index + 1].mTime;
+        Factor = (AnimationTimeTicks - t1) / (t2 - t1);
+        End = Index + 1;
+    }
+}
+
+
+// Exporters usually place the position, rotation and scaling keys of a channel at
+// the same times. In that case the key pair that was found for the positions is
+// valid for the other keys as well and the search is skipped.
+template<typename KeyType>
+static bool IsSameKeyPair(const KeyType* pKeys, uint NumKeys, const aiVectorKey* pPositionKeys, uint NumPositionKeys,
+                          uint Start, uint End)
+{
+    return (NumKeys == NumPositionKeys) &&
+           (pKeys[Start].mTime == pPositionKeys[Start].mTime) &&
+           (pKeys[End].mTime == pPositionKeys[End].mTime);
+}
+
+
+template<typename KeyType>
+static void FindKeyPairFromPositions(const KeyType* pKeys, uint NumKeys, const aiNodeAnim* pNodeAnim,
+                                     float AnimationTimeTicks, KeyframeCursor& Cursor, uint& KeyCursor,
+                                     uint& Start, uint& End, float& Factor)
+{
+    if (IsSameKeyPair(pKeys, NumKeys, pNodeAnim->mPositionKeys, pNodeAnim->mNumPositionKeys, Start, End)) {
+        KeyCursor = Cursor.Position;
+    } else {
+        FindKeyPair(pKeys, NumKeys, AnimationTimeTicks, KeyCursor, Start, End, Factor);
+    }
+}
+
+
+static void GatherLane(LaneSamples& Samples, uint Lane, const aiNodeAnim* pNodeAnim, float AnimationTimeTicks, KeyframeCursor& Cursor)
+{
+    uint Start = 0, End = 0;
+    float Factor = 0.0f;
+
+    const aiVectorKey* pPositionKeys = pNodeAnim->mPositionKeys;
+
+    FindKeyPair(pPositionKeys, pNodeAnim->mNumPositionKeys, AnimationTimeTicks, Cursor.Position, Start, End, Factor);
+
+    Samples.pPos0[Lane] = &pPositionKeys[Start].mValue.x;
+    Samples.pPos1[Lane] = &pPositionKeys[End].mValue.x;
+    Samples.PosFactor[Lane] = Factor;
+
+    // Start, End and Factor are reused when the key times match the positions
+    uint PositionStart = Start, PositionEnd = End;
+    float PositionFactor = Factor;
+
+    const aiQuatKey* pRotationKeys = pNodeAnim->mRotationKeys;
+
+    FindKeyPairFromPositions(pRotationKeys, pNodeAnim->mNumRotationKeys, pNodeAnim, AnimationTimeTicks, Cursor,
+                             Cursor.Rotation, Start, End, Factor);
+
+    Samples.pRot0[Lane] = &pRotationKeys[Start].mValue.w;
+    Samples.pRot1[Lane] = &pRotationKeys[End].mValue.w;
+    Samples.RotFactor[Lane] = Factor;
+
+    Start = PositionStart;
+    End = PositionEnd;
+    Factor = PositionFactor;
+
+    const aiVectorKey* pScalingKeys = pNodeAnim->mScalingKeys;
+
+    FindKeyPairFromPositions(pScalingKeys, pNodeAnim->mNumScalingKeys, pNodeAnim, AnimationTimeTicks, Cursor,
+                             Cursor.Scaling, Start, End, Factor);
+
+    Samples.pScale0[Lane] = &pScalingKeys[Start].mValue.x;
+    Samples.pScale1[Lane] = &pScalingKeys[End].mValue.x;
+    Samples.ScaleFactor[Lane] = Factor;
+}
+
+
+// Lanes without a channel (or beyond the end of the batch) get an identity transform
+static void GatherIdentityLane(LaneSamples& Samples, uint Lane)
+{
+    static const float Zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    static const float One[4] = { 1.0f, 1.0f, 1.0f, 0.0f };
+    static const float IdentityQuat[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+
+    Samples.pPos0[Lane] = Samples.pPos1[Lane] = Zero;
+    Samples.pRot0[Lane] = Samples.pRot1[Lane] = IdentityQuat;
+    Samples.pScale0[Lane] = Samples.pScale1[Lane] = One;
+
+    Samples.PosFactor[Lane] = Samples.RotFactor[Lane] = Samples.ScaleFactor[Lane] = 0.0f;
+}
+
+
+/////////////////////////////////////
+// Interpolation and TRS composition
+/////////////////////////////////////
+
+// Calculates the coefficients of the start and end quaternions for the spherical
+// interpolation (see aiQuaternion::Interpolate). The sign of the end coefficient
+// is flipped when the quaternions are more than 90 degrees apart so that the
+// rotation goes the short way around.
+#ifdef BATCH_LANE_MASKS
+
+// acos(x) for 0 <= x <= 1 (Abramowitz & Stegun 4.4.46, error below 2e-8)
+static Lanes AcosLanes(Lanes x)
+{
+    Lanes p = SetLanes(-0.0012624911f);
+    p = MulAddLanes(p, x, SetLanes(0.0066700901f));
+    p = MulAddLanes(p, x, SetLanes(-0.0170881256f));
+    p = MulAddLanes(p, x, SetLanes(0.0308918810f));
+    p = MulAddLanes(p, x, SetLanes(-0.0501743046f));
+    p = MulAddLanes(p, x, SetLanes(0.0889789874f));
+    p = MulAddLanes(p, x, SetLanes(-0.2145988016f));
+    p = MulAddLanes(p, x, SetLanes(1.5707963050f));
+    return MulLanes(p, SqrtLanes(SubLanes(SetLanes(1.0f), x)));
+}
+
+
+// sin(x) for 0 <= x <= PI/2 (Taylor series up to x^11, error below 1e-7)
+static Lanes SinLanes(Lanes x)
+{
+    Lanes x2 = MulLanes(x, x);
+    Lanes p = SetLanes(-1.0f / 39916800.0f);
+    p = MulAddLanes(p, x2, SetLanes(1.0f / 362880.0f));
+    p = MulAddLanes(p, x2, SetLanes(-1.0f / 5040.0f));
+    p = MulAddLanes(p, x2, SetLanes(1.0f / 120.0f));
+    p = MulAddLanes(p, x2, SetLanes(-1.0f / 6.0f));
+    p = MulAddLanes(p, x2, SetLanes(1.0f));
+    return MulLanes(p, x);
+}
+
+
+static void CalcSlerpCoefficients(Lanes CosOmega, Lanes Factor, Lanes& Coeff0, Lanes& Coeff1)
+{
+    Lanes SignMask = SetLanes(-0.0f);
+    Lanes One = SetLanes(1.0f);
+
+    Lanes c = AndNotLanes(SignMask, CosOmega);
+    Lanes OneMinusFactor = SubLanes(One, Factor);
+
+    // Standard case (slerp)
+    Lanes Omega = AcosLanes(c);
+    Lanes InvSinOmega = DivLanes(One, SqrtLanes(SubLanes(One, MulLanes(c, c))));
+    Lanes Slerp0 = MulLanes(SinLanes(MulLanes(OneMinusFactor, Omega)), InvSinOmega);
+    Lanes Slerp1 = MulLanes(SinLanes(MulLanes(Factor, Omega)), InvSinOmega);
+
+    // Very close - linear interpolation
+    Lanes UseSlerp = GreaterLanes(SubLanes(One, c), SetLanes(0.0001f));
+
+    Coeff0 = OrLanes(AndLanes(UseSlerp, Slerp0), AndNotLanes(UseSlerp, OneMinusFactor));
+    Coeff1 = OrLanes(AndLanes(UseSlerp, Slerp1), AndNotLanes(UseSlerp, Factor));
+
+    Coeff1 = XorLanes(Coeff1, AndLanes(SignMask, CosOmega));
+}
+
+#else
+
+static void CalcSlerpCoefficients(Lanes CosOmegaLanes, Lanes FactorLanes, Lanes& Coeff0, Lanes& Coeff1)
+{
+    float CosOmega[BATCH_LANES], Factor[BATCH_LANES], c0[BATCH_LANES], c1[BATCH_LANES];
+    StoreLanes(CosOmega, CosOmegaLanes);
+    StoreLanes(Factor, FactorLanes);
+
+    for (int i = 0 ; i < BATCH_LANES ; i++) {
+        float c = fabsf(CosOmega[i]);
+        float f = Factor[i];
+
+        if ((1.0f - c) > 0.0001f) {
+            float Omega = acosf(c);
+            float SinOmega = sinf(Omega);
+            c0[i] = sinf((1.0f - f) * Omega) / SinOmega;
+            c1[i] = sinf(f * Omega) / SinOmega;
+        } else {
+            c0[i] = 1.0f - f;
+            c1[i] = f;
+        }
+
+        if (CosOmega[i] < 0.0f) {
+            c1[i] = -c1[i];
+        }
+    }
+
+    Coeff0 = LoadLanes(c0);
+    Coeff1 = LoadLanes(c1);
+}
+
+#endif
+
+
+// Calculates Translation * Rotation * Scaling for all the lanes
+static void ComposeLocalTransforms(const LaneSamples& Samples, LaneMatrix& Local)
+{
+    Lanes Unused;
+
+    // Translation and scaling are interpolated linearly
+    Lanes p0x, p0y, p0z, p1x, p1y, p1z;
+    LoadRowsTransposed(Samples.pPos0, p0x, p0y, p0z, Unused);
+    LoadRowsTransposed(Samples.pPos1, p1x, p1y, p1z, Unused);
+
+    Lanes PosFactor = LoadLanes(Samples.PosFactor);
+    Lanes Tx = LerpLanes(p0x, p1x, PosFactor);
+    Lanes Ty = LerpLanes(p0y, p1y, PosFactor);
+    Lanes Tz = LerpLanes(p0z, p1z, PosFactor);
+
+    Lanes s0x, s0y, s0z, s1x, s1y, s1z;
+    LoadRowsTransposed(Samples.pScale0, s0x, s0y, s0z, Unused);
+    LoadRowsTransposed(Samples.pScale1, s1x, s1y, s1z, Unused);
+
+    Lanes ScaleFactor = LoadLanes(Samples.ScaleFactor);
+    Lanes Sx = LerpLanes(s0x, s1x, ScaleFactor);
+    Lanes Sy = LerpLanes(s0y, s1y, ScaleFactor);
+    Lanes Sz = LerpLanes(s0z, s1z, ScaleFactor);
+
+    // Spherical interpolation of the rotation (same as aiQuaternion::Interpolate)
+    Lanes q0x, q0y, q0z, q0w, q1x, q1y, q1z, q1w;
+    LoadRowsTransposed(Samples.pRot0, q0w, q0x, q0y, q0z);
+    LoadRowsTransposed(Samples.pRot1, q1w, q1x, q1y, q1z);
+
+    Lanes CosOmega = AddLanes(AddLanes(MulLanes(q0x, q1x), MulLanes(q0y, q1y)), AddLanes(MulLanes(q0z, q1z), MulLanes(q0w, q1w)));
+
+    Lanes c0, c1;
+    CalcSlerpCoefficients(CosOmega, LoadLanes(Samples.RotFactor), c0, c1);
+
+    Lanes qx = AddLanes(MulLanes(c0, q0x), MulLanes(c1, q1x));
+    Lanes qy = AddLanes(MulLanes(c0, q0y), MulLanes(c1, q1y));
+    Lanes qz = AddLanes(MulLanes(c0, q0z), MulLanes(c1, q1z));
+    Lanes qw = AddLanes(MulLanes(c0, q0w), MulLanes(c1, q1w));
+
+    Lanes Len = SqrtLanes(AddLanes(AddLanes(MulLanes(qx, qx), MulLanes(qy, qy)), AddLanes(MulLanes(qz, qz), MulLanes(qw, qw))));
+    Lanes InvLen = DivLanes(SetLanes(1.0f), Len);
+    qx = MulLanes(qx, InvLen);
+    qy = MulLanes(qy, InvLen);
+    qz = MulLanes(qz, InvLen);
+    qw = MulLanes(qw, InvLen);
+
+    // Rotation matrix (see aiQuaternion::GetMatrix) with the scaling applied to the columns
+    Lanes One = SetLanes(1.0f);
+    Lanes Two = SetLanes(2.0f);
+
+    Lanes xx = MulLanes(qx, qx), yy = MulLanes(qy, qy), zz = MulLanes(qz, qz);
+    Lanes xy = MulLanes(qx, qy), xz = MulLanes(qx, qz), yz = MulLanes(qy, qz);
+    Lanes wx = MulLanes(qw, qx), wy = MulLanes(qw, qy), wz = MulLanes(qw, qz);
+
+    StoreLanes(Local.m[0][0], MulLanes(SubLanes(One, MulLanes(Two, AddLanes(yy, zz))), Sx));
+    StoreLanes(Local.m[0][1], MulLanes(MulLanes(Two, SubLanes(xy, wz)), Sy));
+    StoreLanes(Local.m[0][2], MulLanes(MulLanes(Two, AddLanes(xz, wy)), Sz));
+    StoreLanes(Local.m[0][3], Tx);
+
+    StoreLanes(Local.m[1][0], MulLanes(MulLanes(Two, AddLanes(xy, wz)), Sx));
+    StoreLanes(Local.m[1][1], MulLanes(SubLanes(One, MulLanes(Two, AddLanes(xx, zz))), Sy));
+    StoreLanes(Local.m[1][2], MulLanes(MulLanes(Two, SubLanes(yz, wx)), Sz));
+    StoreLanes(Local.m[1][3], Ty);
+
+    StoreLanes(Local.m[2][0], MulLanes(MulLanes(Two, SubLanes(xz, wy)), Sx));
+    StoreLanes(Local.m[2][1], MulLanes(MulLanes(Two, AddLanes(yz, wx)), Sy));
+    StoreLanes(Local.m[2][2], MulLanes(SubLanes(One, MulLanes(Two, AddLanes(xx, yy))), Sz));
+    StoreLanes(Local.m[2][3], Tz);
+}
+
+
+/////////////////////////////////////
+// Affine matrix products
+/////////////////////////////////////
+
+// Out = a * b where b is the same for all the lanes
+static void MultiplyLanes(const LaneMatrix& a, const Matrix4f& b, LaneMatrix& Out)
+{
+    for (int i = 0 ; i < 3 ; i++) {
+        Lanes a0 = LoadLanes(a.m[i][0]);
+        Lanes a1 = LoadLanes(a.m[i][1]);
+        Lanes a2 = LoadLanes(a.m[i][2]);
+
+        for (int j = 0 ; j < 4 ; j++) {
+            Lanes r = MulAddLanes(a0, SetLanes(b.m[0][j]), MulAddLanes(a1, SetLanes(b.m[1][j]), MulLanes(a2, SetLanes(b.m[2][j]))));
+
+            if (j == 3) {
+                r = AddLanes(r, LoadLanes(a.m[i][3]));
+            }
+
+            StoreLanes(Out.m[i][j], r);
+        }
+    }
+}
+
+
+// Out = a * b where a is the same for all the lanes
+static void MultiplyLanes(const Matrix4f& a, const LaneMatrix& b, LaneMatrix& Out)
+{
+    for (int i = 0 ; i < 3 ; i++) {
+        Lanes a0 = SetLanes(a.m[i][0]);
+        Lanes a1 = SetLanes(a.m[i][1]);
+        Lanes a2 = SetLanes(a.m[i][2]);
+
+        for (int j = 0 ; j < 4 ; j++) {
+            Lanes r = MulAddLanes(a0, LoadLanes(b.m[0][j]), MulAddLanes(a1, LoadLanes(b.m[1][j]), MulLanes(a2, LoadLanes(b.m[2][j]))));
+
+            if (j == 3) {
+                r = AddLanes(r, SetLanes(a.m[i][3]));
+            }
+
+            StoreLanes(Out.m[i][j], r);
+        }
+    }
+}
+
+
+static void MultiplyLanes(const LaneMatrix& a, const LaneMatrix& b, LaneMatrix& Out)
+{
+    for (int i = 0 ; i < 3 ; i++) {
+        Lanes a0 = LoadLanes(a.m[i][0]);
+        Lanes a1 = LoadLanes(a.m[i][1]);
+        Lanes a2 = LoadLanes(a.m[i][2]);
+
+        for (int j = 0 ; j < 4 ; j++) {
+            Lanes r = MulAddLanes(a0, LoadLanes(b.m[0][j]), MulAddLanes(a1, LoadLanes(b.m[1][j]), MulLanes(a2, LoadLanes(b.m[2][j]))));
+
+            if (j == 3) {
+                r = AddLanes(r, LoadLanes(a.m[i][3]));
+            }
+
+            StoreLanes(Out.m[i][j], r);
+        }
+    }
+}
+
+
+static void BroadcastLanes(const Matrix4f& a, LaneMatrix& Out)
+{
+    for (int i = 0 ; i < 3 ; i++) {
+        for (int j = 0 ; j < 4 ; j++) {
+            StoreLanes(Out.m[i][j], SetLanes(a.m[i][j]));
+        }
+    }
+}
+
+
+static void SetLane(LaneMatrix& a, uint Lane, const Matrix4f& m)
+{
+    for (int i = 0 ; i < 3 ; i++) {
+        for (int j = 0 ; j < 4 ; j++) {
+            a.m[i][j][Lane] = m.m[i][j];
+        }
+    }
+}
+
+
+// Writes lane i as a row major matrix to pOut[i * Stride]. The matrix is cut into
+// chunks of BATCH_LANES elements and every chunk is transposed from SoA to AoS
+// in registers.
+static void ScatterLanes(const LaneMatrix& a, uint NumLanes, Matrix4f* pOut, uint Stride)
+{
+    for (int Chunk = 0 ; Chunk < 16 / BATCH_LANES ; Chunk++) {
+        Lanes Rows[BATCH_LANES];
+
+        for (int i = 0 ; i < BATCH_LANES ; i++) {
+            int Element = Chunk * BATCH_LANES + i;
+
+            if (Element < 12) {
+                Rows[i] = LoadLanes(a.m[Element / 4][Element % 4]);
+            } else {
+                Rows[i] = SetLanes((Element == 15) ? 1.0f : 0.0f);
+            }
+        }
+
+        TransposeLanes(Rows);
+
+        for (uint Lane = 0 ; Lane < NumLanes ; Lane++) {
+            StoreLanes(&pOut[Lane * Stride].m[0][0] + Chunk * BATCH_LANES, Rows[Lane]);
+        }
+    }
+}
+
+
+/////////////////////////////////////
+// CoreModel batch API
+/////////////////////////////////////
+
+void CoreModel::GetBoneTransformsBatch(uint NumInstances,
+                                       const uint* pAnimationIndices,
+                                       const float* pTimesInSeconds,
+                                       Matrix4f* pTransforms,
+                                       AnimationSamplingState** ppStates,
+                                       bool Multithreaded)
+{
+    for (uint i = 0 ; i < NumInstances ; i++) {
+        if (pAnimationIndices[i] >= m_animations.size()) {
+            printf("Invalid animation index %d for instance %d, max is %d\n", pAnimationIndices[i], i, (int)m_animations.size());
+            assert(0);
+        }
+    }
+
+    uint NumThreads = 1;
+
+    if (Multithreaded) {
+        NumThreads = std::min(std::thread::hardware_concurrency(), NumInstances / MinInstancesPerThread);
+    }
+
+    if (NumThreads <= 1) {
+        std::vector<LaneMatrix> GlobalTransforms(m_skeleton.size());
+        GetBoneTransformsBatchRange(0, NumInstances, pAnimationIndices, pTimesInSeconds, pTransforms, ppStates, GlobalTransforms.data());
+        return;
+    }
+
+    uint NumGroups = (NumInstances + BATCH_LANES - 1) / BATCH_LANES;
+
+    std::atomic<uint> NextGroup(0);
+
+    auto Worker = [&]() {
+        std::vector<LaneMatrix> GlobalTransforms(m_skeleton.size());
+
+        uint FirstGroup = 0;
+
+        while ((FirstGroup = NextGroup.fetch_add(BATCH_GROUPS_PER_JOB)) < NumGroups) {
+            uint FirstInstance = FirstGroup * BATCH_LANES;
+            uint Count = std::min((uint)(BATCH_GROUPS_PER_JOB * BATCH_LANES), NumInstances - FirstInstance);
+            GetBoneTransformsBatchRange(FirstInstance, Count, pAnimationIndices, pTimesInSeconds, pTransforms, ppStates, GlobalTransforms.data());
+        }
+    };
+
+    std::vector<std::thread> Threads;
+    Threads.reserve(NumThreads - 1);
+
+    for (uint i = 0 ; i < NumThreads - 1 ; i++) {
+        Threads.emplace_back(Worker);
+    }
+
+    // The calling thread is part of the pool
+    Worker();
+
+    for (std::thread& t : Threads) {
+        t.join();
+    }
+}
+
+
+void CoreModel::GetBoneTransformsBatchRange(uint FirstInstance,
+                                            uint NumInstances,
+                                            const uint* pAnimationIndices,
+                                            const float* pTimesInSeconds,
+                                            Matrix4f* pTransforms,
+                                            AnimationSamplingState** ppStates,
+                                            LaneMatrix* pGlobalTransforms)
+{
+    uint NumNodes = (uint)m_skeleton.size();
+    uint NumBones = (uint)m_BoneInfo.size();
+
+    for (uint GroupStart = FirstInstance ; GroupStart < FirstInstance + NumInstances ; GroupStart += BATCH_LANES) {
+        uint NumLanes = std::min((uint)BATCH_LANES, FirstInstance + NumInstances - GroupStart);
+
+        const aiAnimation* pAnimations[BATCH_LANES] = { NULL };
+        const int* pChannels[BATCH_LANES] = { NULL };
+        KeyframeCursor* pCursors[BATCH_LANES] = { NULL };
+        float AnimationTimeTicks[BATCH_LANES] = { 0.0f };
+
+        for (uint Lane = 0 ; Lane < NumLanes ; Lane++) {
+            uint Instance = GroupStart + Lane;
+            uint AnimationIndex = pAnimationIndices[Instance];
+
+            pAnimations[Lane] = m_animations[AnimationIndex];
+            pChannels[Lane] = GetSkeletonChannels(AnimationIndex);
+            AnimationTimeTicks[Lane] = CalcAnimationTimeTicks(pTimesInSeconds[Instance], AnimationIndex);
+
+            if (ppStates && ppStates[Instance]) {
+                AnimationSamplingState& State = *ppStates[Instance];
+                State.Cursors.resize(m_skeletonChannels.size());
+                pCursors[Lane] = &State.Cursors[AnimationIndex * NumNodes];
+            }
+        }
+
+        for (uint NodeIndex = 0 ; NodeIndex < NumNodes ; NodeIndex++) {
+            const SkeletonNode& Node = m_skeleton[NodeIndex];
+
+            LaneSamples Samples;
+            bool IsAnimated[BATCH_LANES] = { false };
+            uint NumAnimatedLanes = 0;
+
+            for (uint Lane = 0 ; Lane < BATCH_LANES ; Lane++) {
+                int Channel = (Lane < NumLanes) ? pChannels[Lane][NodeIndex] : -1;
+
+                if (Channel >= 0) {
+                    // Without a state the search starts from scratch on every call
+                    KeyframeCursor TempCursor;
+                    KeyframeCursor& Cursor = pCursors[Lane] ? pCursors[Lane][NodeIndex] : TempCursor;
+                    GatherLane(Samples, Lane, pAnimations[Lane]->mChannels[Channel], AnimationTimeTicks[Lane], Cursor);
+                    IsAnimated[Lane] = true;
+                    NumAnimatedLanes++;
+                } else {
+                    GatherIdentityLane(Samples, Lane);
+                }
+            }
+
+            LaneMatrix& Global = pGlobalTransforms[NodeIndex];
+
+            // The global inverse transform is folded into the root instead of
+            // being applied to every bone at the end
+            if (NumAnimatedLanes == 0) {
+                if (Node.ParentIndex >= 0) {
+                    MultiplyLanes(pGlobalTransforms[Node.ParentIndex], Node.Transformation, Global);
+                } else {
+                    BroadcastLanes(m_GlobalInverseTransform * Node.Transformation, Global);
+                }
+            } else {
+                LaneMatrix Local;
+                ComposeLocalTransforms(Samples, Local);
+
+                for (uint Lane = 0 ; Lane < NumLanes ; Lane++) {
+                    if (!IsAnimated[Lane]) {
+                        SetLane(Local, Lane, Node.Transformation);
+                    }
+                }
+
+                if (Node.ParentIndex >= 0) {
+                    MultiplyLanes(pGlobalTransforms[Node.ParentIndex], Local, Global);
+                } else {
+                    MultiplyLanes(m_GlobalInverseTransform, Local, Global);
+                }
+            }
+
+            if (Node.BoneIndex >= 0) {
+                LaneMatrix Bone;
+                MultiplyLanes(Global, m_BoneInfo[Node.BoneIndex].OffsetMatrix, Bone);
+
+                ScatterLanes(Bone, NumLanes, &pTransforms[GroupStart * NumBones + Node.BoneIndex], NumBones);
+            }
+        }
+    }
+}
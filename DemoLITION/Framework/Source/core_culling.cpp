@@ -0,0 +1,254 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Int/core_culling.h"
+
+
+float BoundingVolume::GetSurfaceArea() const
+{
+    if (!IsValid()) {
+        return 0.0f;
+    }
+
+    Vector3f d = Max - Min;
+
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+
+bool BoundingVolume::Contains(const BoundingVolume& Volume) const
+{
+    return (Min.x <= Volume.Min.x) && (Min.y <= Volume.Min.y) && (Min.z <= Volume.Min.z) &&
+           (Max.x >= Volume.Max.x) && (Max.y >= Volume.Max.y) && (Max.z >= Volume.Max.z);
+}
+
+
+bool BoundingVolume::Overlaps(const BoundingVolume& Volume) const
+{
+    return (Min.x <= Volume.Max.x) && (Max.x >= Volume.Min.x) &&
+           (Min.y <= Volume.Max.y) && (Max.y >= Volume.Min.y) &&
+           (Min.z <= Volume.Max.z) && (Max.z >= Volume.Min.z);
+}
+
+
+bool BoundingVolume::OverlapsSphere(const Vector3f& Center, float Radius) const
+{
+    // Distance from the center to the closest point of the box
+    Vector3f Closest(std::min(std::max(Center.x, Min.x), Max.x),
+                     std::min(std::max(Center.y, Min.y), Max.y),
+                     std::min(std::max(Center.z, Min.z), Max.z));
+
+    Vector3f d = Center - Closest;
+
+    return d.Dot(d) <= Radius * Radius;
+}
+
+
+bool BoundingVolume::IntersectsRay(const Vector3f& Origin, const Vector3f& InvDir, float MaxDistance, float& Distance) const
+{
+    float t1 = (Min.x - Origin.x) * InvDir.x;
+    float t2 = (Max.x - Origin.x) * InvDir.x;
+    float tMin = std::min(t1, t2);
+    float tMax = std::max(t1, t2);
+
+    t1 = (Min.y - Origin.y) * InvDir.y;
+    t2 = (Max.y - Origin.y) * InvDir.y;
+    tMin = std::max(tMin, std::min(t1, t2));
+    tMax = std::min(tMax, std::max(t1, t2));
+
+    t1 = (Min.z - Origin.z) * InvDir.z;
+    t2 = (Max.z - Origin.z) * InvDir.z;
+    tMin = std::max(tMin, std::min(t1, t2));
+    tMax = std::min(tMax, std::max(t1, t2));
+
+    tMin = std::max(tMin, 0.0f);
+
+    if ((tMin > tMax) || (tMin > MaxDistance)) {
+        return false;
+    }
+
+    Distance = tMin;
+
+    return true;
+}
+
+
+BoundingVolume BoundingVolume::Transform(const Matrix4f& m) const
+{
+    if (!IsValid()) {
+        return *this;
+    }
+
+    // Transform the center and project the extents on the transformed axes
+    // (Arvo, "Transforming Axis-Aligned Bounding Boxes", Graphics Gems 1990)
+    Vector3f Center = GetCenter();
+    Vector3f Extents = GetExtents();
+
+    Vector4f NewCenter = m * Vector4f(Center, 1.0f);
+
+    Vector3f NewExtents;
+    NewExtents.x = fabsf(m.m[0][0]) * Extents.x + fabsf(m.m[0][1]) * Extents.y + fabsf(m.m[0][2]) * Extents.z;
+    NewExtents.y = fabsf(m.m[1][0]) * Extents.x + fabsf(m.m[1][1]) * Extents.y + fabsf(m.m[1][2]) * Extents.z;
+    NewExtents.z = fabsf(m.m[2][0]) * Extents.x + fabsf(m.m[2][1]) * Extents.y + fabsf(m.m[2][2]) * Extents.z;
+
+    BoundingVolume Ret;
+    Ret.Min = NewCenter.to3f() - NewExtents;
+    Ret.Max = NewCenter.to3f() + NewExtents;
+
+    return Ret;
+}
+
+
+void ViewFrustum::Update(const Matrix4f& ViewProj)
+{
+    const float (&m)[4][4] = ViewProj.m;
+
+    // A point is inside when -w <= x,y,z <= w in clip space. Each inequality
+    // is a plane in world space (Gribb & Hartmann).
+    for (int i = 0 ; i < 3 ; i++) {
+        m_planes[i * 2]     = Vector4f(m[3][0] + m[i][0], m[3][1] + m[i][1], m[3][2] + m[i][2], m[3][3] + m[i][3]);
+        m_planes[i * 2 + 1] = Vector4f(m[3][0] - m[i][0], m[3][1] - m[i][1], m[3][2] - m[i][2], m[3][3] - m[i][3]);
+    }
+
+    // Normalize so that the distance to the sphere center can be compared with the radius
+    for (int i = 0 ; i < NUM_PLANES ; i++) {
+        float Len = m_planes[i].to3f().Length();
+
+        if (Len > 0.0f) {
+            m_planes[i] = m_planes[i] * (1.0f / Len);
+        }
+    }
+}
+
+
+bool ViewFrustum::IsSphereVisible(const Vector3f& Center, float Radius) const
+{
+    Vector4f c(Center, 1.0f);
+
+    for (int i = 0 ; i < NUM_PLANES ; i++) {
+        if (m_planes[i].Dot(c) < -Radius) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+bool ViewFrustum::IsBoxVisible(const BoundingVolume& Box) const
+{
+    for (int i = 0 ; i < NUM_PLANES ; i++) {
+        const Vector4f& p = m_planes[i];
+
+        // The corner of the box which is furthest along the plane normal
+        Vector4f Corner((p.x >= 0.0f) ? Box.Max.x : Box.Min.x,
+                        (p.y >= 0.0f) ? Box.Max.y : Box.Min.y,
+                        (p.z >= 0.0f) ? Box.Max.z : Box.Min.z,
+                        1.0f);
+
+        if (p.Dot(Corner) < 0.0f) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+FRUSTUM_TEST ViewFrustum::ClassifyBox(const BoundingVolume& Box) const
+{
+    FRUSTUM_TEST Ret = FRUSTUM_INSIDE;
+
+    for (int i = 0 ; i < NUM_PLANES ; i++) {
+        const Vector4f& p = m_planes[i];
+
+        // Furthest corner along the normal
+        Vector4f PCorner((p.x >= 0.0f) ? Box.Max.x : Box.Min.x,
+                         (p.y >= 0.0f) ? Box.Max.y : Box.Min.y,
+                         (p.z >= 0.0f) ? Box.Max.z : Box.Min.z,
+                         1.0f);
+
+        if (p.Dot(PCorner) < 0.0f) {
+            return FRUSTUM_OUTSIDE;
+        }
+
+        // Nearest corner along the normal
+        Vector4f NCorner((p.x >= 0.0f) ? Box.Min.x : Box.Max.x,
+                         (p.y >= 0.0f) ? Box.Min.y : Box.Max.y,
+                         (p.z >= 0.0f) ? Box.Min.z : Box.Max.z,
+                         1.0f);
+
+        if (p.Dot(NCorner) < 0.0f) {
+            Ret = FRUSTUM_INTERSECTS;
+        }
+    }
+
+    return Ret;
+}
+
+
+bool ViewFrustum::IsVisible(const BoundingVolume& Volume) const
+{
+    // Nothing is known about invalid (empty) volumes so they are always drawn
+    if (!Volume.IsValid()) {
+        return true;
+    }
+
+    Vector4f c(Volume.GetCenter(), 1.0f);
+    float Radius = Volume.GetRadius();
+    bool Intersects = false;
+
+    for (int i = 0 ; i < NUM_PLANES ; i++) {
+        float Distance = m_planes[i].Dot(c);
+
+        if (Distance < -Radius) {
+            return false;
+        }
+
+        if (Distance < Radius) {
+            Intersects = true;
+        }
+    }
+
+    // The sphere is entirely inside so there is no need to check the box
+    if (!Intersects) {
+        return true;
+    }
+
+    return IsBoxVisible(Volume);
+}
+
+
+bool ViewFrustum::IsVisible(const BoundingVolume& Volume, const Matrix4f& World) const
+{
+    return IsVisible(Volume.Transform(World));
+}
+
+
+bool ViewFrustum::IsVisible(const BoundingVolume& Volume, const Matrix4f& World, CullingStats& Stats) const
+{
+    bool Visible = IsVisible(Volume, World);
+
+    if (Visible) {
+        Stats.NumVisible++;
+    } else {
+        Stats.NumCulled++;
+    }
+
+    return Visible;
+}
@@ -20,10 +20,19 @@
 #include "Int/core_model.h"
 #include "3rdparty/meshoptimizer/src/meshoptimizer.h"
 
+#include <assimp/DefaultIOSystem.h>
+
+#include <algorithm>
+#include <thread>
+#include <atomic>
+
 using namespace std;
 
 // config flags
 static bool UseMeshOptimizer = false;
+static bool UseModelCache = true;
+static bool UseParallelMeshInit = true;
+static bool BuildPickingBVHs = true;
 
 #define DEMOLITION_ASSIMP_LOAD_FLAGS (aiProcess_JoinIdenticalVertices | \
                                       aiProcess_Triangulate | \
@@ -43,6 +52,31 @@ static bool UseMeshOptimizer = false;
 static void traverse(int depth, aiNode* pNode);
 static bool GetFullTransformation(const aiNode* pRootNode, const char* pName, Matrix4f& Transformation);
 
+// Records the files that Assimp opens while importing a model (.mtl, .bin, etc)
+// so that the model cache can be invalidated when one of them changes
+class RecordingIOSystem : public Assimp::DefaultIOSystem
+{
+public:
+    RecordingIOSystem(vector<string>* pFiles) { m_pFiles = pFiles; }
+
+    using Assimp::DefaultIOSystem::Open;
+
+    Assimp::IOStream* Open(const char* pFile, const char* pMode = "rb") override
+    {
+        Assimp::IOStream* pStream = Assimp::DefaultIOSystem::Open(pFile, pMode);
+
+        if (pStream) {
+            m_pFiles->push_back(pFile);
+        }
+
+        return pStream;
+    }
+
+private:
+    vector<string>* m_pFiles = NULL;
+};
+
+
 inline Vector3f VectorFromAssimpVector(const aiVector3D& v)
 {
     Vector3f ret;
@@ -61,18 +95,36 @@ bool CoreModel::LoadAssimpModel(const string& Filename)
 
     bool Ret = false;
 
-    m_pScene = m_Importer.ReadFile(Filename.c_str(), DEMOLITION_ASSIMP_LOAD_FLAGS);
+    u64 SourceHash = 0;
+    bool UseCache = UseModelCache && HashFile(Filename, SourceHash);
+    string CacheFilename = Filename + MODEL_CACHE_EXTENSION;
 
-    if (m_pScene) {
-        printf("--- START Node Hierarchy ---\n");
-        traverse(0, m_pScene->mRootNode);
-        printf("--- END Node Hierarchy ---\n");
-        m_GlobalInverseTransform = m_pScene->mRootNode->mTransformation;
-        m_GlobalInverseTransform = m_GlobalInverseTransform.Inverse();
-        Ret = InitFromScene(m_pScene, Filename);
-    }
-    else {
-        printf("Error parsing '%s': '%s'\n", Filename.c_str(), m_Importer.GetErrorString());
+    if (UseCache && LoadModelCache(CacheFilename, SourceHash)) {
+        Ret = true;
+    } else {
+        // The importer owns the IO handler
+        m_importedFiles.clear();
+        m_Importer.SetIOHandler(new RecordingIOSystem(&m_importedFiles));
+
+        m_pScene = m_Importer.ReadFile(Filename.c_str(), DEMOLITION_ASSIMP_LOAD_FLAGS);
+
+        m_importedFiles.erase(std::remove(m_importedFiles.begin(), m_importedFiles.end(), Filename), m_importedFiles.end());
+
+        if (m_pScene) {
+            printf("--- START Node Hierarchy ---\n");
+            traverse(0, m_pScene->mRootNode);
+            printf("--- END Node Hierarchy ---\n");
+            m_GlobalInverseTransform = m_pScene->mRootNode->mTransformation;
+            m_GlobalInverseTransform = m_GlobalInverseTransform.Inverse();
+            Ret = InitFromScene(m_pScene, Filename);
+
+            if (Ret && UseCache) {
+                SaveModelCache(CacheFilename, SourceHash);
+            }
+        }
+        else {
+            printf("Error parsing '%s': '%s'\n", Filename.c_str(), m_Importer.GetErrorString());
+        }
     }
 
 #ifndef OGLDEV_VULKAN // TODO: move to GLModel using virtual function
@@ -110,15 +162,27 @@ bool CoreModel::InitGeometry(const aiScene* pScene, const string& Filename)
     CountVerticesAndIndices(pScene, NumVertices, NumIndices);
 
     printf("Num animations %d\n", pScene->mNumAnimations);
+    m_animations.assign(pScene->mAnimations, pScene->mAnimations + pScene->mNumAnimations);
 
     if (pScene->mNumAnimations > 0) {
         std::vector<SkinnedVertex> Vertices;
         InitGeometryInternal<SkinnedVertex>(Vertices, NumVertices, NumIndices);
-        PopulateBuffersSkinned(Vertices);
+        CompileSkeleton(pScene);
+        BuildMeshBVHs<SkinnedVertex>(Vertices.data(), m_Indices.data());
+        PopulateBuffersSkinned(Vertices.data(), (uint)Vertices.size(), m_Indices.data(), (uint)m_Indices.size());
+
+        if (UseModelCache) {
+            m_vertexCacheData.assign((const char*)Vertices.data(), (const char*)(Vertices.data() + Vertices.size()));
+        }
     } else {
         std::vector<Vertex> Vertices;
         InitGeometryInternal<Vertex>(Vertices, NumVertices, NumIndices);
-        PopulateBuffers(Vertices);
+        BuildMeshBVHs<Vertex>(Vertices.data(), m_Indices.data());
+        PopulateBuffers(Vertices.data(), (uint)Vertices.size(), m_Indices.data(), (uint)m_Indices.size());
+
+        if (UseModelCache) {
+            m_vertexCacheData.assign((const char*)Vertices.data(), (const char*)(Vertices.data() + Vertices.size()));
+        }
     }
 
     if (!InitMaterials(pScene, Filename)) {
@@ -127,6 +191,8 @@ bool CoreModel::InitGeometry(const aiScene* pScene, const string& Filename)
 
     CalculateMeshTransformations(pScene);
 
+    CalcModelBounds();
+
     InitGeometryPost();
 
 #ifdef OGLDEV_VULKAN
@@ -193,13 +259,114 @@ void CoreModel::ReserveSpace(std::vector<VertexType>& Vertices, unsigned int Num
 template<typename VertexType>
 void CoreModel::InitAllMeshes(const aiScene* pScene, std::vector<VertexType>& Vertices)
 {
+    // Bone indices are allocated in the order the bones are encountered so this
+    // must run serially and before the meshes are processed. The processing itself
+    // only reads the bone name map.
+    if constexpr (std::is_same_v<VertexType, SkinnedVertex>) {
+        for (unsigned int i = 0 ; i < m_Meshes.size() ; i++) {
+            RegisterMeshBones(pScene->mMeshes[i]);
+        }
+    }
+
+    std::vector<MeshStagingBuffer<VertexType>> StagingBuffers(m_Meshes.size());
+
+    ProcessMeshes<VertexType>(pScene, StagingBuffers);
+
+    int TotalSourceIndices = 0;
+
+    // Concatenate the staging buffers in mesh order so that the result does not
+    // depend on the number of threads
     for (unsigned int i = 0 ; i < m_Meshes.size() ; i++) {
-        const aiMesh* paiMesh = pScene->mMeshes[i];
-        if (UseMeshOptimizer) {
-            InitSingleMeshOpt<VertexType>(Vertices, i, paiMesh);
-        } else {
-            InitSingleMesh<VertexType>(Vertices, i, paiMesh);
+        MeshStagingBuffer<VertexType>& Staging = StagingBuffers[i];
+
+        printf("Mesh %d %s\n", i, pScene->mMeshes[i]->mName.C_Str());
+
+        m_Meshes[i].BaseVertex = (uint)Vertices.size();
+        m_Meshes[i].BaseIndex = (uint)m_Indices.size();
+        m_Meshes[i].NumIndices = (uint)Staging.Indices.size();
+
+        Vertices.insert(Vertices.end(), Staging.Vertices.begin(), Staging.Vertices.end());
+        m_Indices.insert(m_Indices.end(), Staging.Indices.begin(), Staging.Indices.end());
+
+        m_minPos.x = std::min(m_minPos.x, Staging.MinPos.x);
+        m_minPos.y = std::min(m_minPos.y, Staging.MinPos.y);
+        m_minPos.z = std::min(m_minPos.z, Staging.MinPos.z);
+
+        m_maxPos.x = std::max(m_maxPos.x, Staging.MaxPos.x);
+        m_maxPos.y = std::max(m_maxPos.y, Staging.MaxPos.y);
+        m_maxPos.z = std::max(m_maxPos.z, Staging.MaxPos.z);
+
+        m_Meshes[i].Bounds.Min = Staging.MinPos;
+        m_Meshes[i].Bounds.Max = Staging.MaxPos;
+
+        TotalSourceIndices += Staging.NumSourceIndices;
+
+        // Release the staging memory as we go to keep the peak usage down
+        std::vector<VertexType>().swap(Staging.Vertices);
+        std::vector<uint>().swap(Staging.Indices);
+    }
+
+    if (UseMeshOptimizer) {
+        printf("Num indices %d\n", TotalSourceIndices);
+        printf("Optimized number of indices %d\n", (int)m_Indices.size());
+    }
+}
+
+
+template<typename VertexType>
+void CoreModel::ProcessMeshes(const aiScene* pScene, std::vector<MeshStagingBuffer<VertexType>>& StagingBuffers) const
+{
+    uint NumMeshes = (uint)StagingBuffers.size();
+    uint NumThreads = 1;
+
+    if (UseParallelMeshInit) {
+        NumThreads = std::min(std::max(std::thread::hardware_concurrency(), 1u), NumMeshes);
+    }
+
+    if (NumThreads <= 1) {
+        for (uint i = 0 ; i < NumMeshes ; i++) {
+            ProcessSingleMesh<VertexType>(StagingBuffers[i], pScene->mMeshes[i]);
         }
+        return;
+    }
+
+    printf("Processing %d meshes on %d threads\n", NumMeshes, NumThreads);
+
+    // Each worker grabs the next unprocessed mesh so that a few large meshes
+    // don't leave the other threads idle
+    std::atomic<uint> NextMesh(0);
+
+    auto Worker = [&]() {
+        uint MeshIndex = 0;
+
+        while ((MeshIndex = NextMesh.fetch_add(1)) < NumMeshes) {
+            ProcessSingleMesh<VertexType>(StagingBuffers[MeshIndex], pScene->mMeshes[MeshIndex]);
+        }
+    };
+
+    std::vector<std::thread> Threads;
+    Threads.reserve(NumThreads - 1);
+
+    for (uint i = 0 ; i < NumThreads - 1 ; i++) {
+        Threads.emplace_back(Worker);
+    }
+
+    // The calling thread is part of the pool
+    Worker();
+
+    for (std::thread& t : Threads) {
+        t.join();
+    }
+}
+
+
+template<typename VertexType>
+void CoreModel::ProcessSingleMesh(MeshStagingBuffer<VertexType>& Staging, const aiMesh* paiMesh) const
+{
+    if (UseMeshOptimizer) {
+        InitSingleMeshOpt<VertexType>(Staging, paiMesh);
+    } else {
+        InitSingleMesh<VertexType>(Staging, paiMesh);
     }
 }
 
@@ -215,6 +382,105 @@ void CoreModel::CalculateMeshTransformations(const aiScene* pScene)
 }
 
 
+// The meshes are independent so each one is built on a worker thread just
+// like in ProcessMeshes
+template<typename VertexType>
+void CoreModel::BuildMeshBVHs(const VertexType* pVertices, const uint* pIndices)
+{
+    m_meshBVHs.clear();
+
+    if (!BuildPickingBVHs) {
+        return;
+    }
+
+    uint NumMeshes = (uint)m_Meshes.size();
+    m_meshBVHs.resize(NumMeshes);
+
+    auto BuildSingle = [&](uint MeshIndex) {
+        const BasicMeshEntry& Mesh = m_Meshes[MeshIndex];
+        const uint* pMeshIndices = pIndices + Mesh.BaseIndex;
+
+        // The indices of the mesh are relative to its base vertex
+        uint NumVertices = 0;
+
+        for (uint i = 0 ; i < Mesh.NumIndices ; i++) {
+            NumVertices = std::max(NumVertices, pMeshIndices[i] + 1);
+        }
+
+        std::vector<Vector3f> Positions(NumVertices);
+
+        for (uint i = 0 ; i < NumVertices ; i++) {
+            Positions[i] = pVertices[Mesh.BaseVertex + i].Position;
+        }
+
+        m_meshBVHs[MeshIndex].Build(Positions.data(), NumVertices, pMeshIndices, Mesh.NumIndices);
+    };
+
+    uint NumThreads = 1;
+
+    if (UseParallelMeshInit) {
+        NumThreads = std::min(std::max(std::thread::hardware_concurrency(), 1u), NumMeshes);
+    }
+
+    std::atomic<uint> NextMesh(0);
+
+    auto Worker = [&]() {
+        uint MeshIndex = 0;
+
+        while ((MeshIndex = NextMesh.fetch_add(1)) < NumMeshes) {
+            BuildSingle(MeshIndex);
+        }
+    };
+
+    std::vector<std::thread> Threads;
+
+    for (uint i = 0 ; i + 1 < NumThreads ; i++) {
+        Threads.emplace_back(Worker);
+    }
+
+    Worker();
+
+    for (std::thread& t : Threads) {
+        t.join();
+    }
+}
+
+
+bool CoreModel::RayCast(const Matrix4f& ObjectMatrix, const Vector3f& Origin, const Vector3f& Dir, float MaxDistance, ModelRayHit& Hit) const
+{
+    bool Found = false;
+    float Closest = MaxDistance;
+
+    for (uint i = 0 ; i < (uint)m_meshBVHs.size() ; i++) {
+        // Same world matrix as the draw path. The root of the mesh BVH is the mesh
+        // bounds so a ray which misses the mesh is rejected right away.
+        Matrix4f World = ObjectMatrix * m_Meshes[i].Transformation;
+
+        TriangleHit TriHit;
+
+        if (m_meshBVHs[i].RayCast(World, Origin, Dir, Closest, TriHit)) {
+            Closest = TriHit.Distance;
+            Hit.MeshIndex = i;
+            Hit.Triangle = TriHit.Triangle;
+            Hit.Distance = TriHit.Distance;
+            Found = true;
+        }
+    }
+
+    return Found;
+}
+
+
+void CoreModel::CalcModelBounds()
+{
+    m_bounds = BoundingVolume();
+
+    for (uint i = 0 ; i < m_Meshes.size() ; i++) {
+        m_bounds.Add(m_Meshes[i].Bounds.Transform(m_Meshes[i].Transformation));
+    }
+}
+
+
 void CoreModel::TraverseNodeHierarchy(Matrix4f ParentTransformation, aiNode* pNode)
 {
     printf("Traversing node '%s'\n", pNode->mName.C_Str());
@@ -246,25 +512,26 @@ void CoreModel::TraverseNodeHierarchy(Matrix4f ParentTransformation, aiNode* pNo
 
 
 template<typename VertexType>
-void CoreModel::InitSingleMesh(vector<VertexType>& Vertices, uint MeshIndex, const aiMesh* paiMesh)
+void CoreModel::InitSingleMesh(MeshStagingBuffer<VertexType>& Staging, const aiMesh* paiMesh) const
 {
     const aiVector3D Zero3D(0.0f, 0.0f, 0.0f);
 
-    printf("Mesh %d %s\n", MeshIndex, paiMesh->mName.C_Str());
     // Populate the vertex attribute vectors
     VertexType v;
 
+    Staging.Vertices.reserve(paiMesh->mNumVertices);
+
     for (unsigned int i = 0 ; i < paiMesh->mNumVertices ; i++) {
         const aiVector3D& Pos = paiMesh->mVertices[i];       
         v.Position = Vector3f(Pos.x, Pos.y, Pos.z);
 
-        m_minPos.x = std::min(m_minPos.x, v.Position.x);
-        m_minPos.y = std::min(m_minPos.y, v.Position.y);
-        m_minPos.z = std::min(m_minPos.z, v.Position.z);
+        Staging.MinPos.x = std::min(Staging.MinPos.x, v.Position.x);
+        Staging.MinPos.y = std::min(Staging.MinPos.y, v.Position.y);
+        Staging.MinPos.z = std::min(Staging.MinPos.z, v.Position.z);
 
-        m_maxPos.x = std::max(m_maxPos.x, v.Position.x);
-        m_maxPos.y = std::max(m_maxPos.y, v.Position.y);
-        m_maxPos.z = std::max(m_maxPos.z, v.Position.z);
+        Staging.MaxPos.x = std::max(Staging.MaxPos.x, v.Position.x);
+        Staging.MaxPos.y = std::max(Staging.MaxPos.y, v.Position.y);
+        Staging.MaxPos.z = std::max(Staging.MaxPos.z, v.Position.z);
 
         if (paiMesh->mNormals) {
             const aiVector3D& pNormal   = paiMesh->mNormals[i];
@@ -294,9 +561,11 @@ void CoreModel::InitSingleMesh(vector<VertexType>& Vertices, uint MeshIndex, con
         printf("Tangent: "); v.Tangent.Print();
         printf("Bitangent: "); v.Bitangent.Print();*/
 
-        Vertices.push_back(v);
+        Staging.Vertices.push_back(v);
     }
 
+    Staging.Indices.reserve(paiMesh->mNumFaces * 3);
+
     // Populate the index buffer
     for (unsigned int i = 0 ; i < paiMesh->mNumFaces ; i++) {
         const aiFace& Face = paiMesh->mFaces[i];
@@ -308,33 +577,43 @@ void CoreModel::InitSingleMesh(vector<VertexType>& Vertices, uint MeshIndex, con
      /*   printf("%d: %d\n", i * 3, Face.mIndices[0]);
         printf("%d: %d\n", i * 3 + 1, Face.mIndices[1]);
         printf("%d: %d\n", i * 3 + 2, Face.mIndices[2]);*/
-        m_Indices.push_back(Face.mIndices[0]);
-        m_Indices.push_back(Face.mIndices[1]);
-        m_Indices.push_back(Face.mIndices[2]);
+        Staging.Indices.push_back(Face.mIndices[0]);
+        Staging.Indices.push_back(Face.mIndices[1]);
+        Staging.Indices.push_back(Face.mIndices[2]);
     }
 
+    Staging.NumSourceIndices = (uint)Staging.Indices.size();
+
     if constexpr (std::is_same_v<VertexType, SkinnedVertex>) {
-        LoadMeshBones(Vertices, MeshIndex, paiMesh);
+        LoadMeshBones(Staging.Vertices, paiMesh);
     }  
 }
 
 
 template<typename VertexType>
-void CoreModel::InitSingleMeshOpt(vector<VertexType>& AllVertices, uint MeshIndex, const aiMesh* paiMesh)
+void CoreModel::InitSingleMeshOpt(MeshStagingBuffer<VertexType>& Staging, const aiMesh* paiMesh) const
 {
     const aiVector3D Zero3D(0.0f, 0.0f, 0.0f);
 
-    // printf("Mesh %d\n", MeshIndex);
     // Populate the vertex attribute vectors
     VertexType v;
 
-    std::vector<VertexType> Vertices(paiMesh->mNumVertices);
+    std::vector<VertexType>& Vertices = Staging.Vertices;
+    Vertices.resize(paiMesh->mNumVertices);
 
     for (unsigned int i = 0; i < paiMesh->mNumVertices; i++) {
         const aiVector3D& Pos = paiMesh->mVertices[i];
         // printf("%d: ", i); Vector3f v(pPos.x, pPos.y, pPos.z); v.Print();
         v.Position = Vector3f(Pos.x, Pos.y, Pos.z);
 
+        Staging.MinPos.x = std::min(Staging.MinPos.x, v.Position.x);
+        Staging.MinPos.y = std::min(Staging.MinPos.y, v.Position.y);
+        Staging.MinPos.z = std::min(Staging.MinPos.z, v.Position.z);
+
+        Staging.MaxPos.x = std::max(Staging.MaxPos.x, v.Position.x);
+        Staging.MaxPos.y = std::max(Staging.MaxPos.y, v.Position.y);
+        Staging.MaxPos.z = std::max(Staging.MaxPos.z, v.Position.z);
+
         if (paiMesh->mNormals) {
             const aiVector3D& pNormal = paiMesh->mNormals[i];
             v.Normal = Vector3f(pNormal.x, pNormal.y, pNormal.z);
@@ -362,12 +641,9 @@ void CoreModel::InitSingleMeshOpt(vector<VertexType>& AllVertices, uint MeshInde
         Vertices[i] = v;
     }
 
-    m_Meshes[MeshIndex].BaseVertex = (uint)AllVertices.size();
-    m_Meshes[MeshIndex].BaseIndex = (uint)m_Indices.size();
-
     int NumIndices = paiMesh->mNumFaces * 3;
 
-    std::vector<uint> Indices;
+    std::vector<uint>& Indices = Staging.Indices;
     Indices.resize(NumIndices);
 
     // Populate the index buffer
@@ -384,17 +660,24 @@ void CoreModel::InitSingleMeshOpt(vector<VertexType>& AllVertices, uint MeshInde
         Indices[i * 3 + 2] = Face.mIndices[2];
     }
 
+    Staging.NumSourceIndices = (uint)NumIndices;
+
+    // The bone weights are part of the vertex so they must be loaded before the
+    // optimizer looks for duplicate vertices
     if constexpr (std::is_same_v<VertexType, SkinnedVertex>) {
-	    LoadMeshBones(Vertices, MeshIndex, paiMesh);
+	    LoadMeshBones(Vertices, paiMesh);
 	}
 
-    OptimizeMesh(MeshIndex, Indices, Vertices, AllVertices);
+    OptimizeMesh(Staging);
 }
 
 
 template<typename VertexType>
-void CoreModel::OptimizeMesh(int MeshIndex, std::vector<uint>&Indices, std::vector<VertexType>&Vertices, std::vector<VertexType>& AllVertices)
+void CoreModel::OptimizeMesh(MeshStagingBuffer<VertexType>& Staging) const
 {
+    std::vector<uint>& Indices = Staging.Indices;
+    std::vector<VertexType>& Vertices = Staging.Vertices;
+
     size_t NumIndices = Indices.size();
     size_t NumVertices = Vertices.size();
 
@@ -435,21 +718,12 @@ void CoreModel::OptimizeMesh(int MeshIndex, std::vector<uint>&Indices, std::vect
     size_t OptIndexCount = meshopt_simplify(SimplifiedIndices.data(), OptIndices.data(), NumIndices,
                                             &OptVertices[0].Position.x, OptVertexCount, sizeof(VertexType), TargetIndexCount, TargetError);
 
-    static int num_indices = 0;
-    num_indices += (int)NumIndices;
-    static int opt_indices = 0;
-    opt_indices += (int)OptIndexCount;
-    printf("Num indices %d\n", num_indices);
     //printf("Target num indices %d\n", TargetIndexCount);
-    printf("Optimized number of indices %d\n", opt_indices);
     SimplifiedIndices.resize(OptIndexCount);
     
-    // Concatenate the local arrays into the class attributes arrays
-    m_Indices.insert(m_Indices.end(), SimplifiedIndices.begin(), SimplifiedIndices.end());
-
-    AllVertices.insert(AllVertices.end(), OptVertices.begin(), OptVertices.end());
-
-    m_Meshes[MeshIndex].NumIndices = (uint)OptIndexCount;
+    // Replace the source arrays in the staging buffer with the optimized ones
+    Indices.swap(SimplifiedIndices);
+    Vertices.swap(OptVertices);
 }
 
 
@@ -461,6 +735,8 @@ bool CoreModel::InitMaterials(const aiScene* pScene, const string& Filename)
 
     printf("Num materials: %d\n", pScene->mNumMaterials);
 
+    m_textureSources.resize(pScene->mNumMaterials);
+
     // Initialize the materials
     for (unsigned int i = 0 ; i < pScene->mNumMaterials ; i++) {
         const aiMaterial* pMaterial = pScene->mMaterials[i];
@@ -529,6 +805,8 @@ void CoreModel::LoadDiffuseTextureEmbedded(const aiTexture* paiTexture, int Mate
     m_Materials[MaterialIndex].pDiffuse = AllocTexture2D();
     int buffer_size = paiTexture->mWidth;   // TODO: just the width???
     m_Materials[MaterialIndex].pDiffuse->Load(buffer_size, paiTexture->pcData);
+    m_textureSources[MaterialIndex].Sources[TEXTURE_SOURCE_DIFFUSE].pEmbeddedData = paiTexture->pcData;
+    m_textureSources[MaterialIndex].Sources[TEXTURE_SOURCE_DIFFUSE].EmbeddedSize = buffer_size;
 }
 
 
@@ -551,6 +829,7 @@ void CoreModel::LoadDiffuseTextureFromFile(const string& Dir, const aiString& Pa
     m_Materials[MaterialIndex].pDiffuse = AllocTexture2D();
 
     m_Materials[MaterialIndex].pDiffuse->Load(FullPath.c_str());
+    m_textureSources[MaterialIndex].Sources[TEXTURE_SOURCE_DIFFUSE].FilePath = FullPath;
     printf("Loaded diffuse texture '%s' at index %d\n", FullPath.c_str(), MaterialIndex);
 }
 
@@ -581,6 +860,8 @@ void CoreModel::LoadSpecularTextureEmbedded(const aiTexture* paiTexture, int Mat
     m_Materials[MaterialIndex].pSpecularExponent = AllocTexture2D();
     int buffer_size = paiTexture->mWidth;   // TODO: just the width???
     m_Materials[MaterialIndex].pSpecularExponent->Load(buffer_size, paiTexture->pcData);
+    m_textureSources[MaterialIndex].Sources[TEXTURE_SOURCE_SPECULAR].pEmbeddedData = paiTexture->pcData;
+    m_textureSources[MaterialIndex].Sources[TEXTURE_SOURCE_SPECULAR].EmbeddedSize = buffer_size;
 }
 
 
@@ -599,6 +880,7 @@ void CoreModel::LoadSpecularTextureFromFile(const string& Dir, const aiString& P
     m_Materials[MaterialIndex].pSpecularExponent = AllocTexture2D();
 
     m_Materials[MaterialIndex].pSpecularExponent->Load(FullPath.c_str());
+    m_textureSources[MaterialIndex].Sources[TEXTURE_SOURCE_SPECULAR].FilePath = FullPath;
     printf("Loaded specular texture '%s'\n", FullPath.c_str());
 }
 
@@ -630,6 +912,8 @@ void CoreModel::LoadNormalTextureEmbedded(const aiTexture* paiTexture, int Mater
     m_Materials[MaterialIndex].pNormal = AllocTexture2D();
     int buffer_size = paiTexture->mWidth;   // TODO: just the width???
     m_Materials[MaterialIndex].pNormal->Load(buffer_size, paiTexture->pcData);
+    m_textureSources[MaterialIndex].Sources[TEXTURE_SOURCE_NORMAL].pEmbeddedData = paiTexture->pcData;
+    m_textureSources[MaterialIndex].Sources[TEXTURE_SOURCE_NORMAL].EmbeddedSize = buffer_size;
 }
 
 
@@ -649,6 +933,7 @@ void CoreModel::LoadNormalTextureFromFile(const string& Dir, const aiString& Pat
     m_Materials[MaterialIndex].pNormal = AllocTexture2D();
 
     m_Materials[MaterialIndex].pNormal->Load(FullPath.c_str());
+    m_textureSources[MaterialIndex].Sources[TEXTURE_SOURCE_NORMAL].FilePath = FullPath;
     printf("Loaded normal texture '%s'\n", FullPath.c_str());
 }
 
@@ -760,6 +1045,7 @@ void CoreModel::InitCameras(const aiScene* pScene)
     printf("Loading %d cameras\n", pScene->mNumCameras);
 
     m_cameras.resize(pScene->mNumCameras);
+    m_cameraInitInfo.resize(pScene->mNumCameras);
 
     for (unsigned int i = 0; i < pScene->mNumCameras; i++) {
         InitSingleCamera(i, pScene);
@@ -827,6 +1113,11 @@ void CoreModel::InitSingleCamera(int Index, const aiScene* pScene)
 
     Vector3f Center = FinalPos + FinalTarget;
     m_cameras[Index].Init(FinalPos.ToGLM(), Center.ToGLM(), FinalUp.ToGLM(), persProjInfo);
+
+    m_cameraInitInfo[Index].Pos = FinalPos;
+    m_cameraInitInfo[Index].Target = Center;
+    m_cameraInitInfo[Index].Up = FinalUp;
+    m_cameraInitInfo[Index].persProjInfo = persProjInfo;
 }
 
 
@@ -1018,7 +1309,7 @@ void CoreModel::InitSpotLight(const aiScene* pScene, const aiLight& light)
 }
 
 
-void CoreModel::LoadMeshBones(vector<SkinnedVertex>& SkinnedVertices, uint MeshIndex, const aiMesh* pMesh)
+void CoreModel::RegisterMeshBones(const aiMesh* pMesh)
 {
     if (pMesh->mNumBones > MAX_BONES) {
         printf("The number of bones in the model (%d) is larger than the maximum supported (%d)\n", pMesh->mNumBones, MAX_BONES);
@@ -1026,32 +1317,45 @@ void CoreModel::LoadMeshBones(vector<SkinnedVertex>& SkinnedVertices, uint MeshI
         assert(0);
     }
 
-    // printf("Loading mesh bones %d\n", MeshIndex);
     for (uint i = 0 ; i < pMesh->mNumBones ; i++) {
-        // printf("Bone %d %s\n", i, pMesh->mBones[i]->mName.C_Str());
-        LoadSingleBone(SkinnedVertices, MeshIndex, pMesh->mBones[i]);
+        const aiBone* pBone = pMesh->mBones[i];
+        int BoneId = GetBoneId(pBone);
+
+        if (BoneId == m_BoneInfo.size()) {
+            BoneInfo bi(pBone->mOffsetMatrix);
+            // bi.OffsetMatrix.Print();
+            m_BoneInfo.push_back(bi);
+        }
+
+        MarkRequiredNodesForBone(pBone);
     }
 }
 
 
-void CoreModel::LoadSingleBone(vector<SkinnedVertex>& SkinnedVertices, uint MeshIndex, const aiBone* pBone)
+// The vertex IDs in the bones are local to the mesh so SkinnedVertices
+// must contain only the vertices of this mesh
+void CoreModel::LoadMeshBones(vector<SkinnedVertex>& SkinnedVertices, const aiMesh* pMesh) const
 {
-    int BoneId = GetBoneId(pBone);
-
-    if (BoneId == m_BoneInfo.size()) {
-        BoneInfo bi(pBone->mOffsetMatrix);
-        // bi.OffsetMatrix.Print();
-        m_BoneInfo.push_back(bi);
+    // printf("Loading mesh bones\n");
+    for (uint i = 0 ; i < pMesh->mNumBones ; i++) {
+        // printf("Bone %d %s\n", i, pMesh->mBones[i]->mName.C_Str());
+        LoadSingleBone(SkinnedVertices, pMesh->mBones[i]);
     }
+}
+
+
+void CoreModel::LoadSingleBone(vector<SkinnedVertex>& SkinnedVertices, const aiBone* pBone) const
+{
+    // The bone was registered by RegisterMeshBones
+    map<string,uint>::const_iterator it = m_BoneNameToIndexMap.find(string(pBone->mName.C_Str()));
+    assert(it != m_BoneNameToIndexMap.end());
+    int BoneId = (int)it->second;
 
     for (uint i = 0 ; i < pBone->mNumWeights ; i++) {
         const aiVertexWeight& vw = pBone->mWeights[i];
-        uint GlobalVertexID = m_Meshes[MeshIndex].BaseVertex + pBone->mWeights[i].mVertexId;
         // printf("%d: %d %f\n",i, pBone->mWeights[i].mVertexId, vw.mWeight);
-        SkinnedVertices[GlobalVertexID].Bones.AddBoneData(BoneId, vw.mWeight);
+        SkinnedVertices[vw.mVertexId].Bones.AddBoneData(BoneId, vw.mWeight);
     }
-
-    MarkRequiredNodesForBone(pBone);
 }
 
 
@@ -1113,20 +1417,13 @@ int CoreModel::GetBoneId(const aiBone* pBone)
 }
 
 
-uint CoreModel::FindPosition(float AnimationTimeTicks, const aiNodeAnim* pNodeAnim)
+uint CoreModel::FindPosition(float AnimationTimeTicks, const aiNodeAnim* pNodeAnim, uint& Cursor)
 {
-    for (uint i = 0 ; i < pNodeAnim->mNumPositionKeys - 1 ; i++) {
-        float t = (float)pNodeAnim->mPositionKeys[i + 1].mTime;
-        if (AnimationTimeTicks < t) {
-            return i;
-        }
-    }
-
-    return 0;
+    return FindKeyframe(pNodeAnim->mPositionKeys, pNodeAnim->mNumPositionKeys, AnimationTimeTicks, Cursor);
 }
 
 
-void CoreModel::CalcInterpolatedPosition(aiVector3D& Out, float AnimationTimeTicks, const aiNodeAnim* pNodeAnim)
+void CoreModel::CalcInterpolatedPosition(aiVector3D& Out, float AnimationTimeTicks, const aiNodeAnim* pNodeAnim, uint& Cursor)
 {
     // we need at least two values to interpolate...
     if (pNodeAnim->mNumPositionKeys == 1) {
@@ -1134,7 +1431,7 @@ void CoreModel::CalcInterpolatedPosition(aiVector3D& Out, float AnimationTimeTic
         return;
     }
 
-    uint PositionIndex = FindPosition(AnimationTimeTicks, pNodeAnim);
+    uint PositionIndex = FindPosition(AnimationTimeTicks, pNodeAnim, Cursor);
     uint NextPositionIndex = PositionIndex + 1;
     assert(NextPositionIndex < pNodeAnim->mNumPositionKeys);
     float t1 = (float)pNodeAnim->mPositionKeys[PositionIndex].mTime;
@@ -1153,22 +1450,13 @@ void CoreModel::CalcInterpolatedPosition(aiVector3D& Out, float AnimationTimeTic
 }
 
 
-uint CoreModel::FindRotation(float AnimationTimeTicks, const aiNodeAnim* pNodeAnim)
+uint CoreModel::FindRotation(float AnimationTimeTicks, const aiNodeAnim* pNodeAnim, uint& Cursor)
 {
-    assert(pNodeAnim->mNumRotationKeys > 0);
-
-    for (uint i = 0 ; i < pNodeAnim->mNumRotationKeys - 1 ; i++) {
-        float t = (float)pNodeAnim->mRotationKeys[i + 1].mTime;
-        if (AnimationTimeTicks < t) {
-            return i;
-        }
-    }
-
-    return 0;
+    return FindKeyframe(pNodeAnim->mRotationKeys, pNodeAnim->mNumRotationKeys, AnimationTimeTicks, Cursor);
 }
 
 
-void CoreModel::CalcInterpolatedRotation(aiQuaternion& Out, float AnimationTimeTicks, const aiNodeAnim* pNodeAnim)
+void CoreModel::CalcInterpolatedRotation(aiQuaternion& Out, float AnimationTimeTicks, const aiNodeAnim* pNodeAnim, uint& Cursor)
 {
     // we need at least two values to interpolate...
     if (pNodeAnim->mNumRotationKeys == 1) {
@@ -1176,7 +1464,7 @@ void CoreModel::CalcInterpolatedRotation(aiQuaternion& Out, float AnimationTimeT
         return;
     }
 
-    uint RotationIndex = FindRotation(AnimationTimeTicks, pNodeAnim);
+    uint RotationIndex = FindRotation(AnimationTimeTicks, pNodeAnim, Cursor);
     uint NextRotationIndex = RotationIndex + 1;
     assert(NextRotationIndex < pNodeAnim->mNumRotationKeys);
     float t1 = (float)pNodeAnim->mRotationKeys[RotationIndex].mTime;
@@ -1196,22 +1484,13 @@ void CoreModel::CalcInterpolatedRotation(aiQuaternion& Out, float AnimationTimeT
 }
 
 
-uint CoreModel::FindScaling(float AnimationTimeTicks, const aiNodeAnim* pNodeAnim)
+uint CoreModel::FindScaling(float AnimationTimeTicks, const aiNodeAnim* pNodeAnim, uint& Cursor)
 {
-    assert(pNodeAnim->mNumScalingKeys > 0);
-
-    for (uint i = 0 ; i < pNodeAnim->mNumScalingKeys - 1 ; i++) {
-        float t = (float)pNodeAnim->mScalingKeys[i + 1].mTime;
-        if (AnimationTimeTicks < t) {
-            return i;
-        }
-    }
-
-    return 0;
+    return FindKeyframe(pNodeAnim->mScalingKeys, pNodeAnim->mNumScalingKeys, AnimationTimeTicks, Cursor);
 }
 
 
-void CoreModel::CalcInterpolatedScaling(aiVector3D& Out, float AnimationTimeTicks, const aiNodeAnim* pNodeAnim)
+void CoreModel::CalcInterpolatedScaling(aiVector3D& Out, float AnimationTimeTicks, const aiNodeAnim* pNodeAnim, uint& Cursor)
 {
     // we need at least two values to interpolate...
     if (pNodeAnim->mNumScalingKeys == 1) {
@@ -1219,7 +1498,7 @@ void CoreModel::CalcInterpolatedScaling(aiVector3D& Out, float AnimationTimeTick
         return;
     }
 
-    uint ScalingIndex = FindScaling(AnimationTimeTicks, pNodeAnim);
+    uint ScalingIndex = FindScaling(AnimationTimeTicks, pNodeAnim, Cursor);
     uint NextScalingIndex = ScalingIndex + 1;
     assert(NextScalingIndex < pNodeAnim->mNumScalingKeys);
     float t1 = (float)pNodeAnim->mScalingKeys[ScalingIndex].mTime;
@@ -1238,120 +1517,244 @@ void CoreModel::CalcInterpolatedScaling(aiVector3D& Out, float AnimationTimeTick
 }
 
 
-void CoreModel::ReadNodeHierarchy(float AnimationTimeTicks, const aiNode* pNode, const Matrix4f& ParentTransform, const aiAnimation& Animation)
+void CoreModel::CalcLocalTransform(LocalTransform& Transform, float AnimationTimeTicks, const aiNodeAnim* pNodeAnim, KeyframeCursor& Cursor)
 {
-    string NodeName(pNode->mName.data);
+    CalcInterpolatedScaling(Transform.Scaling, AnimationTimeTicks, pNodeAnim, Cursor.Scaling);
+    CalcInterpolatedRotation(Transform.Rotation, AnimationTimeTicks, pNodeAnim, Cursor.Rotation);
+    CalcInterpolatedPosition(Transform.Translation, AnimationTimeTicks, pNodeAnim, Cursor.Position);
+}
 
-    Matrix4f NodeTransformation(pNode->mTransformation);
 
-    const aiNodeAnim* pNodeAnim = FindNodeAnim(Animation, NodeName);
+Matrix4f CoreModel::CalcNodeTransformation(const LocalTransform& Transform) const
+{
+    Matrix4f ScalingM;
+    ScalingM.InitScaleTransform(Transform.Scaling.x, Transform.Scaling.y, Transform.Scaling.z);
+    //        printf("Scaling %f %f %f\n", Transoform.Scaling.x, Transform.Scaling.y, Transform.Scaling.z);
 
-    if (pNodeAnim) {
-        LocalTransform Transform;
-        CalcLocalTransform(Transform, AnimationTimeTicks, pNodeAnim);
+    Matrix4f RotationM = Matrix4f(Transform.Rotation.GetMatrix());
 
-        Matrix4f ScalingM;
-        ScalingM.InitScaleTransform(Transform.Scaling.x, Transform.Scaling.y, Transform.Scaling.z);
-        //        printf("Scaling %f %f %f\n", Transoform.Scaling.x, Transform.Scaling.y, Transform.Scaling.z);
+    Matrix4f TranslationM;
+    TranslationM.InitTranslationTransform(Transform.Translation.x, Transform.Translation.y, Transform.Translation.z);
+    //        printf("Translation %f %f %f\n", Transform.Translation.x, Transform.Translation.y, Transform.Translation.z);
 
-        Matrix4f RotationM = Matrix4f(Transform.Rotation.GetMatrix());
+    // Combine the above transformations
+    return TranslationM * RotationM * ScalingM;
+}
 
-        Matrix4f TranslationM;
-        TranslationM.InitTranslationTransform(Transform.Translation.x, Transform.Translation.y, Transform.Translation.z);
-        //        printf("Translation %f %f %f\n", Transform.Translation.x, Transform.Translation.y, Transform.Translation.z);
 
-        // Combine the above transformations
-        NodeTransformation = TranslationM * RotationM * ScalingM;
-    }
+void CoreModel::GetBoneTransforms(float TimeInSeconds, vector<Matrix4f>& Transforms, unsigned int AnimationIndex)
+{
+    GetBoneTransforms(TimeInSeconds, Transforms, AnimationIndex, m_samplingState);
+}
 
-    Matrix4f GlobalTransformation = ParentTransform * NodeTransformation;
 
-    if (m_BoneNameToIndexMap.find(NodeName) != m_BoneNameToIndexMap.end()) {
-        uint BoneIndex = m_BoneNameToIndexMap[NodeName];
-        m_BoneInfo[BoneIndex].FinalTransformation = m_GlobalInverseTransform * GlobalTransformation * m_BoneInfo[BoneIndex].OffsetMatrix;
+void CoreModel::GetBoneTransforms(float TimeInSeconds, vector<Matrix4f>& Transforms, unsigned int AnimationIndex, AnimationSamplingState& State)
+{
+    if (AnimationIndex >= m_animations.size()) {
+        printf("Invalid animation index %d, max is %d\n", AnimationIndex, (int)m_animations.size());
+        assert(0);
     }
 
-    for (uint i = 0 ; i < pNode->mNumChildren ; i++) {
-        string ChildName(pNode->mChildren[i]->mName.data);
+    Matrix4f Identity;
+    Identity.InitIdentity();
 
-        map<string,NodeInfo>::iterator it = m_requiredNodeMap.find(ChildName);
+    float AnimationTimeTicks = CalcAnimationTimeTicks(TimeInSeconds, AnimationIndex);
+    const aiAnimation& Animation = *m_animations[AnimationIndex];
+    const int* pChannels = GetSkeletonChannels(AnimationIndex);
 
-        if (it == m_requiredNodeMap.end()) {
-            printf("Child %s cannot be found in the required node map\n", ChildName.c_str());
-            assert(0);
+    State.Cursors.resize(m_skeletonChannels.size());
+    KeyframeCursor* pCursors = &State.Cursors[AnimationIndex * m_skeleton.size()];
+
+    State.GlobalTransforms.resize(m_skeleton.size());
+    Matrix4f* pGlobalTransforms = State.GlobalTransforms.data();
+
+    Transforms.resize(m_BoneInfo.size());
+
+    for (uint i = 0 ; i < m_skeleton.size() ; i++) {
+        const SkeletonNode& Node = m_skeleton[i];
+
+        const Matrix4f& ParentTransform = (Node.ParentIndex >= 0) ? pGlobalTransforms[Node.ParentIndex] : Identity;
+
+        if (pChannels[i] >= 0) {
+            LocalTransform Transform;
+            CalcLocalTransform(Transform, AnimationTimeTicks, Animation.mChannels[pChannels[i]], pCursors[i]);
+            pGlobalTransforms[i] = ParentTransform * CalcNodeTransformation(Transform);
+        } else {
+            pGlobalTransforms[i] = ParentTransform * Node.Transformation;
         }
 
-        if (it->second.isRequired) {
-            ReadNodeHierarchy(AnimationTimeTicks, pNode->mChildren[i], GlobalTransformation, Animation);
+        if (Node.BoneIndex >= 0) {
+            Transforms[Node.BoneIndex] = m_GlobalInverseTransform * pGlobalTransforms[i] * m_BoneInfo[Node.BoneIndex].OffsetMatrix;
         }
     }
 }
 
 
-void CoreModel::ReadNodeHierarchyBlended(float StartAnimationTimeTicks, float EndAnimationTimeTicks, const aiNode* pNode, const Matrix4f& ParentTransform,
-                                           const aiAnimation& StartAnimation, const aiAnimation& EndAnimation, float BlendFactor)
+void CoreModel::GetBoneTransformsBlended(float TimeInSeconds,
+                                           vector<Matrix4f>& BlendedTransforms,
+                                           unsigned int StartAnimIndex,
+                                           unsigned int EndAnimIndex,
+                                           float BlendFactor)
 {
-    string NodeName(pNode->mName.data);
+    GetBoneTransformsBlended(TimeInSeconds, BlendedTransforms, StartAnimIndex, EndAnimIndex, BlendFactor, m_samplingState);
+}
 
-    Matrix4f NodeTransformation(pNode->mTransformation);
 
-    const aiNodeAnim* pStartNodeAnim = FindNodeAnim(StartAnimation, NodeName);
+void CoreModel::GetBoneTransformsBlended(float TimeInSeconds,
+                                           vector<Matrix4f>& BlendedTransforms,
+                                           unsigned int StartAnimIndex,
+                                           unsigned int EndAnimIndex,
+                                           float BlendFactor,
+                                           AnimationSamplingState& State)
+{
+    if (StartAnimIndex >= m_animations.size()) {
+        printf("Invalid start animation index %d, max is %d\n", StartAnimIndex, (int)m_animations.size());
+        assert(0);
+    }
 
-    LocalTransform StartTransform;
+    if (EndAnimIndex >= m_animations.size()) {
+        printf("Invalid end animation index %d, max is %d\n", EndAnimIndex, (int)m_animations.size());
+        assert(0);
+    }
 
-    if (pStartNodeAnim) {
-        CalcLocalTransform(StartTransform, StartAnimationTimeTicks, pStartNodeAnim);
+    if ((BlendFactor < 0.0f) || (BlendFactor > 1.0f)) {
+        printf("Invalid blend factor %f\n", BlendFactor);
+        assert(0);
     }
 
-    LocalTransform EndTransform;
+    float StartAnimationTimeTicks = CalcAnimationTimeTicks(TimeInSeconds, StartAnimIndex);
+    float EndAnimationTimeTicks = CalcAnimationTimeTicks(TimeInSeconds, EndAnimIndex);
 
-    const aiNodeAnim* pEndNodeAnim = FindNodeAnim(EndAnimation, NodeName);
+    const aiAnimation& StartAnimation = *m_animations[StartAnimIndex];
+    const aiAnimation& EndAnimation = *m_animations[EndAnimIndex];
 
-    if ((pStartNodeAnim && !pEndNodeAnim) || (!pStartNodeAnim && pEndNodeAnim)) {
-        printf("On the node %s there is an animation node for only one of the start/end animations.\n", NodeName.c_str());
-        printf("This case is not supported\n");
-        exit(0);
-    }
+    const int* pStartChannels = GetSkeletonChannels(StartAnimIndex);
+    const int* pEndChannels = GetSkeletonChannels(EndAnimIndex);
+
+    State.Cursors.resize(m_skeletonChannels.size());
+    KeyframeCursor* pStartCursors = &State.Cursors[StartAnimIndex * m_skeleton.size()];
+    KeyframeCursor* pEndCursors = &State.Cursors[EndAnimIndex * m_skeleton.size()];
 
-    if (pEndNodeAnim) {
-        CalcLocalTransform(EndTransform, EndAnimationTimeTicks, pEndNodeAnim);
+    State.GlobalTransforms.resize(m_skeleton.size());
+    Matrix4f* pGlobalTransforms = State.GlobalTransforms.data();
+
+    Matrix4f Identity;
+    Identity.InitIdentity();
+
+    BlendedTransforms.resize(m_BoneInfo.size());
+
+    for (uint i = 0 ; i < m_skeleton.size() ; i++) {
+        const SkeletonNode& Node = m_skeleton[i];
+
+        const Matrix4f& ParentTransform = (Node.ParentIndex >= 0) ? pGlobalTransforms[Node.ParentIndex] : Identity;
+
+        if ((pStartChannels[i] >= 0) != (pEndChannels[i] >= 0)) {
+            printf("On the skeleton node %d there is an animation node for only one of the start/end animations.\n", i);
+            printf("This case is not supported\n");
+            exit(0);
+        }
+
+        if (pStartChannels[i] >= 0) {
+            LocalTransform StartTransform;
+            CalcLocalTransform(StartTransform, StartAnimationTimeTicks, StartAnimation.mChannels[pStartChannels[i]], pStartCursors[i]);
+
+            LocalTransform EndTransform;
+            CalcLocalTransform(EndTransform, EndAnimationTimeTicks, EndAnimation.mChannels[pEndChannels[i]], pEndCursors[i]);
+
+            LocalTransform BlendedTransform;
+
+            // Interpolate scaling
+            BlendedTransform.Scaling = (1.0f - BlendFactor) * StartTransform.Scaling + EndTransform.Scaling * BlendFactor;
+
+            // Interpolate rotation
+            aiQuaternion::Interpolate(BlendedTransform.Rotation, StartTransform.Rotation, EndTransform.Rotation, BlendFactor);
+
+            // Interpolate translation
+            BlendedTransform.Translation = (1.0f - BlendFactor) * StartTransform.Translation + EndTransform.Translation * BlendFactor;
+
+            pGlobalTransforms[i] = ParentTransform * CalcNodeTransformation(BlendedTransform);
+        } else {
+            pGlobalTransforms[i] = ParentTransform * Node.Transformation;
+        }
+
+        if (Node.BoneIndex >= 0) {
+            BlendedTransforms[Node.BoneIndex] = m_GlobalInverseTransform * pGlobalTransforms[i] * m_BoneInfo[Node.BoneIndex].OffsetMatrix;
+        }
     }
+}
+
+
+float CoreModel::CalcAnimationTimeTicks(float TimeInSeconds, unsigned int AnimationIndex)
+{
+    const aiAnimation& Animation = *m_animations[AnimationIndex];
+    float TicksPerSecond = (float)(Animation.mTicksPerSecond != 0 ? Animation.mTicksPerSecond : 25.0f);
+    float TimeInTicks = TimeInSeconds * TicksPerSecond;
+    // we need to use the integral part of mDuration for the total length of the animation
+    float Duration = 0.0f;
+    float fraction = modf((float)Animation.mDuration, &Duration);
+    float AnimationTimeTicks = fmod(TimeInTicks, Duration);
+    return AnimationTimeTicks;
+}
+
 
-    if (pStartNodeAnim && pEndNodeAnim) {
-        // Interpolate scaling
-        const aiVector3D& Scale0 = StartTransform.Scaling;
-        const aiVector3D& Scale1 = EndTransform.Scaling;
-        aiVector3D BlendedScaling = (1.0f - BlendFactor) * Scale0 + Scale1 * BlendFactor;
-        Matrix4f ScalingM;
-        ScalingM.InitScaleTransform(BlendedScaling.x, BlendedScaling.y, BlendedScaling.z);
+void CoreModel::CompileSkeleton(const aiScene* pScene)
+{
+    m_skeleton.clear();
+
+    std::vector<string> NodeNames;
+
+    CompileSkeletonNode(pScene->mRootNode, -1, NodeNames);
+
+    uint NumNodes = (uint)m_skeleton.size();
+
+    m_skeletonChannels.assign(pScene->mNumAnimations * NumNodes, -1);
+
+    for (uint AnimIndex = 0 ; AnimIndex < pScene->mNumAnimations ; AnimIndex++) {
+        const aiAnimation& Animation = *pScene->mAnimations[AnimIndex];
+
+        // If several channels target the same node the first one wins
+        map<string,int> ChannelMap;
 
-        // Interpolate rotation
-        const aiQuaternion& Rot0 = StartTransform.Rotation;
-        const aiQuaternion& Rot1 = EndTransform.Rotation;
-        aiQuaternion BlendedRot;
-        aiQuaternion::Interpolate(BlendedRot, Rot0, Rot1, BlendFactor);
-        Matrix4f RotationM = Matrix4f(BlendedRot.GetMatrix());
+        for (int i = (int)Animation.mNumChannels - 1 ; i >= 0 ; i--) {
+            ChannelMap[string(Animation.mChannels[i]->mNodeName.C_Str())] = i;
+        }
+
+        int* pChannels = &m_skeletonChannels[AnimIndex * NumNodes];
 
-        // Interpolate translation
-        const aiVector3D& Pos0 = StartTransform.Translation;
-        const aiVector3D& Pos1 = EndTransform.Translation;
-        aiVector3D BlendedTranslation = (1.0f - BlendFactor) * Pos0 + Pos1 * BlendFactor;
-        Matrix4f TranslationM;
-        TranslationM.InitTranslationTransform(BlendedTranslation.x, BlendedTranslation.y, BlendedTranslation.z);
+        for (uint i = 0 ; i < NumNodes ; i++) {
+            map<string,int>::const_iterator it = ChannelMap.find(NodeNames[i]);
 
-        // Combine it all
-        NodeTransformation = TranslationM * RotationM * ScalingM;
+            if (it != ChannelMap.end()) {
+                pChannels[i] = it->second;
+            }
+        }
     }
 
-    Matrix4f GlobalTransformation = ParentTransform * NodeTransformation;
+    printf("Compiled skeleton: %d nodes, %d bones\n", NumNodes, (int)m_BoneInfo.size());
+}
+
 
-    if (m_BoneNameToIndexMap.find(NodeName) != m_BoneNameToIndexMap.end()) {
-        uint BoneIndex = m_BoneNameToIndexMap[NodeName];
-        m_BoneInfo[BoneIndex].FinalTransformation = m_GlobalInverseTransform * GlobalTransformation * m_BoneInfo[BoneIndex].OffsetMatrix;
+void CoreModel::CompileSkeletonNode(const aiNode* pNode, int ParentIndex, std::vector<string>& NodeNames)
+{
+    string NodeName(pNode->mName.C_Str());
+
+    int NodeIndex = (int)m_skeleton.size();
+
+    SkeletonNode Node;
+    Node.ParentIndex = ParentIndex;
+    Node.Transformation = Matrix4f(pNode->mTransformation);
+
+    map<string,uint>::const_iterator BoneIt = m_BoneNameToIndexMap.find(NodeName);
+
+    if (BoneIt != m_BoneNameToIndexMap.end()) {
+        Node.BoneIndex = (int)BoneIt->second;
     }
 
+    m_skeleton.push_back(Node);
+    NodeNames.push_back(NodeName);
+
     for (uint i = 0 ; i < pNode->mNumChildren ; i++) {
-        string ChildName(pNode->mChildren[i]->mName.data);
+        string ChildName(pNode->mChildren[i]->mName.C_Str());
 
         map<string,NodeInfo>::iterator it = m_requiredNodeMap.find(ChildName);
 
@@ -1361,118 +1764,494 @@ void CoreModel::ReadNodeHierarchyBlended(float StartAnimationTimeTicks, float En
         }
 
         if (it->second.isRequired) {
-            ReadNodeHierarchyBlended(StartAnimationTimeTicks, EndAnimationTimeTicks,
-                                     pNode->mChildren[i], GlobalTransformation, StartAnimation, EndAnimation, BlendFactor);
+            CompileSkeletonNode(pNode->mChildren[i], NodeIndex, NodeNames);
         }
     }
 }
 
 
-void CoreModel::CalcLocalTransform(LocalTransform& Transform, float AnimationTimeTicks, const aiNodeAnim* pNodeAnim)
+bool CoreModel::IsAnimated() const
 {
-    CalcInterpolatedScaling(Transform.Scaling, AnimationTimeTicks, pNodeAnim);
-    CalcInterpolatedRotation(Transform.Rotation, AnimationTimeTicks, pNodeAnim);
-    CalcInterpolatedPosition(Transform.Translation, AnimationTimeTicks, pNodeAnim);
+    bool ret = m_animations.size() > 0;
+
+    if (ret && (NumBones() == 0)) {
+        printf("Animations without bones? need to check this\n");
+        assert(0);
+    }
+
+    return ret;
 }
 
 
-void CoreModel::GetBoneTransforms(float TimeInSeconds, vector<Matrix4f>& Transforms, unsigned int AnimationIndex)
+/////////////////////////////////////
+// Model cache
+/////////////////////////////////////
+
+// Size of a mesh entry in the cache (see SaveModelCache)
+#define CACHED_MESH_SIZE (5 * sizeof(uint) + sizeof(Matrix4f) + sizeof(BoundingVolume))
+
+// Smallest possible material in the cache - empty name and no textures
+#define CACHED_MATERIAL_MIN_SIZE (sizeof(u32) + 3 * sizeof(Vector4f) + 2 * sizeof(float) + NUM_TEXTURE_SOURCES * 2 * sizeof(u32))
+
+// Smallest possible bone and animation channel in the cache (see SaveAnimationsToCache)
+#define CACHED_BONE_MIN_SIZE (sizeof(u32) + sizeof(Matrix4f))
+#define CACHED_CHANNEL_MIN_SIZE (3 * sizeof(u32))
+#define CACHED_ANIMATION_MIN_SIZE (2 * sizeof(double) + sizeof(u32))
+
+
+static u32 GetModelCacheFlags()
 {
-    if (AnimationIndex >= m_pScene->mNumAnimations) {
-        printf("Invalid animation index %d, max is %d\n", AnimationIndex, m_pScene->mNumAnimations);
-        assert(0);
+    u32 Flags = 0;
+
+    if (UseMeshOptimizer) {
+        Flags |= MODEL_CACHE_FLAG_MESH_OPTIMIZER;
     }
 
-    Matrix4f Identity;
-    Identity.InitIdentity();
+    return Flags;
+}
 
-    float AnimationTimeTicks = CalcAnimationTimeTicks(TimeInSeconds, AnimationIndex);
-    const aiAnimation& Animation = *m_pScene->mAnimations[AnimationIndex];
 
-    ReadNodeHierarchy(AnimationTimeTicks, m_pScene->mRootNode, Identity, Animation);
-    Transforms.resize(m_BoneInfo.size());
+static bool AreCachedMeshesValid(const std::vector<BasicMeshEntry>& Meshes, uint NumMaterials,
+                                 const uint* pIndices, uint NumVertices, uint NumIndices)
+{
+    for (uint i = 0 ; i < Meshes.size() ; i++) {
+        const BasicMeshEntry& Mesh = Meshes[i];
 
-    for (uint i = 0 ; i < m_BoneInfo.size() ; i++) {
-        Transforms[i] = m_BoneInfo[i].FinalTransformation;
+        if ((Mesh.MaterialIndex >= NumMaterials) ||
+            ((u64)Mesh.BaseIndex + Mesh.NumIndices > NumIndices) ||
+            (Mesh.BaseVertex > NumVertices)) {
+            return false;
+        }
+
+        for (uint j = Mesh.BaseIndex ; j < Mesh.BaseIndex + Mesh.NumIndices ; j++) {
+            if (pIndices[j] >= NumVertices - Mesh.BaseVertex) {
+                return false;
+            }
+        }
     }
+
+    return true;
 }
 
 
-void CoreModel::GetBoneTransformsBlended(float TimeInSeconds,
-                                           vector<Matrix4f>& BlendedTransforms,
-                                           unsigned int StartAnimIndex,
-                                           unsigned int EndAnimIndex,
-                                           float BlendFactor)
+void CoreModel::SaveModelCache(const string& CacheFilename, u64 SourceHash)
 {
-    if (StartAnimIndex >= m_pScene->mNumAnimations) {
-        printf("Invalid start animation index %d, max is %d\n", StartAnimIndex, m_pScene->mNumAnimations);
-        assert(0);
+    vector<string> Dependencies = m_importedFiles;
+
+    for (uint i = 0 ; i < m_textureSources.size() ; i++) {
+        for (int j = 0 ; j < NUM_TEXTURE_SOURCES ; j++) {
+            const string& FilePath = m_textureSources[i].Sources[j].FilePath;
+
+            if (!FilePath.empty()) {
+                Dependencies.push_back(FilePath);
+            }
+        }
     }
 
-    if (EndAnimIndex >= m_pScene->mNumAnimations) {
-        printf("Invalid end animation index %d, max is %d\n", EndAnimIndex, m_pScene->mNumAnimations);
-        assert(0);
+    std::sort(Dependencies.begin(), Dependencies.end());
+    Dependencies.erase(std::unique(Dependencies.begin(), Dependencies.end()), Dependencies.end());
+
+    ModelCacheWriter Writer;
+
+    ModelCacheHeader Header;
+    Header.SourceHash = SourceHash;
+    Header.DependencyHash = HashFileStamps(Dependencies);
+    Header.VertexSize = IsAnimated() ? sizeof(SkinnedVertex) : sizeof(Vertex);
+    Header.Flags = GetModelCacheFlags();
+    Writer.Write(Header);
+
+    Writer.Write<u32>((u32)Dependencies.size());
+
+    for (uint i = 0 ; i < Dependencies.size() ; i++) {
+        Writer.WriteString(Dependencies[i]);
     }
 
-    if ((BlendFactor < 0.0f) || (BlendFactor > 1.0f)) {
-        printf("Invalid blend factor %f\n", BlendFactor);
-        assert(0);
+    Writer.Write<u32>((u32)m_Meshes.size());
+
+    for (uint i = 0 ; i < m_Meshes.size() ; i++) {
+        const BasicMeshEntry& Mesh = m_Meshes[i];
+        Writer.Write(Mesh.NumIndices);
+        Writer.Write(Mesh.BaseVertex);
+        Writer.Write(Mesh.BaseIndex);
+        Writer.Write(Mesh.ValidFaces);
+        Writer.Write(Mesh.MaterialIndex);
+        Writer.Write(Mesh.Transformation);
+        Writer.Write(Mesh.Bounds);
     }
 
-    float StartAnimationTimeTicks = CalcAnimationTimeTicks(TimeInSeconds, StartAnimIndex);
-    float EndAnimationTimeTicks = CalcAnimationTimeTicks(TimeInSeconds, EndAnimIndex);
+    Writer.Write(m_minPos);
+    Writer.Write(m_maxPos);
 
-    const aiAnimation& StartAnimation = *m_pScene->mAnimations[StartAnimIndex];
-    const aiAnimation& EndAnimation = *m_pScene->mAnimations[EndAnimIndex];
+    uint NumVertices = (uint)(m_vertexCacheData.size() / Header.VertexSize);
+    Writer.Write<u32>(NumVertices);
+    Writer.Align();
+    Writer.WriteArray(m_vertexCacheData.data(), m_vertexCacheData.size());
 
-    Matrix4f Identity;
-    Identity.InitIdentity();
+    Writer.Write<u32>((u32)m_Indices.size());
+    Writer.Align();
+    Writer.WriteArray(m_Indices.data(), m_Indices.size() * sizeof(m_Indices[0]));
 
-    ReadNodeHierarchyBlended(StartAnimationTimeTicks, EndAnimationTimeTicks, m_pScene->mRootNode, Identity, StartAnimation, EndAnimation, BlendFactor);
+    SaveMaterialsToCache(Writer);
 
-    BlendedTransforms.resize(m_BoneInfo.size());
+    Writer.Write<u32>((u32)m_cameraInitInfo.size());
 
-    for (uint i = 0 ; i < m_BoneInfo.size() ; i++) {
-        BlendedTransforms[i] = m_BoneInfo[i].FinalTransformation;
+    for (uint i = 0 ; i < m_cameraInitInfo.size() ; i++) {
+        Writer.Write(m_cameraInitInfo[i]);
+    }
+
+    Writer.WriteVector(m_dirLights);
+    Writer.WriteVector(m_pointLights);
+    Writer.WriteVector(m_spotLights);
+
+    if (IsAnimated()) {
+        SaveAnimationsToCache(Writer);
+    }
+
+    if (Writer.Save(CacheFilename)) {
+        printf("Saved model cache '%s'\n", CacheFilename.c_str());
     }
+
+    m_vertexCacheData.clear();
+    m_vertexCacheData.shrink_to_fit();
+    m_textureSources.clear();
+    m_importedFiles.clear();
 }
 
 
-float CoreModel::CalcAnimationTimeTicks(float TimeInSeconds, unsigned int AnimationIndex)
+void CoreModel::SaveMaterialsToCache(ModelCacheWriter& Writer)
 {
-    float TicksPerSecond = (float)(m_pScene->mAnimations[AnimationIndex]->mTicksPerSecond != 0 ? m_pScene->mAnimations[AnimationIndex]->mTicksPerSecond : 25.0f);
-    float TimeInTicks = TimeInSeconds * TicksPerSecond;
-    // we need to use the integral part of mDuration for the total length of the animation
-    float Duration = 0.0f;
-    float fraction = modf((float)m_pScene->mAnimations[AnimationIndex]->mDuration, &Duration);
-    float AnimationTimeTicks = fmod(TimeInTicks, Duration);
-    return AnimationTimeTicks;
+    Writer.Write<u32>((u32)m_Materials.size());
+
+    for (uint i = 0 ; i < m_Materials.size() ; i++) {
+        const Material& material = m_Materials[i];
+
+        Writer.WriteString(material.m_name);
+        Writer.Write(material.AmbientColor);
+        Writer.Write(material.DiffuseColor);
+        Writer.Write(material.SpecularColor);
+        Writer.Write(material.m_transparencyFactor);
+        Writer.Write(material.m_alphaTest);
+
+        for (int j = 0 ; j < NUM_TEXTURE_SOURCES ; j++) {
+            const TextureSource& Source = m_textureSources[i].Sources[j];
+            Writer.WriteString(Source.FilePath);
+            Writer.Write<u32>(Source.EmbeddedSize);
+            Writer.WriteArray(Source.pEmbeddedData, Source.EmbeddedSize);
+        }
+    }
 }
 
 
-const aiNodeAnim* CoreModel::FindNodeAnim(const aiAnimation&
-                                            Animation, const string& NodeName)
+bool CoreModel::LoadModelCache(const string& CacheFilename, u64 SourceHash)
 {
-    for (uint i = 0 ; i < Animation.mNumChannels ; i++) {
-        const aiNodeAnim* pNodeAnim = Animation.mChannels[i];
+    MappedFile File;
+
+    if (!File.Map(CacheFilename)) {
+        return false;
+    }
+
+    ModelCacheReader Reader(File.GetData(), File.GetSize());
+
+    ModelCacheHeader Header = Reader.Read<ModelCacheHeader>();
+
+    if ((Header.Magic != MODEL_CACHE_MAGIC) ||
+        (Header.Version != MODEL_CACHE_VERSION) ||
+        (Header.SourceHash != SourceHash) ||
+        ((Header.VertexSize != sizeof(Vertex)) && (Header.VertexSize != sizeof(SkinnedVertex))) ||
+        (Header.Flags != GetModelCacheFlags())) {
+        printf("Model cache '%s' is out of date\n", CacheFilename.c_str());
+        return false;
+    }
 
-        if (string(pNodeAnim->mNodeName.data) == NodeName) {
-            return pNodeAnim;
+    u32 NumDependencies = Reader.ReadCount(sizeof(u32));
+    vector<string> Dependencies(NumDependencies);
+
+    for (uint i = 0 ; i < NumDependencies ; i++) {
+        Dependencies[i] = Reader.ReadString();
+    }
+
+    if (!Reader.IsOK() || (HashFileStamps(Dependencies) != Header.DependencyHash)) {
+        printf("Model cache '%s' is out of date\n", CacheFilename.c_str());
+        return false;
+    }
+
+    u32 NumMeshes = Reader.ReadCount(CACHED_MESH_SIZE);
+    m_Meshes.resize(NumMeshes);
+
+    for (uint i = 0 ; i < NumMeshes ; i++) {
+        BasicMeshEntry& Mesh = m_Meshes[i];
+        Mesh.NumIndices = Reader.Read<uint>();
+        Mesh.BaseVertex = Reader.Read<uint>();
+        Mesh.BaseIndex = Reader.Read<uint>();
+        Mesh.ValidFaces = Reader.Read<uint>();
+        Mesh.MaterialIndex = Reader.Read<uint>();
+        Mesh.Transformation = Reader.Read<Matrix4f>();
+        Mesh.Bounds = Reader.Read<BoundingVolume>();
+    }
+
+    m_minPos = Reader.Read<Vector3f>();
+    m_maxPos = Reader.Read<Vector3f>();
+
+    // Only animated models use skinned vertices
+    bool IsSkinned = (Header.VertexSize == sizeof(SkinnedVertex));
+
+    u32 NumVertices = Reader.ReadCount(Header.VertexSize);
+    Reader.Align();
+    const char* pVertices = Reader.ReadArray(NumVertices * Header.VertexSize);
+
+    u32 NumIndices = Reader.ReadCount(sizeof(uint));
+    Reader.Align();
+    const uint* pIndices = (const uint*)Reader.ReadArray(NumIndices * sizeof(uint));
+
+    LoadMaterialsFromCache(Reader);
+
+    u32 NumCameras = Reader.ReadCount(sizeof(CameraInitInfo));
+    m_cameras.resize(NumCameras);
+
+    for (uint i = 0 ; i < NumCameras ; i++) {
+        CameraInitInfo Info = Reader.Read<CameraInitInfo>();
+        m_cameras[i].Init(Info.Pos.ToGLM(), Info.Target.ToGLM(), Info.Up.ToGLM(), Info.persProjInfo);
+    }
+
+    Reader.ReadVector(m_dirLights);
+    Reader.ReadVector(m_pointLights);
+    Reader.ReadVector(m_spotLights);
+
+    bool AnimationsOK = !IsSkinned || LoadAnimationsFromCache(Reader);
+
+    // A corrupted cache must not send the BVH build, the upload or the
+    // animation code outside of the arrays
+    if (!Reader.IsOK() || !AnimationsOK || !AreCachedMeshesValid(m_Meshes, (uint)m_Materials.size(), pIndices, NumVertices, NumIndices)) {
+        printf("Model cache '%s' is corrupted\n", CacheFilename.c_str());
+        m_Meshes.clear();
+        m_Materials.clear();
+        m_textureSources.clear();
+        m_cameras.clear();
+        m_dirLights.clear();
+        m_pointLights.clear();
+        m_spotLights.clear();
+        m_BoneInfo.clear();
+        m_BoneNameToIndexMap.clear();
+        m_skeleton.clear();
+        m_skeletonChannels.clear();
+        m_animations.clear();
+        m_cachedAnimations.clear();
+        return false;
+    }
+
+    printf("Loading model from cache '%s'\n", CacheFilename.c_str());
+
+    CalcModelBounds();
+
+    if (IsSkinned) {
+        BuildMeshBVHs<SkinnedVertex>((const SkinnedVertex*)pVertices, pIndices);
+        PopulateBuffersSkinned((const SkinnedVertex*)pVertices, NumVertices, pIndices, NumIndices);
+    } else {
+        BuildMeshBVHs<Vertex>((const Vertex*)pVertices, pIndices);
+        PopulateBuffers((const Vertex*)pVertices, NumVertices, pIndices, NumIndices);
+    }
+
+    // The embedded textures point into the mapping so this must be done before it is released
+    LoadCachedTextures();
+
+    InitGeometryPost();
+
+#ifdef OGLDEV_VULKAN
+    return true;
+#else
+    return GLCheckError();
+#endif
+}
+
+
+void CoreModel::LoadMaterialsFromCache(ModelCacheReader& Reader)
+{
+    u32 NumMaterials = Reader.ReadCount(CACHED_MATERIAL_MIN_SIZE);
+
+    m_Materials.resize(NumMaterials);
+    m_textureSources.resize(NumMaterials);
+
+    for (uint i = 0 ; i < NumMaterials ; i++) {
+        Material& material = m_Materials[i];
+
+        material.m_name = Reader.ReadString();
+        material.AmbientColor = Reader.Read<Vector4f>();
+        material.DiffuseColor = Reader.Read<Vector4f>();
+        material.SpecularColor = Reader.Read<Vector4f>();
+        material.m_transparencyFactor = Reader.Read<float>();
+        material.m_alphaTest = Reader.Read<float>();
+
+        for (int j = 0 ; j < NUM_TEXTURE_SOURCES ; j++) {
+            TextureSource& Source = m_textureSources[i].Sources[j];
+            Source.FilePath = Reader.ReadString();
+            Source.EmbeddedSize = Reader.ReadCount(1);
+            Source.pEmbeddedData = Reader.ReadArray(Source.EmbeddedSize);
         }
     }
+}
+
+
+
+// Bones, the compiled skeleton and the keyframes. This is everything the
+// animation code needs so an animated model doesn't need the aiScene.
+void CoreModel::SaveAnimationsToCache(ModelCacheWriter& Writer)
+{
+    Writer.Write(m_GlobalInverseTransform);
+
+    vector<string> BoneNames(m_BoneInfo.size());
+
+    for (map<string,uint>::const_iterator it = m_BoneNameToIndexMap.begin() ; it != m_BoneNameToIndexMap.end() ; it++) {
+        BoneNames[it->second] = it->first;
+    }
+
+    Writer.Write<u32>((u32)m_BoneInfo.size());
+
+    for (uint i = 0 ; i < m_BoneInfo.size() ; i++) {
+        Writer.WriteString(BoneNames[i]);
+        Writer.Write(m_BoneInfo[i].OffsetMatrix);
+    }
+
+    Writer.WriteVector(m_skeleton);
+    Writer.WriteVector(m_skeletonChannels);
+
+    Writer.Write<u32>((u32)m_animations.size());
+
+    for (uint i = 0 ; i < m_animations.size() ; i++) {
+        const aiAnimation& Animation = *m_animations[i];
+
+        Writer.Write(Animation.mDuration);
+        Writer.Write(Animation.mTicksPerSecond);
+        Writer.Write<u32>(Animation.mNumChannels);
 
-    return NULL;
+        for (uint j = 0 ; j < Animation.mNumChannels ; j++) {
+            const aiNodeAnim& Channel = *Animation.mChannels[j];
+
+            Writer.Write<u32>(Channel.mNumPositionKeys);
+            Writer.WriteArray(Channel.mPositionKeys, Channel.mNumPositionKeys * sizeof(aiVectorKey));
+            Writer.Write<u32>(Channel.mNumRotationKeys);
+            Writer.WriteArray(Channel.mRotationKeys, Channel.mNumRotationKeys * sizeof(aiQuatKey));
+            Writer.Write<u32>(Channel.mNumScalingKeys);
+            Writer.WriteArray(Channel.mScalingKeys, Channel.mNumScalingKeys * sizeof(aiVectorKey));
+        }
+    }
 }
 
 
-bool CoreModel::IsAnimated() const
+// Returns NULL if the keys are missing. The interpolation needs at least one key.
+template<typename KeyType>
+static KeyType* ReadCachedKeys(ModelCacheReader& Reader, unsigned int& NumKeys)
 {
-    bool ret = m_pScene->mNumAnimations > 0;
+    NumKeys = Reader.ReadCount(sizeof(KeyType));
+    const char* p = Reader.ReadArray(NumKeys * sizeof(KeyType));
 
-    if (ret && (NumBones() == 0)) {
-        printf("Animations without bones? need to check this\n");
-        assert(0);
+    if (!p || (NumKeys == 0)) {
+        NumKeys = 0;
+        return NULL;
     }
 
-    return ret;
-}
\ No newline at end of file
+    KeyType* pKeys = new KeyType[NumKeys];
+    memcpy(pKeys, p, NumKeys * sizeof(KeyType));
+
+    return pKeys;
+}
+
+
+bool CoreModel::LoadAnimationsFromCache(ModelCacheReader& Reader)
+{
+    m_GlobalInverseTransform = Reader.Read<Matrix4f>();
+
+    u32 NumBones = Reader.ReadCount(CACHED_BONE_MIN_SIZE);
+
+    for (uint i = 0 ; i < NumBones ; i++) {
+        m_BoneNameToIndexMap[Reader.ReadString()] = i;
+        m_BoneInfo.push_back(BoneInfo(Reader.Read<Matrix4f>()));
+    }
+
+    Reader.ReadVector(m_skeleton);
+    Reader.ReadVector(m_skeletonChannels);
+
+    u32 NumAnimations = Reader.ReadCount(CACHED_ANIMATION_MIN_SIZE);
+
+    for (uint i = 0 ; i < NumAnimations ; i++) {
+        // aiAnimation and aiNodeAnim release their arrays in the destructor
+        aiAnimation* pAnimation = new aiAnimation;
+        m_cachedAnimations.push_back(std::unique_ptr<aiAnimation>(pAnimation));
+        m_animations.push_back(pAnimation);
+
+        pAnimation->mDuration = Reader.Read<double>();
+        pAnimation->mTicksPerSecond = Reader.Read<double>();
+
+        u32 NumChannels = Reader.ReadCount(CACHED_CHANNEL_MIN_SIZE);
+
+        if (NumChannels == 0) {
+            continue;
+        }
+
+        pAnimation->mChannels = new aiNodeAnim*[NumChannels];
+        pAnimation->mNumChannels = NumChannels;
+
+        for (uint j = 0 ; j < NumChannels ; j++) {
+            aiNodeAnim* pChannel = new aiNodeAnim;
+            pAnimation->mChannels[j] = pChannel;
+
+            pChannel->mPositionKeys = ReadCachedKeys<aiVectorKey>(Reader, pChannel->mNumPositionKeys);
+            pChannel->mRotationKeys = ReadCachedKeys<aiQuatKey>(Reader, pChannel->mNumRotationKeys);
+            pChannel->mScalingKeys = ReadCachedKeys<aiVectorKey>(Reader, pChannel->mNumScalingKeys);
+
+            if (!pChannel->mPositionKeys || !pChannel->mRotationKeys || !pChannel->mScalingKeys) {
+                return false;
+            }
+        }
+    }
+
+    if (!Reader.IsOK() || (NumAnimations == 0) || (m_skeletonChannels.size() != (size_t)NumAnimations * m_skeleton.size())) {
+        return false;
+    }
+
+    for (uint i = 0 ; i < m_skeleton.size() ; i++) {
+        const SkeletonNode& Node = m_skeleton[i];
+
+        if ((Node.ParentIndex < -1) || (Node.ParentIndex >= (int)i) ||
+            (Node.BoneIndex < -1) || (Node.BoneIndex >= (int)NumBones)) {
+            return false;
+        }
+    }
+
+    for (uint i = 0 ; i < m_skeletonChannels.size() ; i++) {
+        int Channel = m_skeletonChannels[i];
+        const aiAnimation& Animation = *m_animations[i / m_skeleton.size()];
+
+        if ((Channel < -1) || (Channel >= (int)Animation.mNumChannels)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+void CoreModel::LoadCachedTextures()
+{
+    for (uint i = 0 ; i < m_Materials.size() ; i++) {
+        Texture** ppTextures[NUM_TEXTURE_SOURCES] = { &m_Materials[i].pDiffuse,
+                                                      &m_Materials[i].pSpecularExponent,
+                                                      &m_Materials[i].pNormal };
+
+        for (int j = 0 ; j < NUM_TEXTURE_SOURCES ; j++) {
+            const TextureSource& Source = m_textureSources[i].Sources[j];
+
+            if (Source.EmbeddedSize > 0) {
+                *ppTextures[j] = AllocTexture2D();
+                (*ppTextures[j])->Load(Source.EmbeddedSize, (void*)Source.pEmbeddedData);
+            } else if (Source.FilePath.size() > 0) {
+                *ppTextures[j] = AllocTexture2D();
+                (*ppTextures[j])->Load(Source.FilePath);
+                printf("Loaded cached texture '%s'\n", Source.FilePath.c_str());
+            } else {
+                *ppTextures[j] = NULL;
+            }
+        }
+    }
+
+    m_textureSources.clear();
+}
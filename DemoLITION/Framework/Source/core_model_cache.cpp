@@ -0,0 +1,336 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdio.h>
+
+#include "Int/core_model_cache.h"
+
+
+MappedFile::~MappedFile()
+{
+    Unmap();
+}
+
+
+#ifdef _WIN32
+
+bool MappedFile::Map(const std::string& Filename)
+{
+    Unmap();
+
+    HANDLE hFile = CreateFileA(Filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER FileSize;
+
+    if (!GetFileSizeEx(hFile, &FileSize) || (FileSize.QuadPart == 0)) {
+        CloseHandle(hFile);
+        return false;
+    }
+
+    HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+
+    if (!hMapping) {
+        CloseHandle(hFile);
+        return false;
+    }
+
+    void* p = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+
+    if (!p) {
+        CloseHandle(hMapping);
+        CloseHandle(hFile);
+        return false;
+    }
+
+    m_hFile = hFile;
+    m_hMapping = hMapping;
+    m_pData = (const char*)p;
+    m_size = (size_t)FileSize.QuadPart;
+
+    return true;
+}
+
+
+void MappedFile::Unmap()
+{
+    if (m_pData) {
+        UnmapViewOfFile(m_pData);
+        m_pData = NULL;
+    }
+
+    if (m_hMapping) {
+        CloseHandle(m_hMapping);
+        m_hMapping = NULL;
+    }
+
+    if (m_hFile) {
+        CloseHandle(m_hFile);
+        m_hFile = NULL;
+    }
+
+    m_size = 0;
+}
+
+#else
+
+bool MappedFile::Map(const std::string& Filename)
+{
+    Unmap();
+
+    int fd = open(Filename.c_str(), O_RDONLY);
+
+    if (fd == -1) {
+        return false;
+    }
+
+    struct stat stat_buf;
+
+    if ((fstat(fd, &stat_buf) != 0) || (stat_buf.st_size == 0)) {
+        close(fd);
+        return false;
+    }
+
+    void* p = mmap(NULL, stat_buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping keeps its own reference to the file
+    close(fd);
+
+    if (p == MAP_FAILED) {
+        return false;
+    }
+
+    m_pData = (const char*)p;
+    m_size = (size_t)stat_buf.st_size;
+
+    return true;
+}
+
+
+void MappedFile::Unmap()
+{
+    if (m_pData) {
+        munmap((void*)m_pData, m_size);
+        m_pData = NULL;
+    }
+
+    m_size = 0;
+}
+
+#endif
+
+
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+
+
+static void HashBytes(u64& Hash, const void* pData, size_t Size)
+{
+    const unsigned char* p = (const unsigned char*)pData;
+
+    for (size_t i = 0 ; i < Size ; i++) {
+        Hash ^= p[i];
+        Hash *= 1099511628211ULL;   // FNV prime
+    }
+}
+
+
+bool HashFile(const std::string& Filename, u64& Hash)
+{
+    FILE* f = fopen(Filename.c_str(), "rb");
+
+    if (!f) {
+        return false;
+    }
+
+    Hash = FNV_OFFSET_BASIS;
+
+    unsigned char buf[64 * 1024];
+    size_t BytesRead = 0;
+
+    while ((BytesRead = fread(buf, 1, sizeof(buf), f)) > 0) {
+        HashBytes(Hash, buf, BytesRead);
+    }
+
+    fclose(f);
+
+    return true;
+}
+
+
+bool GetFileStamp(const std::string& Filename, u64& Size, u64& ModTime)
+{
+#ifdef _WIN32
+    struct _stat64 Stat;
+
+    if (_stat64(Filename.c_str(), &Stat) != 0) {
+        return false;
+    }
+#else
+    struct stat Stat;
+
+    if (stat(Filename.c_str(), &Stat) != 0) {
+        return false;
+    }
+#endif
+
+    Size = (u64)Stat.st_size;
+    ModTime = (u64)Stat.st_mtime;
+
+    return true;
+}
+
+
+u64 HashFileStamps(const std::vector<std::string>& Filenames)
+{
+    u64 Hash = FNV_OFFSET_BASIS;
+
+    for (uint i = 0 ; i < Filenames.size() ; i++) {
+        u64 Stamp[2] = { 0, 0 };
+
+        if (!GetFileStamp(Filenames[i], Stamp[0], Stamp[1])) {
+            Stamp[0] = Stamp[1] = ~0ULL;
+        }
+
+        HashBytes(Hash, Filenames[i].data(), Filenames[i].size() + 1);     // including the terminating zero
+        HashBytes(Hash, Stamp, sizeof(Stamp));
+    }
+
+    return Hash;
+}
+
+
+void ModelCacheWriter::WriteArray(const void* pData, size_t Size)
+{
+    const char* p = (const char*)pData;
+    m_data.insert(m_data.end(), p, p + Size);
+}
+
+
+void ModelCacheWriter::WriteString(const std::string& s)
+{
+    Write<u32>((u32)s.size());
+    WriteArray(s.data(), s.size());
+}
+
+
+void ModelCacheWriter::Align()
+{
+    size_t Padding = (MODEL_CACHE_ALIGNMENT - (m_data.size() % MODEL_CACHE_ALIGNMENT)) % MODEL_CACHE_ALIGNMENT;
+    m_data.insert(m_data.end(), Padding, 0);
+}
+
+
+bool ModelCacheWriter::Save(const std::string& Filename)
+{
+    // Write to a temporary file and rename it so that a crash in the
+    // middle of the write never leaves a truncated cache behind
+    std::string TempFilename = Filename + ".tmp";
+
+    FILE* f = fopen(TempFilename.c_str(), "wb");
+
+    if (!f) {
+        printf("Error opening model cache '%s' for writing\n", TempFilename.c_str());
+        return false;
+    }
+
+    size_t BytesWritten = fwrite(m_data.data(), 1, m_data.size(), f);
+
+    fclose(f);
+
+    if (BytesWritten != m_data.size()) {
+        printf("Error writing model cache '%s'\n", TempFilename.c_str());
+        remove(TempFilename.c_str());
+        return false;
+    }
+
+    remove(Filename.c_str());
+
+    if (rename(TempFilename.c_str(), Filename.c_str()) != 0) {
+        printf("Error renaming '%s' to '%s'\n", TempFilename.c_str(), Filename.c_str());
+        remove(TempFilename.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+
+const char* ModelCacheReader::ReadArray(size_t Size)
+{
+    if (!m_isOK || ((size_t)(m_pEnd - m_pCur) < Size)) {
+        m_isOK = false;
+        return NULL;
+    }
+
+    const char* p = m_pCur;
+    m_pCur += Size;
+
+    return p;
+}
+
+
+u32 ModelCacheReader::ReadCount(size_t MinElementSize)
+{
+    u32 Count = Read<u32>();
+
+    if (!m_isOK) {
+        return 0;
+    }
+
+    size_t BytesLeft = (size_t)(m_pEnd - m_pCur);
+
+    if ((MinElementSize > 0) && (Count > BytesLeft / MinElementSize)) {
+        m_isOK = false;
+        return 0;
+    }
+
+    return Count;
+}
+
+
+std::string ModelCacheReader::ReadString()
+{
+    u32 Len = ReadCount(1);
+    const char* p = ReadArray(Len);
+
+    if (!p) {
+        return std::string();
+    }
+
+    return std::string(p, Len);
+}
+
+
+void ModelCacheReader::Align()
+{
+    size_t Offset = m_pCur - m_pStart;
+    size_t Padding = (MODEL_CACHE_ALIGNMENT - (Offset % MODEL_CACHE_ALIGNMENT)) % MODEL_CACHE_ALIGNMENT;
+    ReadArray(Padding);
+}
@@ -30,6 +30,8 @@ void SceneObject::SetRotation(const Vector3f& Rot)
 {
     m_rotations[0] = Rot;
     m_numRotations = 1;
+
+    MarkTransformDirty();
 }
 
 
@@ -39,6 +41,8 @@ void SceneObject::SetRotation(float x, float y, float z)
     m_rotations[0].y = y;
     m_rotations[0].z = z;
     m_numRotations = 1;
+
+    MarkTransformDirty();
 }
 
 void SceneObject::RotateBy(float x, float y, float z)
@@ -47,6 +51,8 @@ void SceneObject::RotateBy(float x, float y, float z)
     m_rotations[0].y += y;
     m_rotations[0].z += z;
     m_numRotations = 1;
+
+    MarkTransformDirty();
 }
 
 
@@ -59,6 +65,8 @@ void SceneObject::PushRotation(const Vector3f& Rot)
         
     m_rotations[m_numRotations] = Rot;
     m_numRotations++;
+
+    MarkTransformDirty();
 }
 
 
@@ -68,7 +76,112 @@ bool QuaternionIsZero(const glm::quat& q)
     return r;
 }
 
-Matrix4f SceneObject::GetMatrix() const
+void SceneObject::MarkTransformDirty()
+{
+    // A dirty object always has dirty descendants so there is nothing to propagate
+    if (m_worldDirty) {
+        return;
+    }
+
+    m_worldDirty = true;
+    m_inverseDirty = true;
+
+    OnTransformChanged();
+
+    for (int i = 0 ; i < (int)m_children.size() ; i++) {
+        m_children[i]->MarkTransformDirty();
+    }
+}
+
+
+void SceneObject::SetParent(SceneObject* pParent)
+{
+    if (pParent == m_pParent) {
+        return;
+    }
+
+    // Make sure we don't create a cycle
+    for (SceneObject* p = pParent ; p ; p = p->m_pParent) {
+        if (p == this) {
+            printf("%s:%d - an object cannot be attached to its own descendant\n", __FILE__, __LINE__);
+            assert(0);
+            return;
+        }
+    }
+
+    if (m_pParent) {
+        std::vector<SceneObject*>& Siblings = m_pParent->m_children;
+        Siblings.erase(std::find(Siblings.begin(), Siblings.end(), this));
+    }
+
+    m_pParent = pParent;
+
+    if (m_pParent) {
+        m_pParent->m_children.push_back(this);
+    }
+
+    // Force the notification even if the world matrix was not calculated yet
+    m_worldDirty = false;
+    MarkTransformDirty();
+}
+
+
+const Matrix4f& SceneObject::GetMatrix() const
+{
+    if (m_worldDirty) {
+        if (m_pParent) {
+            Matrix4f::Multiply(m_pParent->GetMatrix(), CalcLocalMatrix(), m_worldMatrix);
+        } else {
+            m_worldMatrix = CalcLocalMatrix();
+        }
+
+        m_worldDirty = false;
+    }
+
+    return m_worldMatrix;
+}
+
+
+const Matrix4f& SceneObject::GetInverseMatrix() const
+{
+    if (m_inverseDirty) {
+        m_inverseMatrix = GetMatrix().AffineInverse();
+        m_normalMatrix = m_inverseMatrix.Transpose();
+        m_inverseDirty = false;
+    }
+
+    return m_inverseMatrix;
+}
+
+
+const Matrix4f& SceneObject::GetNormalMatrix() const
+{
+    GetInverseMatrix();
+
+    return m_normalMatrix;
+}
+
+
+void SceneObject::UpdateTransforms()
+{
+    std::vector<const SceneObject*> Stack;
+    Stack.push_back(this);
+
+    while (!Stack.empty()) {
+        const SceneObject* pObject = Stack.back();
+        Stack.pop_back();
+
+        // The parent is already up to date so this is a single multiplication
+        pObject->GetMatrix();
+
+        for (int i = 0 ; i < (int)pObject->m_children.size() ; i++) {
+            Stack.push_back(pObject->m_children[i]);
+        }
+    }
+}
+
+
+Matrix4f SceneObject::CalcLocalMatrix() const
 {
     Matrix4f Scale;
     Scale.InitScaleTransform(m_scale);
@@ -195,6 +308,7 @@ void CoreScene::AddToRenderList(SceneObject* pSceneObject)
 
     if (it == m_renderList.end()) {
         m_renderList.push_back(pCoreSceneObject);
+        AddToSpatialIndex(pCoreSceneObject);
     }
 }
 
@@ -206,6 +320,7 @@ bool CoreScene::RemoveFromRenderList(SceneObject* pSceneObject)
     bool ret = false;
 
     if (it != m_renderList.end()) {
+        RemoveFromSpatialIndex(*it);
         m_renderList.erase(it);
         ret = true;
     }
@@ -214,6 +329,170 @@ bool CoreScene::RemoveFromRenderList(SceneObject* pSceneObject)
 }
 
 
+CoreSceneObject* CoreScene::GetSceneObjectById(int Id)
+{
+    if ((Id < 0) || (Id >= m_numSceneObjects)) {
+        return NULL;
+    }
+
+    return &m_sceneObjects[Id];
+}
+
+
+void CoreSceneObject::OnTransformChanged()
+{
+    if (m_pScene) {
+        m_pScene->OnSceneObjectMoved(this);
+    }
+}
+
+
+void CoreScene::OnSceneObjectMoved(CoreSceneObject* pSceneObject)
+{
+    // Only objects in the BVH need an update and only once per batch of changes
+    if ((pSceneObject->GetBVHProxy() != -1) && !pSceneObject->IsInDirtyList()) {
+        pSceneObject->SetInDirtyList(true);
+        m_dirtyObjects.push_back(pSceneObject);
+    }
+}
+
+
+BoundingVolume CoreScene::CalcWorldBounds(CoreSceneObject* pSceneObject) const
+{
+    CoreModel* pModel = pSceneObject->GetModel();
+    const Matrix4f& ObjectMatrix = pSceneObject->GetMatrix();
+
+    // Same world matrix as the draw path (ObjectMatrix * MeshTransformation).
+    // Transforming every mesh box is also tighter than transforming the model box
+    // which was already grown once by the mesh transformations.
+    BoundingVolume Bounds;
+
+    for (uint i = 0 ; i < pModel->GetNumMeshes() ; i++) {
+        Bounds.Add(pModel->GetMeshBounds(i).Transform(ObjectMatrix * pModel->GetMeshTransformation(i)));
+    }
+
+    return Bounds;
+}
+
+
+void CoreScene::AddToSpatialIndex(CoreSceneObject* pSceneObject)
+{
+    CoreModel* pModel = pSceneObject->GetModel();
+
+    // The bounds of animated models are in the bind pose so they can't be trusted
+    if (pModel->IsAnimated() || !pModel->GetBounds().IsValid()) {
+        m_unboundedObjects.push_back(pSceneObject);
+        return;
+    }
+
+    int Proxy = m_bvh.Insert(CalcWorldBounds(pSceneObject), pSceneObject);
+    pSceneObject->SetBVHProxy(Proxy);
+}
+
+
+void CoreScene::RemoveFromSpatialIndex(CoreSceneObject* pSceneObject)
+{
+    int Proxy = pSceneObject->GetBVHProxy();
+
+    if (Proxy == -1) {
+        std::vector<CoreSceneObject*>::iterator it = std::find(m_unboundedObjects.begin(), m_unboundedObjects.end(), pSceneObject);
+
+        if (it != m_unboundedObjects.end()) {
+            m_unboundedObjects.erase(it);
+        }
+
+        return;
+    }
+
+    m_bvh.Remove(Proxy);
+    pSceneObject->SetBVHProxy(-1);
+
+    if (pSceneObject->IsInDirtyList()) {
+        m_dirtyObjects.erase(std::find(m_dirtyObjects.begin(), m_dirtyObjects.end(), pSceneObject));
+        pSceneObject->SetInDirtyList(false);
+    }
+}
+
+
+void CoreScene::UpdateSpatialIndex()
+{
+    for (int i = 0 ; i < (int)m_dirtyObjects.size() ; i++) {
+        CoreSceneObject* pSceneObject = m_dirtyObjects[i];
+        m_bvh.Update(pSceneObject->GetBVHProxy(), CalcWorldBounds(pSceneObject));
+        pSceneObject->SetInDirtyList(false);
+    }
+
+    m_dirtyObjects.clear();
+}
+
+
+void CoreScene::AppendQueryResult(std::vector<CoreSceneObject*>& Result)
+{
+    for (int i = 0 ; i < (int)m_queryResult.size() ; i++) {
+        Result.push_back((CoreSceneObject*)m_queryResult[i]);
+    }
+
+    Result.insert(Result.end(), m_unboundedObjects.begin(), m_unboundedObjects.end());
+}
+
+
+void CoreScene::QueryFrustum(const ViewFrustum& Frustum, std::vector<CoreSceneObject*>& Result)
+{
+    UpdateSpatialIndex();
+
+    m_queryResult.clear();
+    m_bvh.QueryFrustum(Frustum, m_queryResult);
+
+    AppendQueryResult(Result);
+}
+
+
+void CoreScene::QueryBox(const BoundingVolume& Box, std::vector<CoreSceneObject*>& Result)
+{
+    UpdateSpatialIndex();
+
+    m_queryResult.clear();
+    m_bvh.QueryBox(Box, m_queryResult);
+
+    AppendQueryResult(Result);
+}
+
+
+void CoreScene::QuerySphere(const Vector3f& Center, float Radius, std::vector<CoreSceneObject*>& Result)
+{
+    UpdateSpatialIndex();
+
+    m_queryResult.clear();
+    m_bvh.QuerySphere(Center, Radius, m_queryResult);
+
+    AppendQueryResult(Result);
+}
+
+
+void CoreScene::QueryRay(const Vector3f& Origin, const Vector3f& Dir, float MaxDistance, std::vector<SceneObjectHit>& Result)
+{
+    UpdateSpatialIndex();
+
+    // Nothing is known about the unbounded objects so they go first
+    for (int i = 0 ; i < (int)m_unboundedObjects.size() ; i++) {
+        SceneObjectHit Hit;
+        Hit.pSceneObject = m_unboundedObjects[i];
+        Hit.Distance = 0.0f;
+        Result.push_back(Hit);
+    }
+
+    std::vector<SceneBVH::RayHit> Hits;
+    m_bvh.QueryRay(Origin, Dir, MaxDistance, Hits);
+
+    for (int i = 0 ; i < (int)Hits.size() ; i++) {
+        SceneObjectHit Hit;
+        Hit.pSceneObject = (CoreSceneObject*)Hits[i].pUserData;
+        Hit.Distance = Hits[i].Distance;
+        Result.push_back(Hit);
+    }
+}
+
+
 
 std::list<SceneObject*> CoreScene::GetSceneObjectsList()
 {
@@ -255,6 +534,7 @@ SceneObject* CoreScene::CreateSceneObject(const std::string& BasicShape)
 CoreSceneObject* CoreScene::CreateSceneObjectInternal(CoreModel* pModel)
 {
     m_sceneObjects[m_numSceneObjects].SetModel(pModel);
+    m_sceneObjects[m_numSceneObjects].SetScene(this);
 
     CoreSceneObject* pCoreSceneObject = &(m_sceneObjects[m_numSceneObjects]);
     int Id = m_numSceneObjects;
@@ -267,6 +547,42 @@ CoreSceneObject* CoreScene::CreateSceneObjectInternal(CoreModel* pModel)
 }
 
 
+bool CoreScene::RayCast(const Vector3f& Origin, const Vector3f& Dir, float MaxDistance, SceneRayHit& Hit)
+{
+    m_rayQueryResult.clear();
+    QueryRay(Origin, Dir, MaxDistance, m_rayQueryResult);
+
+    bool Found = false;
+    float Closest = MaxDistance;
+
+    for (int i = 0 ; i < (int)m_rayQueryResult.size() ; i++) {
+        // The candidates are sorted by the distance to their boxes so once a box
+        // is further than the closest triangle nothing else can be closer
+        if (m_rayQueryResult[i].Distance >= Closest) {
+            break;
+        }
+
+        CoreSceneObject* pSceneObject = m_rayQueryResult[i].pSceneObject;
+
+        ModelRayHit ModelHit;
+
+        if (pSceneObject->GetModel()->RayCast(pSceneObject->GetMatrix(), Origin, Dir, Closest, ModelHit)) {
+            Closest = ModelHit.Distance;
+            Hit.pSceneObject = pSceneObject;
+            Hit.MeshIndex = ModelHit.MeshIndex;
+            Hit.Triangle = ModelHit.Triangle;
+            Hit.Distance = ModelHit.Distance;
+            Found = true;
+        }
+    }
+
+    if (Found) {
+        Hit.Point = Origin + Dir * Hit.Distance;
+    }
+
+    return Found;
+}
+
 const std::vector<PointLight>& CoreScene::GetPointLights()
 {
     if (m_pointLights.size() > 0) {
@@ -0,0 +1,559 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <assert.h>
+#include <algorithm>
+
+#include "Int/core_scene_bvh.h"
+
+// A leaf whose fat box is this many times larger (in surface area) than the fat box
+// it would get now is reinserted even though it is still contained. Keeps objects
+// that shrink from leaving huge boxes behind.
+#define MAX_FAT_BOX_AREA_RATIO 4.0f
+
+
+static BoundingVolume Union(const BoundingVolume& a, const BoundingVolume& b)
+{
+    BoundingVolume Ret = a;
+    Ret.Add(b);
+    return Ret;
+}
+
+
+int SceneBVH::Insert(const BoundingVolume& Box, void* pUserData)
+{
+    int Leaf = AllocNode();
+
+    m_nodes[Leaf].Box = CalcFatBox(Box);
+    m_nodes[Leaf].LeafBox = Box;
+    m_nodes[Leaf].pUserData = pUserData;
+    m_nodes[Leaf].Height = 0;
+
+    InsertLeaf(Leaf);
+
+    m_numLeaves++;
+
+    return Leaf;
+}
+
+
+void SceneBVH::Remove(int Proxy)
+{
+    assert((Proxy >= 0) && (Proxy < (int)m_nodes.size()));
+    assert(m_nodes[Proxy].IsLeaf());
+
+    RemoveLeaf(Proxy);
+    FreeNode(Proxy);
+
+    m_numLeaves--;
+}
+
+
+bool SceneBVH::Update(int Proxy, const BoundingVolume& Box)
+{
+    assert((Proxy >= 0) && (Proxy < (int)m_nodes.size()));
+    assert(m_nodes[Proxy].IsLeaf());
+
+    m_nodes[Proxy].LeafBox = Box;
+
+    BoundingVolume FatBox = CalcFatBox(Box);
+
+    if (m_nodes[Proxy].Box.Contains(Box) &&
+        (m_nodes[Proxy].Box.GetSurfaceArea() <= FatBox.GetSurfaceArea() * MAX_FAT_BOX_AREA_RATIO)) {
+        return false;
+    }
+
+    RemoveLeaf(Proxy);
+    m_nodes[Proxy].Box = FatBox;
+    InsertLeaf(Proxy);
+
+    return true;
+}
+
+
+void SceneBVH::Clear()
+{
+    m_nodes.clear();
+    m_root = NULL_NODE;
+    m_freeList = NULL_NODE;
+    m_numLeaves = 0;
+}
+
+
+int SceneBVH::AllocNode()
+{
+    if (m_freeList == NULL_NODE) {
+        m_nodes.push_back(Node());
+        return (int)m_nodes.size() - 1;
+    }
+
+    int NodeIndex = m_freeList;
+    m_freeList = m_nodes[NodeIndex].Parent;
+    m_nodes[NodeIndex] = Node();
+
+    return NodeIndex;
+}
+
+
+void SceneBVH::FreeNode(int NodeIndex)
+{
+    m_nodes[NodeIndex].Parent = m_freeList;
+    m_nodes[NodeIndex].Height = -1;
+    m_nodes[NodeIndex].pUserData = NULL;
+    m_freeList = NodeIndex;
+}
+
+
+BoundingVolume SceneBVH::CalcFatBox(const BoundingVolume& Box) const
+{
+    Vector3f Size = Box.Max - Box.Min;
+    float Margin = std::max(Size.x, std::max(Size.y, Size.z)) * m_marginRatio;
+
+    BoundingVolume Ret;
+    Ret.Min = Box.Min - Vector3f(Margin, Margin, Margin);
+    Ret.Max = Box.Max + Vector3f(Margin, Margin, Margin);
+
+    return Ret;
+}
+
+
+void SceneBVH::InsertLeaf(int Leaf)
+{
+    if (m_root == NULL_NODE) {
+        m_root = Leaf;
+        m_nodes[m_root].Parent = NULL_NODE;
+        return;
+    }
+
+    // Walk down the tree and find the sibling that adds the least surface area
+    // (the branch and bound heuristic of the Box2D dynamic tree)
+    BoundingVolume LeafBox = m_nodes[Leaf].Box;
+    int Index = m_root;
+
+    while (!m_nodes[Index].IsLeaf()) {
+        const Node& n = m_nodes[Index];
+
+        float Area = n.Box.GetSurfaceArea();
+        float CombinedArea = Union(n.Box, LeafBox).GetSurfaceArea();
+
+        // Cost of creating a new parent for this node and the new leaf
+        float Cost = 2.0f * CombinedArea;
+
+        // Minimum cost of pushing the leaf further down the tree
+        float InheritanceCost = 2.0f * (CombinedArea - Area);
+
+        float ChildCost[2];
+        int Children[2] = { n.Child1, n.Child2 };
+
+        for (int i = 0 ; i < 2 ; i++) {
+            const Node& Child = m_nodes[Children[i]];
+            float NewArea = Union(Child.Box, LeafBox).GetSurfaceArea();
+
+            if (Child.IsLeaf()) {
+                ChildCost[i] = NewArea + InheritanceCost;
+            } else {
+                ChildCost[i] = (NewArea - Child.Box.GetSurfaceArea()) + InheritanceCost;
+            }
+        }
+
+        if ((Cost < ChildCost[0]) && (Cost < ChildCost[1])) {
+            break;
+        }
+
+        Index = (ChildCost[0] < ChildCost[1]) ? Children[0] : Children[1];
+    }
+
+    int Sibling = Index;
+
+    // AllocNode may grow the vector so no references across this call
+    int NewParent = AllocNode();
+    int OldParent = m_nodes[Sibling].Parent;
+
+    m_nodes[NewParent].Parent = OldParent;
+    m_nodes[NewParent].Box = Union(LeafBox, m_nodes[Sibling].Box);
+    m_nodes[NewParent].Height = m_nodes[Sibling].Height + 1;
+    m_nodes[NewParent].Child1 = Sibling;
+    m_nodes[NewParent].Child2 = Leaf;
+
+    if (OldParent != NULL_NODE) {
+        if (m_nodes[OldParent].Child1 == Sibling) {
+            m_nodes[OldParent].Child1 = NewParent;
+        } else {
+            m_nodes[OldParent].Child2 = NewParent;
+        }
+    } else {
+        m_root = NewParent;
+    }
+
+    m_nodes[Sibling].Parent = NewParent;
+    m_nodes[Leaf].Parent = NewParent;
+
+    FixUpwards(m_nodes[Leaf].Parent);
+}
+
+
+void SceneBVH::RemoveLeaf(int Leaf)
+{
+    if (Leaf == m_root) {
+        m_root = NULL_NODE;
+        return;
+    }
+
+    int Parent = m_nodes[Leaf].Parent;
+    int GrandParent = m_nodes[Parent].Parent;
+    int Sibling = (m_nodes[Parent].Child1 == Leaf) ? m_nodes[Parent].Child2 : m_nodes[Parent].Child1;
+
+    if (GrandParent != NULL_NODE) {
+        if (m_nodes[GrandParent].Child1 == Parent) {
+            m_nodes[GrandParent].Child1 = Sibling;
+        } else {
+            m_nodes[GrandParent].Child2 = Sibling;
+        }
+
+        m_nodes[Sibling].Parent = GrandParent;
+        FreeNode(Parent);
+
+        FixUpwards(GrandParent);
+    } else {
+        m_root = Sibling;
+        m_nodes[Sibling].Parent = NULL_NODE;
+        FreeNode(Parent);
+    }
+
+    m_nodes[Leaf].Parent = NULL_NODE;
+}
+
+
+// Walk from a node to the root, rebalancing and refitting the boxes on the way
+void SceneBVH::FixUpwards(int NodeIndex)
+{
+    while (NodeIndex != NULL_NODE) {
+        NodeIndex = Balance(NodeIndex);
+
+        Node& n = m_nodes[NodeIndex];
+        const Node& Child1 = m_nodes[n.Child1];
+        const Node& Child2 = m_nodes[n.Child2];
+
+        n.Height = 1 + std::max(Child1.Height, Child2.Height);
+        n.Box = Union(Child1.Box, Child2.Box);
+
+        NodeIndex = n.Parent;
+    }
+}
+
+
+// If one subtree of A is more than one level higher than the other, rotate its
+// root up. Returns the index of the node that took the place of A.
+int SceneBVH::Balance(int iA)
+{
+    Node& A = m_nodes[iA];
+
+    if (A.IsLeaf() || (A.Height < 2)) {
+        return iA;
+    }
+
+    int iB = A.Child1;
+    int iC = A.Child2;
+    Node& B = m_nodes[iB];
+    Node& C = m_nodes[iC];
+
+    int Diff = C.Height - B.Height;
+
+    if (Diff > 1) {
+        // Rotate C up
+        int iF = C.Child1;
+        int iG = C.Child2;
+        Node& F = m_nodes[iF];
+        Node& G = m_nodes[iG];
+
+        C.Child1 = iA;
+        C.Parent = A.Parent;
+        A.Parent = iC;
+
+        if (C.Parent != NULL_NODE) {
+            if (m_nodes[C.Parent].Child1 == iA) {
+                m_nodes[C.Parent].Child1 = iC;
+            } else {
+                m_nodes[C.Parent].Child2 = iC;
+            }
+        } else {
+            m_root = iC;
+        }
+
+        // The higher of F and G stays under C, the other one moves to A
+        if (F.Height > G.Height) {
+            C.Child2 = iF;
+            A.Child2 = iG;
+            G.Parent = iA;
+            A.Box = Union(B.Box, G.Box);
+            C.Box = Union(A.Box, F.Box);
+            A.Height = 1 + std::max(B.Height, G.Height);
+            C.Height = 1 + std::max(A.Height, F.Height);
+        } else {
+            C.Child2 = iG;
+            A.Child2 = iF;
+            F.Parent = iA;
+            A.Box = Union(B.Box, F.Box);
+            C.Box = Union(A.Box, G.Box);
+            A.Height = 1 + std::max(B.Height, F.Height);
+            C.Height = 1 + std::max(A.Height, G.Height);
+        }
+
+        return iC;
+    }
+
+    if (Diff < -1) {
+        // Rotate B up
+        int iD = B.Child1;
+        int iE = B.Child2;
+        Node& D = m_nodes[iD];
+        Node& E = m_nodes[iE];
+
+        B.Child1 = iA;
+        B.Parent = A.Parent;
+        A.Parent = iB;
+
+        if (B.Parent != NULL_NODE) {
+            if (m_nodes[B.Parent].Child1 == iA) {
+                m_nodes[B.Parent].Child1 = iB;
+            } else {
+                m_nodes[B.Parent].Child2 = iB;
+            }
+        } else {
+            m_root = iB;
+        }
+
+        if (D.Height > E.Height) {
+            B.Child2 = iD;
+            A.Child1 = iE;
+            E.Parent = iA;
+            A.Box = Union(C.Box, E.Box);
+            B.Box = Union(A.Box, D.Box);
+            A.Height = 1 + std::max(C.Height, E.Height);
+            B.Height = 1 + std::max(A.Height, D.Height);
+        } else {
+            B.Child2 = iE;
+            A.Child1 = iD;
+            D.Parent = iA;
+            A.Box = Union(C.Box, D.Box);
+            B.Box = Union(A.Box, E.Box);
+            A.Height = 1 + std::max(C.Height, D.Height);
+            B.Height = 1 + std::max(A.Height, E.Height);
+        }
+
+        return iB;
+    }
+
+    return iA;
+}
+
+
+void SceneBVH::CollectLeaves(int NodeIndex, std::vector<void*>& Result, std::vector<int>& Stack) const
+{
+    size_t StackBase = Stack.size();
+
+    Stack.push_back(NodeIndex);
+
+    while (Stack.size() > StackBase) {
+        const Node& n = m_nodes[Stack.back()];
+        Stack.pop_back();
+
+        if (n.IsLeaf()) {
+            Result.push_back(n.pUserData);
+        } else {
+            Stack.push_back(n.Child1);
+            Stack.push_back(n.Child2);
+        }
+    }
+}
+
+
+void SceneBVH::QueryFrustum(const ViewFrustum& Frustum, std::vector<void*>& Result) const
+{
+    if (m_root == NULL_NODE) {
+        return;
+    }
+
+    std::vector<int> Stack;
+    Stack.reserve(64);
+    Stack.push_back(m_root);
+
+    while (!Stack.empty()) {
+        int NodeIndex = Stack.back();
+        Stack.pop_back();
+
+        const Node& n = m_nodes[NodeIndex];
+
+        if (n.IsLeaf()) {
+            if (Frustum.IsVisible(n.LeafBox)) {
+                Result.push_back(n.pUserData);
+            }
+            continue;
+        }
+
+        switch (Frustum.ClassifyBox(n.Box)) {
+        case FRUSTUM_OUTSIDE:
+            break;
+
+        case FRUSTUM_INSIDE:
+            // Every box below is inside as well
+            CollectLeaves(NodeIndex, Result, Stack);
+            break;
+
+        case FRUSTUM_INTERSECTS:
+            Stack.push_back(n.Child1);
+            Stack.push_back(n.Child2);
+            break;
+        }
+    }
+}
+
+
+void SceneBVH::QueryBox(const BoundingVolume& Box, std::vector<void*>& Result) const
+{
+    if (m_root == NULL_NODE) {
+        return;
+    }
+
+    std::vector<int> Stack;
+    Stack.reserve(64);
+    Stack.push_back(m_root);
+
+    while (!Stack.empty()) {
+        const Node& n = m_nodes[Stack.back()];
+        Stack.pop_back();
+
+        if (n.IsLeaf()) {
+            if (n.LeafBox.Overlaps(Box)) {
+                Result.push_back(n.pUserData);
+            }
+        } else if (n.Box.Overlaps(Box)) {
+            Stack.push_back(n.Child1);
+            Stack.push_back(n.Child2);
+        }
+    }
+}
+
+
+void SceneBVH::QuerySphere(const Vector3f& Center, float Radius, std::vector<void*>& Result) const
+{
+    if (m_root == NULL_NODE) {
+        return;
+    }
+
+    std::vector<int> Stack;
+    Stack.reserve(64);
+    Stack.push_back(m_root);
+
+    while (!Stack.empty()) {
+        const Node& n = m_nodes[Stack.back()];
+        Stack.pop_back();
+
+        if (n.IsLeaf()) {
+            if (n.LeafBox.OverlapsSphere(Center, Radius)) {
+                Result.push_back(n.pUserData);
+            }
+        } else if (n.Box.OverlapsSphere(Center, Radius)) {
+            Stack.push_back(n.Child1);
+            Stack.push_back(n.Child2);
+        }
+    }
+}
+
+
+void SceneBVH::QueryRay(const Vector3f& Origin, const Vector3f& Dir, float MaxDistance, std::vector<RayHit>& Result) const
+{
+    if (m_root == NULL_NODE) {
+        return;
+    }
+
+    Vector3f InvDir(1.0f / Dir.x, 1.0f / Dir.y, 1.0f / Dir.z);
+
+    size_t FirstHit = Result.size();
+
+    std::vector<int> Stack;
+    Stack.reserve(64);
+    Stack.push_back(m_root);
+
+    while (!Stack.empty()) {
+        const Node& n = m_nodes[Stack.back()];
+        Stack.pop_back();
+
+        float Distance = 0.0f;
+
+        if (n.IsLeaf()) {
+            if (n.LeafBox.IntersectsRay(Origin, InvDir, MaxDistance, Distance)) {
+                RayHit Hit;
+                Hit.pUserData = n.pUserData;
+                Hit.Distance = Distance;
+                Result.push_back(Hit);
+            }
+        } else if (n.Box.IntersectsRay(Origin, InvDir, MaxDistance, Distance)) {
+            Stack.push_back(n.Child1);
+            Stack.push_back(n.Child2);
+        }
+    }
+
+    std::sort(Result.begin() + FirstHit, Result.end(),
+              [](const RayHit& a, const RayHit& b) { return a.Distance < b.Distance; });
+}
+
+
+bool SceneBVH::Validate() const
+{
+    if (m_root == NULL_NODE) {
+        return m_numLeaves == 0;
+    }
+
+    if (m_nodes[m_root].Parent != NULL_NODE) {
+        return false;
+    }
+
+    return ValidateNode(m_root);
+}
+
+
+bool SceneBVH::ValidateNode(int NodeIndex) const
+{
+    const Node& n = m_nodes[NodeIndex];
+
+    if (n.IsLeaf()) {
+        return (n.Height == 0) && (n.Child2 == NULL_NODE) && n.Box.Contains(n.LeafBox);
+    }
+
+    const Node& Child1 = m_nodes[n.Child1];
+    const Node& Child2 = m_nodes[n.Child2];
+
+    if ((Child1.Parent != NodeIndex) || (Child2.Parent != NodeIndex)) {
+        return false;
+    }
+
+    if (n.Height != 1 + std::max(Child1.Height, Child2.Height)) {
+        return false;
+    }
+
+    if (abs(Child1.Height - Child2.Height) > 1) {
+        return false;
+    }
+
+    if (!n.Box.Contains(Child1.Box) || !n.Box.Contains(Child2.Box)) {
+        return false;
+    }
+
+    return ValidateNode(n.Child1) && ValidateNode(n.Child2);
+}
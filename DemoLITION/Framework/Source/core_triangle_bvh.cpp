@@ -0,0 +1,341 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+
+#include "Int/core_triangle_bvh.h"
+
+#define MAX_LEAF_TRIANGLES 4
+#define NUM_SAH_BINS 16
+
+
+void TriangleBVH::Build(const Vector3f* pPositions, uint NumPositions, const uint* pIndices, uint NumIndices)
+{
+    m_nodes.clear();
+    m_positions.assign(pPositions, pPositions + NumPositions);
+    m_triIndices.clear();
+    m_triIds.clear();
+
+    uint NumTriangles = NumIndices / 3;
+
+    if (NumTriangles == 0) {
+        return;
+    }
+
+    std::vector<BuildTriangle> Triangles(NumTriangles);
+    m_triIds.resize(NumTriangles);
+
+    for (uint i = 0 ; i < NumTriangles ; i++) {
+        BuildTriangle& t = Triangles[i];
+        t.Box.Add(pPositions[pIndices[i * 3]]);
+        t.Box.Add(pPositions[pIndices[i * 3 + 1]]);
+        t.Box.Add(pPositions[pIndices[i * 3 + 2]]);
+        t.Centroid = t.Box.GetCenter();
+        m_triIds[i] = i;
+    }
+
+    // A binary tree with at least one triangle per leaf has less than 2N nodes
+    m_nodes.reserve(NumTriangles * 2);
+
+    Node Root;
+    Root.First = 0;
+    Root.Count = NumTriangles;
+    m_nodes.push_back(Root);
+
+    Subdivide(0, Triangles);
+
+    // Store the triangles in the order of the leaves so that a leaf is a contiguous range
+    m_triIndices.resize(NumTriangles * 3);
+
+    for (uint i = 0 ; i < NumTriangles ; i++) {
+        uint Src = m_triIds[i] * 3;
+        m_triIndices[i * 3]     = pIndices[Src];
+        m_triIndices[i * 3 + 1] = pIndices[Src + 1];
+        m_triIndices[i * 3 + 2] = pIndices[Src + 2];
+    }
+
+    m_nodes.shrink_to_fit();
+}
+
+
+void TriangleBVH::Subdivide(uint NodeIndex, std::vector<BuildTriangle>& Triangles)
+{
+    Node& n = m_nodes[NodeIndex];
+
+    for (uint i = n.First ; i < n.First + n.Count ; i++) {
+        n.Box.Add(Triangles[i].Box);
+    }
+
+    if (n.Count <= MAX_LEAF_TRIANGLES) {
+        return;
+    }
+
+    int Axis = 0;
+    float SplitPos = 0.0f;
+
+    if (!FindSplit(n, Triangles, Axis, SplitPos)) {
+        return;
+    }
+
+    // Partition the triangles of the node around the split position
+    int i = (int)n.First;
+    int j = (int)(n.First + n.Count) - 1;
+
+    while (i <= j) {
+        if (Triangles[i].Centroid[Axis] < SplitPos) {
+            i++;
+        } else {
+            std::swap(Triangles[i], Triangles[j]);
+            std::swap(m_triIds[i], m_triIds[j]);
+            j--;
+        }
+    }
+
+    uint LeftCount = (uint)i - n.First;
+
+    if ((LeftCount == 0) || (LeftCount == n.Count)) {
+        return;
+    }
+
+    // The vector has reserved enough space so the reference to the node stays valid
+    uint Left = (uint)m_nodes.size();
+
+    Node LeftNode;
+    LeftNode.First = n.First;
+    LeftNode.Count = LeftCount;
+
+    Node RightNode;
+    RightNode.First = n.First + LeftCount;
+    RightNode.Count = n.Count - LeftCount;
+
+    m_nodes.push_back(LeftNode);
+    m_nodes.push_back(RightNode);
+
+    n.First = Left;
+    n.Count = 0;
+
+    Subdivide(Left, Triangles);
+    Subdivide(Left + 1, Triangles);
+}
+
+
+// Binned surface area heuristic. Returns false if no split is cheaper than a leaf.
+bool TriangleBVH::FindSplit(const Node& n, const std::vector<BuildTriangle>& Triangles, int& Axis, float& SplitPos) const
+{
+    BoundingVolume CentroidBounds;
+
+    for (uint i = n.First ; i < n.First + n.Count ; i++) {
+        CentroidBounds.Add(Triangles[i].Centroid);
+    }
+
+    // Only the longest axis of the centroids is considered. Much faster to build
+    // and the trees are almost as good.
+    Vector3f Size = CentroidBounds.Max - CentroidBounds.Min;
+    int a = 0;
+
+    if (Size.y > Size[a]) {
+        a = 1;
+    }
+
+    if (Size.z > Size[a]) {
+        a = 2;
+    }
+
+    float Min = CentroidBounds.Min[a];
+    float Max = CentroidBounds.Max[a];
+
+    if (Max <= Min) {
+        return false;
+    }
+
+    float BestCost = n.Count * n.Box.GetSurfaceArea();
+    bool Found = false;
+
+    BoundingVolume BinBoxes[NUM_SAH_BINS];
+    uint BinCounts[NUM_SAH_BINS] = { 0 };
+    float Scale = NUM_SAH_BINS / (Max - Min);
+
+    for (uint i = n.First ; i < n.First + n.Count ; i++) {
+        int Bin = std::min(NUM_SAH_BINS - 1, (int)((Triangles[i].Centroid[a] - Min) * Scale));
+        BinCounts[Bin]++;
+        BinBoxes[Bin].Add(Triangles[i].Box);
+    }
+
+    // Sweep from the left and from the right to get the cost of every split plane
+    float LeftArea[NUM_SAH_BINS - 1];
+    uint LeftCount[NUM_SAH_BINS - 1];
+    BoundingVolume Box;
+    uint Count = 0;
+
+    for (int b = 0 ; b < NUM_SAH_BINS - 1 ; b++) {
+        Box.Add(BinBoxes[b]);
+        Count += BinCounts[b];
+        LeftArea[b] = Box.GetSurfaceArea();
+        LeftCount[b] = Count;
+    }
+
+    Box = BoundingVolume();
+    Count = 0;
+
+    for (int b = NUM_SAH_BINS - 1 ; b > 0 ; b--) {
+        Box.Add(BinBoxes[b]);
+        Count += BinCounts[b];
+
+        float Cost = LeftCount[b - 1] * LeftArea[b - 1] + Count * Box.GetSurfaceArea();
+
+        if (Cost < BestCost) {
+            BestCost = Cost;
+            Axis = a;
+            SplitPos = Min + b / Scale;
+            Found = true;
+        }
+    }
+
+    return Found;
+}
+
+
+bool TriangleBVH::RayCast(const Vector3f& Origin, const Vector3f& Dir, float MaxDistance, TriangleHit& Hit) const
+{
+    if (m_nodes.empty()) {
+        return false;
+    }
+
+    Vector3f InvDir(1.0f / Dir.x, 1.0f / Dir.y, 1.0f / Dir.z);
+
+    float Closest = MaxDistance;
+    bool Found = false;
+
+    std::vector<uint> Stack;
+    Stack.reserve(64);
+    Stack.push_back(0);
+
+    while (!Stack.empty()) {
+        const Node& n = m_nodes[Stack.back()];
+        Stack.pop_back();
+
+        float Distance = 0.0f;
+
+        if (!n.Box.IntersectsRay(Origin, InvDir, Closest, Distance)) {
+            continue;
+        }
+
+        if (n.Count > 0) {
+            for (uint i = n.First ; i < n.First + n.Count ; i++) {
+                if (IntersectTriangle(i, Origin, Dir, Closest, Hit)) {
+                    Closest = Hit.Distance;
+                    Found = true;
+                }
+            }
+            continue;
+        }
+
+        // Visit the nearer child first so that the far one is more likely to be pruned
+        float DistLeft = FLT_MAX, DistRight = FLT_MAX;
+        bool HitLeft = m_nodes[n.First].Box.IntersectsRay(Origin, InvDir, Closest, DistLeft);
+        bool HitRight = m_nodes[n.First + 1].Box.IntersectsRay(Origin, InvDir, Closest, DistRight);
+
+        if (HitLeft && HitRight) {
+            if (DistLeft <= DistRight) {
+                Stack.push_back(n.First + 1);
+                Stack.push_back(n.First);
+            } else {
+                Stack.push_back(n.First);
+                Stack.push_back(n.First + 1);
+            }
+        } else if (HitLeft) {
+            Stack.push_back(n.First);
+        } else if (HitRight) {
+            Stack.push_back(n.First + 1);
+        }
+    }
+
+    return Found;
+}
+
+
+bool TriangleBVH::RayCast(const Matrix4f& World, const Vector3f& Origin, const Vector3f& Dir, float MaxDistance, TriangleHit& Hit) const
+{
+    if (m_nodes.empty()) {
+        return false;
+    }
+
+    // Dir is not normalized in the local space so the distance is still in units of its length
+    Matrix4f WorldToLocal = World.AffineInverse();
+    Vector3f LocalOrigin = (WorldToLocal * Vector4f(Origin, 1.0f)).to3f();
+    Vector3f LocalDir = (WorldToLocal * Vector4f(Dir, 0.0f)).to3f();
+
+    return RayCast(LocalOrigin, LocalDir, MaxDistance, Hit);
+}
+
+
+// Moller-Trumbore. Both sides of the triangle are hit.
+bool TriangleBVH::IntersectTriangle(uint Tri, const Vector3f& Origin, const Vector3f& Dir, float MaxDistance, TriangleHit& Hit) const
+{
+    const Vector3f& v0 = m_positions[m_triIndices[Tri * 3]];
+    const Vector3f& v1 = m_positions[m_triIndices[Tri * 3 + 1]];
+    const Vector3f& v2 = m_positions[m_triIndices[Tri * 3 + 2]];
+
+    Vector3f Edge1 = v1 - v0;
+    Vector3f Edge2 = v2 - v0;
+
+    Vector3f p = Dir.Cross(Edge2);
+    float Det = Edge1.Dot(p);
+
+    if (fabsf(Det) < 1e-12f) {
+        return false;   // the ray is parallel to the triangle
+    }
+
+    float InvDet = 1.0f / Det;
+
+    Vector3f s = Origin - v0;
+    float u = s.Dot(p) * InvDet;
+
+    if ((u < 0.0f) || (u > 1.0f)) {
+        return false;
+    }
+
+    Vector3f q = s.Cross(Edge1);
+    float v = Dir.Dot(q) * InvDet;
+
+    if ((v < 0.0f) || (u + v > 1.0f)) {
+        return false;
+    }
+
+    float t = Edge2.Dot(q) * InvDet;
+
+    if ((t < 0.0f) || (t >= MaxDistance)) {
+        return false;
+    }
+
+    Hit.Distance = t;
+    Hit.Triangle = m_triIds[Tri];
+    Hit.u = u;
+    Hit.v = v;
+
+    return true;
+}
+
+
+size_t TriangleBVH::GetMemoryUsage() const
+{
+    return m_nodes.capacity() * sizeof(Node) +
+           m_positions.capacity() * sizeof(Vector3f) +
+           m_triIndices.capacity() * sizeof(uint) +
+           m_triIds.capacity() * sizeof(uint);
+}
@@ -40,6 +40,9 @@
 
 #define NUM_PSOs 1000
 
+// Physics steps per second, independent of the frame rate
+#define PHYSICS_STEP_RATE 120.0f
+
 struct PhysicsSceneObject {
     SceneObject* pSceneObject = NULL;
     OgldevPhysics::Particle* pParticle = NULL;
@@ -80,6 +83,8 @@ public:
         m_spotLight.Cutoff = 30.0f;
         m_spotLight.DiffuseIntensity = 0.2f;
         m_spotLight.AmbientIntensity = 0.1f;
+
+        m_physicsSystem.SetFixedTimeStep(PHYSICS_STEP_RATE);
     }
 
     ~Carbonara() {}
@@ -159,7 +164,9 @@ public:
         Box.pParticle->SetPosition(0.0f, 9.5f, 0.0f);
 
         m_buoyancyForceGenerator.Init(5.0f, 1.0f, 10.0f, 0.1f);
-        m_fakeSpringForceGenerator.Init(&Water.pParticle->GetPosition(), 0.000001f, 0.01f);
+        // The water has an infinite mass so its position never changes
+        m_waterPos = Water.pParticle->GetPosition();
+        m_fakeSpringForceGenerator.Init(&m_waterPos, 0.000001f, 0.01f);
         m_physicsSystem.GetRegistry().Add(Box.pParticle, &m_fakeSpringForceGenerator);
     }
 
@@ -206,7 +213,7 @@ public:
     {
         for (std::list<PhysicsSceneObject>::iterator it = m_sceneObjects.begin(); it != m_sceneObjects.end(); it++) {
             if (it->pParticle) {
-                const Vector3f& NewPos = it->pParticle->GetPosition();
+                Vector3f NewPos = m_physicsSystem.GetInterpolatedPosition(it->pParticle);
                 it->pSceneObject->SetPosition(NewPos);
             }
         }
@@ -448,6 +455,7 @@ private:
     OgldevPhysics::SpringForceGenerator m_springForceGenerator;
     OgldevPhysics::BuoyancyForceGenerator m_buoyancyForceGenerator;
     OgldevPhysics::FakeSpringForceGenerator m_fakeSpringForceGenerator;
+    Vector3f m_waterPos;
 };
 
 
@@ -697,21 +705,21 @@ protected:
         // Add the proportion to the correct masses
         m_particles[x * 2 + z]->SetMass(BASE_MASS + EXTRA_MASS * (1 - xp) * (1 - zp));
 
-        m_ballDisplayPos += (m_particles[x * 2 + z]->GetPosition() * (1 - xp) * (1 - zp));
+        m_ballDisplayPos += (m_physicsSystem.GetInterpolatedPosition(m_particles[x * 2 + z]) * (1 - xp) * (1 - zp));
 
         if (xp > 0) {
             m_particles[x * 2 + z + 2]->SetMass(BASE_MASS + EXTRA_MASS * xp * (1 - zp));
-            m_ballDisplayPos += (m_particles[x * 2 + z + 2]->GetPosition() * xp * (1 - zp));
+            m_ballDisplayPos += (m_physicsSystem.GetInterpolatedPosition(m_particles[x * 2 + z + 2]) * xp * (1 - zp));
 
             if (zp > 0) {
                 m_particles[x * 2 + z + 3]->SetMass(BASE_MASS + EXTRA_MASS * xp * zp);
-                m_ballDisplayPos += (m_particles[x * 2 + z + 3]->GetPosition() * xp * zp);
+                m_ballDisplayPos += (m_physicsSystem.GetInterpolatedPosition(m_particles[x * 2 + z + 3]) * xp * zp);
             }
         }
 
         if (zp > 0) {
             m_particles[x * 2 + z + 1]->SetMass(BASE_MASS + EXTRA_MASS * (1 - xp) * zp);
-            m_ballDisplayPos += (m_particles[x * 2 + z + 1]->GetPosition() * (1 - xp) * zp);
+            m_ballDisplayPos += (m_physicsSystem.GetInterpolatedPosition(m_particles[x * 2 + z + 1]) * (1 - xp) * zp);
         }
 
         m_ballDisplayPos.y += 0.5f;
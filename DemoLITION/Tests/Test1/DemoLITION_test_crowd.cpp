@@ -0,0 +1,110 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    DemoLITION - Forward Renderer Demo
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "demolition.h"
+
+
+#define WINDOW_WIDTH  1920
+#define WINDOW_HEIGHT 1080
+
+#define CROWD_WIDTH 24
+#define CROWD_DEPTH 24
+#define CROWD_SPACING 1.5f
+
+
+// Many instances of the same animated model. Every instance plays the animation
+// with a different time offset so the renderer evaluates all the bone transforms
+// of the crowd with one batched call per frame.
+class CrowdTest : public GameCallbacks
+{
+public:
+
+    virtual ~CrowdTest()
+    {
+    }
+
+
+    void Init()
+    {
+        bool LoadBasicShapes = false;
+        m_pRenderingSystem = RenderingSystem::CreateRenderingSystem(RENDERING_SYSTEM_GL, this, LoadBasicShapes);
+
+        m_pRenderingSystem->CreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Crowd Test");
+
+        m_pScene = m_pRenderingSystem->CreateEmptyScene();
+
+        m_pScene->SetCamera(Vector3f(0.0f, 8.0f, -6.0f), Vector3f(0.0f, -0.5f, 1.0f));
+
+        DirectionalLight DirLight;
+        DirLight.WorldDirection = Vector3f(1.0f, -1.0f, 1.0f);
+        DirLight.DiffuseIntensity = 1.0f;
+
+        m_pScene->GetDirLights().push_back(DirLight);
+
+        m_pRenderingSystem->SetScene(m_pScene);
+
+        InitCrowd();
+    }
+
+
+    void Run()
+    {
+        m_pRenderingSystem->Execute();
+    }
+
+private:
+
+    void InitCrowd()
+    {
+        m_pModel = m_pRenderingSystem->LoadModel("../Content/boblampclean.md5mesh");
+
+        for (int z = 0 ; z < CROWD_DEPTH ; z++) {
+            for (int x = 0 ; x < CROWD_WIDTH ; x++) {
+                SceneObject* pSceneObject = m_pScene->CreateSceneObject(m_pModel);
+                m_pScene->AddToRenderList(pSceneObject);
+
+                float PosX = (x - CROWD_WIDTH / 2) * CROWD_SPACING;
+                float PosZ = z * CROWD_SPACING;
+                pSceneObject->SetPosition(PosX, 0.0f, PosZ);
+                pSceneObject->SetRotation(-90.0f, 180.0f, 0.0f);
+                pSceneObject->SetScale(0.02f, 0.02f, 0.02f);
+
+                float TimeOffsetSec = (float)(x * 7 + z * 13) * 0.1f;
+                pSceneObject->SetAnimation(0, TimeOffsetSec);
+            }
+        }
+    }
+
+    RenderingSystem* m_pRenderingSystem = NULL;
+    Scene* m_pScene = NULL;
+    Model* m_pModel = NULL;
+};
+
+
+void test_crowd()
+{
+    CrowdTest App;
+    App.Init();
+    App.Run();
+}
@@ -27,6 +27,7 @@ void test_lighting();
 void test_normal_map();
 void test_parallax_map();
 void test_grid();
+void test_crowd();
 void carbonara();
 
 
@@ -42,5 +43,6 @@ int main(int argc, char* arg[])
   //  test_normal_map();
    // test_parallax_map();
   // test_grid();
+  // test_crowd();
     carbonara();
 }
\ No newline at end of file
@@ -0,0 +1,66 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_COUNTER_RNG_H
+#define OGLDEV_COUNTER_RNG_H
+
+//
+// Counter based random numbers. Every number is a pure function of the seed and
+// a counter (e.g. the index of a heightmap cell) so unlike rand() the results do
+// not depend on the order of the calls or on how the work is split between threads.
+// The mixing function is the SplitMix64 finalizer.
+//
+
+class CounterRNG
+{
+public:
+    CounterRNG(unsigned int Seed = 0)
+    {
+        m_key = Mix((unsigned long long)Seed);
+    }
+
+    unsigned int GetUInt(unsigned long long Counter) const
+    {
+        return (unsigned int)(Mix(m_key + Counter * 0x9E3779B97F4A7C15ull) >> 32);
+    }
+
+    // [0, 1)
+    float GetFloat(unsigned long long Counter) const
+    {
+        return (float)(GetUInt(Counter) >> 8) * (1.0f / 16777216.0f);
+    }
+
+    // [Start, End)
+    float GetFloatRange(unsigned long long Counter, float Start, float End) const
+    {
+        return Start + GetFloat(Counter) * (End - Start);
+    }
+
+private:
+    static unsigned long long Mix(unsigned long long z)
+    {
+        z += 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    unsigned long long m_key = 0;
+};
+
+#endif
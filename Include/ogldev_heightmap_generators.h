@@ -0,0 +1,38 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_HEIGHTMAP_GENERATORS_H
+#define OGLDEV_HEIGHTMAP_GENERATORS_H
+
+#include "ogldev_array_2d.h"
+
+//
+// Procedural heightmaps for the terrain demos. They use all the cores and the
+// result depends only on the parameters and the seed - never on NumThreads
+// (zero means one thread per core). The heights are not normalized.
+//
+
+// Diamond-square. The grid has to be 2^n + 1 vertices across so other sizes are
+// generated on the next such grid and cropped.
+void GenerateMidpointDisplacement(Array2D<float>& HeightMap, int Size, float Roughness, unsigned int Seed, int NumThreads = 0);
+
+// Iterations random faults followed by the FIR erosion filter (Filter in [0, 1])
+void GenerateFaultFormation(Array2D<float>& HeightMap, int Size, int Iterations, float MinHeight, float MaxHeight,
+                            float Filter, unsigned int Seed, int NumThreads = 0);
+
+#endif
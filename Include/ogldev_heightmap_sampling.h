@@ -0,0 +1,40 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_HEIGHTMAP_SAMPLING_H
+#define OGLDEV_HEIGHTMAP_SAMPLING_H
+
+#include "ogldev_math_3d.h"
+#include "ogldev_array_2d.h"
+
+//
+// Normals and height queries that work directly on the heightmap of the terrain.
+// The heightmap sample (x, z) is at world position (x * WorldScale, z * WorldScale).
+//
+
+// One normal per sample from central differences (one sided on the borders). pNormals
+// has room for HeightMap.GetSize() normals in the order of the heightmap. The rows
+// are split between NumThreads threads (zero means one thread per core).
+void CalcHeightMapNormals(const Array2D<float>& HeightMap, float WorldScale, Vector3f* pNormals, int NumThreads = 0);
+
+// Bilinear height and the normal of the bilinear surface at Count world XZ positions.
+// Positions outside the heightmap are clamped to its border. pNormals may be NULL.
+void GetHeightsAndNormals(const Array2D<float>& HeightMap, float WorldScale, int Count,
+                          const Vector2f* pPositions, float* pHeights, Vector3f* pNormals);
+
+#endif
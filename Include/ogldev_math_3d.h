@@ -33,6 +33,7 @@
 #include <cfloat>
 
 #include "ogldev_util.h"
+#include "ogldev_simd.h"
 
 #include <assimp/vector3.h>
 #include <assimp/matrix3x3.h>
@@ -609,15 +610,31 @@ public:
         ZERO_MEM(m);
     }
 
+    // The SIMD versions below are slower than the plain loops when the Float4
+    // backend is scalar (OGLDEV_SIMD_SCALAR) so the loops are kept for that case.
     Matrix4f Transpose() const
     {
         Matrix4f n;
 
+#ifdef OGLDEV_SIMD_SCALAR
         for (unsigned int i = 0 ; i < 4 ; i++) {
             for (unsigned int j = 0 ; j < 4 ; j++) {
                 n.m[i][j] = m[j][i];
             }
         }
+#else
+        Float4 r0 = Load4(m[0]);
+        Float4 r1 = Load4(m[1]);
+        Float4 r2 = Load4(m[2]);
+        Float4 r3 = Load4(m[3]);
+
+        Transpose4(r0, r1, r2, r3);
+
+        Store4(n.m[0], r0);
+        Store4(n.m[1], r1);
+        Store4(n.m[2], r2);
+        Store4(n.m[3], r3);
+#endif
 
         return n;
     }
@@ -631,10 +648,33 @@ public:
         m[3][0] = 0.0f; m[3][1] = 0.0f; m[3][2] = 0.0f; m[3][3] = 1.0f;
     }
 
+    // Out = a * b. Every row of the result is a combination of the rows of b.
+    // Out can be the same matrix as a or b.
+    static inline void Multiply(const Matrix4f& a, const Matrix4f& b, Matrix4f& Out)
+    {
+#ifdef OGLDEV_SIMD_SCALAR
+        Out = a * b;
+#else
+        Float4 b0 = Load4(b.m[0]);
+        Float4 b1 = Load4(b.m[1]);
+        Float4 b2 = Load4(b.m[2]);
+        Float4 b3 = Load4(b.m[3]);
+
+        for (unsigned int i = 0 ; i < 4 ; i++) {
+            Float4 Row = Mul4(Set4(a.m[i][0]), b0);
+            Row = MulAdd4(Set4(a.m[i][1]), b1, Row);
+            Row = MulAdd4(Set4(a.m[i][2]), b2, Row);
+            Row = MulAdd4(Set4(a.m[i][3]), b3, Row);
+            Store4(Out.m[i], Row);
+        }
+#endif
+    }
+
     inline Matrix4f operator*(const Matrix4f& Right) const
     {
         Matrix4f Ret;
 
+#ifdef OGLDEV_SIMD_SCALAR
         for (unsigned int i = 0 ; i < 4 ; i++) {
             for (unsigned int j = 0 ; j < 4 ; j++) {
                 Ret.m[i][j] = m[i][0] * Right.m[0][j] +
@@ -643,6 +683,9 @@ public:
                               m[i][3] * Right.m[3][j];
             }
         }
+#else
+        Multiply(*this, Right, Ret);
+#endif
 
         return Ret;
     }
@@ -651,14 +694,35 @@ public:
     {
         Vector4f r;
 
+#ifdef OGLDEV_SIMD_SCALAR
         r.x = m[0][0]* v.x + m[0][1]* v.y + m[0][2]* v.z + m[0][3]* v.w;
         r.y = m[1][0]* v.x + m[1][1]* v.y + m[1][2]* v.z + m[1][3]* v.w;
         r.z = m[2][0]* v.x + m[2][1]* v.y + m[2][2]* v.z + m[2][3]* v.w;
         r.w = m[3][0]* v.x + m[3][1]* v.y + m[3][2]* v.z + m[3][3]* v.w;
+#else
+        // Transpose so that the result is a combination of the columns
+        Float4 c0 = Load4(m[0]);
+        Float4 c1 = Load4(m[1]);
+        Float4 c2 = Load4(m[2]);
+        Float4 c3 = Load4(m[3]);
+
+        Transpose4(c0, c1, c2, c3);
+
+        Float4 Res = Mul4(c0, Set4(v.x));
+        Res = MulAdd4(c1, Set4(v.y), Res);
+        Res = MulAdd4(c2, Set4(v.z), Res);
+        Res = MulAdd4(c3, Set4(v.w), Res);
+
+        Store4(&r.x, Res);
+#endif
 
         return r;
     }
 
+    // Batch version of operator*(Vector4f). The matrix is transposed only once
+    // for the entire array. pOut can be the same array as pIn.
+    void TransformVectors(const Vector4f* pIn, Vector4f* pOut, uint Count) const;
+
     operator const float*() const
     {
         return &(m[0][0]);
@@ -675,6 +739,10 @@ public:
 
     Matrix4f Inverse() const;
 
+    // Inverse of a matrix whose last row is (0, 0, 0, 1) (any combination of
+    // translation, rotation and scaling). Much cheaper than the general Inverse().
+    Matrix4f AffineInverse() const;
+
     void InitScaleTransform(float ScaleX, float ScaleY, float ScaleZ);
     void InitScaleTransform(float Scale);
     void InitScaleTransform(const Vector3f& Scale);
@@ -861,15 +929,8 @@ public:
 
     void Transform(const Matrix4f& m)
     {
-         NearTopLeft     = m * NearTopLeft;
-         NearBottomLeft  = m * NearBottomLeft;
-         NearTopRight    = m * NearTopRight;
-         NearBottomRight = m * NearBottomRight;
-
-         FarTopLeft     = m * FarTopLeft;
-         FarBottomLeft  = m * FarBottomLeft;
-         FarTopRight    = m * FarTopRight;
-         FarBottomRight = m * FarBottomRight;
+        // The corners are laid out one after the other (see the static_assert below)
+        m.TransformVectors(&NearTopLeft, &NearTopLeft, 8);
     }
 
 
@@ -901,6 +962,8 @@ public:
     }
 };
 
+static_assert(sizeof(Frustum) == 8 * sizeof(Vector4f), "Frustum::Transform expects the corners to be packed");
+
 
 class FrustumCulling
 {
@@ -936,6 +999,43 @@ public:
         return Inside;
     }
 
+    // Returns false if the box is completely outside one of the planes (conservative -
+    // a box near a corner of the frustum may be reported as inside). FullyInside is set
+    // when the box is inside all the planes.
+    bool IsBoxInsideViewFrustum(const Vector3f& Min, const Vector3f& Max, bool& FullyInside) const
+    {
+        FullyInside = true;
+
+        // The first three planes have the inside on their positive side and the
+        // other three on their negative side
+        const Vector4f* Planes[6] = { &m_leftClipPlane, &m_bottomClipPlane, &m_nearClipPlane,
+                                      &m_rightClipPlane, &m_topClipPlane, &m_farClipPlane };
+
+        for (int i = 0 ; i < 6 ; i++) {
+            float Sign = (i < 3) ? 1.0f : -1.0f;
+            Vector4f Plane = *Planes[i] * Sign;
+
+            // Corners of the box that are furthest along and against the plane normal
+            Vector4f Far((Plane.x >= 0.0f) ? Max.x : Min.x,
+                         (Plane.y >= 0.0f) ? Max.y : Min.y,
+                         (Plane.z >= 0.0f) ? Max.z : Min.z, 1.0f);
+            Vector4f Near((Plane.x >= 0.0f) ? Min.x : Max.x,
+                          (Plane.y >= 0.0f) ? Min.y : Max.y,
+                          (Plane.z >= 0.0f) ? Min.z : Max.z, 1.0f);
+
+            if (Plane.Dot(Far) < 0.0f) {
+                FullyInside = false;
+                return false;
+            }
+
+            if (Plane.Dot(Near) < 0.0f) {
+                FullyInside = false;
+            }
+        }
+
+        return true;
+    }
+
 private:
 
     Vector4f m_leftClipPlane;
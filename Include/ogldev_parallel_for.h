@@ -0,0 +1,63 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_PARALLEL_FOR_H
+#define OGLDEV_PARALLEL_FOR_H
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+//
+// Splits [0, Count) into contiguous bands, calls Func(Begin, End) for every band
+// on its own thread and waits for all of them. NumThreads zero means one thread
+// per core. The calling thread takes the first band.
+//
+template<typename Func>
+void ParallelFor(int Count, const Func& f, int NumThreads = 0)
+{
+    if (NumThreads <= 0) {
+        NumThreads = std::max((int)std::thread::hardware_concurrency(), 1);
+    }
+
+    NumThreads = std::min(NumThreads, Count);
+
+    if (NumThreads <= 1) {
+        if (Count > 0) {
+            f(0, Count);
+        }
+        return;
+    }
+
+    std::vector<std::thread> Threads;
+    Threads.reserve(NumThreads - 1);
+
+    for (int i = 1 ; i < NumThreads ; i++) {
+        int Begin = (int)((long long)Count * i / NumThreads);
+        int End = (int)((long long)Count * (i + 1) / NumThreads);
+        Threads.push_back(std::thread([&f, Begin, End]() { f(Begin, End); }));
+    }
+
+    f(0, (int)((long long)Count / NumThreads));
+
+    for (std::thread& t : Threads) {
+        t.join();
+    }
+}
+
+#endif
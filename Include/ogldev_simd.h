@@ -0,0 +1,134 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_SIMD_H
+#define OGLDEV_SIMD_H
+
+//
+// A thin 4 wide float abstraction used by the math library and the other hot loops.
+// The backend is selected at compile time: SSE on x86/x64, NEON on 64 bit ARM and
+// plain C++ on everything else. Define OGLDEV_NO_SIMD to force the scalar backend
+// (useful for comparing results).
+//
+// All loads and stores are unaligned so the existing structures (Matrix4f, Vector4f)
+// can be used without changing their layout.
+//
+
+#include <math.h>
+
+#if !defined(OGLDEV_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#define OGLDEV_SIMD_SSE
+#include <emmintrin.h>
+#elif !defined(OGLDEV_NO_SIMD) && defined(__ARM_NEON) && defined(__aarch64__)
+#define OGLDEV_SIMD_NEON
+#include <arm_neon.h>
+#else
+#define OGLDEV_SIMD_SCALAR
+#endif
+
+
+#if defined(OGLDEV_SIMD_SSE)
+
+typedef __m128 Float4;
+
+inline Float4 Load4(const float* p)             { return _mm_loadu_ps(p); }
+inline void Store4(float* p, Float4 a)          { _mm_storeu_ps(p, a); }
+inline Float4 Set4(float f)                     { return _mm_set1_ps(f); }
+inline Float4 Add4(Float4 a, Float4 b)          { return _mm_add_ps(a, b); }
+inline Float4 Sub4(Float4 a, Float4 b)          { return _mm_sub_ps(a, b); }
+inline Float4 Mul4(Float4 a, Float4 b)          { return _mm_mul_ps(a, b); }
+inline Float4 Div4(Float4 a, Float4 b)          { return _mm_div_ps(a, b); }
+inline Float4 Sqrt4(Float4 a)                   { return _mm_sqrt_ps(a); }
+inline Float4 Min4(Float4 a, Float4 b)          { return _mm_min_ps(a, b); }
+inline Float4 Max4(Float4 a, Float4 b)          { return _mm_max_ps(a, b); }
+
+inline void Transpose4(Float4& r0, Float4& r1, Float4& r2, Float4& r3)
+{
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+}
+
+#elif defined(OGLDEV_SIMD_NEON)
+
+typedef float32x4_t Float4;
+
+inline Float4 Load4(const float* p)             { return vld1q_f32(p); }
+inline void Store4(float* p, Float4 a)          { vst1q_f32(p, a); }
+inline Float4 Set4(float f)                     { return vdupq_n_f32(f); }
+inline Float4 Add4(Float4 a, Float4 b)          { return vaddq_f32(a, b); }
+inline Float4 Sub4(Float4 a, Float4 b)          { return vsubq_f32(a, b); }
+inline Float4 Mul4(Float4 a, Float4 b)          { return vmulq_f32(a, b); }
+inline Float4 Div4(Float4 a, Float4 b)          { return vdivq_f32(a, b); }
+inline Float4 Sqrt4(Float4 a)                   { return vsqrtq_f32(a); }
+inline Float4 Min4(Float4 a, Float4 b)          { return vminq_f32(a, b); }
+inline Float4 Max4(Float4 a, Float4 b)          { return vmaxq_f32(a, b); }
+
+inline void Transpose4(Float4& r0, Float4& r1, Float4& r2, Float4& r3)
+{
+    float32x4x2_t t01 = vtrnq_f32(r0, r1);
+    float32x4x2_t t23 = vtrnq_f32(r2, r3);
+
+    r0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+    r1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+    r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+    r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+}
+
+#else
+
+struct Float4 { float v[4]; };
+
+inline Float4 Load4(const float* p)             { Float4 r; for (int i = 0 ; i < 4 ; i++) r.v[i] = p[i]; return r; }
+inline void Store4(float* p, Float4 a)          { for (int i = 0 ; i < 4 ; i++) p[i] = a.v[i]; }
+inline Float4 Set4(float f)                     { Float4 r; for (int i = 0 ; i < 4 ; i++) r.v[i] = f; return r; }
+inline Float4 Add4(Float4 a, Float4 b)          { Float4 r; for (int i = 0 ; i < 4 ; i++) r.v[i] = a.v[i] + b.v[i]; return r; }
+inline Float4 Sub4(Float4 a, Float4 b)          { Float4 r; for (int i = 0 ; i < 4 ; i++) r.v[i] = a.v[i] - b.v[i]; return r; }
+inline Float4 Mul4(Float4 a, Float4 b)          { Float4 r; for (int i = 0 ; i < 4 ; i++) r.v[i] = a.v[i] * b.v[i]; return r; }
+inline Float4 Div4(Float4 a, Float4 b)          { Float4 r; for (int i = 0 ; i < 4 ; i++) r.v[i] = a.v[i] / b.v[i]; return r; }
+inline Float4 Sqrt4(Float4 a)                   { Float4 r; for (int i = 0 ; i < 4 ; i++) r.v[i] = sqrtf(a.v[i]); return r; }
+inline Float4 Min4(Float4 a, Float4 b)          { Float4 r; for (int i = 0 ; i < 4 ; i++) r.v[i] = (a.v[i] < b.v[i]) ? a.v[i] : b.v[i]; return r; }
+inline Float4 Max4(Float4 a, Float4 b)          { Float4 r; for (int i = 0 ; i < 4 ; i++) r.v[i] = (a.v[i] > b.v[i]) ? a.v[i] : b.v[i]; return r; }
+
+inline void Transpose4(Float4& r0, Float4& r1, Float4& r2, Float4& r3)
+{
+    Float4 t0 = {{ r0.v[0], r1.v[0], r2.v[0], r3.v[0] }};
+    Float4 t1 = {{ r0.v[1], r1.v[1], r2.v[1], r3.v[1] }};
+    Float4 t2 = {{ r0.v[2], r1.v[2], r2.v[2], r3.v[2] }};
+    Float4 t3 = {{ r0.v[3], r1.v[3], r2.v[3], r3.v[3] }};
+
+    r0 = t0;
+    r1 = t1;
+    r2 = t2;
+    r3 = t3;
+}
+
+#endif
+
+
+// a * b + c
+inline Float4 MulAdd4(Float4 a, Float4 b, Float4 c)
+{
+    return Add4(Mul4(a, b), c);
+}
+
+
+inline Float4 Lerp4(Float4 Start, Float4 End, Float4 Factor)
+{
+    return Add4(Start, Mul4(Factor, Sub4(End, Start)));
+}
+
+#endif
@@ -50,6 +50,11 @@ public:
 
     void LoadRaw(int Width, int Height, int BPP, const unsigned char* pImageData);
 
+    // ppLevels holds NumLevels images - the full size one followed by its mipmaps, each
+    // half the size of the previous one (rounded down, at least one texel). The rows are
+    // tightly packed. The driver does not generate any mipmaps.
+    void LoadRawMipmaps(int Width, int Height, int BPP, int NumLevels, const unsigned char* const* ppLevels);
+
     void LoadF32(int Width, int Height, const float* pImageData);
 
     // Must be called at least once for the specific texture unit
@@ -69,6 +74,7 @@ private:
     void LoadInternal(const void* pImageData);
     void LoadInternalNonDSA(const void* pImageData);
     void LoadInternalDSA(const void* pImageData);    
+    void GetRawFormat(GLenum& InternalFormat, GLenum& Format) const;
 
     void BindInternalNonDSA(GLenum TextureUnit);
     void BindInternalDSA(GLenum TextureUnit);
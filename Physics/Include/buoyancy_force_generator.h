@@ -24,8 +24,6 @@
 namespace OgldevPhysics
 {
 
-#define DEFAULT_WATER_DENSITY 1000.0f
-
 class BuoyancyForceGenerator : public ForceGenerator
 {
 public:
@@ -20,6 +20,7 @@
 
 #include <vector>
 
+#include "ogldev_types.h"
 #include "ogldev_math_3d.h"
 #include "particle.h"
 
@@ -60,24 +61,64 @@ private:
 };
 
 
+//
+// Splits the contacts into islands - groups of contacts that are connected through
+// the particles they move. Particles with an infinite mass do not connect contacts.
+// Every island is solved with Gauss-Seidel sweeps until none of its contacts is
+// closing or interpenetrating or until the iterations run out. Different islands
+// are solved in parallel. The contacts of a large island are colored so that the
+// contacts of a single color don't share a particle and every color is solved in parallel.
+//
 class ParticleContactResolver {
 
 public:
 
     ParticleContactResolver() {}
 
-    void Init(int Iterations) { SetIterations(Iterations); }
+    // NumThreads zero means one thread per core
+    void Init(int Iterations, int NumThreads = 0) { SetIterations(Iterations); m_numThreads = NumThreads; }
 
+    // The number of contact resolutions. Every sweep over an island resolves each of its
+    // contacts at most once so an island gets up to Iterations / NumContacts sweeps.
     void SetIterations(int Iterations) { m_iterations = Iterations; }
 
     void ResolveContacts(std::vector<ParticleContact>& ContactArray, uint NumContacts, float dt);
 
+    int GetIterationsUsed() const { return m_iterationsUsed; }
+
+    uint GetNumIslands() const { return m_islandStart.empty() ? 0 : (uint)m_islandStart.size() - 1; }
+
 protected:
 
-    int FindContactWithLargestClosingVelocity(std::vector<ParticleContact>& ContactArray, uint NumContacts);
+    void BuildIslands(std::vector<ParticleContact>& ContactArray, uint NumContacts);
+
+    void ColorIsland(uint Island);
+
+    int SolveIsland(std::vector<ParticleContact>& ContactArray, uint Island, int NumSweeps, float dt);
+
+    int SolveColoredIsland(std::vector<ParticleContact>& ContactArray, uint Island, int NumSweeps, float dt);
+
+    bool ResolveContact(ParticleContact& Contact, uint ContactIndex, float dt);
+
+    float GetCurrentPenetration(const ParticleContact& Contact, uint ContactIndex) const;
+
+    uint FindIsland(uint Body);
 
     int m_iterations = 0;
     int m_iterationsUsed = 0;
+    int m_numThreads = 0;
+
+    // Rebuilt by every ResolveContacts. A body is a particle with a finite mass.
+    std::vector<std::pair<Particle*, uint>> m_particleRefs;    // particle and contact end (contact * 2 + end)
+    std::vector<int> m_contactBodies;           // two per contact, -1 for no particle or an infinite mass
+    std::vector<Vector3f> m_startPositions;     // two per contact, where the particles were when the penetration was set
+    std::vector<uint> m_bodyParent;             // union find
+    std::vector<int> m_bodyIsland;
+    std::vector<uint> m_islandContacts;         // contact indices grouped by island
+    std::vector<uint> m_islandStart;            // per island, plus one at the end
+    std::vector<u64> m_bodyColors;              // the colors used by the contacts of every body
+    std::vector<uint> m_batchContacts;          // the contacts of a colored island grouped by color
+    std::vector<uint> m_batchStart;
 };
 
 
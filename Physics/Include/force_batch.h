@@ -0,0 +1,176 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "ogldev_types.h"
+
+namespace OgldevPhysics
+{
+
+#define INVALID_FORCE_ID 0xffffffff
+
+//
+// Storage for all the forces of a single type. Every force has NumIndices particle
+// indices and NumFloats parameters and each of them has its own array so that the
+// kernel of the type streams through them. A force is referred to by an id that stays
+// the same while other forces come and go. Remove moves the last force into the hole
+// so the arrays never have gaps and both Add and Remove are O(1).
+// Removed ids are reused, so every id also has a generation which is bumped when its
+// force goes away. An id/generation pair from before the removal is stale and is
+// rejected instead of reaching the force that reused the id.
+//
+template<int NumIndices, int NumFloats>
+class ForceBatch {
+
+public:
+
+    ForceBatch() {}
+
+    uint Add(const uint* pIndices, const float* pFloats)
+    {
+        uint Id = 0;
+
+        if (m_freeIds.empty()) {
+            Id = (uint)m_idToSlot.size();
+            m_idToSlot.push_back(0);
+            m_generations.push_back(0);
+        } else {
+            Id = m_freeIds.back();
+            m_freeIds.pop_back();
+        }
+
+        m_idToSlot[Id] = GetCount();
+        m_slotToId.push_back(Id);
+
+        for (int i = 0 ; i < NumIndices ; i++) {
+            m_indices[i].push_back(pIndices[i]);
+        }
+
+        for (int i = 0 ; i < NumFloats ; i++) {
+            m_floats[i].push_back(pFloats[i]);
+        }
+
+        return Id;
+    }
+
+    // Returns false and does nothing when the id/generation pair is stale
+    bool Remove(uint Id, uint Generation)
+    {
+        if (!IsValid(Id, Generation)) {
+            return false;
+        }
+
+        uint Slot = m_idToSlot[Id];
+        uint Last = GetCount() - 1;
+
+        if (Slot != Last) {
+            for (int i = 0 ; i < NumIndices ; i++) {
+                m_indices[i][Slot] = m_indices[i][Last];
+            }
+
+            for (int i = 0 ; i < NumFloats ; i++) {
+                m_floats[i][Slot] = m_floats[i][Last];
+            }
+
+            m_slotToId[Slot] = m_slotToId[Last];
+            m_idToSlot[m_slotToId[Slot]] = Slot;
+        }
+
+        for (int i = 0 ; i < NumIndices ; i++) {
+            m_indices[i].pop_back();
+        }
+
+        for (int i = 0 ; i < NumFloats ; i++) {
+            m_floats[i].pop_back();
+        }
+
+        m_slotToId.pop_back();
+
+        m_idToSlot[Id] = INVALID_FORCE_ID;
+        m_generations[Id]++;
+        m_freeIds.push_back(Id);
+
+        return true;
+    }
+
+    void Clear()
+    {
+        for (int i = 0 ; i < NumIndices ; i++) {
+            m_indices[i].clear();
+        }
+
+        for (int i = 0 ; i < NumFloats ; i++) {
+            m_floats[i].clear();
+        }
+
+        m_slotToId.clear();
+
+        // The ids and their generations are kept so the handles from before the
+        // call stay stale
+        m_freeIds.clear();
+
+        for (uint Id = 0 ; Id < (uint)m_idToSlot.size() ; Id++) {
+            if (m_idToSlot[Id] != INVALID_FORCE_ID) {
+                m_idToSlot[Id] = INVALID_FORCE_ID;
+                m_generations[Id]++;
+            }
+
+            m_freeIds.push_back(Id);
+        }
+    }
+
+    bool IsValid(uint Id, uint Generation) const
+    {
+        return (Id < m_idToSlot.size()) && (m_idToSlot[Id] != INVALID_FORCE_ID) && (m_generations[Id] == Generation);
+    }
+
+    uint GetGeneration(uint Id) const { return m_generations[Id]; }
+
+    // Returns false and does nothing when the id/generation pair is stale
+    bool SetFloat(uint Id, uint Generation, int Field, float Value)
+    {
+        if (!IsValid(Id, Generation)) {
+            return false;
+        }
+
+        m_floats[Field][m_idToSlot[Id]] = Value;
+
+        return true;
+    }
+
+    uint GetCount() const { return (uint)m_slotToId.size(); }
+
+    const uint* GetIndices(int Field) const { return m_indices[Field].data(); }
+
+    const float* GetFloats(int Field) const { return m_floats[Field].data(); }
+
+private:
+
+    std::vector<uint> m_indices[NumIndices];
+    std::vector<float> m_floats[NumFloats];
+    std::vector<uint> m_slotToId;
+    std::vector<uint> m_idToSlot;       // INVALID_FORCE_ID for removed forces
+    std::vector<uint> m_generations;    // per id, bumped on every removal
+    std::vector<uint> m_freeIds;
+};
+
+}
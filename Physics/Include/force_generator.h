@@ -21,9 +21,16 @@
 
 #include <vector>
 
+#include "ogldev_types.h"
+#include "ogldev_math_3d.h"
+#include "force_batch.h"
+
 namespace OgldevPhysics
 {
 class Particle;
+class ParticleStore;
+
+#define DEFAULT_WATER_DENSITY 1000.0f
 
 class ForceGenerator {
 public:
@@ -31,19 +38,81 @@ public:
 };
 
 
+enum FORCE_TYPE {
+    FORCE_TYPE_GRAVITY,
+    FORCE_TYPE_DRAG,
+    FORCE_TYPE_SPRING,
+    FORCE_TYPE_ANCHORED_SPRING,
+    FORCE_TYPE_BUNGEE_SPRING,
+    FORCE_TYPE_BUOYANCY,
+    FORCE_TYPE_NUM
+};
+
+
+struct ForceHandle {
+    FORCE_TYPE Type = FORCE_TYPE_NUM;
+    uint Id = INVALID_FORCE_ID;
+    uint Generation = 0;    // the handle is stale once the force it refers to is removed
+};
+
+
+//
+// Generic force generators are called once per particle through a virtual function.
+// The built in forces are stored by type instead. The parameters of every type are
+// kept in contiguous arrays and Update() runs a single loop per type that reads and
+// writes the arrays of the ParticleStore directly. Their math is the same as the math
+// of the generator with the same name. Forces on particles with an infinite mass are
+// skipped since the integrator ignores them anyway.
+//
 class ForceRegistry {
 public:
 
+    // The particles of the batched forces must belong to this store
+    void Init(ParticleStore* pStore) { m_pStore = pStore; }
+
     void Add(Particle* pParticle, ForceGenerator* pForceGenerator);
 
+    // Linear in the number of generic generators
     void Remove(Particle* pParticle, ForceGenerator* pForceGenerator);
 
+    ForceHandle AddGravity(Particle* pParticle, const Vector3f& Gravity);
+
+    ForceHandle AddDrag(Particle* pParticle, float k1, float k2);
+
+    ForceHandle AddSpring(Particle* pParticle, Particle* pOtherEnd, float SpringConstant, float RestLength);
+
+    ForceHandle AddAnchoredSpring(Particle* pParticle, const Vector3f& Anchor, float SpringConstant, float RestLength);
+
+    // Returns false when the handle is stale
+    bool SetAnchor(ForceHandle Handle, const Vector3f& Anchor);
+
+    ForceHandle AddBungeeSpring(Particle* pParticle, Particle* pOtherEnd, float SpringConstant, float RestLength);
+
+    ForceHandle AddBuoyancy(Particle* pParticle, float MaxDepth, float Volume, float WaterHeight, float LiquidDensity = DEFAULT_WATER_DENSITY);
+
+    // O(1). The handle is stale afterwards (and after Clear). Removing a stale handle
+    // returns false and does nothing, even when its id was reused by a new force.
+    bool Remove(ForceHandle Handle);
+
+    bool IsValid(ForceHandle Handle) const;
+
     void Clear();
 
     void Update(float dt);
 
+    uint GetNumForces() const;
+
 protected:
 
+    uint GetParticleIndex(const Particle* pParticle) const;
+
+    void UpdateGravity();
+    void UpdateDrag();
+    void UpdateSprings();
+    void UpdateAnchoredSprings();
+    void UpdateBungeeSprings();
+    void UpdateBuoyancy();
+
     struct ForceEntry {
         ForceEntry(Particle* pParticleIn, ForceGenerator* pForceGeneratorIn)
         {
@@ -57,6 +126,15 @@ protected:
 
     typedef std::vector<ForceEntry> Registry;
     Registry m_forceRegistry;
+
+    ParticleStore* m_pStore = NULL;
+
+    ForceBatch<1, 3> m_gravity;             // gravity x/y/z
+    ForceBatch<1, 2> m_drag;                // k1, k2
+    ForceBatch<2, 2> m_springs;             // particle, other end : spring constant, rest length
+    ForceBatch<1, 5> m_anchoredSprings;     // anchor x/y/z, spring constant, rest length
+    ForceBatch<2, 2> m_bungeeSprings;       // particle, other end : spring constant, rest length
+    ForceBatch<1, 4> m_buoyancy;            // max depth, volume, water height, liquid density
 };
 
 }
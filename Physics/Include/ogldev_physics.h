@@ -23,6 +23,7 @@
 #include <vector>
 
 #include "ogldev_types.h"
+#include "particle_store.h"
 #include "particle.h"
 #include "firework.h"
 #include "gravity_force_generator.h"
@@ -33,12 +34,15 @@
 #include "buoyancy_force_generator.h"
 #include "fake_spring_force_generator.h"
 #include "contact_resolver.h"
+#include "spatial_hash_contacts.h"
 
 namespace OgldevPhysics
 {
 
 const static Vector3f GRAVITY = Vector3f(0.0f, -9.81f, 0.0f);
 
+#define DEFAULT_MAX_SUB_STEPS 8
+
 class PhysicsSystem {
 
 public:
@@ -54,8 +58,29 @@ public:
 
     void Update(long long DeltaTimeMillis);
 
+    // Switches Update() to fixed steps of 1 / StepRate seconds. The frame time is accumulated
+    // and Update() runs as many steps as fit into it but no more than MaxSubSteps. The time
+    // beyond that is dropped so that a long frame doesn't lead to even longer frames.
+    // StepRate zero goes back to a single step of the frame time per Update().
+    void SetFixedTimeStep(float StepRate, uint MaxSubSteps = DEFAULT_MAX_SUB_STEPS);
+
+    // Where the time of the last Update() falls between the previous step (zero) and the
+    // last step (one). Always one without a fixed time step.
+    float GetInterpolationAlpha() const { return m_interpolationAlpha; }
+
+    // The position to draw the particle at
+    Vector3f GetInterpolatedPosition(const Particle* pParticle) const { return pParticle->GetInterpolatedPosition(m_interpolationAlpha); }
+
+    // The number of steps that the last Update() ran
+    uint GetNumSubSteps() const { return m_numSubSteps; }
+
     ForceRegistry& GetRegistry() { return m_forceRegistry; }    
 
+    const ParticleStore& GetParticleStore() const { return m_particleStore; }
+
+    // Handle i refers to particle i of the store
+    Particle* GetParticles() { return m_particles.data(); }
+
     void RunPhysics(float dt);
 
     void StartFrame();
@@ -66,6 +91,8 @@ private:
 
     void InitFireworksConfig();
 
+    void Step(float dt);
+
     void Create(int Type, uint Count, Firework* pFirework);
 
     void ParticleUpdate(float dt);
@@ -73,7 +100,9 @@ private:
 
     uint GenerateContacts();
 
-    std::vector<Particle> m_particles;
+    ParticleStore m_particleStore;
+    ParticleStore m_fireworkStore;      // fireworks are integrated one at a time by Firework::Update
+    std::vector<Particle> m_particles;  // handles into m_particleStore
     std::vector<Firework> m_fireworks;
     std::vector<FireworkConfig> m_fireworkConfigs;
     std::vector<ParticleContactGenerator*> m_contactGenerators;
@@ -87,6 +116,13 @@ private:
     uint m_nextFirework = 0; 
     uint m_numContactGenerators = 0;
     bool m_calcIters = false;   
+
+    float m_fixedTimeStep = 0.0f;   // zero for a variable step
+    uint m_maxSubSteps = DEFAULT_MAX_SUB_STEPS;
+    float m_accumulator = 0.0f;
+    float m_interpolationAlpha = 1.0f;
+    uint m_numSubSteps = 0;
+    uint m_numFixedSteps = 0;
 };
 
 }
\ No newline at end of file
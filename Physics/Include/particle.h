@@ -22,55 +22,58 @@
 #include <assert.h>
 
 #include "ogldev_math_3d.h"
+#include "particle_store.h"
 
 namespace OgldevPhysics
 {
 
+//
+// A handle to a particle in a ParticleStore. Keeps the per particle interface for
+// the force generators and the contact code while the data itself lives in the
+// arrays of the store.
+//
 class Particle {
 
 public:
 
-    const Vector3f& GetPosition() const { return m_position; }
-    void SetPosition(const Vector3f& Position) { m_position = Position; }    
-    void SetPosition(float x, float y, float z) { m_position.x = x; m_position.y = y; m_position.z = z; }
+    void Init(ParticleStore* pStore, uint Index) { m_pStore = pStore; m_index = Index; }
+
+    ParticleStore* GetStore() const { return m_pStore; }
+    uint GetIndex() const { return m_index; }
+
+    Vector3f GetPosition() const { return m_pStore->GetPosition(m_index); }
+    void SetPosition(const Vector3f& Position) { m_pStore->SetPosition(m_index, Position); }
+    void SetPosition(float x, float y, float z) { m_pStore->SetPosition(m_index, Vector3f(x, y, z)); }
+
+    Vector3f GetInterpolatedPosition(float Alpha) const { return m_pStore->GetInterpolatedPosition(m_index, Alpha); }
 
     float GetMass() const;
     void SetMass(float Mass);
 
-    float GetReciprocalMass() const { return m_reciprocalMass; }
-    void SetReciprocalMass(float ReciprocalMass) { m_reciprocalMass = ReciprocalMass; }
+    float GetReciprocalMass() const { return m_pStore->GetReciprocalMass(m_index); }
+    void SetReciprocalMass(float ReciprocalMass) { m_pStore->SetReciprocalMass(m_index, ReciprocalMass); }
 
-    const Vector3f& GetVelocity() const { return m_velocity; }
-    void SetVelocity(const Vector3f& Velocity) 
-    { 
-        m_velocity = Velocity; 
-      //  printf("velocity y %f\n", Velocity.y);
-    }
+    Vector3f GetVelocity() const { return m_pStore->GetVelocity(m_index); }
+    void SetVelocity(const Vector3f& Velocity) { m_pStore->SetVelocity(m_index, Velocity); }
 
-    const Vector3f& GetAcceleration() const { return m_acceleration; }
-    void SetAcceleration(const Vector3f& Acceleration) { m_acceleration = Acceleration; }
+    Vector3f GetAcceleration() const { return m_pStore->GetAcceleration(m_index); }
+    void SetAcceleration(const Vector3f& Acceleration) { m_pStore->SetAcceleration(m_index, Acceleration); }
 
-    void SetDamping(float Damping) { m_damping = Damping; }
+    void SetDamping(float Damping) { m_pStore->SetDamping(m_index, Damping); }
 
-    void Integrate(float dt);
+    void Integrate(float dt) { m_pStore->IntegrateParticle(m_index, dt); }
 
-    void AddForce(const Vector3f& Force) { m_forceAccum += Force; }
+    void AddForce(const Vector3f& Force) { m_pStore->AddForce(m_index, Force); }
 
-    bool HasFiniteMass() const { return (m_reciprocalMass >= 0.0f); }
+    bool HasFiniteMass() const { return (GetReciprocalMass() >= 0.0f); }
 
-    void ClearAccum();
+    void ClearAccum() { m_pStore->ClearForce(m_index); }
 
 protected:    
 
-    Vector3f m_position = Vector3f(0.0f, 0.0f, 0.0f);
-    Vector3f m_velocity = Vector3f(0.0f, 0.0f, 0.0f);
-    Vector3f m_acceleration = Vector3f(0.0f, 0.0f, 0.0f);
-
-    Vector3f m_forceAccum = Vector3f(0.0f, 0.0f, 0.0f);
-
-    float m_damping = 0.999f;
-    float m_reciprocalMass = 0.0f;
+    ParticleStore* m_pStore = NULL;
+    uint m_index = 0;
 };
 
 
-}
\ No newline at end of file
+}
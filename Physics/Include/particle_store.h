@@ -0,0 +1,144 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "ogldev_types.h"
+#include "ogldev_math_3d.h"
+
+namespace OgldevPhysics
+{
+
+// The batch integrator processes this many particles at a time. The arrays are
+// padded to a multiple of it so there is never a scalar tail.
+#define PARTICLE_STORE_WIDTH 8
+
+#define MAX_DAMPING_CLASSES 255
+
+#define DEFAULT_PARTICLE_DAMPING 0.999f
+
+//
+// Structure of arrays storage of particles. Every component has its own array so
+// Integrate() streams through memory and handles 8 particles per instruction with
+// AVX2 (4 with the SSE/NEON backend of ogldev_simd.h).
+//
+// Particles with the same damping share a damping class. The damping power only
+// depends on the class and on dt so it is calculated once per class per step
+// instead of once per particle.
+//
+class ParticleStore {
+
+public:
+    ParticleStore() {}
+
+    ~ParticleStore() {}
+
+    void Init(uint MaxParticles);
+
+    uint AllocParticle();
+
+    uint GetNumParticles() const { return m_numParticles; }
+
+    uint GetMaxParticles() const { return m_maxParticles; }
+
+    Vector3f GetPosition(uint i) const { return Vector3f(m_posX[i], m_posY[i], m_posZ[i]); }
+    void SetPosition(uint i, const Vector3f& Pos) { m_posX[i] = Pos.x; m_posY[i] = Pos.y; m_posZ[i] = Pos.z; }
+
+    Vector3f GetVelocity(uint i) const { return Vector3f(m_velX[i], m_velY[i], m_velZ[i]); }
+    void SetVelocity(uint i, const Vector3f& Vel) { m_velX[i] = Vel.x; m_velY[i] = Vel.y; m_velZ[i] = Vel.z; }
+
+    Vector3f GetAcceleration(uint i) const { return Vector3f(m_accX[i], m_accY[i], m_accZ[i]); }
+    void SetAcceleration(uint i, const Vector3f& Acc) { m_accX[i] = Acc.x; m_accY[i] = Acc.y; m_accZ[i] = Acc.z; }
+
+    void AddForce(uint i, const Vector3f& Force) { m_forceX[i] += Force.x; m_forceY[i] += Force.y; m_forceZ[i] += Force.z; }
+    void ClearForce(uint i) { m_forceX[i] = 0.0f; m_forceY[i] = 0.0f; m_forceZ[i] = 0.0f; }
+
+    float GetReciprocalMass(uint i) const { return m_reciprocalMass[i]; }
+    void SetReciprocalMass(uint i, float ReciprocalMass);
+
+    void SetDamping(uint i, float Damping);
+
+    void ClearForces();
+
+    // All the particles, vectorized
+    void Integrate(float dt);
+
+    // Copies the current positions over the previous ones. Called before every fixed step
+    // so that the particles can be drawn in between the last two steps.
+    void SavePositions();
+
+    Vector3f GetPreviousPosition(uint i) const { return Vector3f(m_prevPosX[i], m_prevPosY[i], m_prevPosZ[i]); }
+
+    // Alpha zero is the previous position and one is the current position
+    Vector3f GetInterpolatedPosition(uint i, float Alpha) const
+    {
+        return Vector3f(m_prevPosX[i] + (m_posX[i] - m_prevPosX[i]) * Alpha,
+                        m_prevPosY[i] + (m_posY[i] - m_prevPosY[i]) * Alpha,
+                        m_prevPosZ[i] + (m_posZ[i] - m_prevPosZ[i]) * Alpha);
+    }
+
+    // A single particle, same math as Integrate()
+    void IntegrateParticle(uint i, float dt);
+
+    // For systems that work on the arrays directly
+    const float* GetPositionsX() const { return m_posX.data(); }
+    const float* GetPositionsY() const { return m_posY.data(); }
+    const float* GetPositionsZ() const { return m_posZ.data(); }
+    const float* GetVelocitiesX() const { return m_velX.data(); }
+    const float* GetVelocitiesY() const { return m_velY.data(); }
+    const float* GetVelocitiesZ() const { return m_velZ.data(); }
+    const float* GetReciprocalMasses() const { return m_reciprocalMass.data(); }
+    float* GetForcesX() { return m_forceX.data(); }
+    float* GetForcesY() { return m_forceY.data(); }
+    float* GetForcesZ() { return m_forceZ.data(); }
+
+private:
+
+    uint GetDampingClass(float Damping);
+
+    void UpdateDampingFactors(float dt);
+
+    void IntegrateBatch(float dt);
+
+    uint m_maxParticles = 0;
+    uint m_numParticles = 0;
+
+    std::vector<float> m_posX, m_posY, m_posZ;
+    std::vector<float> m_prevPosX, m_prevPosY, m_prevPosZ;
+    std::vector<float> m_velX, m_velY, m_velZ;
+    std::vector<float> m_accX, m_accY, m_accZ;
+    std::vector<float> m_forceX, m_forceY, m_forceZ;
+    std::vector<float> m_reciprocalMass;
+
+    // 1 for particles with a finite mass, 0 for the ones that Integrate must not move
+    std::vector<float> m_active;
+
+    std::vector<int> m_dampingClass;
+
+    // Index into m_dampingFactors - the damping class plus one for active particles and zero
+    // (a factor of one) for the rest
+    std::vector<int> m_dampingSlot;
+
+    std::vector<float> m_dampingValues;
+    std::vector<float> m_dampingFactors;
+};
+
+}
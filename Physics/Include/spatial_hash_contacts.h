@@ -0,0 +1,85 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "ogldev_types.h"
+#include "ogldev_math_3d.h"
+#include "particle_store.h"
+#include "contact_resolver.h"
+
+namespace OgldevPhysics
+{
+
+//
+// Broad and narrow phase for collisions between all the particles of a store.
+// Every particle is a sphere of the same radius. The particles are bucketed into
+// a uniform grid with a cell size of two diameters so only 8 cells can contain
+// particles that touch a particle. The grid is hashed into a table that is rebuilt
+// from scratch on every call with a counting sort.
+//
+class SpatialHashContacts : public ParticleContactGenerator
+{
+public:
+    SpatialHashContacts() {}
+
+    // pParticles[i] must be the handle of particle i of the store. NumThreads zero
+    // means one thread per core.
+    void Init(const ParticleStore* pStore, Particle* pParticles, float Radius, float Restitution, int NumThreads = 0);
+
+    virtual int AddContact(std::vector<ParticleContact>& Contacts, int StartIndex) const;
+
+    // Number of overlapping pairs found by the last AddContact, including the ones
+    // that did not fit into the contact array
+    uint GetNumPairs() const { return m_numPairs; }
+
+private:
+
+    struct ContactPair {
+        uint Particles[2];
+        Vector3f Normal;
+        float Penetration;
+    };
+
+    void BuildGrid() const;
+
+    void FindPairs(uint First, uint Last, std::vector<ContactPair>& Pairs) const;
+
+    uint GetCellHash(int x, int y, int z) const;
+
+    const ParticleStore* m_pStore = NULL;
+    Particle* m_pParticles = NULL;
+    float m_radius = 0.0f;
+    float m_restitution = 0.0f;
+    float m_invCellSize = 0.0f;
+    int m_numThreads = 0;
+
+    // Rebuilt by every AddContact
+    mutable uint m_tableMask = 0;
+    mutable std::vector<uint> m_cellHash;       // per particle
+    mutable std::vector<uint> m_cellStart;      // per hash table entry, plus one at the end
+    mutable std::vector<uint> m_sorted;         // particle indices sorted by cell hash
+    mutable std::vector<float> m_sortedX, m_sortedY, m_sortedZ;
+    mutable std::vector<std::vector<ContactPair>> m_bandPairs;
+    mutable uint m_numPairs = 0;
+};
+
+}
@@ -19,12 +19,26 @@
 
 #include <assert.h>
 #include <algorithm>
+#include <atomic>
+#include <functional>
 
+#include "ogldev_parallel_for.h"
 #include "contact_resolver.h"
 
 namespace OgldevPhysics
 {
 
+// Below this number of contacts everything is solved on the calling thread
+#define MIN_PARALLEL_CONTACTS 1024
+
+// Islands with at least this number of contacts are colored and every color is solved in parallel
+#define MIN_COLORED_ISLAND_CONTACTS 256
+
+#define MAX_CONTACT_COLORS 64
+
+// Contacts that are closing or interpenetrating by less than this are considered resolved
+#define CONTACT_EPSILON 1e-6f
+
 void ParticleContact::Resolve(float dt)
 {
     ResolveVelocity(dt);
@@ -62,11 +76,15 @@ void ParticleContact::ResolveInterpenetration(float dt)
                 m_particleMovement[1].SetAll(0.0f);
             }
 
-            Vector3f NewPos = m_pParticles[0]->GetPosition() + m_particleMovement[0];
-            m_pParticles[0]->SetPosition(NewPos);
+            // Particles with an infinite mass are not written. They can be shared by contacts
+            // that are resolved on different threads.
+            if (m_pParticles[0]->GetReciprocalMass() > 0.0f) {
+                Vector3f NewPos = m_pParticles[0]->GetPosition() + m_particleMovement[0];
+                m_pParticles[0]->SetPosition(NewPos);
+            }
 
-            if (m_pParticles[1]) {
-                NewPos = m_pParticles[1]->GetPosition() + m_particleMovement[1];
+            if (m_pParticles[1] && (m_pParticles[1]->GetReciprocalMass() > 0.0f)) {
+                Vector3f NewPos = m_pParticles[1]->GetPosition() + m_particleMovement[1];
                 m_pParticles[1]->SetPosition(NewPos);
             }
         }
@@ -98,13 +116,14 @@ void ParticleContact::ResolveVelocity(float dt)
 
             Vector3f ImpulsePerMass = m_contactNormal * Impluse;
 
-            Vector3f NewVelocity = m_pParticles[0]->GetVelocity() + ImpulsePerMass * m_pParticles[0]->GetReciprocalMass();
-
-            m_pParticles[0]->SetVelocity(NewVelocity);
-
-            if (m_pParticles[1]) {
-                NewVelocity = m_pParticles[1]->GetVelocity() + ImpulsePerMass * -m_pParticles[1]->GetReciprocalMass();
+            // See ResolveInterpenetration
+            if (m_pParticles[0]->GetReciprocalMass() > 0.0f) {
+                Vector3f NewVelocity = m_pParticles[0]->GetVelocity() + ImpulsePerMass * m_pParticles[0]->GetReciprocalMass();
+                m_pParticles[0]->SetVelocity(NewVelocity);
+            }
 
+            if (m_pParticles[1] && (m_pParticles[1]->GetReciprocalMass() > 0.0f)) {
+                Vector3f NewVelocity = m_pParticles[1]->GetVelocity() + ImpulsePerMass * -m_pParticles[1]->GetReciprocalMass();
                 m_pParticles[1]->SetVelocity(NewVelocity);
             }
         }
@@ -139,59 +158,334 @@ float ParticleContact::CalcTotalReciprocalMass()
 
 
 void ParticleContactResolver::ResolveContacts(std::vector<ParticleContact>& ContactArray, uint NumContacts, float dt)
+{
+    m_iterationsUsed = 0;
+
+    if ((NumContacts == 0) || (m_iterations <= 0)) {
+        return;
+    }
+
+    BuildIslands(ContactArray, NumContacts);
+
+    int NumSweeps = (m_iterations + (int)NumContacts - 1) / (int)NumContacts;
+
+    uint NumIslands = GetNumIslands();
+
+    // Starting threads costs more than solving a few contacts
+    if (NumContacts < MIN_PARALLEL_CONTACTS) {
+        for (uint Island = 0 ; Island < NumIslands ; Island++) {
+            m_iterationsUsed += SolveIsland(ContactArray, Island, NumSweeps, dt);
+        }
+
+        return;
+    }
+
+    std::vector<uint> SmallIslands;
+
+    for (uint Island = 0 ; Island < NumIslands ; Island++) {
+        uint Count = m_islandStart[Island + 1] - m_islandStart[Island];
+
+        if (Count >= MIN_COLORED_ISLAND_CONTACTS) {
+            m_iterationsUsed += SolveColoredIsland(ContactArray, Island, NumSweeps, dt);
+        } else {
+            SmallIslands.push_back(Island);
+        }
+    }
+
+    std::atomic<int> IterationsUsed(0);
+
+    ParallelFor((int)SmallIslands.size(), [&](int Begin, int End) {
+        int Count = 0;
+
+        for (int i = Begin ; i < End ; i++) {
+            Count += SolveIsland(ContactArray, SmallIslands[i], NumSweeps, dt);
+        }
+
+        IterationsUsed += Count;
+    }, m_numThreads);
+
+    m_iterationsUsed += IterationsUsed;
+}
+
+
+uint ParticleContactResolver::FindIsland(uint Body)
+{
+    while (m_bodyParent[Body] != Body) {
+        m_bodyParent[Body] = m_bodyParent[m_bodyParent[Body]];
+        Body = m_bodyParent[Body];
+    }
+
+    return Body;
+}
+
+
+void ParticleContactResolver::BuildIslands(std::vector<ParticleContact>& ContactArray, uint NumContacts)
+{
+    // Find the particles that can be moved and give each one a body index
+    m_particleRefs.clear();
+    m_particleRefs.reserve(NumContacts * 2);
+    m_contactBodies.assign(NumContacts * 2, -1);
+    m_startPositions.resize(NumContacts * 2);
+
+    for (uint c = 0 ; c < NumContacts ; c++) {
+        for (int End = 0 ; End < 2 ; End++) {
+            Particle* pParticle = ContactArray[c].m_pParticles[End];
+
+            if (pParticle && (pParticle->GetReciprocalMass() > 0.0f)) {
+                m_particleRefs.push_back(std::make_pair(pParticle, c * 2 + End));
+                m_startPositions[c * 2 + End] = pParticle->GetPosition();
+            }
+        }
+    }
+
+    std::sort(m_particleRefs.begin(), m_particleRefs.end(),
+              [](const std::pair<Particle*, uint>& a, const std::pair<Particle*, uint>& b) {
+                  return std::less<Particle*>()(a.first, b.first);
+              });
+
+    int NumBodies = 0;
+
+    for (uint i = 0 ; i < m_particleRefs.size() ; i++) {
+        if ((i > 0) && (m_particleRefs[i].first != m_particleRefs[i - 1].first)) {
+            NumBodies++;
+        }
+
+        m_contactBodies[m_particleRefs[i].second] = NumBodies;
+    }
+
+    if (!m_particleRefs.empty()) {
+        NumBodies++;
+    }
+
+    // Join the bodies of every contact
+    m_bodyParent.resize(NumBodies);
+
+    for (int b = 0 ; b < NumBodies ; b++) {
+        m_bodyParent[b] = b;
+    }
+
+    for (uint c = 0 ; c < NumContacts ; c++) {
+        int Body0 = m_contactBodies[c * 2];
+        int Body1 = m_contactBodies[c * 2 + 1];
+
+        if ((Body0 >= 0) && (Body1 >= 0)) {
+            uint Root0 = FindIsland(Body0);
+            uint Root1 = FindIsland(Body1);
+
+            if (Root0 != Root1) {
+                m_bodyParent[Root0] = Root1;
+            }
+        }
+    }
+
+    // Counting sort of the contacts by island. Contacts that cannot move anything are dropped.
+    m_bodyIsland.assign(NumBodies, -1);
+    m_islandStart.assign(1, 0);
+
+    std::vector<int> ContactIsland(NumContacts, -1);
+
+    for (uint c = 0 ; c < NumContacts ; c++) {
+        int Body = (m_contactBodies[c * 2] >= 0) ? m_contactBodies[c * 2] : m_contactBodies[c * 2 + 1];
+
+        if (Body < 0) {
+            continue;
+        }
+
+        uint Root = FindIsland(Body);
+
+        if (m_bodyIsland[Root] < 0) {
+            m_bodyIsland[Root] = (int)m_islandStart.size() - 1;
+            m_islandStart.push_back(0);
+        }
+
+        ContactIsland[c] = m_bodyIsland[Root];
+        m_islandStart[ContactIsland[c] + 1]++;
+    }
+
+    for (uint i = 1 ; i < m_islandStart.size() ; i++) {
+        m_islandStart[i] += m_islandStart[i - 1];
+    }
+
+    m_islandContacts.resize(m_islandStart.back());
+
+    std::vector<uint> Next(m_islandStart.begin(), m_islandStart.end() - 1);
+
+    for (uint c = 0 ; c < NumContacts ; c++) {
+        if (ContactIsland[c] >= 0) {
+            m_islandContacts[Next[ContactIsland[c]]++] = c;
+        }
+    }
+}
+
+
+// Greedy coloring. Contacts that don't fit into MAX_CONTACT_COLORS go into an extra batch
+// that is solved by a single thread.
+void ParticleContactResolver::ColorIsland(uint Island)
+{
+    uint First = m_islandStart[Island];
+    uint Count = m_islandStart[Island + 1] - First;
+
+    m_bodyColors.assign(m_bodyParent.size(), 0);
+    m_batchStart.assign(MAX_CONTACT_COLORS + 2, 0);
+
+    std::vector<uint> ContactColor(Count);
+
+    for (uint i = 0 ; i < Count ; i++) {
+        uint c = m_islandContacts[First + i];
+        int Body0 = m_contactBodies[c * 2];
+        int Body1 = m_contactBodies[c * 2 + 1];
+
+        u64 Used = 0;
+
+        if (Body0 >= 0) {
+            Used |= m_bodyColors[Body0];
+        }
+
+        if (Body1 >= 0) {
+            Used |= m_bodyColors[Body1];
+        }
+
+        uint Color = 0;
+
+        while ((Color < MAX_CONTACT_COLORS) && (Used & (1ULL << Color))) {
+            Color++;
+        }
+
+        if (Color < MAX_CONTACT_COLORS) {
+            if (Body0 >= 0) {
+                m_bodyColors[Body0] |= 1ULL << Color;
+            }
+
+            if (Body1 >= 0) {
+                m_bodyColors[Body1] |= 1ULL << Color;
+            }
+        }
+
+        ContactColor[i] = Color;
+        m_batchStart[Color + 1]++;
+    }
+
+    for (uint b = 1 ; b < m_batchStart.size() ; b++) {
+        m_batchStart[b] += m_batchStart[b - 1];
+    }
+
+    m_batchContacts.resize(Count);
+
+    std::vector<uint> Next(m_batchStart.begin(), m_batchStart.end() - 1);
+
+    for (uint i = 0 ; i < Count ; i++) {
+        m_batchContacts[Next[ContactColor[i]]++] = m_islandContacts[First + i];
+    }
+}
+
+
+int ParticleContactResolver::SolveIsland(std::vector<ParticleContact>& ContactArray, uint Island, int NumSweeps, float dt)
 {
     int IterationsUsed = 0;
 
-    while (IterationsUsed < m_iterations) {
-        int Index = FindContactWithLargestClosingVelocity(ContactArray, NumContacts);
+    for (int Sweep = 0 ; Sweep < NumSweeps ; Sweep++) {
+        int Resolved = 0;
+
+        for (uint i = m_islandStart[Island] ; i < m_islandStart[Island + 1] ; i++) {
+            uint c = m_islandContacts[i];
 
-        if (Index == NumContacts) {
+            if (ResolveContact(ContactArray[c], c, dt)) {
+                Resolved++;
+            }
+        }
+
+        IterationsUsed += Resolved;
+
+        if (Resolved == 0) {
             break;
         }
+    }
+
+    return IterationsUsed;
+}
 
-        ContactArray[Index].Resolve(dt);
 
-        // Update the interpenetrations for all particles
-        Vector3f* Move = &(ContactArray[Index].m_particleMovement[0]);
+int ParticleContactResolver::SolveColoredIsland(std::vector<ParticleContact>& ContactArray, uint Island, int NumSweeps, float dt)
+{
+    ColorIsland(Island);
 
-        for (uint i = 0; i < NumContacts; i++) {
-            if (ContactArray[i].m_pParticles[0] == ContactArray[Index].m_pParticles[0]) {
-                ContactArray[i].m_penetration -= Move[0].Dot(ContactArray[i].m_contactNormal);
-            } else if (ContactArray[i].m_pParticles[0] == ContactArray[Index].m_pParticles[1]) {
-                ContactArray[i].m_penetration -= Move[1].Dot( ContactArray[i].m_contactNormal);
-            }
+    int IterationsUsed = 0;
+
+    for (int Sweep = 0 ; Sweep < NumSweeps ; Sweep++) {
+        std::atomic<int> Resolved(0);
+
+        for (uint Color = 0 ; Color <= MAX_CONTACT_COLORS ; Color++) {
+            uint First = m_batchStart[Color];
+            uint Count = m_batchStart[Color + 1] - First;
+
+            // The overflow batch may have contacts that share a particle
+            int NumThreads = (Color < MAX_CONTACT_COLORS) ? m_numThreads : 1;
+
+            ParallelFor((int)Count, [&](int Begin, int End) {
+                int BandResolved = 0;
+
+                for (int i = Begin ; i < End ; i++) {
+                    uint c = m_batchContacts[First + i];
 
-            if (ContactArray[i].m_pParticles[1]) {
-                if (ContactArray[i].m_pParticles[1] == ContactArray[Index].m_pParticles[0]) {
-                    ContactArray[i].m_penetration += Move[0].Dot(ContactArray[i].m_contactNormal);
-                } else if (ContactArray[i].m_pParticles[1] == ContactArray[Index].m_pParticles[1]) {
-                    ContactArray[i].m_penetration += Move[1].Dot(ContactArray[i].m_contactNormal);
+                    if (ResolveContact(ContactArray[c], c, dt)) {
+                        BandResolved++;
+                    }
                 }
-            }
+
+                Resolved += BandResolved;
+            }, NumThreads);
         }
 
-        IterationsUsed++;
+        IterationsUsed += Resolved;
+
+        if (Resolved == 0) {
+            break;
+        }
     }
+
+    return IterationsUsed;
 }
 
 
-int ParticleContactResolver::FindContactWithLargestClosingVelocity(std::vector<ParticleContact>& ContactArray, uint NumContacts)
+// The penetration is updated by the movement of the particles since it was last set
+float ParticleContactResolver::GetCurrentPenetration(const ParticleContact& Contact, uint ContactIndex) const
 {
-    float MaxSepVelocity = FLT_MAX;
-    uint MaxIndex = NumContacts;
+    float Penetration = Contact.m_penetration;
 
-    assert(NumContacts <= MaxIndex);
+    if (m_contactBodies[ContactIndex * 2] >= 0) {
+        Vector3f Move = Contact.m_pParticles[0]->GetPosition() - m_startPositions[ContactIndex * 2];
+        Penetration -= Move.Dot(Contact.m_contactNormal);
+    }
 
-    for (uint i = 0; i < NumContacts; i++) {
-        float SepVelocity = ContactArray[i].CalcSeparatingVelocity();
+    if (m_contactBodies[ContactIndex * 2 + 1] >= 0) {
+        Vector3f Move = Contact.m_pParticles[1]->GetPosition() - m_startPositions[ContactIndex * 2 + 1];
+        Penetration += Move.Dot(Contact.m_contactNormal);
+    }
 
-        if ((SepVelocity < MaxSepVelocity) && ((SepVelocity < 0.0f) || (ContactArray[i].GetPenetration() > 0.0f))) {
-            MaxSepVelocity = SepVelocity;
-            MaxIndex = i;
+    return Penetration;
+}
+
+
+bool ParticleContactResolver::ResolveContact(ParticleContact& Contact, uint ContactIndex, float dt)
+{
+    float SepVelocity = Contact.CalcSeparatingVelocity();
+    float Penetration = GetCurrentPenetration(Contact, ContactIndex);
+
+    if ((SepVelocity >= -CONTACT_EPSILON) && (Penetration <= CONTACT_EPSILON)) {
+        return false;
+    }
+
+    Contact.SetPenetration(Penetration);
+
+    for (int End = 0 ; End < 2 ; End++) {
+        if (m_contactBodies[ContactIndex * 2 + End] >= 0) {
+            m_startPositions[ContactIndex * 2 + End] = Contact.m_pParticles[End]->GetPosition();
         }
     }
 
-    return MaxIndex;
+    Contact.Resolve(dt);
+
+    return true;
 }
 
 
@@ -31,7 +31,7 @@ bool Firework::Update(float dt)
 
    // printf("age %f\n", m_age);
 
-    bool ret = ((m_age < 0.0f) || (m_position.y < 0));
+    bool ret = ((m_age < 0.0f) || (GetPosition().y < 0));
 
     return ret;
 }
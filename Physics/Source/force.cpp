@@ -18,7 +18,17 @@
  */
 
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 #include "force_generator.h"
+#include "particle.h"
 
 namespace OgldevPhysics {
 
@@ -30,10 +40,468 @@ void ForceRegistry::Add(Particle* pParticle, ForceGenerator* pForceGenerator)
 }
 
 
+void ForceRegistry::Remove(Particle* pParticle, ForceGenerator* pForceGenerator)
+{
+    for (uint i = 0 ; i < m_forceRegistry.size() ; i++) {
+        if ((m_forceRegistry[i].pParticle == pParticle) && (m_forceRegistry[i].pForceGenerator == pForceGenerator)) {
+            m_forceRegistry[i] = m_forceRegistry.back();
+            m_forceRegistry.pop_back();
+            return;
+        }
+    }
+}
+
+
+uint ForceRegistry::GetParticleIndex(const Particle* pParticle) const
+{
+    if (!m_pStore || (pParticle->GetStore() != m_pStore)) {
+        printf("%s:%d - the particle doesn't belong to the store of the force registry\n", __FILE__, __LINE__);
+        exit(1);
+    }
+
+    return pParticle->GetIndex();
+}
+
+
+ForceHandle ForceRegistry::AddGravity(Particle* pParticle, const Vector3f& Gravity)
+{
+    uint Indices[] = { GetParticleIndex(pParticle) };
+    float Params[] = { Gravity.x, Gravity.y, Gravity.z };
+
+    ForceHandle Handle;
+    Handle.Type = FORCE_TYPE_GRAVITY;
+    Handle.Id = m_gravity.Add(Indices, Params);
+    Handle.Generation = m_gravity.GetGeneration(Handle.Id);
+
+    return Handle;
+}
+
+
+ForceHandle ForceRegistry::AddDrag(Particle* pParticle, float k1, float k2)
+{
+    uint Indices[] = { GetParticleIndex(pParticle) };
+    float Params[] = { k1, k2 };
+
+    ForceHandle Handle;
+    Handle.Type = FORCE_TYPE_DRAG;
+    Handle.Id = m_drag.Add(Indices, Params);
+    Handle.Generation = m_drag.GetGeneration(Handle.Id);
+
+    return Handle;
+}
+
+
+ForceHandle ForceRegistry::AddSpring(Particle* pParticle, Particle* pOtherEnd, float SpringConstant, float RestLength)
+{
+    uint Indices[] = { GetParticleIndex(pParticle), GetParticleIndex(pOtherEnd) };
+    float Params[] = { SpringConstant, RestLength };
+
+    ForceHandle Handle;
+    Handle.Type = FORCE_TYPE_SPRING;
+    Handle.Id = m_springs.Add(Indices, Params);
+    Handle.Generation = m_springs.GetGeneration(Handle.Id);
+
+    return Handle;
+}
+
+
+ForceHandle ForceRegistry::AddAnchoredSpring(Particle* pParticle, const Vector3f& Anchor, float SpringConstant, float RestLength)
+{
+    uint Indices[] = { GetParticleIndex(pParticle) };
+    float Params[] = { Anchor.x, Anchor.y, Anchor.z, SpringConstant, RestLength };
+
+    ForceHandle Handle;
+    Handle.Type = FORCE_TYPE_ANCHORED_SPRING;
+    Handle.Id = m_anchoredSprings.Add(Indices, Params);
+    Handle.Generation = m_anchoredSprings.GetGeneration(Handle.Id);
+
+    return Handle;
+}
+
+
+bool ForceRegistry::SetAnchor(ForceHandle Handle, const Vector3f& Anchor)
+{
+    assert(Handle.Type == FORCE_TYPE_ANCHORED_SPRING);
+
+    return m_anchoredSprings.SetFloat(Handle.Id, Handle.Generation, 0, Anchor.x) &&
+           m_anchoredSprings.SetFloat(Handle.Id, Handle.Generation, 1, Anchor.y) &&
+           m_anchoredSprings.SetFloat(Handle.Id, Handle.Generation, 2, Anchor.z);
+}
+
+
+ForceHandle ForceRegistry::AddBungeeSpring(Particle* pParticle, Particle* pOtherEnd, float SpringConstant, float RestLength)
+{
+    uint Indices[] = { GetParticleIndex(pParticle), GetParticleIndex(pOtherEnd) };
+    float Params[] = { SpringConstant, RestLength };
+
+    ForceHandle Handle;
+    Handle.Type = FORCE_TYPE_BUNGEE_SPRING;
+    Handle.Id = m_bungeeSprings.Add(Indices, Params);
+    Handle.Generation = m_bungeeSprings.GetGeneration(Handle.Id);
+
+    return Handle;
+}
+
+
+ForceHandle ForceRegistry::AddBuoyancy(Particle* pParticle, float MaxDepth, float Volume, float WaterHeight, float LiquidDensity)
+{
+    uint Indices[] = { GetParticleIndex(pParticle) };
+    float Params[] = { MaxDepth, Volume, WaterHeight, LiquidDensity };
+
+    ForceHandle Handle;
+    Handle.Type = FORCE_TYPE_BUOYANCY;
+    Handle.Id = m_buoyancy.Add(Indices, Params);
+    Handle.Generation = m_buoyancy.GetGeneration(Handle.Id);
+
+    return Handle;
+}
+
+
+bool ForceRegistry::Remove(ForceHandle Handle)
+{
+    switch (Handle.Type) {
+    case FORCE_TYPE_GRAVITY:
+        return m_gravity.Remove(Handle.Id, Handle.Generation);
+
+    case FORCE_TYPE_DRAG:
+        return m_drag.Remove(Handle.Id, Handle.Generation);
+
+    case FORCE_TYPE_SPRING:
+        return m_springs.Remove(Handle.Id, Handle.Generation);
+
+    case FORCE_TYPE_ANCHORED_SPRING:
+        return m_anchoredSprings.Remove(Handle.Id, Handle.Generation);
+
+    case FORCE_TYPE_BUNGEE_SPRING:
+        return m_bungeeSprings.Remove(Handle.Id, Handle.Generation);
+
+    case FORCE_TYPE_BUOYANCY:
+        return m_buoyancy.Remove(Handle.Id, Handle.Generation);
+
+    default:
+        printf("%s:%d - invalid force type %d\n", __FILE__, __LINE__, Handle.Type);
+        exit(1);
+    }
+}
+
+
+bool ForceRegistry::IsValid(ForceHandle Handle) const
+{
+    switch (Handle.Type) {
+    case FORCE_TYPE_GRAVITY:
+        return m_gravity.IsValid(Handle.Id, Handle.Generation);
+
+    case FORCE_TYPE_DRAG:
+        return m_drag.IsValid(Handle.Id, Handle.Generation);
+
+    case FORCE_TYPE_SPRING:
+        return m_springs.IsValid(Handle.Id, Handle.Generation);
+
+    case FORCE_TYPE_ANCHORED_SPRING:
+        return m_anchoredSprings.IsValid(Handle.Id, Handle.Generation);
+
+    case FORCE_TYPE_BUNGEE_SPRING:
+        return m_bungeeSprings.IsValid(Handle.Id, Handle.Generation);
+
+    case FORCE_TYPE_BUOYANCY:
+        return m_buoyancy.IsValid(Handle.Id, Handle.Generation);
+
+    default:
+        return false;
+    }
+}
+
+
+void ForceRegistry::Clear()
+{
+    m_forceRegistry.clear();
+    m_gravity.Clear();
+    m_drag.Clear();
+    m_springs.Clear();
+    m_anchoredSprings.Clear();
+    m_bungeeSprings.Clear();
+    m_buoyancy.Clear();
+}
+
+
+uint ForceRegistry::GetNumForces() const
+{
+    return (uint)m_forceRegistry.size() + m_gravity.GetCount() + m_drag.GetCount() + m_springs.GetCount() +
+           m_anchoredSprings.GetCount() + m_bungeeSprings.GetCount() + m_buoyancy.GetCount();
+}
+
+
 void ForceRegistry::Update(float dt)
 {
     for (Registry::iterator it = m_forceRegistry.begin(); it != m_forceRegistry.end(); it++) {
         it->pForceGenerator->UpdateForce(it->pParticle, dt);
     }
+
+    if (!m_pStore) {
+        return;
+    }
+
+    UpdateGravity();
+    UpdateDrag();
+    UpdateSprings();
+    UpdateAnchoredSprings();
+    UpdateBungeeSprings();
+    UpdateBuoyancy();
+}
+
+
+void ForceRegistry::UpdateGravity()
+{
+    const uint* pParticles = m_gravity.GetIndices(0);
+    const float* pGravityX = m_gravity.GetFloats(0);
+    const float* pGravityY = m_gravity.GetFloats(1);
+    const float* pGravityZ = m_gravity.GetFloats(2);
+
+    const float* pReciprocalMass = m_pStore->GetReciprocalMasses();
+    float* pForceX = m_pStore->GetForcesX();
+    float* pForceY = m_pStore->GetForcesY();
+    float* pForceZ = m_pStore->GetForcesZ();
+
+    for (uint f = 0 ; f < m_gravity.GetCount() ; f++) {
+        uint i = pParticles[f];
+
+        if (pReciprocalMass[i] <= 0.0f) {
+            continue;
+        }
+
+        float Mass = 1.0f / pReciprocalMass[i];
+
+        pForceX[i] += pGravityX[f] * Mass;
+        pForceY[i] += pGravityY[f] * Mass;
+        pForceZ[i] += pGravityZ[f] * Mass;
+    }
+}
+
+
+void ForceRegistry::UpdateDrag()
+{
+    const uint* pParticles = m_drag.GetIndices(0);
+    const float* pK1 = m_drag.GetFloats(0);
+    const float* pK2 = m_drag.GetFloats(1);
+
+    const float* pVelX = m_pStore->GetVelocitiesX();
+    const float* pVelY = m_pStore->GetVelocitiesY();
+    const float* pVelZ = m_pStore->GetVelocitiesZ();
+    const float* pReciprocalMass = m_pStore->GetReciprocalMasses();
+    float* pForceX = m_pStore->GetForcesX();
+    float* pForceY = m_pStore->GetForcesY();
+    float* pForceZ = m_pStore->GetForcesZ();
+
+    uint Count = m_drag.GetCount();
+    uint f = 0;
+
+#ifdef __AVX2__
+    // The forces of 8 drags are calculated with gathers. Two drags can act on the same
+    // particle so the forces are added one by one.
+    __m256 Zero = _mm256_setzero_ps();
+    float ForceX[8], ForceY[8], ForceZ[8];
+
+    for ( ; f + 8 <= Count ; f += 8) {
+        __m256i Index = _mm256_loadu_si256((const __m256i*)&pParticles[f]);
+        __m256 vx = _mm256_i32gather_ps(pVelX, Index, 4);
+        __m256 vy = _mm256_i32gather_ps(pVelY, Index, 4);
+        __m256 vz = _mm256_i32gather_ps(pVelZ, Index, 4);
+
+        __m256 Speed = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)), _mm256_mul_ps(vz, vz)));
+        __m256 Coeff = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&pK1[f]), Speed),
+                                     _mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(&pK2[f]), Speed), Speed));
+        __m256 Moving = _mm256_cmp_ps(Speed, Zero, _CMP_GT_OQ);
+        __m256 NegCoeff = _mm256_sub_ps(Zero, Coeff);
+
+        // Zero for the particles that don't move instead of 0 / 0
+        _mm256_storeu_ps(ForceX, _mm256_and_ps(Moving, _mm256_mul_ps(_mm256_div_ps(vx, Speed), NegCoeff)));
+        _mm256_storeu_ps(ForceY, _mm256_and_ps(Moving, _mm256_mul_ps(_mm256_div_ps(vy, Speed), NegCoeff)));
+        _mm256_storeu_ps(ForceZ, _mm256_and_ps(Moving, _mm256_mul_ps(_mm256_div_ps(vz, Speed), NegCoeff)));
+
+        for (int j = 0 ; j < 8 ; j++) {
+            uint i = pParticles[f + j];
+
+            if (pReciprocalMass[i] > 0.0f) {
+                pForceX[i] += ForceX[j];
+                pForceY[i] += ForceY[j];
+                pForceZ[i] += ForceZ[j];
+            }
+        }
+    }
+#endif
+
+    for ( ; f < Count ; f++) {
+        uint i = pParticles[f];
+
+        if (pReciprocalMass[i] <= 0.0f) {
+            continue;
+        }
+
+        float Speed = sqrtf(pVelX[i] * pVelX[i] + pVelY[i] * pVelY[i] + pVelZ[i] * pVelZ[i]);
+
+        if (Speed > 0.0f) {
+            float Coeff = pK1[f] * Speed + pK2[f] * Speed * Speed;
+
+            pForceX[i] += pVelX[i] / Speed * -Coeff;
+            pForceY[i] += pVelY[i] / Speed * -Coeff;
+            pForceZ[i] += pVelZ[i] / Speed * -Coeff;
+        }
+    }
+}
+
+
+void ForceRegistry::UpdateSprings()
+{
+    const uint* pParticles = m_springs.GetIndices(0);
+    const uint* pOtherEnds = m_springs.GetIndices(1);
+    const float* pSpringConstant = m_springs.GetFloats(0);
+    const float* pRestLength = m_springs.GetFloats(1);
+
+    const float* pPosX = m_pStore->GetPositionsX();
+    const float* pPosY = m_pStore->GetPositionsY();
+    const float* pPosZ = m_pStore->GetPositionsZ();
+    const float* pReciprocalMass = m_pStore->GetReciprocalMasses();
+    float* pForceX = m_pStore->GetForcesX();
+    float* pForceY = m_pStore->GetForcesY();
+    float* pForceZ = m_pStore->GetForcesZ();
+
+    for (uint f = 0 ; f < m_springs.GetCount() ; f++) {
+        uint i = pParticles[f];
+        uint o = pOtherEnds[f];
+
+        if (pReciprocalMass[i] <= 0.0f) {
+            continue;
+        }
+
+        float dx = pPosX[i] - pPosX[o];
+        float dy = pPosY[i] - pPosY[o];
+        float dz = pPosZ[i] - pPosZ[o];
+
+        float Length = sqrtf(dx * dx + dy * dy + dz * dz);
+
+        if (Length > 0.0f) {
+            float Magnitude = fabsf(Length - pRestLength[f]) * pSpringConstant[f];
+
+            pForceX[i] += dx / Length * -Magnitude;
+            pForceY[i] += dy / Length * -Magnitude;
+            pForceZ[i] += dz / Length * -Magnitude;
+        }
+    }
+}
+
+
+void ForceRegistry::UpdateAnchoredSprings()
+{
+    const uint* pParticles = m_anchoredSprings.GetIndices(0);
+    const float* pAnchorX = m_anchoredSprings.GetFloats(0);
+    const float* pAnchorY = m_anchoredSprings.GetFloats(1);
+    const float* pAnchorZ = m_anchoredSprings.GetFloats(2);
+    const float* pSpringConstant = m_anchoredSprings.GetFloats(3);
+    const float* pRestLength = m_anchoredSprings.GetFloats(4);
+
+    const float* pPosX = m_pStore->GetPositionsX();
+    const float* pPosY = m_pStore->GetPositionsY();
+    const float* pPosZ = m_pStore->GetPositionsZ();
+    const float* pReciprocalMass = m_pStore->GetReciprocalMasses();
+    float* pForceX = m_pStore->GetForcesX();
+    float* pForceY = m_pStore->GetForcesY();
+    float* pForceZ = m_pStore->GetForcesZ();
+
+    for (uint f = 0 ; f < m_anchoredSprings.GetCount() ; f++) {
+        uint i = pParticles[f];
+
+        if (pReciprocalMass[i] <= 0.0f) {
+            continue;
+        }
+
+        float dx = pPosX[i] - pAnchorX[f];
+        float dy = pPosY[i] - pAnchorY[f];
+        float dz = pPosZ[i] - pAnchorZ[f];
+
+        float Length = sqrtf(dx * dx + dy * dy + dz * dz);
+
+        float Magnitude = (pRestLength[f] - Length) * pSpringConstant[f];
+
+        if ((Magnitude > 0.0f) && (Length > 0.0f)) {
+            pForceX[i] += dx / Length * Magnitude;
+            pForceY[i] += dy / Length * Magnitude;
+            pForceZ[i] += dz / Length * Magnitude;
+        }
+    }
+}
+
+
+void ForceRegistry::UpdateBungeeSprings()
+{
+    const uint* pParticles = m_bungeeSprings.GetIndices(0);
+    const uint* pOtherEnds = m_bungeeSprings.GetIndices(1);
+    const float* pSpringConstant = m_bungeeSprings.GetFloats(0);
+    const float* pRestLength = m_bungeeSprings.GetFloats(1);
+
+    const float* pPosX = m_pStore->GetPositionsX();
+    const float* pPosY = m_pStore->GetPositionsY();
+    const float* pPosZ = m_pStore->GetPositionsZ();
+    const float* pReciprocalMass = m_pStore->GetReciprocalMasses();
+    float* pForceX = m_pStore->GetForcesX();
+    float* pForceY = m_pStore->GetForcesY();
+    float* pForceZ = m_pStore->GetForcesZ();
+
+    for (uint f = 0 ; f < m_bungeeSprings.GetCount() ; f++) {
+        uint i = pParticles[f];
+        uint o = pOtherEnds[f];
+
+        if (pReciprocalMass[i] <= 0.0f) {
+            continue;
+        }
+
+        float dx = pPosX[i] - pPosX[o];
+        float dy = pPosY[i] - pPosY[o];
+        float dz = pPosZ[i] - pPosZ[o];
+
+        float Length = sqrtf(dx * dx + dy * dy + dz * dz);
+
+        if (Length > pRestLength[f]) {
+            float Magnitude = pSpringConstant[f] * (pRestLength[f] - Length);
+
+            pForceX[i] += dx / Length * -Magnitude;
+            pForceY[i] += dy / Length * -Magnitude;
+            pForceZ[i] += dz / Length * -Magnitude;
+        }
+    }
+}
+
+
+void ForceRegistry::UpdateBuoyancy()
+{
+    const uint* pParticles = m_buoyancy.GetIndices(0);
+    const float* pMaxDepth = m_buoyancy.GetFloats(0);
+    const float* pVolume = m_buoyancy.GetFloats(1);
+    const float* pWaterHeight = m_buoyancy.GetFloats(2);
+    const float* pLiquidDensity = m_buoyancy.GetFloats(3);
+
+    const float* pPosY = m_pStore->GetPositionsY();
+    const float* pReciprocalMass = m_pStore->GetReciprocalMasses();
+    float* pForceY = m_pStore->GetForcesY();
+
+    for (uint f = 0 ; f < m_buoyancy.GetCount() ; f++) {
+        uint i = pParticles[f];
+
+        if (pReciprocalMass[i] <= 0.0f) {
+            continue;
+        }
+
+        float Depth = pPosY[i];
+
+        if (Depth >= pWaterHeight[f] + pMaxDepth[f]) {
+            continue;   // out of the water
+        }
+
+        if (Depth <= pWaterHeight[f] - pMaxDepth[f]) {
+            pForceY[i] += pLiquidDensity[f] * pVolume[f];
+        } else {
+            pForceY[i] += pLiquidDensity[f] * pVolume[f] * (Depth - pMaxDepth[f] - pWaterHeight[f]) / 2.0f * pMaxDepth[f];
+        }
+    }
+}
+
 }
-}
\ No newline at end of file
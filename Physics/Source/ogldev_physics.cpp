@@ -18,6 +18,9 @@
  */
 
 
+#include <math.h>
+#include <algorithm>
+
 #include "ogldev_physics.h"
 
 namespace OgldevPhysics
@@ -25,12 +28,22 @@ namespace OgldevPhysics
 
 void PhysicsSystem::Init(uint NumObjects, uint MaxContacts, uint Iterations)
 {
+    m_particleStore.Init(NumObjects);
     m_particles.resize(NumObjects);
     m_numParticles = 0;
 
+    // The batched forces are applied directly on the arrays of the store
+    m_forceRegistry.Init(&m_particleStore);
+
+    // The fireworks are also used as a ring buffer by Create() so all of them are bound up front
+    m_fireworkStore.Init(NumObjects);
     m_fireworks.resize(NumObjects);
     m_numFireworks = 0;
 
+    for (uint i = 0; i < NumObjects; i++) {
+        m_fireworks[i].Init(&m_fireworkStore, m_fireworkStore.AllocParticle());
+    }
+
     InitFireworksConfig();
 
     m_resolver.Init(Iterations);
@@ -51,6 +64,7 @@ Particle* PhysicsSystem::AllocParticle()
     }
 
     Particle* ret = &m_particles[m_numParticles];
+    ret->Init(&m_particleStore, m_particleStore.AllocParticle());
     m_numParticles++;
 
     return ret;
@@ -71,12 +85,62 @@ Firework* PhysicsSystem::AllocFirework()
 }
 
 
+void PhysicsSystem::SetFixedTimeStep(float StepRate, uint MaxSubSteps)
+{
+    if (StepRate < 0.0f) {
+        printf("%s:%d - invalid step rate %f\n", __FILE__, __LINE__, StepRate);
+        exit(1);
+    }
+
+    m_fixedTimeStep = (StepRate > 0.0f) ? 1.0f / StepRate : 0.0f;
+    m_maxSubSteps = std::max(MaxSubSteps, 1u);
+    m_accumulator = 0.0f;
+    m_interpolationAlpha = 1.0f;
+    m_numFixedSteps = 0;
+}
+
+
 void PhysicsSystem::Update(long long DeltaTimeMillis)
 {
     assert(DeltaTimeMillis >= 0.0f);
 
     float dt = (float)DeltaTimeMillis / 1000.0f;
 
+    if (m_fixedTimeStep == 0.0f) {
+        Step(dt);
+        m_numSubSteps = 1;
+        m_interpolationAlpha = 1.0f;
+        return;
+    }
+
+    m_accumulator += dt;
+    m_numSubSteps = 0;
+
+    while ((m_accumulator >= m_fixedTimeStep) && (m_numSubSteps < m_maxSubSteps)) {
+        m_particleStore.SavePositions();
+        m_fireworkStore.SavePositions();
+
+        Step(m_fixedTimeStep);
+
+        m_accumulator -= m_fixedTimeStep;
+        m_numSubSteps++;
+        m_numFixedSteps++;
+    }
+
+    // Out of sub steps - the simulation falls behind instead of trying to catch up
+    if (m_accumulator >= m_fixedTimeStep) {
+        m_accumulator = fmodf(m_accumulator, m_fixedTimeStep);
+    }
+
+    // The previous positions are only valid after the first step
+    if (m_numFixedSteps > 0) {
+        m_interpolationAlpha = m_accumulator / m_fixedTimeStep;
+    }
+}
+
+
+void PhysicsSystem::Step(float dt)
+{
     StartFrame();
 
   //  m_forceRegistry.Update(dt);
@@ -99,9 +163,7 @@ void PhysicsSystem::Update(long long DeltaTimeMillis)
 
 void PhysicsSystem::ParticleUpdate(float dt)
 {
-    for (uint i = 0; i < m_numParticles; i++) {
-        m_particles[i].Integrate(dt);
-    }
+    m_particleStore.Integrate(dt);
 }
 
 
@@ -137,9 +199,7 @@ void PhysicsSystem::FireworkUpdate(float dt)
 
 void PhysicsSystem::StartFrame()
 {
-    for (uint i = 0; i < m_numParticles; i++) {
-        m_particles[i].ClearAccum(); // Also called from Particle::Integrate !!!
-    }
+    m_particleStore.ClearForces(); // Also done by ParticleStore::Integrate !!!
 }
 
 
@@ -23,32 +23,11 @@
 namespace OgldevPhysics
 {
 
-void Particle::Integrate(float dt)
-{
-    if (m_reciprocalMass <= 0.0f) {
-        return;
-    }
-
-    m_position += m_velocity * dt;
-
-    Vector3f AccTemp = m_acceleration;
-    AccTemp += m_forceAccum * m_reciprocalMass;
-   // printf("accel y %f\n", AccTemp.y);
-    m_velocity += AccTemp * dt;
-
-    m_velocity *= powf(m_damping, dt);
-
-  //  printf("pos y %f velocity y %f\n", m_position.y, m_velocity.y);
-
-    ClearAccum();
-}
-
-
 void Particle::SetMass(float Mass)
 {
     assert(Mass > 0.0f);
 
-    m_reciprocalMass = 1.0f / Mass;
+    SetReciprocalMass(1.0f / Mass);
 }
 
 
@@ -56,19 +35,15 @@ float Particle::GetMass() const
 {
     float ret = 0.0f;
 
-    if (m_reciprocalMass == 0.0f) {
+    float ReciprocalMass = GetReciprocalMass();
+
+    if (ReciprocalMass == 0.0f) {
         ret = FLT_MAX;
     } else {
-        ret = 1.0f / m_reciprocalMass;
+        ret = 1.0f / ReciprocalMass;
     }
 
     return ret;
 }
 
-
-void Particle::ClearAccum()
-{
-    m_forceAccum = Vector3f(0.0f, 0.0f, 0.0f);
-}
-
 }
\ No newline at end of file
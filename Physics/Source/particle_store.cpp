@@ -0,0 +1,254 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#else
+#include "ogldev_simd.h"
+#endif
+
+#include "ogldev_util.h"
+#include "particle_store.h"
+
+namespace OgldevPhysics
+{
+
+void ParticleStore::Init(uint MaxParticles)
+{
+    m_maxParticles = MaxParticles;
+    m_numParticles = 0;
+
+    uint Size = (MaxParticles + PARTICLE_STORE_WIDTH - 1) / PARTICLE_STORE_WIDTH * PARTICLE_STORE_WIDTH;
+
+    std::vector<float>* FloatArrays[] = { &m_posX, &m_posY, &m_posZ, &m_prevPosX, &m_prevPosY, &m_prevPosZ,
+                                          &m_velX, &m_velY, &m_velZ, &m_accX, &m_accY, &m_accZ,
+                                          &m_forceX, &m_forceY, &m_forceZ, &m_reciprocalMass, &m_active };
+
+    for (uint i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(FloatArrays) ; i++) {
+        FloatArrays[i]->assign(Size, 0.0f);
+    }
+
+    m_dampingValues.clear();
+    m_dampingFactors.assign(1, 1.0f);
+
+    int DefaultClass = (int)GetDampingClass(DEFAULT_PARTICLE_DAMPING);
+
+    m_dampingClass.assign(Size, DefaultClass);
+    m_dampingSlot.assign(Size, 0);
+}
+
+
+uint ParticleStore::AllocParticle()
+{
+    if (m_numParticles == m_maxParticles) {
+        printf("%s:%d - exceeded max number of particles\n", __FILE__, __LINE__);
+        exit(1);
+    }
+
+    uint ret = m_numParticles;
+    m_numParticles++;
+
+    return ret;
+}
+
+
+void ParticleStore::SetReciprocalMass(uint i, float ReciprocalMass)
+{
+    m_reciprocalMass[i] = ReciprocalMass;
+
+    bool Active = (ReciprocalMass > 0.0f);
+    m_active[i] = Active ? 1.0f : 0.0f;
+    m_dampingSlot[i] = Active ? m_dampingClass[i] + 1 : 0;
+}
+
+
+void ParticleStore::SetDamping(uint i, float Damping)
+{
+    m_dampingClass[i] = (int)GetDampingClass(Damping);
+
+    if (m_active[i] > 0.0f) {
+        m_dampingSlot[i] = m_dampingClass[i] + 1;
+    }
+}
+
+
+uint ParticleStore::GetDampingClass(float Damping)
+{
+    for (uint i = 0 ; i < m_dampingValues.size() ; i++) {
+        if (m_dampingValues[i] == Damping) {
+            return i;
+        }
+    }
+
+    if (m_dampingValues.size() == MAX_DAMPING_CLASSES) {
+        printf("%s:%d - exceeded max number of damping classes (%d)\n", __FILE__, __LINE__, MAX_DAMPING_CLASSES);
+        exit(1);
+    }
+
+    m_dampingValues.push_back(Damping);
+    m_dampingFactors.push_back(1.0f);
+
+    return (uint)m_dampingValues.size() - 1;
+}
+
+
+void ParticleStore::UpdateDampingFactors(float dt)
+{
+    // Slot zero belongs to the particles with an infinite mass and stays one
+    for (uint i = 0 ; i < m_dampingValues.size() ; i++) {
+        m_dampingFactors[i + 1] = powf(m_dampingValues[i], dt);
+    }
+}
+
+
+void ParticleStore::ClearForces()
+{
+    memset(m_forceX.data(), 0, m_forceX.size() * sizeof(float));
+    memset(m_forceY.data(), 0, m_forceY.size() * sizeof(float));
+    memset(m_forceZ.data(), 0, m_forceZ.size() * sizeof(float));
+}
+
+
+void ParticleStore::SavePositions()
+{
+    memcpy(m_prevPosX.data(), m_posX.data(), m_numParticles * sizeof(float));
+    memcpy(m_prevPosY.data(), m_posY.data(), m_numParticles * sizeof(float));
+    memcpy(m_prevPosZ.data(), m_posZ.data(), m_numParticles * sizeof(float));
+}
+
+
+void ParticleStore::IntegrateParticle(uint i, float dt)
+{
+    if (m_reciprocalMass[i] <= 0.0f) {
+        return;
+    }
+
+    float Damping = powf(m_dampingValues[m_dampingClass[i]], dt);
+
+    m_posX[i] += m_velX[i] * dt;
+    m_posY[i] += m_velY[i] * dt;
+    m_posZ[i] += m_velZ[i] * dt;
+
+    float AccX = m_accX[i] + m_forceX[i] * m_reciprocalMass[i];
+    float AccY = m_accY[i] + m_forceY[i] * m_reciprocalMass[i];
+    float AccZ = m_accZ[i] + m_forceZ[i] * m_reciprocalMass[i];
+
+    m_velX[i] = (m_velX[i] + AccX * dt) * Damping;
+    m_velY[i] = (m_velY[i] + AccY * dt) * Damping;
+    m_velZ[i] = (m_velZ[i] + AccZ * dt) * Damping;
+
+    ClearForce(i);
+}
+
+
+void ParticleStore::Integrate(float dt)
+{
+    UpdateDampingFactors(dt);
+
+    IntegrateBatch(dt);
+}
+
+
+/*
+    The particles with an infinite mass go through the same math with a time step of
+    zero and a damping factor of one so they come out unchanged without any branches.
+*/
+#ifdef __AVX2__
+
+static inline void IntegrateAxis8(float* pPos, float* pVel, const float* pAcc, float* pForce,
+                                  __m256 ReciprocalMass, __m256 dt, __m256 Damping)
+{
+    __m256 Pos = _mm256_loadu_ps(pPos);
+    __m256 Vel = _mm256_loadu_ps(pVel);
+    __m256 Acc = _mm256_add_ps(_mm256_loadu_ps(pAcc), _mm256_mul_ps(_mm256_loadu_ps(pForce), ReciprocalMass));
+
+    Pos = _mm256_add_ps(Pos, _mm256_mul_ps(Vel, dt));
+    Vel = _mm256_mul_ps(_mm256_add_ps(Vel, _mm256_mul_ps(Acc, dt)), Damping);
+
+    _mm256_storeu_ps(pPos, Pos);
+    _mm256_storeu_ps(pVel, Vel);
+    _mm256_storeu_ps(pForce, _mm256_setzero_ps());
+}
+
+
+void ParticleStore::IntegrateBatch(float dt)
+{
+    __m256 Step = _mm256_set1_ps(dt);
+
+    for (uint i = 0 ; i < m_numParticles ; i += 8) {
+        __m256 ParticleStep = _mm256_mul_ps(Step, _mm256_loadu_ps(&m_active[i]));
+        __m256 ReciprocalMass = _mm256_loadu_ps(&m_reciprocalMass[i]);
+        __m256i Slot = _mm256_loadu_si256((const __m256i*)&m_dampingSlot[i]);
+        __m256 Damping = _mm256_i32gather_ps(m_dampingFactors.data(), Slot, 4);
+
+        IntegrateAxis8(&m_posX[i], &m_velX[i], &m_accX[i], &m_forceX[i], ReciprocalMass, ParticleStep, Damping);
+        IntegrateAxis8(&m_posY[i], &m_velY[i], &m_accY[i], &m_forceY[i], ReciprocalMass, ParticleStep, Damping);
+        IntegrateAxis8(&m_posZ[i], &m_velZ[i], &m_accZ[i], &m_forceZ[i], ReciprocalMass, ParticleStep, Damping);
+    }
+}
+
+#else
+
+static inline void IntegrateAxis4(float* pPos, float* pVel, const float* pAcc, float* pForce,
+                                  Float4 ReciprocalMass, Float4 dt, Float4 Damping)
+{
+    Float4 Pos = Load4(pPos);
+    Float4 Vel = Load4(pVel);
+    Float4 Acc = Add4(Load4(pAcc), Mul4(Load4(pForce), ReciprocalMass));
+
+    Pos = Add4(Pos, Mul4(Vel, dt));
+    Vel = Mul4(Add4(Vel, Mul4(Acc, dt)), Damping);
+
+    Store4(pPos, Pos);
+    Store4(pVel, Vel);
+    Store4(pForce, Set4(0.0f));
+}
+
+
+void ParticleStore::IntegrateBatch(float dt)
+{
+    Float4 Step = Set4(dt);
+
+    for (uint i = 0 ; i < m_numParticles ; i += 4) {
+        Float4 ParticleStep = Mul4(Step, Load4(&m_active[i]));
+        Float4 ReciprocalMass = Load4(&m_reciprocalMass[i]);
+
+        float DampingFactors[4];
+
+        for (int j = 0 ; j < 4 ; j++) {
+            DampingFactors[j] = m_dampingFactors[m_dampingSlot[i + j]];
+        }
+
+        Float4 Damping = Load4(DampingFactors);
+
+        IntegrateAxis4(&m_posX[i], &m_velX[i], &m_accX[i], &m_forceX[i], ReciprocalMass, ParticleStep, Damping);
+        IntegrateAxis4(&m_posY[i], &m_velY[i], &m_accY[i], &m_forceY[i], ReciprocalMass, ParticleStep, Damping);
+        IntegrateAxis4(&m_posZ[i], &m_velZ[i], &m_accZ[i], &m_forceZ[i], ReciprocalMass, ParticleStep, Damping);
+    }
+}
+
+#endif
+
+}
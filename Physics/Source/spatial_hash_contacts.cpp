@@ -0,0 +1,249 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <thread>
+
+#include "ogldev_parallel_for.h"
+#include "spatial_hash_contacts.h"
+
+namespace OgldevPhysics
+{
+
+#define MIN_HASH_TABLE_SIZE 64
+
+void SpatialHashContacts::Init(const ParticleStore* pStore, Particle* pParticles, float Radius, float Restitution, int NumThreads)
+{
+    if (Radius <= 0.0f) {
+        printf("%s:%d - invalid particle radius %f\n", __FILE__, __LINE__, Radius);
+        exit(1);
+    }
+
+    m_pStore = pStore;
+    m_pParticles = pParticles;
+    m_radius = Radius;
+    m_restitution = Restitution;
+    m_invCellSize = 1.0f / (4.0f * Radius);
+
+    if (NumThreads <= 0) {
+        NumThreads = std::max((int)std::thread::hardware_concurrency(), 1);
+    }
+
+    m_numThreads = NumThreads;
+}
+
+
+uint SpatialHashContacts::GetCellHash(int x, int y, int z) const
+{
+    return (((uint)x * 73856093u) ^ ((uint)y * 19349663u) ^ ((uint)z * 83492791u)) & m_tableMask;
+}
+
+
+/*
+    Counting sort of the particles by the hash of their cell. The table has at least
+    twice as many entries as there are particles so most buckets hold a single cell.
+    After the sort the particles of bucket h are m_sorted[m_cellStart[h]] up to (but not
+    including) m_sorted[m_cellStart[h + 1]]. The positions are copied in the same order
+    so that the search reads them sequentially.
+*/
+void SpatialHashContacts::BuildGrid() const
+{
+    uint NumParticles = m_pStore->GetNumParticles();
+
+    uint TableSize = MIN_HASH_TABLE_SIZE;
+
+    while (TableSize < NumParticles * 2) {
+        TableSize *= 2;
+    }
+
+    m_tableMask = TableSize - 1;
+
+    m_cellHash.resize(NumParticles);
+    m_sorted.resize(NumParticles);
+    m_sortedX.resize(NumParticles);
+    m_sortedY.resize(NumParticles);
+    m_sortedZ.resize(NumParticles);
+    m_cellStart.assign(TableSize + 1, 0);
+
+    const float* pX = m_pStore->GetPositionsX();
+    const float* pY = m_pStore->GetPositionsY();
+    const float* pZ = m_pStore->GetPositionsZ();
+
+    for (uint i = 0 ; i < NumParticles ; i++) {
+        int x = (int)floorf(pX[i] * m_invCellSize);
+        int y = (int)floorf(pY[i] * m_invCellSize);
+        int z = (int)floorf(pZ[i] * m_invCellSize);
+        uint Hash = GetCellHash(x, y, z);
+        m_cellHash[i] = Hash;
+        m_cellStart[Hash]++;
+    }
+
+    // Inclusive prefix sum - every entry becomes the end of its bucket
+    for (uint h = 1 ; h <= TableSize ; h++) {
+        m_cellStart[h] += m_cellStart[h - 1];
+    }
+
+    // Walking backwards moves every entry to the start of its bucket and keeps the
+    // particles of a bucket in increasing order
+    for (int i = (int)NumParticles - 1 ; i >= 0 ; i--) {
+        uint Slot = --m_cellStart[m_cellHash[i]];
+        m_sorted[Slot] = i;
+        m_sortedX[Slot] = pX[i];
+        m_sortedY[Slot] = pY[i];
+        m_sortedZ[Slot] = pZ[i];
+    }
+}
+
+
+/*
+    The cells are two diameters wide so a particle can only touch the particles of the
+    2x2x2 block of cells that is centered on the corner closest to it. Every pair is
+    reported once, by the particle with the lower index. Cells of the block can land
+    in the same bucket so the duplicate hashes are dropped before the buckets are searched.
+*/
+void SpatialHashContacts::FindPairs(uint First, uint Last, std::vector<ContactPair>& Pairs) const
+{
+    float Diameter = 2.0f * m_radius;
+    float DiameterSquared = Diameter * Diameter;
+
+    for (uint s = First ; s < Last ; s++) {
+        uint i = m_sorted[s];
+        float x = m_sortedX[s];
+        float y = m_sortedY[s];
+        float z = m_sortedZ[s];
+
+        // The far corner of the block
+        int CellX = (int)floorf(x * m_invCellSize + 0.5f);
+        int CellY = (int)floorf(y * m_invCellSize + 0.5f);
+        int CellZ = (int)floorf(z * m_invCellSize + 0.5f);
+
+        uint Hashes[8];
+        int NumHashes = 0;
+
+        for (int dz = -1 ; dz <= 0 ; dz++) {
+            for (int dy = -1 ; dy <= 0 ; dy++) {
+                for (int dx = -1 ; dx <= 0 ; dx++) {
+                    uint Hash = GetCellHash(CellX + dx, CellY + dy, CellZ + dz);
+
+                    bool Found = false;
+
+                    for (int h = 0 ; h < NumHashes ; h++) {
+                        Found |= (Hashes[h] == Hash);
+                    }
+
+                    if (!Found) {
+                        Hashes[NumHashes] = Hash;
+                        NumHashes++;
+                    }
+                }
+            }
+        }
+
+        bool FiniteMass = m_pStore->GetReciprocalMass(i) > 0.0f;
+
+        for (int h = 0 ; h < NumHashes ; h++) {
+            uint Hash = Hashes[h];
+
+            for (uint k = m_cellStart[Hash] ; k < m_cellStart[Hash + 1] ; k++) {
+                uint j = m_sorted[k];
+
+                if (j <= i) {
+                    continue;
+                }
+
+                Vector3f Diff(x - m_sortedX[k], y - m_sortedY[k], z - m_sortedZ[k]);
+                float DistSquared = Diff.x * Diff.x + Diff.y * Diff.y + Diff.z * Diff.z;
+
+                if (DistSquared >= DiameterSquared) {
+                    continue;
+                }
+
+                // Nothing to resolve between two particles with an infinite mass
+                if (!FiniteMass && (m_pStore->GetReciprocalMass(j) <= 0.0f)) {
+                    continue;
+                }
+
+                float Dist = sqrtf(DistSquared);
+
+                ContactPair Pair;
+                Pair.Particles[0] = i;
+                Pair.Particles[1] = j;
+                // Points from the second particle towards the first
+                Pair.Normal = (Dist > 0.0f) ? Diff / Dist : Vector3f(0.0f, 1.0f, 0.0f);
+                Pair.Penetration = Diameter - Dist;
+                Pairs.push_back(Pair);
+            }
+        }
+    }
+}
+
+
+int SpatialHashContacts::AddContact(std::vector<ParticleContact>& Contacts, int StartIndex) const
+{
+    uint NumParticles = m_pStore->GetNumParticles();
+
+    m_numPairs = 0;
+
+    if (NumParticles < 2) {
+        return 0;
+    }
+
+    BuildGrid();
+
+    int NumBands = std::min(m_numThreads, (int)NumParticles);
+
+    m_bandPairs.resize(NumBands);
+
+    ParallelFor(NumBands, [&](int Begin, int End) {
+        for (int Band = Begin ; Band < End ; Band++) {
+            uint First = (uint)((long long)NumParticles * Band / NumBands);
+            uint Last = (uint)((long long)NumParticles * (Band + 1) / NumBands);
+
+            m_bandPairs[Band].clear();
+
+            FindPairs(First, Last, m_bandPairs[Band]);
+        }
+    }, NumBands);
+
+    int Limit = (int)Contacts.size() - StartIndex;
+    int Count = 0;
+
+    for (int Band = 0 ; Band < NumBands ; Band++) {
+        const std::vector<ContactPair>& Pairs = m_bandPairs[Band];
+
+        m_numPairs += (uint)Pairs.size();
+
+        for (uint p = 0 ; (p < Pairs.size()) && (Count < Limit) ; p++) {
+            ParticleContact& Contact = Contacts[StartIndex + Count];
+            Contact.m_pParticles[0] = &m_pParticles[Pairs[p].Particles[0]];
+            Contact.m_pParticles[1] = &m_pParticles[Pairs[p].Particles[1]];
+            Vector3f Normal = Pairs[p].Normal;
+            Contact.SetContactNormal(Normal);
+            Contact.SetPenetration(Pairs[p].Penetration);
+            Contact.SetRestitution(m_restitution);
+            Count++;
+        }
+    }
+
+    return Count;
+}
+
+}
@@ -40,18 +40,18 @@ void SpringForceGenerator::Init(Particle* pOtherEnd, float SpringConstant, float
     
 void SpringForceGenerator::UpdateForce(Particle* pParticle, float dt)
 {
-    Vector3f Velocity = pParticle->GetVelocity();
+    Vector3f Force = pParticle->GetPosition();
 
-    Velocity -= m_pOtherEnd->GetPosition();
+    Force -= m_pOtherEnd->GetPosition();
 
-    float Magnitude = Velocity.Length();
+    float Magnitude = Force.Length();
 
     if (Magnitude > 0.0f) {
         Magnitude = fabsf(Magnitude - m_restLength);
 
         Magnitude *= m_springConstant;
 
-        Vector3f Force = Velocity.Normalize() * (-Magnitude);
+        Force = Force.Normalize() * (-Magnitude);
 
         pParticle->AddForce(Force);
     }
@@ -0,0 +1,181 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Compares a GetBoneTransforms call per instance with a single
+    GetBoneTransformsBatch call for the whole crowd (with and without threads)
+    and checks that both produce the same bone transforms.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#include "demolition.h"
+#include "Int/core_model.h"
+
+#define MODEL_FILENAME "../Content/boblampclean.md5mesh"
+#define NUM_INSTANCES 512
+#define NUM_FRAMES 500
+#define FRAME_TIME (1.0f / 60.0f)
+
+
+struct Crowd
+{
+    std::vector<uint> AnimationIndices;
+    std::vector<float> Times;
+    std::vector<AnimationSamplingState> States;
+    std::vector<AnimationSamplingState*> StatePtrs;
+};
+
+
+static void InitCrowd(Crowd& crowd, uint NumInstances, uint NumAnimations)
+{
+    crowd.AnimationIndices.resize(NumInstances);
+    crowd.Times.resize(NumInstances);
+    crowd.States.resize(NumInstances);
+    crowd.StatePtrs.resize(NumInstances);
+
+    for (uint i = 0 ; i < NumInstances ; i++) {
+        crowd.AnimationIndices[i] = i % NumAnimations;
+        crowd.Times[i] = 0.37f * i;     // every instance is at a different pose
+        crowd.StatePtrs[i] = &crowd.States[i];
+    }
+}
+
+
+static void AdvanceCrowd(Crowd& crowd)
+{
+    for (float& t : crowd.Times) {
+        t += FRAME_TIME;
+    }
+}
+
+
+// Returns the best frame time in milliseconds (the least disturbed by the rest of the system)
+static double RunPerInstance(CoreModel* pModel, uint NumInstances, std::vector<Matrix4f>& Palettes)
+{
+    Crowd crowd;
+    InitCrowd(crowd, NumInstances, pModel->GetNumAnimations());
+
+    uint NumBones = pModel->NumBones();
+    std::vector<Matrix4f> Transforms;
+    double Best = 1e10;
+
+    for (uint Frame = 0 ; Frame < NUM_FRAMES ; Frame++) {
+        AdvanceCrowd(crowd);
+
+        auto Start = std::chrono::high_resolution_clock::now();
+
+        for (uint i = 0 ; i < NumInstances ; i++) {
+            pModel->GetBoneTransforms(crowd.Times[i], Transforms, crowd.AnimationIndices[i], crowd.States[i]);
+            memcpy(&Palettes[i * NumBones], Transforms.data(), NumBones * sizeof(Matrix4f));
+        }
+
+        double Time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+        Best = std::min(Best, Time);
+    }
+
+    return Best;
+}
+
+
+static double RunBatch(CoreModel* pModel, uint NumInstances, bool Multithreaded, std::vector<Matrix4f>& Palettes)
+{
+    Crowd crowd;
+    InitCrowd(crowd, NumInstances, pModel->GetNumAnimations());
+
+    double Best = 1e10;
+
+    for (uint Frame = 0 ; Frame < NUM_FRAMES ; Frame++) {
+        AdvanceCrowd(crowd);
+
+        auto Start = std::chrono::high_resolution_clock::now();
+
+        pModel->GetBoneTransformsBatch(NumInstances, crowd.AnimationIndices.data(), crowd.Times.data(),
+                                       Palettes.data(), crowd.StatePtrs.data(), Multithreaded);
+
+        double Time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+        Best = std::min(Best, Time);
+    }
+
+    return Best;
+}
+
+
+static float MaxError(const std::vector<Matrix4f>& a, const std::vector<Matrix4f>& b)
+{
+    float Error = 0.0f;
+
+    for (size_t i = 0 ; i < a.size() ; i++) {
+        for (int j = 0 ; j < 4 ; j++) {
+            for (int k = 0 ; k < 4 ; k++) {
+                Error = std::max(Error, fabsf(a[i].m[j][k] - b[i].m[j][k]));
+            }
+        }
+    }
+
+    return Error;
+}
+
+
+int main(int argc, char* argv[])
+{
+    const char* pFilename = (argc > 1) ? argv[1] : MODEL_FILENAME;
+    uint NumInstances = (argc > 2) ? atoi(argv[2]) : NUM_INSTANCES;
+
+    // The model loader needs a GL context for the vertex buffers
+    GameCallbacks Callbacks;
+    RenderingSystem* pRenderingSystem = RenderingSystem::CreateRenderingSystem(RENDERING_SYSTEM_GL, &Callbacks, false);
+    pRenderingSystem->CreateWindow(64, 64, "Animation Batch Benchmark");
+
+    CoreModel* pModel = (CoreModel*)pRenderingSystem->LoadModel(pFilename);
+
+    if (!pModel->IsAnimated()) {
+        printf("'%s' is not animated\n", pFilename);
+        return 1;
+    }
+
+    uint NumBones = pModel->NumBones();
+
+    std::vector<Matrix4f> Reference(NumInstances * NumBones);
+    std::vector<Matrix4f> Batch(NumInstances * NumBones);
+    std::vector<Matrix4f> BatchMT(NumInstances * NumBones);
+
+    double PerInstanceTime = RunPerInstance(pModel, NumInstances, Reference);
+    double BatchTime = RunBatch(pModel, NumInstances, false, Batch);
+    double BatchMTTime = RunBatch(pModel, NumInstances, true, BatchMT);
+
+    printf("%s: %d instances, %d bones, %d frames\n", pFilename, NumInstances, NumBones, NUM_FRAMES);
+    printf("    per instance:    %8.3f ms\n", PerInstanceTime);
+    printf("    batch:           %8.3f ms (%.2fx)\n", BatchTime, PerInstanceTime / BatchTime);
+    printf("    batch threaded:  %8.3f ms (%.2fx)\n", BatchMTTime, PerInstanceTime / BatchMTTime);
+
+    float Error = std::max(MaxError(Reference, Batch), MaxError(Reference, BatchMT));
+
+    printf("    max error %g\n", Error);
+
+    if (Error > 1e-4f) {
+        printf("Error! the batch doesn't match GetBoneTransforms\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,239 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Compares the linear keyframe search that CoreModel used to do on every
+    sample with the cursor based search in core_animation_sampler.h.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+
+#include "Int/core_animation_sampler.h"
+
+#define MODEL_FILENAME "../Content/boblampclean.md5mesh"
+#define FRAME_TIME (1.0f / 60.0f)
+
+
+struct Channel
+{
+    const aiVectorKey* pPositionKeys = NULL;
+    uint NumPositionKeys = 0;
+    const aiQuatKey* pRotationKeys = NULL;
+    uint NumRotationKeys = 0;
+};
+
+
+struct Clip
+{
+    const char* pName = NULL;
+    float TicksPerSecond = 25.0f;
+    float Duration = 0.0f;
+    std::vector<Channel> Channels;
+};
+
+
+// The original search from CoreModel::FindPosition/FindRotation
+template<typename KeyType>
+uint FindKeyframeLinear(const KeyType* pKeys, uint NumKeys, float AnimationTimeTicks)
+{
+    for (uint i = 0 ; i < NumKeys - 1 ; i++) {
+        float t = (float)pKeys[i + 1].mTime;
+        if (AnimationTimeTicks < t) {
+            return i;
+        }
+    }
+
+    return 0;
+}
+
+
+static float CalcAnimationTimeTicks(const Clip& clip, float TimeInSeconds)
+{
+    float Duration = 0.0f;
+    modf(clip.Duration, &Duration);
+    return fmod(TimeInSeconds * clip.TicksPerSecond, Duration);
+}
+
+
+// Samples every channel of the clip once per frame. Returns the sum of the key indices
+// so that both versions can be checked against each other and the work is not optimized away.
+static u64 RunLinear(const Clip& clip, uint NumFrames, double& Seconds)
+{
+    u64 Sum = 0;
+
+    auto Start = std::chrono::high_resolution_clock::now();
+
+    for (uint Frame = 0 ; Frame < NumFrames ; Frame++) {
+        float AnimationTimeTicks = CalcAnimationTimeTicks(clip, Frame * FRAME_TIME);
+
+        for (const Channel& c : clip.Channels) {
+            if (c.NumPositionKeys > 1) {
+                Sum += FindKeyframeLinear(c.pPositionKeys, c.NumPositionKeys, AnimationTimeTicks);
+            }
+
+            if (c.NumRotationKeys > 1) {
+                Sum += FindKeyframeLinear(c.pRotationKeys, c.NumRotationKeys, AnimationTimeTicks);
+            }
+        }
+    }
+
+    Seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - Start).count();
+
+    return Sum;
+}
+
+
+static u64 RunCursor(const Clip& clip, uint NumFrames, double& Seconds)
+{
+    u64 Sum = 0;
+
+    std::vector<KeyframeCursor> Cursors(clip.Channels.size());
+
+    auto Start = std::chrono::high_resolution_clock::now();
+
+    for (uint Frame = 0 ; Frame < NumFrames ; Frame++) {
+        float AnimationTimeTicks = CalcAnimationTimeTicks(clip, Frame * FRAME_TIME);
+
+        for (uint i = 0 ; i < clip.Channels.size() ; i++) {
+            const Channel& c = clip.Channels[i];
+
+            if (c.NumPositionKeys > 1) {
+                Sum += FindKeyframe(c.pPositionKeys, c.NumPositionKeys, AnimationTimeTicks, Cursors[i].Position);
+            }
+
+            if (c.NumRotationKeys > 1) {
+                Sum += FindKeyframe(c.pRotationKeys, c.NumRotationKeys, AnimationTimeTicks, Cursors[i].Rotation);
+            }
+        }
+    }
+
+    Seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - Start).count();
+
+    return Sum;
+}
+
+
+static void Benchmark(const Clip& clip, uint NumFrames)
+{
+    uint NumSamples = 0;
+
+    for (const Channel& c : clip.Channels) {
+        NumSamples += (c.NumPositionKeys > 1) ? 1 : 0;
+        NumSamples += (c.NumRotationKeys > 1) ? 1 : 0;
+    }
+
+    double LinearTime = 0.0;
+    double CursorTime = 0.0;
+
+    u64 LinearSum = RunLinear(clip, NumFrames, LinearTime);
+    u64 CursorSum = RunCursor(clip, NumFrames, CursorTime);
+
+    double TotalSamples = (double)NumSamples * NumFrames;
+
+    printf("%s: %d channels, %d frames\n", clip.pName, (int)clip.Channels.size(), NumFrames);
+    printf("    linear: %8.2f ns/sample\n", LinearTime * 1e9 / TotalSamples);
+    printf("    cursor: %8.2f ns/sample\n", CursorTime * 1e9 / TotalSamples);
+    printf("    speedup %.2fx\n", LinearTime / CursorTime);
+
+    if (LinearSum != CursorSum) {
+        printf("Error! the samplers don't agree (%llu vs %llu)\n", (unsigned long long)LinearSum, (unsigned long long)CursorSum);
+        exit(1);
+    }
+}
+
+
+// A long motion capture style clip - every channel has a key on every tick
+static void BenchmarkSyntheticClip(uint NumChannels, uint NumKeys, uint NumFrames)
+{
+    std::vector<aiVectorKey> PositionKeys(NumKeys);
+    std::vector<aiQuatKey> RotationKeys(NumKeys);
+
+    for (uint i = 0 ; i < NumKeys ; i++) {
+        PositionKeys[i].mTime = (double)i;
+        PositionKeys[i].mValue = aiVector3D((float)i, 0.0f, 0.0f);
+        RotationKeys[i].mTime = (double)i;
+        RotationKeys[i].mValue = aiQuaternion();
+    }
+
+    Clip clip;
+    clip.pName = "synthetic";
+    clip.TicksPerSecond = 120.0f;
+    clip.Duration = (float)(NumKeys - 1);
+
+    // All the channels share the key arrays
+    Channel c;
+    c.pPositionKeys = PositionKeys.data();
+    c.NumPositionKeys = NumKeys;
+    c.pRotationKeys = RotationKeys.data();
+    c.NumRotationKeys = NumKeys;
+    clip.Channels.resize(NumChannels, c);
+
+    Benchmark(clip, NumFrames);
+}
+
+
+static void BenchmarkModel(const char* pFilename, uint NumFrames)
+{
+    Assimp::Importer Importer;
+
+    const aiScene* pScene = Importer.ReadFile(pFilename, 0);
+
+    if (!pScene) {
+        printf("Error parsing '%s': '%s'\n", pFilename, Importer.GetErrorString());
+        return;
+    }
+
+    for (uint i = 0 ; i < pScene->mNumAnimations ; i++) {
+        const aiAnimation* pAnimation = pScene->mAnimations[i];
+
+        Clip clip;
+        clip.pName = pFilename;
+        clip.TicksPerSecond = (pAnimation->mTicksPerSecond != 0) ? (float)pAnimation->mTicksPerSecond : 25.0f;
+        clip.Duration = (float)pAnimation->mDuration;
+
+        for (uint j = 0 ; j < pAnimation->mNumChannels ; j++) {
+            const aiNodeAnim* pNodeAnim = pAnimation->mChannels[j];
+
+            Channel c;
+            c.pPositionKeys = pNodeAnim->mPositionKeys;
+            c.NumPositionKeys = pNodeAnim->mNumPositionKeys;
+            c.pRotationKeys = pNodeAnim->mRotationKeys;
+            c.NumRotationKeys = pNodeAnim->mNumRotationKeys;
+            clip.Channels.push_back(c);
+        }
+
+        Benchmark(clip, NumFrames);
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    const char* pFilename = (argc > 1) ? argv[1] : MODEL_FILENAME;
+
+    BenchmarkModel(pFilename, 100000);
+
+    BenchmarkSyntheticClip(64, 20000, 20000);
+
+    return 0;
+}
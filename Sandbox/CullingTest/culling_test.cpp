@@ -0,0 +1,258 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    CPU tests of the bounding volumes and the view frustum in core_culling.cpp.
+    Also checks that the culling volume of every mesh of a rotated/translated
+    multi-mesh model uses the same transformation order as the draw path
+    (ObjectMatrix * MeshTransformation).
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "Int/core_culling.h"
+
+#define EPSILON 1e-4f
+
+static int NumFailures = 0;
+
+
+static void Check(bool Condition, const char* pName)
+{
+    printf("%-60s %s\n", pName, Condition ? "OK" : "FAILED");
+
+    if (!Condition) {
+        NumFailures++;
+    }
+}
+
+
+static bool IsEqual(const Vector3f& a, const Vector3f& b)
+{
+    return (fabsf(a.x - b.x) < EPSILON) && (fabsf(a.y - b.y) < EPSILON) && (fabsf(a.z - b.z) < EPSILON);
+}
+
+
+static bool IsInside(const BoundingVolume& Volume, const Vector3f& p)
+{
+    return (p.x >= Volume.Min.x - EPSILON) && (p.y >= Volume.Min.y - EPSILON) && (p.z >= Volume.Min.z - EPSILON) &&
+           (p.x <= Volume.Max.x + EPSILON) && (p.y <= Volume.Max.y + EPSILON) && (p.z <= Volume.Max.z + EPSILON);
+}
+
+
+static BoundingVolume MakeBox(const Vector3f& Center, float HalfSize)
+{
+    BoundingVolume Box;
+    Box.Add(Center - Vector3f(HalfSize, HalfSize, HalfSize));
+    Box.Add(Center + Vector3f(HalfSize, HalfSize, HalfSize));
+    return Box;
+}
+
+
+static void GetCorners(const BoundingVolume& Box, Vector3f Corners[8])
+{
+    for (int i = 0 ; i < 8 ; i++) {
+        Corners[i] = Vector3f((i & 1) ? Box.Max.x : Box.Min.x,
+                              (i & 2) ? Box.Max.y : Box.Min.y,
+                              (i & 4) ? Box.Max.z : Box.Min.z);
+    }
+}
+
+
+// Camera at the origin looking down +Z so the view matrix is the identity
+static Matrix4f GetViewProj()
+{
+    PersProjInfo persProjInfo = { 30.0f, 1000.0f, 1000.0f, 1.0f, 100.0f };
+
+    Matrix4f Projection;
+    Projection.InitPersProjTransform(persProjInfo);
+
+    return Projection;
+}
+
+
+static void TestBoundingVolume()
+{
+    printf("\nBoundingVolume\n");
+
+    BoundingVolume Empty;
+    Check(!Empty.IsValid(), "default volume is empty");
+
+    BoundingVolume Box = MakeBox(Vector3f(1.0f, 2.0f, 3.0f), 1.0f);
+    Check(Box.IsValid(), "box is valid");
+    Check(IsEqual(Box.GetCenter(), Vector3f(1.0f, 2.0f, 3.0f)), "box center");
+    Check(IsEqual(Box.GetExtents(), Vector3f(1.0f, 1.0f, 1.0f)), "box extents");
+
+    BoundingVolume Union = Empty;
+    Union.Add(Box);
+    Check(IsEqual(Union.Min, Box.Min) && IsEqual(Union.Max, Box.Max), "empty volume + box == box");
+
+    Matrix4f Translation;
+    Translation.InitTranslationTransform(10.0f, 0.0f, -5.0f);
+    BoundingVolume Moved = Box.Transform(Translation);
+    Check(IsEqual(Moved.Min, Vector3f(10.0f, 1.0f, -3.0f)) && IsEqual(Moved.Max, Vector3f(12.0f, 3.0f, -1.0f)),
+          "translated box");
+
+    // A unit cube rotated by 45 degrees around Y grows to sqrt(2) along X and Z
+    Matrix4f Rotation;
+    Rotation.InitRotateTransform(0.0f, 45.0f, 0.0f);
+    BoundingVolume Rotated = MakeBox(Vector3f(0.0f, 0.0f, 0.0f), 1.0f).Transform(Rotation);
+    float s = sqrtf(2.0f);
+    Check(IsEqual(Rotated.Min, Vector3f(-s, -1.0f, -s)) && IsEqual(Rotated.Max, Vector3f(s, 1.0f, s)),
+          "rotated box");
+
+    Check(!Empty.Transform(Translation).IsValid(), "transformed empty volume stays empty");
+}
+
+
+static void TestFrustum()
+{
+    printf("\nViewFrustum\n");
+
+    ViewFrustum Frustum(GetViewProj());
+
+    BoundingVolume Inside = MakeBox(Vector3f(0.0f, 0.0f, 20.0f), 1.0f);
+    Check(Frustum.IsVisible(Inside), "inside box is visible");
+    Check(Frustum.ClassifyBox(Inside) == FRUSTUM_INSIDE, "inside box is classified as inside");
+
+    BoundingVolume OutsideLeft = MakeBox(Vector3f(-30.0f, 0.0f, 20.0f), 1.0f);
+    BoundingVolume OutsideTop = MakeBox(Vector3f(0.0f, 30.0f, 20.0f), 1.0f);
+    BoundingVolume Behind = MakeBox(Vector3f(0.0f, 0.0f, -20.0f), 1.0f);
+    BoundingVolume BeyondFar = MakeBox(Vector3f(0.0f, 0.0f, 120.0f), 1.0f);
+    Check(!Frustum.IsVisible(OutsideLeft), "box left of the frustum is culled");
+    Check(!Frustum.IsVisible(OutsideTop), "box above the frustum is culled");
+    Check(!Frustum.IsVisible(Behind), "box behind the camera is culled");
+    Check(!Frustum.IsVisible(BeyondFar), "box beyond the far plane is culled");
+    Check(Frustum.ClassifyBox(OutsideLeft) == FRUSTUM_OUTSIDE, "outside box is classified as outside");
+
+    // tan(15) * 20 = 5.36 so a box centered at x = 5.36 straddles the side plane
+    BoundingVolume StraddleSide = MakeBox(Vector3f(5.36f, 0.0f, 20.0f), 1.0f);
+    BoundingVolume StraddleNear = MakeBox(Vector3f(0.0f, 0.0f, 1.0f), 0.5f);
+    BoundingVolume StraddleFar = MakeBox(Vector3f(0.0f, 0.0f, 100.0f), 1.0f);
+    Check(Frustum.IsVisible(StraddleSide), "box straddling a side plane is visible");
+    Check(Frustum.IsVisible(StraddleNear), "box straddling the near plane is visible");
+    Check(Frustum.IsVisible(StraddleFar), "box straddling the far plane is visible");
+    Check(Frustum.ClassifyBox(StraddleSide) == FRUSTUM_INTERSECTS, "straddling box is classified as intersecting");
+
+    // Local space box which is outside until the world matrix moves it in
+    Matrix4f World;
+    World.InitTranslationTransform(30.0f, 0.0f, 0.0f);
+    Check(Frustum.IsVisible(OutsideLeft, World), "transformed box is visible");
+    Check(!Frustum.IsVisible(Inside, World), "transformed box is culled");
+
+    CullingStats Stats;
+    Frustum.IsVisible(OutsideLeft, World, Stats);
+    Frustum.IsVisible(Inside, World, Stats);
+    Check((Stats.NumVisible == 1) && (Stats.NumCulled == 1), "culling stats");
+
+    Check(Frustum.IsVisible(BoundingVolume()), "empty volume is never culled");
+}
+
+
+// A model with two meshes in different nodes, placed in the world by a rotated and
+// translated scene object. The vertex shader computes WVP * Pos where WVP is
+// ViewProj * ObjectMatrix * MeshTransformation so the culling volumes must use the
+// same order.
+static void TestMultiMeshModel()
+{
+    printf("\nRotated/translated multi mesh model\n");
+
+    enum { NUM_MESHES = 2 };
+
+    BoundingVolume MeshBounds[NUM_MESHES] = { MakeBox(Vector3f(0.0f, 0.0f, 0.0f), 1.0f),
+                                              MakeBox(Vector3f(0.0f, 1.0f, 0.0f), 0.5f) };
+
+    Matrix4f MeshTransformations[NUM_MESHES];
+    MeshTransformations[0].InitTranslationTransform(10.0f, 0.0f, 0.0f);
+
+    Matrix4f NodeRotation, NodeTranslation;
+    NodeRotation.InitRotateTransform(0.0f, 0.0f, 30.0f);
+    NodeTranslation.InitTranslationTransform(0.0f, 3.0f, 0.0f);
+    MeshTransformations[1] = NodeTranslation * NodeRotation;
+
+    // Same as CoreModel::CalcModelBounds
+    BoundingVolume ModelBounds;
+
+    for (int i = 0 ; i < NUM_MESHES ; i++) {
+        ModelBounds.Add(MeshBounds[i].Transform(MeshTransformations[i]));
+    }
+
+    // Rotating by 90 degrees around Y moves the mesh at +X in front of the camera.
+    // In the wrong order (MeshTransformation * ObjectMatrix) it stays at x = 10
+    // which is outside the frustum.
+    Matrix4f ObjectRotation, ObjectTranslation;
+    ObjectRotation.InitRotateTransform(0.0f, 90.0f, 0.0f);
+    ObjectTranslation.InitTranslationTransform(0.0f, 0.0f, 30.0f);
+    Matrix4f ObjectMatrix = ObjectTranslation * ObjectRotation;
+
+    Matrix4f ViewProj = GetViewProj();
+    ViewFrustum Frustum(ViewProj);
+
+    BoundingVolume WorldModelBounds = ModelBounds.Transform(ObjectMatrix);
+
+    for (int i = 0 ; i < NUM_MESHES ; i++) {
+        Matrix4f World = ObjectMatrix * MeshTransformations[i];
+        BoundingVolume WorldMeshBounds = MeshBounds[i].Transform(World);
+
+        Vector3f Corners[8];
+        GetCorners(MeshBounds[i], Corners);
+
+        bool InsideMeshBounds = true;
+        bool InsideModelBounds = true;
+        bool InsideClipSpace = false;
+
+        for (int j = 0 ; j < 8 ; j++) {
+            Vector4f WorldPos = World * Vector4f(Corners[j], 1.0f);
+            InsideMeshBounds = InsideMeshBounds && IsInside(WorldMeshBounds, WorldPos.to3f());
+            InsideModelBounds = InsideModelBounds && IsInside(WorldModelBounds, WorldPos.to3f());
+
+            Vector4f ClipPos = ViewProj * WorldPos;
+            InsideClipSpace = InsideClipSpace ||
+                              ((fabsf(ClipPos.x) <= ClipPos.w) && (fabsf(ClipPos.y) <= ClipPos.w) && (fabsf(ClipPos.z) <= ClipPos.w));
+        }
+
+        char Name[64];
+        snprintf(Name, sizeof(Name), "mesh %d vertices are inside the mesh culling volume", i);
+        Check(InsideMeshBounds, Name);
+        snprintf(Name, sizeof(Name), "mesh %d vertices are inside the model culling volume", i);
+        Check(InsideModelBounds, Name);
+        snprintf(Name, sizeof(Name), "mesh %d culling matches clip space", i);
+        Check(Frustum.IsVisible(MeshBounds[i], World) == InsideClipSpace, Name);
+    }
+
+    Matrix4f WrongWorld = MeshTransformations[0] * ObjectMatrix;
+    Check(Frustum.IsVisible(MeshBounds[0], ObjectMatrix * MeshTransformations[0]) &&
+          !Frustum.IsVisible(MeshBounds[0], WrongWorld), "mesh 0 is only visible in the draw order");
+}
+
+
+int main(int argc, char* argv[])
+{
+    TestBoundingVolume();
+    TestFrustum();
+    TestMultiMeshModel();
+
+    if (NumFailures > 0) {
+        printf("\n%d checks failed\n", NumFailures);
+        return 1;
+    }
+
+    printf("\nAll checks passed\n");
+
+    return 0;
+}
@@ -0,0 +1,454 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Times the heightmap generators in ogldev_heightmap_generators.cpp against the
+    original serial code of MidpointDispTerrain and FaultFormationTerrain, checks
+    that the output does not depend on the number of threads and that the fault
+    ranges match the original per cell test.
+
+    Also times the normals and the batch height queries of ogldev_heightmap_sampling.cpp
+    against the per triangle normals of GeomipGrid and BaseTerrain::GetHeightInterpolated.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "ogldev_math_3d.h"
+#include "ogldev_array_2d.h"
+#include "ogldev_counter_rng.h"
+#include "ogldev_heightmap_generators.h"
+#include "ogldev_heightmap_sampling.h"
+
+#define ROUGHNESS 1.0f
+#define FAULT_ITERATIONS 200
+#define FAULT_FILTER 0.5f
+#define SEED 1234
+
+// Also compared against an odd number of threads so the bands don't line up with the cores
+#define ODD_NUM_THREADS 7
+
+// The original fault formation tests every cell in every iteration. Beyond this
+// size it takes minutes.
+#define MAX_SERIAL_FAULT_SIZE 2049
+
+#define NORMALS_SIZE 4097
+#define WORLD_SCALE 4.0f
+#define NUM_QUERIES (1024 * 1024)
+
+
+/////////////////////////////////////
+// The original serial code
+/////////////////////////////////////
+
+static void DiamondStepSerial(Array2D<float>& HeightMap, int Size, int RectSize, float CurHeight)
+{
+    int HalfRectSize = RectSize / 2;
+
+    for (int y = 0 ; y < Size ; y += RectSize) {
+        for (int x = 0 ; x < Size ; x += RectSize) {
+            int next_x = (x + RectSize) % Size;
+            int next_y = (y + RectSize) % Size;
+
+            if (next_x < x) {
+                next_x = Size - 1;
+            }
+
+            if (next_y < y) {
+                next_y = Size - 1;
+            }
+
+            float TopLeft     = HeightMap.Get(x, y);
+            float TopRight    = HeightMap.Get(next_x, y);
+            float BottomLeft  = HeightMap.Get(x, next_y);
+            float BottomRight = HeightMap.Get(next_x, next_y);
+
+            int mid_x = (x + HalfRectSize) % Size;
+            int mid_y = (y + HalfRectSize) % Size;
+
+            float RandValue = RandomFloatRange(-CurHeight, CurHeight);
+            float MidPoint = (TopLeft + TopRight + BottomLeft + BottomRight) / 4.0f;
+
+            HeightMap.Set(mid_x, mid_y, MidPoint + RandValue);
+        }
+    }
+}
+
+
+static void SquareStepSerial(Array2D<float>& HeightMap, int Size, int RectSize, float CurHeight)
+{
+    int HalfRectSize = RectSize / 2;
+
+    for (int y = 0 ; y < Size ; y += RectSize) {
+        for (int x = 0 ; x < Size ; x += RectSize) {
+            int next_x = (x + RectSize) % Size;
+            int next_y = (y + RectSize) % Size;
+
+            if (next_x < x) {
+                next_x = Size - 1;
+            }
+
+            if (next_y < y) {
+                next_y = Size - 1;
+            }
+
+            int mid_x = (x + HalfRectSize) % Size;
+            int mid_y = (y + HalfRectSize) % Size;
+
+            int prev_mid_x = (x - HalfRectSize + Size) % Size;
+            int prev_mid_y = (y - HalfRectSize + Size) % Size;
+
+            float CurTopLeft  = HeightMap.Get(x, y);
+            float CurTopRight = HeightMap.Get(next_x, y);
+            float CurCenter   = HeightMap.Get(mid_x, mid_y);
+            float PrevYCenter = HeightMap.Get(mid_x, prev_mid_y);
+            float CurBotLeft  = HeightMap.Get(x, next_y);
+            float PrevXCenter = HeightMap.Get(prev_mid_x, mid_y);
+
+            float CurLeftMid = (CurTopLeft + CurCenter + CurBotLeft + PrevXCenter) / 4.0f + RandomFloatRange(-CurHeight, CurHeight);
+            float CurTopMid  = (CurTopLeft + CurCenter + CurTopRight + PrevYCenter) / 4.0f + RandomFloatRange(-CurHeight, CurHeight);
+
+            HeightMap.Set(mid_x, y, CurTopMid);
+            HeightMap.Set(x, mid_y, CurLeftMid);
+        }
+    }
+}
+
+
+static void MidpointDisplacementSerial(Array2D<float>& HeightMap, int Size, float Roughness)
+{
+    HeightMap.InitArray2D(Size, Size, 0.0f);
+
+    int RectSize = CalcNextPowerOfTwo(Size);
+    float CurHeight = (float)RectSize / 2.0f;
+    float HeightReduce = pow(2.0f, -Roughness);
+
+    while (RectSize > 0) {
+        DiamondStepSerial(HeightMap, Size, RectSize, CurHeight);
+        SquareStepSerial(HeightMap, Size, RectSize, CurHeight);
+        RectSize /= 2;
+        CurHeight *= HeightReduce;
+    }
+}
+
+
+static float FIRFilterSinglePoint(Array2D<float>& HeightMap, int x, int z, float PrevVal, float Filter)
+{
+    float CurVal = HeightMap.Get(x, z);
+    float NewVal = Filter * PrevVal + (1 - Filter) * CurVal;
+    HeightMap.Set(x, z, NewVal);
+    return NewVal;
+}
+
+
+static void ApplyFIRFilterSerial(Array2D<float>& HeightMap, int Size, float Filter)
+{
+    for (int z = 0 ; z < Size ; z++) {
+        float PrevVal = HeightMap.Get(0, z);
+        for (int x = 1 ; x < Size ; x++) {
+            PrevVal = FIRFilterSinglePoint(HeightMap, x, z, PrevVal, Filter);
+        }
+    }
+
+    for (int z = 0 ; z < Size ; z++) {
+        float PrevVal = HeightMap.Get(Size - 1, z);
+        for (int x = Size - 2 ; x >= 0 ; x--) {
+            PrevVal = FIRFilterSinglePoint(HeightMap, x, z, PrevVal, Filter);
+        }
+    }
+
+    for (int x = 0 ; x < Size ; x++) {
+        float PrevVal = HeightMap.Get(x, 0);
+        for (int z = 1 ; z < Size ; z++) {
+            PrevVal = FIRFilterSinglePoint(HeightMap, x, z, PrevVal, Filter);
+        }
+    }
+
+    for (int x = 0 ; x < Size ; x++) {
+        float PrevVal = HeightMap.Get(x, Size - 1);
+        for (int z = Size - 2 ; z >= 0 ; z--) {
+            PrevVal = FIRFilterSinglePoint(HeightMap, x, z, PrevVal, Filter);
+        }
+    }
+}
+
+
+// Same fault lines as GenerateFaultFormation() so the results can be compared
+static void GenFault(const CounterRNG& Rng, int Size, int CurIter, int& x1, int& z1, int& x2, int& z2)
+{
+    unsigned long long Counter = (unsigned long long)CurIter << 32;
+
+    do {
+        x1 = Rng.GetUInt(Counter++) % Size;
+        z1 = Rng.GetUInt(Counter++) % Size;
+        x2 = Rng.GetUInt(Counter++) % Size;
+        z2 = Rng.GetUInt(Counter++) % Size;
+    } while ((x1 == x2) && (z1 == z2));
+}
+
+
+static void FaultFormationSerial(Array2D<float>& HeightMap, int Size, int Iterations, float MinHeight, float MaxHeight, float Filter)
+{
+    HeightMap.InitArray2D(Size, Size, 0.0f);
+
+    CounterRNG Rng(SEED);
+    float DeltaHeight = MaxHeight - MinHeight;
+
+    for (int CurIter = 0 ; CurIter < Iterations ; CurIter++) {
+        float IterationRatio = ((float)CurIter / (float)Iterations);
+        float Height = MaxHeight - IterationRatio * DeltaHeight;
+
+        int x1, z1, x2, z2;
+        GenFault(Rng, Size, CurIter, x1, z1, x2, z2);
+
+        int DirX = x2 - x1;
+        int DirZ = z2 - z1;
+
+        for (int z = 0 ; z < Size ; z++) {
+            for (int x = 0 ; x < Size ; x++) {
+                int DirX_in = x - x1;
+                int DirZ_in = z - z1;
+
+                int CrossProduct = DirX_in * DirZ - DirX * DirZ_in;
+
+                if (CrossProduct > 0) {
+                    float CurHeight = HeightMap.Get(x, z);
+                    HeightMap.Set(x, z, CurHeight + Height);
+                }
+            }
+        }
+    }
+
+    ApplyFIRFilterSerial(HeightMap, Size, Filter);
+}
+
+
+// Accumulates the normalized normals of the two triangles of every cell like
+// GeomipGrid::CalcNormals did with the LOD 0 indices
+static void CalcNormalsPerTriangle(const Array2D<float>& HeightMap, float WorldScale, std::vector<Vector3f>& Normals)
+{
+    int Size = HeightMap.GetWidth();
+
+    Normals.assign(HeightMap.GetSize(), Vector3f(0.0f, 0.0f, 0.0f));
+
+    for (int z = 0 ; z < Size - 1 ; z++) {
+        for (int x = 0 ; x < Size - 1 ; x++) {
+            int Index[4] = { z * Size + x, (z + 1) * Size + x, (z + 1) * Size + x + 1, z * Size + x + 1 };
+            Vector3f Pos[4] = { Vector3f(x * WorldScale, HeightMap.Get(x, z), z * WorldScale),
+                                Vector3f(x * WorldScale, HeightMap.Get(x, z + 1), (z + 1) * WorldScale),
+                                Vector3f((x + 1) * WorldScale, HeightMap.Get(x + 1, z + 1), (z + 1) * WorldScale),
+                                Vector3f((x + 1) * WorldScale, HeightMap.Get(x + 1, z), z * WorldScale) };
+
+            for (int t = 0 ; t < 2 ; t++) {
+                int i0 = 0, i1 = t + 1, i2 = t + 2;
+                Vector3f Normal = (Pos[i1] - Pos[i0]).Cross(Pos[i2] - Pos[i0]);
+                Normal.Normalize();
+
+                Normals[Index[i0]] += Normal;
+                Normals[Index[i1]] += Normal;
+                Normals[Index[i2]] += Normal;
+            }
+        }
+    }
+
+    for (Vector3f& n : Normals) {
+        n.Normalize();
+    }
+}
+
+
+// Same as BaseTerrain::GetHeightInterpolated plus the clamping of GetHeightsAndNormals
+static float GetHeightInterpolatedSerial(const Array2D<float>& HeightMap, float x, float z)
+{
+    int Max = HeightMap.GetWidth() - 1;
+
+    x = std::min(std::max(x, 0.0f), (float)Max);
+    z = std::min(std::max(z, 0.0f), (float)Max);
+
+    int x0 = std::min((int)x, Max - 1);
+    int z0 = std::min((int)z, Max - 1);
+
+    float FactorX = x - (float)x0;
+    float FactorZ = z - (float)z0;
+
+    float Bottom = (HeightMap.Get(x0 + 1, z0) - HeightMap.Get(x0, z0)) * FactorX + HeightMap.Get(x0, z0);
+    float Top = (HeightMap.Get(x0 + 1, z0 + 1) - HeightMap.Get(x0, z0 + 1)) * FactorX + HeightMap.Get(x0, z0 + 1);
+
+    return (Top - Bottom) * FactorZ + Bottom;
+}
+
+
+/////////////////////////////////////
+// Checks and timing
+/////////////////////////////////////
+
+template<typename Func>
+static double TimeMS(const Func& f)
+{
+    auto Start = std::chrono::high_resolution_clock::now();
+    f();
+    auto End = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(End - Start).count();
+}
+
+
+static bool IsEqual(const Array2D<float>& a, const Array2D<float>& b)
+{
+    return (a.GetSize() == b.GetSize()) && (memcmp(a.GetBaseAddr(), b.GetBaseAddr(), a.GetSizeInBytes()) == 0);
+}
+
+
+static float MaxRelError(const Array2D<float>& a, const Array2D<float>& b)
+{
+    float MaxError = 0.0f;
+    float MaxValue = 1.0f;
+
+    for (int i = 0 ; i < a.GetSize() ; i++) {
+        MaxError = std::max(MaxError, fabsf(a.Get(i) - b.Get(i)));
+        MaxValue = std::max(MaxValue, fabsf(a.Get(i)));
+    }
+
+    return MaxError / MaxValue;
+}
+
+
+int main(int argc, char* argv[])
+{
+    int NumThreads = std::max((int)std::thread::hardware_concurrency(), 1);
+    int Sizes[] = { 257, 513, 1025, 2049, 4097, 8193 };
+    bool Ok = true;
+
+    printf("%d threads\n\n", NumThreads);
+
+    printf("Midpoint displacement (roughness %.1f)\n", ROUGHNESS);
+    printf("%6s %12s %12s %12s %9s %s\n", "size", "serial ms", "1 thread ms", "all ms", "speedup", "deterministic");
+
+    for (int Size : Sizes) {
+        Array2D<float> Serial, Single, Parallel, Odd;
+
+        srand(SEED);
+        double SerialTime = TimeMS([&]() { MidpointDisplacementSerial(Serial, Size, ROUGHNESS); });
+        double SingleTime = TimeMS([&]() { GenerateMidpointDisplacement(Single, Size, ROUGHNESS, SEED, 1); });
+        double ParallelTime = TimeMS([&]() { GenerateMidpointDisplacement(Parallel, Size, ROUGHNESS, SEED, NumThreads); });
+
+        GenerateMidpointDisplacement(Odd, Size, ROUGHNESS, SEED, ODD_NUM_THREADS);
+
+        bool Deterministic = IsEqual(Single, Parallel) && IsEqual(Single, Odd);
+        Ok = Ok && Deterministic;
+
+        printf("%6d %12.2f %12.2f %12.2f %8.1fx %s\n", Size, SerialTime, SingleTime, ParallelTime,
+               SerialTime / ParallelTime, Deterministic ? "yes" : "NO");
+    }
+
+    printf("\nFault formation (%d iterations, filter %.1f)\n", FAULT_ITERATIONS, FAULT_FILTER);
+    printf("%6s %12s %12s %12s %9s %s\n", "size", "serial ms", "1 thread ms", "all ms", "speedup", "deterministic / rel error");
+
+    for (int Size : Sizes) {
+        Array2D<float> Serial, Single, Parallel, Odd;
+
+        double SingleTime = TimeMS([&]() { GenerateFaultFormation(Single, Size, FAULT_ITERATIONS, 0.0f, 300.0f, FAULT_FILTER, SEED, 1); });
+        double ParallelTime = TimeMS([&]() { GenerateFaultFormation(Parallel, Size, FAULT_ITERATIONS, 0.0f, 300.0f, FAULT_FILTER, SEED, NumThreads); });
+
+        GenerateFaultFormation(Odd, Size, FAULT_ITERATIONS, 0.0f, 300.0f, FAULT_FILTER, SEED, ODD_NUM_THREADS);
+
+        bool Deterministic = IsEqual(Single, Parallel) && IsEqual(Single, Odd);
+        Ok = Ok && Deterministic;
+
+        if (Size > MAX_SERIAL_FAULT_SIZE) {
+            printf("%6d %12s %12.2f %12.2f %9s %s\n", Size, "-", SingleTime, ParallelTime, "-", Deterministic ? "yes" : "NO");
+            continue;
+        }
+
+        double SerialTime = TimeMS([&]() { FaultFormationSerial(Serial, Size, FAULT_ITERATIONS, 0.0f, 300.0f, FAULT_FILTER); });
+
+        // The faults are summed in a different order so the floats are not identical
+        float Error = MaxRelError(Serial, Parallel);
+        Ok = Ok && (Error < 1e-5f);
+
+        printf("%6d %12.2f %12.2f %12.2f %8.1fx %s / %g\n", Size, SerialTime, SingleTime, ParallelTime,
+               SerialTime / ParallelTime, Deterministic ? "yes" : "NO", Error);
+    }
+
+    printf("\nNormals (size %d)\n", NORMALS_SIZE);
+
+    Array2D<float> HeightMap;
+    GenerateMidpointDisplacement(HeightMap, NORMALS_SIZE, ROUGHNESS, SEED);
+    HeightMap.Normalize(0.0f, 600.0f);
+
+    std::vector<Vector3f> TriangleNormals, Single(HeightMap.GetSize()), Parallel(HeightMap.GetSize());
+
+    double TriangleTime = TimeMS([&]() { CalcNormalsPerTriangle(HeightMap, WORLD_SCALE, TriangleNormals); });
+    double SingleTime = TimeMS([&]() { CalcHeightMapNormals(HeightMap, WORLD_SCALE, Single.data(), 1); });
+    double ParallelTime = TimeMS([&]() { CalcHeightMapNormals(HeightMap, WORLD_SCALE, Parallel.data(), NumThreads); });
+
+    // Different methods so the normals are only expected to be close
+    double SumDot = 0.0;
+    bool Deterministic = (memcmp(Single.data(), Parallel.data(), sizeof(Vector3f) * Single.size()) == 0);
+
+    for (size_t i = 0 ; i < Single.size() ; i++) {
+        SumDot += Single[i].Dot(TriangleNormals[i]);
+    }
+
+    float AvgDot = (float)(SumDot / Single.size());
+    Ok = Ok && Deterministic && (AvgDot > 0.99f);
+
+    printf("per triangle %.2f ms, central differences 1 thread %.2f ms, all %.2f ms (%.1fx), deterministic %s, average dot %f\n",
+           TriangleTime, SingleTime, ParallelTime, TriangleTime / ParallelTime, Deterministic ? "yes" : "NO", AvgDot);
+
+    printf("\nHeight queries (%d)\n", NUM_QUERIES);
+
+    std::vector<Vector2f> Positions(NUM_QUERIES);
+    CounterRNG Rng(SEED);
+    float WorldSize = (NORMALS_SIZE - 1) * WORLD_SCALE;
+
+    for (int i = 0 ; i < NUM_QUERIES ; i++) {
+        Positions[i].x = Rng.GetFloatRange(i * 2, -10.0f, WorldSize + 10.0f);
+        Positions[i].y = Rng.GetFloatRange(i * 2 + 1, -10.0f, WorldSize + 10.0f);
+    }
+
+    std::vector<float> SerialHeights(NUM_QUERIES), BatchHeights(NUM_QUERIES);
+    std::vector<Vector3f> BatchNormals(NUM_QUERIES);
+
+    double SerialQueryTime = TimeMS([&]() {
+        for (int i = 0 ; i < NUM_QUERIES ; i++) {
+            SerialHeights[i] = GetHeightInterpolatedSerial(HeightMap, Positions[i].x / WORLD_SCALE, Positions[i].y / WORLD_SCALE);
+        }
+    });
+
+    double BatchTime = TimeMS([&]() { GetHeightsAndNormals(HeightMap, WORLD_SCALE, NUM_QUERIES, Positions.data(), BatchHeights.data(), NULL); });
+    double BatchNormalsTime = TimeMS([&]() { GetHeightsAndNormals(HeightMap, WORLD_SCALE, NUM_QUERIES, Positions.data(), BatchHeights.data(), BatchNormals.data()); });
+
+    float MaxError = 0.0f;
+
+    for (int i = 0 ; i < NUM_QUERIES ; i++) {
+        MaxError = std::max(MaxError, fabsf(SerialHeights[i] - BatchHeights[i]));
+    }
+
+    Ok = Ok && (MaxError < 1e-3f);
+
+    printf("one at a time %.2f ms, batch %.2f ms, batch with normals %.2f ms, max height difference %g\n",
+           SerialQueryTime, BatchTime, BatchNormalsTime, MaxError);
+
+    printf("\n%s\n", Ok ? "PASSED" : "FAILED");
+
+    return Ok ? 0 : 1;
+}
@@ -0,0 +1,347 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Checks the Matrix4f operations that go through ogldev_simd.h against the
+    original scalar code and reports ns/op for both.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "ogldev_math_3d.h"
+
+#define NUM_MATRICES 1024
+#define NUM_VECTORS 4096
+#define NUM_ITERATIONS 200
+
+// Allowed difference relative to the magnitude of the values
+#define MAX_REL_ERROR 1e-5f
+
+// M * Inverse(M) accumulates the rounding of both matrices (the translations are up to 100)
+#define MAX_INVERSE_ERROR 1e-4f
+
+
+/////////////////////////////////////
+// The original scalar code
+/////////////////////////////////////
+
+static Matrix4f MultiplyScalar(const Matrix4f& l, const Matrix4f& r)
+{
+    Matrix4f Ret;
+
+    for (unsigned int i = 0 ; i < 4 ; i++) {
+        for (unsigned int j = 0 ; j < 4 ; j++) {
+            Ret.m[i][j] = l.m[i][0] * r.m[0][j] +
+                          l.m[i][1] * r.m[1][j] +
+                          l.m[i][2] * r.m[2][j] +
+                          l.m[i][3] * r.m[3][j];
+        }
+    }
+
+    return Ret;
+}
+
+
+static Vector4f TransformScalar(const Matrix4f& m, const Vector4f& v)
+{
+    Vector4f r;
+
+    r.x = m.m[0][0]* v.x + m.m[0][1]* v.y + m.m[0][2]* v.z + m.m[0][3]* v.w;
+    r.y = m.m[1][0]* v.x + m.m[1][1]* v.y + m.m[1][2]* v.z + m.m[1][3]* v.w;
+    r.z = m.m[2][0]* v.x + m.m[2][1]* v.y + m.m[2][2]* v.z + m.m[2][3]* v.w;
+    r.w = m.m[3][0]* v.x + m.m[3][1]* v.y + m.m[3][2]* v.z + m.m[3][3]* v.w;
+
+    return r;
+}
+
+
+static Matrix4f TransposeScalar(const Matrix4f& m)
+{
+    Matrix4f n;
+
+    for (unsigned int i = 0 ; i < 4 ; i++) {
+        for (unsigned int j = 0 ; j < 4 ; j++) {
+            n.m[i][j] = m.m[j][i];
+        }
+    }
+
+    return n;
+}
+
+
+/////////////////////////////////////
+// Test data
+/////////////////////////////////////
+
+// Random translation * rotation * scale
+static Matrix4f RandomAffineMatrix()
+{
+    Matrix4f Translation, Rotation, Scale;
+    Translation.InitTranslationTransform(RandomFloatRange(-100.0f, 100.0f), RandomFloatRange(-100.0f, 100.0f), RandomFloatRange(-100.0f, 100.0f));
+    Rotation.InitRotateTransform(RandomFloatRange(0.0f, 360.0f), RandomFloatRange(0.0f, 360.0f), RandomFloatRange(0.0f, 360.0f));
+    Scale.InitScaleTransform(RandomFloatRange(0.5f, 2.0f), RandomFloatRange(0.5f, 2.0f), RandomFloatRange(0.5f, 2.0f));
+
+    return MultiplyScalar(Translation, MultiplyScalar(Rotation, Scale));
+}
+
+
+static float MaxRelError(const float* a, const float* b, int Count)
+{
+    float MaxError = 0.0f;
+
+    for (int i = 0 ; i < Count ; i++) {
+        float Error = fabsf(a[i] - b[i]) / std::max(1.0f, fabsf(b[i]));
+        MaxError = std::max(MaxError, Error);
+    }
+
+    return MaxError;
+}
+
+
+static int NumFailures = 0;
+
+static void Check(const char* pName, float MaxError, float MaxAllowedError = MAX_REL_ERROR)
+{
+    bool OK = (MaxError <= MaxAllowedError);
+
+    printf("%-22s max rel error %g %s\n", pName, MaxError, OK ? "OK" : "FAILED");
+
+    if (!OK) {
+        NumFailures++;
+    }
+}
+
+
+/////////////////////////////////////
+// Timing
+/////////////////////////////////////
+
+static float Checksum = 0.0f;     // keeps the optimizer from removing the benchmarked code
+
+template<typename Func>
+static double MeasureNsPerOp(int NumOps, Func f)
+{
+    auto Start = std::chrono::high_resolution_clock::now();
+
+    for (int i = 0 ; i < NUM_ITERATIONS ; i++) {
+        f();
+    }
+
+    auto End = std::chrono::high_resolution_clock::now();
+
+    double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(End - Start).count();
+
+    return ns / ((double)NUM_ITERATIONS * NumOps);
+}
+
+
+static void Report(const char* pName, double ScalarNs, double SimdNs)
+{
+    printf("%-22s scalar %7.2f ns/op   simd %7.2f ns/op   (%.2fx)\n", pName, ScalarNs, SimdNs, ScalarNs / SimdNs);
+}
+
+
+int main(int argc, char* argv[])
+{
+#if defined(OGLDEV_SIMD_SSE)
+    printf("Backend: SSE\n\n");
+#elif defined(OGLDEV_SIMD_NEON)
+    printf("Backend: NEON\n\n");
+#else
+    printf("Backend: scalar\n\n");
+#endif
+
+    srand(1);
+
+    std::vector<Matrix4f> Matrices(NUM_MATRICES);
+    std::vector<Matrix4f> Results(NUM_MATRICES);
+    std::vector<Matrix4f> ScalarResults(NUM_MATRICES);
+
+    for (int i = 0 ; i < NUM_MATRICES ; i++) {
+        Matrices[i] = RandomAffineMatrix();
+    }
+
+    std::vector<Vector4f> Vectors(NUM_VECTORS);
+    std::vector<Vector4f> VecResults(NUM_VECTORS);
+    std::vector<Vector4f> ScalarVecResults(NUM_VECTORS);
+
+    for (int i = 0 ; i < NUM_VECTORS ; i++) {
+        Vectors[i] = Vector4f(RandomFloatRange(-10.0f, 10.0f), RandomFloatRange(-10.0f, 10.0f), RandomFloatRange(-10.0f, 10.0f), 1.0f);
+    }
+
+    //
+    // Correctness
+    //
+    float MaxError = 0.0f;
+
+    for (int i = 0 ; i < NUM_MATRICES ; i++) {
+        const Matrix4f& a = Matrices[i];
+        const Matrix4f& b = Matrices[(i + 1) % NUM_MATRICES];
+        Matrix4f Simd = a * b;
+        Matrix4f Scalar = MultiplyScalar(a, b);
+        MaxError = std::max(MaxError, MaxRelError(&Simd.m[0][0], &Scalar.m[0][0], 16));
+    }
+
+    Check("Multiply", MaxError);
+
+    MaxError = 0.0f;
+
+    for (int i = 0 ; i < NUM_MATRICES ; i++) {
+        Matrix4f Simd = Matrices[i].Transpose();
+        Matrix4f Scalar = TransposeScalar(Matrices[i]);
+        MaxError = std::max(MaxError, MaxRelError(&Simd.m[0][0], &Scalar.m[0][0], 16));
+    }
+
+    Check("Transpose", MaxError);
+
+    MaxError = 0.0f;
+
+    for (int i = 0 ; i < NUM_VECTORS ; i++) {
+        const Matrix4f& m = Matrices[i % NUM_MATRICES];
+        Vector4f Simd = m * Vectors[i];
+        Vector4f Scalar = TransformScalar(m, Vectors[i]);
+        MaxError = std::max(MaxError, MaxRelError(&Simd.x, &Scalar.x, 4));
+    }
+
+    Check("Transform", MaxError);
+
+    Matrices[0].TransformVectors(Vectors.data(), VecResults.data(), NUM_VECTORS);
+
+    MaxError = 0.0f;
+
+    for (int i = 0 ; i < NUM_VECTORS ; i++) {
+        Vector4f Scalar = TransformScalar(Matrices[0], Vectors[i]);
+        MaxError = std::max(MaxError, MaxRelError(&VecResults[i].x, &Scalar.x, 4));
+    }
+
+    Check("TransformVectors", MaxError);
+
+    MaxError = 0.0f;
+
+    // The inverses are compared through M * Inverse(M) which should be the identity
+    // (comparing them directly mostly measures the error of the general inverse)
+    Matrix4f Identity;
+    Identity.InitIdentity();
+
+    float MaxGeneralError = 0.0f;
+
+    for (int i = 0 ; i < NUM_MATRICES ; i++) {
+        Matrix4f Affine = MultiplyScalar(Matrices[i], Matrices[i].AffineInverse());
+        Matrix4f General = MultiplyScalar(Matrices[i], Matrices[i].Inverse());
+        MaxError = std::max(MaxError, MaxRelError(&Affine.m[0][0], &Identity.m[0][0], 16));
+        MaxGeneralError = std::max(MaxGeneralError, MaxRelError(&General.m[0][0], &Identity.m[0][0], 16));
+    }
+
+    printf("%-22s max rel error %g (general inverse)\n", "Inverse", MaxGeneralError);
+    Check("AffineInverse", MaxError, MAX_INVERSE_ERROR);
+
+    printf("\n");
+
+    //
+    // Performance
+    //
+    double ScalarNs = MeasureNsPerOp(NUM_MATRICES, [&]() {
+        for (int i = 0 ; i < NUM_MATRICES ; i++) {
+            ScalarResults[i] = MultiplyScalar(Matrices[i], Matrices[NUM_MATRICES - 1 - i]);
+        }
+        Checksum += ScalarResults[0].m[0][0];
+    });
+
+    double SimdNs = MeasureNsPerOp(NUM_MATRICES, [&]() {
+        for (int i = 0 ; i < NUM_MATRICES ; i++) {
+            Results[i] = Matrices[i] * Matrices[NUM_MATRICES - 1 - i];
+        }
+        Checksum += Results[0].m[0][0];
+    });
+
+    Report("Multiply", ScalarNs, SimdNs);
+
+    ScalarNs = MeasureNsPerOp(NUM_MATRICES, [&]() {
+        for (int i = 0 ; i < NUM_MATRICES ; i++) {
+            ScalarResults[i] = TransposeScalar(Matrices[i]);
+        }
+        Checksum += ScalarResults[0].m[0][1];
+    });
+
+    SimdNs = MeasureNsPerOp(NUM_MATRICES, [&]() {
+        for (int i = 0 ; i < NUM_MATRICES ; i++) {
+            Results[i] = Matrices[i].Transpose();
+        }
+        Checksum += Results[0].m[0][1];
+    });
+
+    Report("Transpose", ScalarNs, SimdNs);
+
+    ScalarNs = MeasureNsPerOp(NUM_VECTORS, [&]() {
+        for (int i = 0 ; i < NUM_VECTORS ; i++) {
+            ScalarVecResults[i] = TransformScalar(Matrices[i % NUM_MATRICES], Vectors[i]);
+        }
+        Checksum += ScalarVecResults[0].x;
+    });
+
+    SimdNs = MeasureNsPerOp(NUM_VECTORS, [&]() {
+        for (int i = 0 ; i < NUM_VECTORS ; i++) {
+            VecResults[i] = Matrices[i % NUM_MATRICES] * Vectors[i];
+        }
+        Checksum += VecResults[0].x;
+    });
+
+    Report("Transform", ScalarNs, SimdNs);
+
+    ScalarNs = MeasureNsPerOp(NUM_VECTORS, [&]() {
+        for (int i = 0 ; i < NUM_VECTORS ; i++) {
+            ScalarVecResults[i] = TransformScalar(Matrices[0], Vectors[i]);
+        }
+        Checksum += ScalarVecResults[0].x;
+    });
+
+    SimdNs = MeasureNsPerOp(NUM_VECTORS, [&]() {
+        Matrices[0].TransformVectors(Vectors.data(), VecResults.data(), NUM_VECTORS);
+        Checksum += VecResults[0].x;
+    });
+
+    Report("TransformVectors", ScalarNs, SimdNs);
+
+    ScalarNs = MeasureNsPerOp(NUM_MATRICES, [&]() {
+        for (int i = 0 ; i < NUM_MATRICES ; i++) {
+            ScalarResults[i] = Matrices[i].Inverse();
+        }
+        Checksum += ScalarResults[0].m[0][0];
+    });
+
+    SimdNs = MeasureNsPerOp(NUM_MATRICES, [&]() {
+        for (int i = 0 ; i < NUM_MATRICES ; i++) {
+            Results[i] = Matrices[i].AffineInverse();
+        }
+        Checksum += Results[0].m[0][0];
+    });
+
+    Report("Inverse/AffineInverse", ScalarNs, SimdNs);
+
+    printf("\nChecksum %f\n", Checksum);
+
+    if (NumFailures > 0) {
+        printf("%d checks failed\n", NumFailures);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,231 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Tests BuildPatchDrawCommands of the TerrainWater demo against the per patch
+    draw parameters of the original GeomipGrid::Render loop: number of commands,
+    index offsets and counts and base vertices for both vertex layouts.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "lod_manager.h"
+#include "patch_draw_commands.h"
+
+#define PATCH_SIZE 33
+#define NUM_PATCHES_X 16
+#define NUM_PATCHES_Z 12
+#define WORLD_SCALE 4.0f
+#define WIDTH ((PATCH_SIZE - 1) * NUM_PATCHES_X + 1)
+
+static int NumFailures = 0;
+
+
+static void Check(bool Condition, const char* pName)
+{
+    printf("%-72s %s\n", pName, Condition ? "OK" : "FAILED");
+
+    if (!Condition) {
+        NumFailures++;
+    }
+}
+
+
+// Same layout as GeomipGrid::InitIndicesLOD: the permutations of every LOD one after
+// the other. The counts only need to be different from each other.
+static void InitLodInfos(int MaxLOD, std::vector<LodInfo>& LodInfos)
+{
+    LodInfos.resize(MaxLOD + 1);
+
+    int Index = 0;
+
+    for (int lod = 0 ; lod <= MaxLOD ; lod++) {
+        int CoreCount = 6 * ((PATCH_SIZE - 1) >> lod) * ((PATCH_SIZE - 1) >> lod);
+
+        for (int l = 0 ; l < LEFT ; l++) {
+            for (int r = 0 ; r < RIGHT ; r++) {
+                for (int t = 0 ; t < TOP ; t++) {
+                    for (int b = 0 ; b < BOTTOM ; b++) {
+                        SingleLodInfo& Info = LodInfos[lod].info[l][r][t][b];
+                        Info.Start = Index;
+                        Info.Count = CoreCount - 3 * (l + 2 * r + 4 * t + 8 * b);
+                        Index += Info.Count;
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+// The draw parameters of the original loop in GeomipGrid::Render
+static DrawElementsIndirectCommand GetReferenceCommand(int Patch, const LodManager& Lods,
+                                                       const std::vector<LodInfo>& LodInfos, int PatchVertexCount)
+{
+    int PatchX = Patch % NUM_PATCHES_X;
+    int PatchZ = Patch / NUM_PATCHES_X;
+
+    int x = PatchX * (PATCH_SIZE - 1);
+    int z = PatchZ * (PATCH_SIZE - 1);
+
+    const LodManager::PatchLod& plod = Lods.GetPatchLod(PatchX, PatchZ);
+    const SingleLodInfo& Info = LodInfos[plod.Core].info[plod.Left][plod.Right][plod.Top][plod.Bottom];
+
+    DrawElementsIndirectCommand Cmd;
+    Cmd.Count = Info.Count;
+    Cmd.InstanceCount = 1;
+    Cmd.FirstIndex = Info.Start;
+    Cmd.BaseVertex = (PatchVertexCount > 0) ? Patch * PatchVertexCount : z * WIDTH + x;
+    Cmd.BaseInstance = 0;
+
+    return Cmd;
+}
+
+
+static bool IsSameCommand(const DrawElementsIndirectCommand& a, const DrawElementsIndirectCommand& b)
+{
+    return (a.Count == b.Count) && (a.InstanceCount == b.InstanceCount) && (a.FirstIndex == b.FirstIndex) &&
+           (a.BaseVertex == b.BaseVertex) && (a.BaseInstance == b.BaseInstance);
+}
+
+
+// Builds the commands into a buffer that is larger than needed and checks that the
+// entries after the last command are left alone
+static void TestPatches(const char* pName, const std::vector<int>& Patches, const LodManager& Lods,
+                        const std::vector<LodInfo>& LodInfos, int PatchVertexCount)
+{
+    const unsigned int Guard = 0xdeadbeef;
+
+    std::vector<DrawElementsIndirectCommand> Commands(NUM_PATCHES_X * NUM_PATCHES_Z + 1);
+
+    for (DrawElementsIndirectCommand& Cmd : Commands) {
+        Cmd.Count = Guard;
+    }
+
+    int NumCommands = BuildPatchDrawCommands(Patches, Lods, LodInfos, NUM_PATCHES_X, PATCH_SIZE, WIDTH,
+                                             PatchVertexCount, Commands.data());
+
+    bool AllMatch = true;
+
+    for (int i = 0 ; i < NumCommands ; i++) {
+        AllMatch = AllMatch && IsSameCommand(Commands[i], GetReferenceCommand(Patches[i], Lods, LodInfos, PatchVertexCount));
+    }
+
+    char Name[128];
+    snprintf(Name, sizeof(Name), "%s: one command per patch", pName);
+    Check(NumCommands == (int)Patches.size(), Name);
+    snprintf(Name, sizeof(Name), "%s: counts, index offsets and base vertices", pName);
+    Check(AllMatch, Name);
+    snprintf(Name, sizeof(Name), "%s: nothing written after the last command", pName);
+    Check(Commands[NumCommands].Count == Guard, Name);
+}
+
+
+static void TestBaseVertices(const LodManager& Lods, const std::vector<LodInfo>& LodInfos)
+{
+    // Patch (0, 0), (1, 0), (0, 1) and the last patch
+    int LastPatch = NUM_PATCHES_X * NUM_PATCHES_Z - 1;
+    std::vector<int> Patches = { 0, 1, NUM_PATCHES_X, LastPatch };
+    DrawElementsIndirectCommand Commands[4];
+
+    BuildPatchDrawCommands(Patches, Lods, LodInfos, NUM_PATCHES_X, PATCH_SIZE, WIDTH, 0, Commands);
+
+    // In a single grid neighboring patches share the vertices of the border
+    Check((Commands[0].BaseVertex == 0) &&
+          (Commands[1].BaseVertex == PATCH_SIZE - 1) &&
+          (Commands[2].BaseVertex == (PATCH_SIZE - 1) * WIDTH) &&
+          (Commands[3].BaseVertex == (NUM_PATCHES_Z - 1) * (PATCH_SIZE - 1) * WIDTH + (NUM_PATCHES_X - 1) * (PATCH_SIZE - 1)),
+          "grid layout base vertices");
+
+    int PatchVertexCount = PATCH_SIZE * PATCH_SIZE;
+
+    BuildPatchDrawCommands(Patches, Lods, LodInfos, NUM_PATCHES_X, PATCH_SIZE, WIDTH, PatchVertexCount, Commands);
+
+    Check((Commands[0].BaseVertex == 0) &&
+          (Commands[1].BaseVertex == PatchVertexCount) &&
+          (Commands[2].BaseVertex == NUM_PATCHES_X * PatchVertexCount) &&
+          (Commands[3].BaseVertex == LastPatch * PatchVertexCount),
+          "compact layout base vertices");
+}
+
+
+int main(int argc, char* argv[])
+{
+    Check(sizeof(DrawElementsIndirectCommand) == 5 * sizeof(unsigned int), "command layout matches GL");
+
+    LodManager Lods;
+    int MaxLOD = Lods.InitLodManager(PATCH_SIZE, NUM_PATCHES_X, NUM_PATCHES_Z, WORLD_SCALE);
+
+    // Camera over one corner so the LOD map has all the cores and neighbor combinations
+    Lods.Update(Vector3f(0.0f, 100.0f, 0.0f));
+
+    std::vector<LodInfo> LodInfos;
+    InitLodInfos(MaxLOD, LodInfos);
+
+    int NumCores = 0;
+    bool HasNeighborFlags = false;
+    std::vector<bool> CoreSeen(MaxLOD + 1, false);
+
+    for (int z = 0 ; z < NUM_PATCHES_Z ; z++) {
+        for (int x = 0 ; x < NUM_PATCHES_X ; x++) {
+            const LodManager::PatchLod& plod = Lods.GetPatchLod(x, z);
+
+            if (!CoreSeen[plod.Core]) {
+                CoreSeen[plod.Core] = true;
+                NumCores++;
+            }
+
+            HasNeighborFlags = HasNeighborFlags || plod.Left || plod.Right || plod.Top || plod.Bottom;
+        }
+    }
+
+    printf("Max LOD %d, %d different LODs in the map\n", MaxLOD, NumCores);
+    Check((NumCores > 1) && HasNeighborFlags, "the LOD map is not uniform");
+
+    std::vector<int> AllPatches;
+
+    for (int i = 0 ; i < NUM_PATCHES_X * NUM_PATCHES_Z ; i++) {
+        AllPatches.push_back(i);
+    }
+
+    // The quadtree returns the visible patches in tree order, not in row order
+    std::vector<int> SomePatches;
+
+    for (int i = NUM_PATCHES_X * NUM_PATCHES_Z - 1 ; i >= 0 ; i -= 3) {
+        SomePatches.push_back(i);
+    }
+
+    std::vector<int> NoPatches;
+
+    TestPatches("all patches, grid layout", AllPatches, Lods, LodInfos, 0);
+    TestPatches("all patches, compact layout", AllPatches, Lods, LodInfos, PATCH_SIZE * PATCH_SIZE);
+    TestPatches("some patches, grid layout", SomePatches, Lods, LodInfos, 0);
+    TestPatches("some patches, compact layout", SomePatches, Lods, LodInfos, PATCH_SIZE * PATCH_SIZE);
+    TestPatches("no patches", NoPatches, Lods, LodInfos, 0);
+
+    TestBaseVertices(Lods, LodInfos);
+
+    if (NumFailures > 0) {
+        printf("\n%d checks failed\n", NumFailures);
+        return 1;
+    }
+
+    printf("\nAll checks passed\n");
+
+    return 0;
+}
@@ -0,0 +1,846 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Times the structure of arrays ParticleStore::Integrate against the original
+    per particle Particle::Integrate for 10K to 1M particles and checks that both
+    end up with the same positions and velocities.
+
+    Then times the SpatialHashContacts broad phase for 10K and 100K particles and
+    checks that at 10K it finds exactly the pairs that a brute force search finds.
+
+    Finally the island based ParticleContactResolver is compared against the original
+    resolver that always picks the contact with the largest closing velocity. The bridge
+    of the DemoLITION carbonara test is simulated by both. The bridge keeps swinging
+    and a single extra iteration of the original resolver is enough to change its path
+    so the average positions of the spheres and the worst constraint violations are
+    compared instead of the positions in every frame. Then piles of overlapping
+    particles are resolved by both.
+
+    The last part compares the batched kernels of the ForceRegistry against the
+    virtual force generators. Every particle has gravity, drag, buoyancy and a spring
+    to its neighbour. The forces of both paths must match and the time to add and
+    remove a force through a handle is measured.
+
+    Build with -mavx2 to get the 8 wide integrator. Without it the 4 wide
+    ogldev_simd.h backend is used.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "ogldev_util.h"
+#include "ogldev_math_3d.h"
+#include "particle_store.h"
+#include "particle.h"
+#include "spatial_hash_contacts.h"
+#include "contact_resolver.h"
+#include "force_generator.h"
+#include "gravity_force_generator.h"
+#include "drag_force_generator.h"
+#include "spring_force_generator.h"
+#include "buoyancy_force_generator.h"
+
+using namespace OgldevPhysics;
+
+// Particles per size times steps is kept around this number so every size runs for a similar time
+#define WORK_PER_SIZE 20000000
+
+#define DT (1.0f / 60.0f)
+
+// Every n-th particle has an infinite mass
+#define INFINITE_MASS_STRIDE 17
+
+#define MAX_REL_ERROR 1e-5f
+
+static const float DampingValues[] = { 0.999f, 0.99f, 0.95f, 0.5f };
+
+#define CONTACT_RADIUS 0.5f
+
+// World volume per particle. Gives roughly half a contact per particle.
+#define VOLUME_PER_PARTICLE 8.0f
+
+#define CONTACT_STEPS 20
+
+#define MAX_BRUTE_FORCE_PARTICLES 10000
+
+#define BRIDGE_SPHERES 12
+#define BRIDGE_CABLES (BRIDGE_SPHERES - 2)
+#define BRIDGE_PLANKS (BRIDGE_SPHERES / 2)
+#define BRIDGE_STEPS 1200
+#define BRIDGE_DT 0.016f
+
+// Largest difference in the average positions of the bridge spheres from the original resolver.
+// The bridge is about 10 units long.
+#define MAX_BRIDGE_ERROR 0.15f
+
+// Allowed increase in the worst constraint violation of the bridge
+#define MAX_BRIDGE_VIOLATION_RATIO 1.1f
+
+// Radius 0.5 particles overlap about 4 others
+#define PILE_VOLUME_PER_PARTICLE 1.0f
+
+// Above this the original resolver is too slow to compare against
+#define MAX_ORIGINAL_PILE_PARTICLES 4000
+
+#define FORCE_STEPS 100
+
+// Every n-th particle is at rest so the drag of zero velocity is covered
+#define AT_REST_STRIDE 13
+
+
+/////////////////////////////////////
+// The original particle
+/////////////////////////////////////
+
+class OriginalParticle {
+
+public:
+    void Integrate(float dt)
+    {
+        if (m_reciprocalMass <= 0.0f) {
+            return;
+        }
+
+        m_position += m_velocity * dt;
+
+        Vector3f AccTemp = m_acceleration;
+        AccTemp += m_forceAccum * m_reciprocalMass;
+        m_velocity += AccTemp * dt;
+
+        m_velocity *= powf(m_damping, dt);
+
+        m_forceAccum = Vector3f(0.0f, 0.0f, 0.0f);
+    }
+
+    Vector3f m_position = Vector3f(0.0f, 0.0f, 0.0f);
+    Vector3f m_velocity = Vector3f(0.0f, 0.0f, 0.0f);
+    Vector3f m_acceleration = Vector3f(0.0f, 0.0f, 0.0f);
+    Vector3f m_forceAccum = Vector3f(0.0f, 0.0f, 0.0f);
+    float m_damping = 0.999f;
+    float m_reciprocalMass = 0.0f;
+};
+
+
+static Vector3f RandomVector(float Range)
+{
+    return Vector3f(RandomFloatRange(-Range, Range), RandomFloatRange(-Range, Range), RandomFloatRange(-Range, Range));
+}
+
+
+// The force that is applied to particle i in every step
+static Vector3f GetForce(int i)
+{
+    return Vector3f((float)(i % 7) - 3.0f, 1.0f, (float)(i % 5) - 2.0f);
+}
+
+
+static float RelError(const Vector3f& a, const Vector3f& b)
+{
+    float Error = std::max(fabsf(a.x - b.x), std::max(fabsf(a.y - b.y), fabsf(a.z - b.z)));
+    float Magnitude = std::max(1.0f, std::max(fabsf(b.x), std::max(fabsf(b.y), fabsf(b.z))));
+    return Error / Magnitude;
+}
+
+
+static int NumFailures = 0;
+
+
+static void RunSize(int NumParticles)
+{
+    int NumSteps = std::max(WORK_PER_SIZE / NumParticles, 10);
+
+    std::vector<OriginalParticle> Original(NumParticles);
+
+    ParticleStore Store;
+    Store.Init(NumParticles);
+
+    for (int i = 0 ; i < NumParticles ; i++) {
+        OriginalParticle& p = Original[i];
+        p.m_position = RandomVector(100.0f);
+        p.m_velocity = RandomVector(10.0f);
+        p.m_acceleration = Vector3f(0.0f, -9.81f, 0.0f);
+        p.m_damping = DampingValues[i % ARRAY_SIZE_IN_ELEMENTS(DampingValues)];
+        p.m_reciprocalMass = (i % INFINITE_MASS_STRIDE == 0) ? 0.0f : RandomFloatRange(0.1f, 2.0f);
+
+        uint Index = Store.AllocParticle();
+        Store.SetPosition(Index, p.m_position);
+        Store.SetVelocity(Index, p.m_velocity);
+        Store.SetAcceleration(Index, p.m_acceleration);
+        Store.SetDamping(Index, p.m_damping);
+        Store.SetReciprocalMass(Index, p.m_reciprocalMass);
+    }
+
+    // Only the integration is timed. The forces are added outside the timed part of every step.
+    double OriginalNs = 0.0;
+    double StoreNs = 0.0;
+
+    for (int Step = 0 ; Step < NumSteps ; Step++) {
+        for (int i = 0 ; i < NumParticles ; i++) {
+            Original[i].m_forceAccum += GetForce(i);
+            Store.AddForce(i, GetForce(i));
+        }
+
+        auto Start = std::chrono::high_resolution_clock::now();
+
+        for (int i = 0 ; i < NumParticles ; i++) {
+            Original[i].Integrate(DT);
+        }
+
+        auto Mid = std::chrono::high_resolution_clock::now();
+
+        Store.Integrate(DT);
+
+        auto End = std::chrono::high_resolution_clock::now();
+
+        OriginalNs += std::chrono::duration<double, std::nano>(Mid - Start).count();
+        StoreNs += std::chrono::duration<double, std::nano>(End - Mid).count();
+    }
+
+    double Count = (double)NumParticles * NumSteps;
+
+    float MaxError = 0.0f;
+
+    for (int i = 0 ; i < NumParticles ; i++) {
+        MaxError = std::max(MaxError, RelError(Store.GetPosition(i), Original[i].m_position));
+        MaxError = std::max(MaxError, RelError(Store.GetVelocity(i), Original[i].m_velocity));
+    }
+
+    bool Passed = MaxError <= MAX_REL_ERROR;
+
+    if (!Passed) {
+        NumFailures++;
+    }
+
+    printf("%8d particles, %5d steps: original %6.2f ns/particle, store %6.2f ns/particle, speedup %5.2fx, max error %g %s\n",
+           NumParticles, NumSteps, OriginalNs / Count, StoreNs / Count, OriginalNs / StoreNs, MaxError, Passed ? "" : "FAILED");
+}
+
+
+/////////////////////////////////////
+// Contact generation
+/////////////////////////////////////
+
+static bool PairLess(const std::pair<uint, uint>& a, const std::pair<uint, uint>& b)
+{
+    return (a.first < b.first) || ((a.first == b.first) && (a.second < b.second));
+}
+
+
+static std::vector<std::pair<uint, uint>> BruteForcePairs(const ParticleStore& Store)
+{
+    std::vector<std::pair<uint, uint>> Pairs;
+
+    float DiameterSquared = 4.0f * CONTACT_RADIUS * CONTACT_RADIUS;
+
+    for (uint i = 0 ; i < Store.GetNumParticles() ; i++) {
+        for (uint j = i + 1 ; j < Store.GetNumParticles() ; j++) {
+            if ((Store.GetReciprocalMass(i) <= 0.0f) && (Store.GetReciprocalMass(j) <= 0.0f)) {
+                continue;
+            }
+
+            Vector3f Diff = Store.GetPosition(i) - Store.GetPosition(j);
+
+            if (Diff.Dot(Diff) < DiameterSquared) {
+                Pairs.push_back(std::make_pair(i, j));
+            }
+        }
+    }
+
+    return Pairs;
+}
+
+
+static void RunContacts(int NumParticles)
+{
+    float WorldSize = cbrtf(NumParticles * VOLUME_PER_PARTICLE);
+
+    ParticleStore Store;
+    Store.Init(NumParticles);
+
+    std::vector<Particle> Particles(NumParticles);
+
+    for (int i = 0 ; i < NumParticles ; i++) {
+        uint Index = Store.AllocParticle();
+        Particles[i].Init(&Store, Index);
+        Store.SetReciprocalMass(Index, (i % INFINITE_MASS_STRIDE == 0) ? 0.0f : 1.0f);
+    }
+
+    // Enough room for every pair so the check below sees all of them
+    std::vector<ParticleContact> Contacts(NumParticles * 4);
+
+    SpatialHashContacts Generator;
+    Generator.Init(&Store, Particles.data(), CONTACT_RADIUS, 0.5f);
+
+    double TotalNs = 0.0;
+    int NumContacts = 0;
+
+    for (int Step = 0 ; Step < CONTACT_STEPS ; Step++) {
+        for (int i = 0 ; i < NumParticles ; i++) {
+            Store.SetPosition(i, Vector3f(RandomFloatRange(0.0f, WorldSize),
+                                          RandomFloatRange(0.0f, WorldSize),
+                                          RandomFloatRange(0.0f, WorldSize)));
+        }
+
+        auto Start = std::chrono::high_resolution_clock::now();
+
+        NumContacts = Generator.AddContact(Contacts, 0);
+
+        auto End = std::chrono::high_resolution_clock::now();
+
+        TotalNs += std::chrono::duration<double, std::nano>(End - Start).count();
+    }
+
+    const char* pResult = "";
+
+    if (NumParticles <= MAX_BRUTE_FORCE_PARTICLES) {
+        std::vector<std::pair<uint, uint>> Found;
+
+        for (int i = 0 ; i < NumContacts ; i++) {
+            Found.push_back(std::make_pair(Contacts[i].m_pParticles[0]->GetIndex(), Contacts[i].m_pParticles[1]->GetIndex()));
+        }
+
+        std::sort(Found.begin(), Found.end(), PairLess);
+
+        bool Passed = (Found == BruteForcePairs(Store)) && ((int)Generator.GetNumPairs() == NumContacts);
+
+        if (!Passed) {
+            NumFailures++;
+        }
+
+        pResult = Passed ? "matches brute force" : "FAILED";
+    }
+
+    printf("%8d particles: %6d contacts, %7.3f ms per step, %6.2f ns/particle %s\n",
+           NumParticles, NumContacts, TotalNs / CONTACT_STEPS / 1000000.0, TotalNs / CONTACT_STEPS / NumParticles, pResult);
+}
+
+
+/////////////////////////////////////
+// Contact resolution
+/////////////////////////////////////
+
+// The original ParticleContactResolver::ResolveContacts
+static int FindContactWithLargestClosingVelocity(std::vector<ParticleContact>& ContactArray, uint NumContacts)
+{
+    float MaxSepVelocity = FLT_MAX;
+    uint MaxIndex = NumContacts;
+
+    for (uint i = 0; i < NumContacts; i++) {
+        float SepVelocity = ContactArray[i].CalcSeparatingVelocity();
+
+        if ((SepVelocity < MaxSepVelocity) && ((SepVelocity < 0.0f) || (ContactArray[i].GetPenetration() > 0.0f))) {
+            MaxSepVelocity = SepVelocity;
+            MaxIndex = i;
+        }
+    }
+
+    return MaxIndex;
+}
+
+
+static void OriginalResolveContacts(std::vector<ParticleContact>& ContactArray, uint NumContacts, int Iterations, float dt)
+{
+    int IterationsUsed = 0;
+
+    while (IterationsUsed < Iterations) {
+        uint Index = FindContactWithLargestClosingVelocity(ContactArray, NumContacts);
+
+        if (Index == NumContacts) {
+            break;
+        }
+
+        ContactArray[Index].Resolve(dt);
+
+        Vector3f* Move = &(ContactArray[Index].m_particleMovement[0]);
+
+        for (uint i = 0; i < NumContacts; i++) {
+            if (ContactArray[i].m_pParticles[0] == ContactArray[Index].m_pParticles[0]) {
+                ContactArray[i].m_penetration -= Move[0].Dot(ContactArray[i].m_contactNormal);
+            } else if (ContactArray[i].m_pParticles[0] == ContactArray[Index].m_pParticles[1]) {
+                ContactArray[i].m_penetration -= Move[1].Dot(ContactArray[i].m_contactNormal);
+            }
+
+            if (ContactArray[i].m_pParticles[1]) {
+                if (ContactArray[i].m_pParticles[1] == ContactArray[Index].m_pParticles[0]) {
+                    ContactArray[i].m_penetration += Move[0].Dot(ContactArray[i].m_contactNormal);
+                } else if (ContactArray[i].m_pParticles[1] == ContactArray[Index].m_pParticles[1]) {
+                    ContactArray[i].m_penetration += Move[1].Dot(ContactArray[i].m_contactNormal);
+                }
+            }
+        }
+
+        IterationsUsed++;
+    }
+}
+
+
+static int GenerateContacts(const std::vector<ParticleContactGenerator*>& Generators, std::vector<ParticleContact>& Contacts)
+{
+    int NumContacts = 0;
+
+    for (uint i = 0 ; i < Generators.size() ; i++) {
+        NumContacts += Generators[i]->AddContact(Contacts, NumContacts);
+
+        if (NumContacts >= (int)Contacts.size()) {
+            break;
+        }
+    }
+
+    return NumContacts;
+}
+
+
+// Same as the bridge of the carbonara test with the extra mass moving along it
+struct Bridge {
+
+    void Init()
+    {
+        Store.Init(BRIDGE_SPHERES);
+        Particles.resize(BRIDGE_SPHERES);
+        ParticlePtrs.resize(BRIDGE_SPHERES);
+
+        for (int i = 0 ; i < BRIDGE_SPHERES ; i++) {
+            Particles[i].Init(&Store, Store.AllocParticle());
+            Particles[i].SetPosition(Vector3f((i / 2.0f) * 2.0f - 5.0f, 1.0f, (i % 2) * 2.0f - 1.0f));
+            Particles[i].SetMass(1.0f);
+            Particles[i].SetDamping(0.9f);
+            Particles[i].SetAcceleration(Vector3f(0.0f, -9.81f, 0.0f));
+            ParticlePtrs[i] = &Particles[i];
+        }
+
+        Rods.resize(BRIDGE_PLANKS);
+
+        for (int i = 0 ; i < BRIDGE_PLANKS ; i++) {
+            Rods[i].m_pParticles[0] = &Particles[i * 2];
+            Rods[i].m_pParticles[1] = &Particles[i * 2 + 1];
+            Rods[i].m_len = 2.0f;
+            Generators.push_back(&Rods[i]);
+        }
+
+        Supports.resize(BRIDGE_SPHERES);
+
+        for (int i = 0 ; i < BRIDGE_SPHERES ; i++) {
+            Supports[i].m_pParticle = &Particles[i];
+            Supports[i].m_anchor = Vector3f((i / 2.0f) * 2.2f - 5.5f, 6, (i % 2) * 1.6f - 0.8f);
+            Supports[i].m_maxLength = (i < 6) ? (i / 2.0f) * 0.5f + 3.0f : 5.5f - (i / 2.0f) * 0.5f;
+            Supports[i].m_restitution = 0.5f;
+            Generators.push_back(&Supports[i]);
+        }
+
+        Cables.resize(BRIDGE_CABLES);
+
+        for (int i = 0 ; i < BRIDGE_CABLES ; i++) {
+            Cables[i].m_pParticles[0] = &Particles[i];
+            Cables[i].m_pParticles[1] = &Particles[i + 2];
+            Cables[i].m_maxLength = 1.9f;
+            Cables[i].m_restituion = 0.3f;
+            Generators.push_back(&Cables[i]);
+        }
+
+        Ground.Init(&ParticlePtrs);
+        Generators.push_back(&Ground);
+
+        Contacts.resize(BRIDGE_SPHERES * 10);
+    }
+
+    void Step(int Frame, bool UseOriginal)
+    {
+        // The extra mass of the demo moves to the next sphere every 100 frames
+        int Heavy = (Frame / 100) % BRIDGE_SPHERES;
+
+        for (int i = 0 ; i < BRIDGE_SPHERES ; i++) {
+            Particles[i].SetMass((i == Heavy) ? 11.0f : 1.0f);
+        }
+
+        Store.Integrate(BRIDGE_DT);
+
+        int NumContacts = GenerateContacts(Generators, Contacts);
+
+        if (UseOriginal) {
+            OriginalResolveContacts(Contacts, NumContacts, NumContacts * 2, BRIDGE_DT);
+        } else {
+            Resolver.SetIterations(NumContacts * 2);
+            Resolver.ResolveContacts(Contacts, NumContacts, BRIDGE_DT);
+        }
+    }
+
+    ParticleStore Store;
+    std::vector<Particle> Particles;
+    std::vector<Particle*> ParticlePtrs;
+    std::vector<ParticleRod> Rods;
+    std::vector<ParticleCableConstraint> Supports;
+    std::vector<ParticleCable> Cables;
+    GroundContacts Ground;
+    std::vector<ParticleContactGenerator*> Generators;
+    std::vector<ParticleContact> Contacts;
+    ParticleContactResolver Resolver;
+};
+
+
+// The constraint violation that the resolver left behind
+static float GetMaxViolation(Bridge& b)
+{
+    int NumContacts = GenerateContacts(b.Generators, b.Contacts);
+
+    float MaxViolation = 0.0f;
+
+    for (int i = 0 ; i < NumContacts ; i++) {
+        MaxViolation = std::max(MaxViolation, b.Contacts[i].GetPenetration());
+    }
+
+    return MaxViolation;
+}
+
+
+static void RunBridge()
+{
+    Bridge Original, Islands;
+    Original.Init();
+    Islands.Init();
+
+    std::vector<Vector3f> OriginalSum(BRIDGE_SPHERES, Vector3f(0.0f, 0.0f, 0.0f));
+    std::vector<Vector3f> IslandsSum(BRIDGE_SPHERES, Vector3f(0.0f, 0.0f, 0.0f));
+
+    float OriginalViolation = 0.0f;
+    float IslandsViolation = 0.0f;
+
+    for (int Frame = 0 ; Frame < BRIDGE_STEPS ; Frame++) {
+        Original.Step(Frame, true);
+        Islands.Step(Frame, false);
+
+        for (int i = 0 ; i < BRIDGE_SPHERES ; i++) {
+            OriginalSum[i] += Original.Particles[i].GetPosition();
+            IslandsSum[i] += Islands.Particles[i].GetPosition();
+        }
+
+        OriginalViolation = std::max(OriginalViolation, GetMaxViolation(Original));
+        IslandsViolation = std::max(IslandsViolation, GetMaxViolation(Islands));
+    }
+
+    float MaxError = 0.0f;
+
+    for (int i = 0 ; i < BRIDGE_SPHERES ; i++) {
+        Vector3f Diff = (IslandsSum[i] - OriginalSum[i]) / (float)BRIDGE_STEPS;
+        MaxError = std::max(MaxError, Diff.Length());
+    }
+
+    bool Passed = (MaxError <= MAX_BRIDGE_ERROR) && (IslandsViolation <= OriginalViolation * MAX_BRIDGE_VIOLATION_RATIO);
+
+    if (!Passed) {
+        NumFailures++;
+    }
+
+    printf("bridge, %d frames: average positions within %f of the original resolver, worst violation %f (original %f) %s\n",
+           BRIDGE_STEPS, MaxError, IslandsViolation, OriginalViolation, Passed ? "" : "FAILED");
+}
+
+
+// The deepest interpenetration of the pile and the time it took to resolve it
+static float ResolvePile(int NumParticles, bool UseOriginal, double& Ms)
+{
+    float WorldSize = cbrtf(NumParticles * PILE_VOLUME_PER_PARTICLE);
+
+    ParticleStore Store;
+    Store.Init(NumParticles);
+
+    std::vector<Particle> Particles(NumParticles);
+
+    srand(1);
+
+    for (int i = 0 ; i < NumParticles ; i++) {
+        Particles[i].Init(&Store, Store.AllocParticle());
+        Particles[i].SetPosition(Vector3f(RandomFloatRange(0.0f, WorldSize), RandomFloatRange(0.0f, WorldSize), RandomFloatRange(0.0f, WorldSize)));
+        Particles[i].SetVelocity(RandomVector(1.0f));
+        Particles[i].SetReciprocalMass((i % INFINITE_MASS_STRIDE == 0) ? 0.0f : 1.0f);
+    }
+
+    std::vector<ParticleContact> Contacts(NumParticles * 8);
+
+    SpatialHashContacts Generator;
+    Generator.Init(&Store, Particles.data(), CONTACT_RADIUS, 0.5f);
+
+    int NumContacts = Generator.AddContact(Contacts, 0);
+
+    auto Start = std::chrono::high_resolution_clock::now();
+
+    if (UseOriginal) {
+        OriginalResolveContacts(Contacts, NumContacts, NumContacts * 2, DT);
+    } else {
+        ParticleContactResolver Resolver;
+        Resolver.Init(NumContacts * 2);
+        Resolver.ResolveContacts(Contacts, NumContacts, DT);
+    }
+
+    auto End = std::chrono::high_resolution_clock::now();
+
+    Ms = std::chrono::duration<double, std::milli>(End - Start).count();
+
+    NumContacts = Generator.AddContact(Contacts, 0);
+
+    float MaxPenetration = 0.0f;
+
+    for (int i = 0 ; i < NumContacts ; i++) {
+        MaxPenetration = std::max(MaxPenetration, Contacts[i].GetPenetration());
+    }
+
+    return MaxPenetration;
+}
+
+
+static void RunPile(int NumParticles)
+{
+    double IslandsMs = 0.0;
+    float Islands = ResolvePile(NumParticles, false, IslandsMs);
+
+    if (NumParticles > MAX_ORIGINAL_PILE_PARTICLES) {
+        printf("%8d particle pile: islands %9.3f ms, deepest penetration %f\n", NumParticles, IslandsMs, Islands);
+        return;
+    }
+
+    double OriginalMs = 0.0;
+    float Original = ResolvePile(NumParticles, true, OriginalMs);
+
+    printf("%8d particle pile: original %9.3f ms, islands %9.3f ms, deepest penetration %f (original %f)\n",
+           NumParticles, OriginalMs, IslandsMs, Islands, Original);
+}
+
+/////////////////////////////////////
+// Forces
+/////////////////////////////////////
+
+static double TimeForces(ForceRegistry& Registry, ParticleStore& Store)
+{
+    Store.ClearForces();
+
+    auto Start = std::chrono::high_resolution_clock::now();
+
+    for (int Step = 0 ; Step < FORCE_STEPS ; Step++) {
+        Registry.Update(DT);
+    }
+
+    auto End = std::chrono::high_resolution_clock::now();
+
+    return std::chrono::duration<double, std::milli>(End - Start).count() / FORCE_STEPS;
+}
+
+
+// The ids of removed forces are reused by new forces so the handles of the removed
+// ones must be rejected instead of reaching the new forces
+static bool CheckStaleHandles(ForceRegistry& Registry, std::vector<Particle>& Particles,
+                              const std::vector<ForceHandle>& StaleHandles)
+{
+    uint NumForces = Registry.GetNumForces();
+
+    std::vector<ForceHandle> Handles(Particles.size());
+
+    for (size_t i = 0 ; i < Particles.size() ; i++) {
+        Handles[i] = Registry.AddDrag(&Particles[i], 0.2f, 0.02f);
+    }
+
+    bool Passed = true;
+
+    for (const ForceHandle& Handle : StaleHandles) {
+        Passed = Passed && !Registry.IsValid(Handle) && !Registry.Remove(Handle);
+    }
+
+    Passed = Passed && (Registry.GetNumForces() == NumForces + Particles.size());
+
+    for (const ForceHandle& Handle : Handles) {
+        Passed = Passed && Registry.IsValid(Handle) && Registry.Remove(Handle);
+    }
+
+    // Removed twice
+    Passed = Passed && !Registry.Remove(Handles[0]);
+
+    ForceHandle Anchored = Registry.AddAnchoredSpring(&Particles[0], Vector3f(0.0f, 1.0f, 0.0f), 2.0f, 1.0f);
+    Registry.Remove(Anchored);
+    ForceHandle Reused = Registry.AddAnchoredSpring(&Particles[0], Vector3f(0.0f, 1.0f, 0.0f), 2.0f, 1.0f);
+
+    Passed = Passed && (Reused.Id == Anchored.Id) &&
+             !Registry.SetAnchor(Anchored, Vector3f(1.0f, 1.0f, 0.0f)) &&
+             Registry.SetAnchor(Reused, Vector3f(1.0f, 1.0f, 0.0f));
+
+    Passed = Passed && (Registry.GetNumForces() == NumForces + 1);
+
+    // Clear makes every handle stale
+    Registry.Clear();
+    ForceHandle AfterClear = Registry.AddAnchoredSpring(&Particles[0], Vector3f(0.0f, 1.0f, 0.0f), 2.0f, 1.0f);
+
+    Passed = Passed && !Registry.IsValid(Reused) && !Registry.Remove(Reused) &&
+             Registry.IsValid(AfterClear) && (Registry.GetNumForces() == 1);
+
+    return Passed;
+}
+
+
+static void RunForces(int NumParticles)
+{
+    ParticleStore Store;
+    Store.Init(NumParticles);
+
+    std::vector<Particle> Particles(NumParticles);
+
+    for (int i = 0 ; i < NumParticles ; i++) {
+        uint Index = Store.AllocParticle();
+        Particles[i].Init(&Store, Index);
+        Store.SetReciprocalMass(Index, RandomFloatRange(0.5f, 2.0f));
+        Store.SetPosition(Index, RandomVector(2.0f));
+        Store.SetVelocity(Index, (i % AT_REST_STRIDE == 0) ? Vector3f(0.0f, 0.0f, 0.0f) : RandomVector(5.0f));
+    }
+
+    GravityForceGenerator Gravity(Vector3f(0.0f, -9.8f, 0.0f));
+    DragForceGenerator Drag(0.1f, 0.01f);
+    BuoyancyForceGenerator Buoyancy(1.0f, 0.001f, 0.0f);
+    std::vector<SpringForceGenerator> Springs;
+
+    for (int i = 0 ; i < NumParticles ; i++) {
+        Springs.push_back(SpringForceGenerator(&Particles[(i + 1) % NumParticles], 2.0f, 1.0f));
+    }
+
+    ForceRegistry Virtual;
+    ForceRegistry Batched;
+    Batched.Init(&Store);
+
+    for (int i = 0 ; i < NumParticles ; i++) {
+        Virtual.Add(&Particles[i], &Gravity);
+        Virtual.Add(&Particles[i], &Drag);
+        Virtual.Add(&Particles[i], &Springs[i]);
+        Virtual.Add(&Particles[i], &Buoyancy);
+
+        Batched.AddGravity(&Particles[i], Vector3f(0.0f, -9.8f, 0.0f));
+        Batched.AddDrag(&Particles[i], 0.1f, 0.01f);
+        Batched.AddSpring(&Particles[i], &Particles[(i + 1) % NumParticles], 2.0f, 1.0f);
+        Batched.AddBuoyancy(&Particles[i], 1.0f, 0.001f, 0.0f);
+    }
+
+    double VirtualMs = TimeForces(Virtual, Store);
+    double BatchedMs = TimeForces(Batched, Store);
+
+    // Check the forces of a single update
+    std::vector<Vector3f> Expected(NumParticles);
+
+    Store.ClearForces();
+    Virtual.Update(DT);
+
+    for (int i = 0 ; i < NumParticles ; i++) {
+        Expected[i] = Vector3f(Store.GetForcesX()[i], Store.GetForcesY()[i], Store.GetForcesZ()[i]);
+    }
+
+    Store.ClearForces();
+    Batched.Update(DT);
+
+    float MaxError = 0.0f;
+
+    for (int i = 0 ; i < NumParticles ; i++) {
+        Vector3f Force(Store.GetForcesX()[i], Store.GetForcesY()[i], Store.GetForcesZ()[i]);
+        MaxError = std::max(MaxError, RelError(Force, Expected[i]));
+    }
+
+    bool Passed = (MaxError <= MAX_REL_ERROR) && (Batched.GetNumForces() == Virtual.GetNumForces());
+
+    if (!Passed) {
+        NumFailures++;
+    }
+
+    // Add a drag to every particle and remove them in random order
+    std::vector<ForceHandle> Handles(NumParticles);
+
+    auto Start = std::chrono::high_resolution_clock::now();
+
+    for (int i = 0 ; i < NumParticles ; i++) {
+        Handles[i] = Batched.AddDrag(&Particles[i], 0.1f, 0.01f);
+    }
+
+    auto Mid = std::chrono::high_resolution_clock::now();
+
+    for (int i = NumParticles - 1 ; i > 0 ; i--) {
+        std::swap(Handles[i], Handles[rand() % (i + 1)]);
+    }
+
+    auto Shuffled = std::chrono::high_resolution_clock::now();
+
+    for (int i = 0 ; i < NumParticles ; i++) {
+        Batched.Remove(Handles[i]);
+    }
+
+    auto End = std::chrono::high_resolution_clock::now();
+
+    double AddNs = std::chrono::duration<double, std::nano>(Mid - Start).count() / NumParticles;
+    double RemoveNs = std::chrono::duration<double, std::nano>(End - Shuffled).count() / NumParticles;
+
+    if (Batched.GetNumForces() != Virtual.GetNumForces()) {
+        NumFailures++;
+        Passed = false;
+    }
+
+    if (!CheckStaleHandles(Batched, Particles, Handles)) {
+        NumFailures++;
+        Passed = false;
+    }
+
+    printf("%8d particles, 4 forces each: virtual %7.3f ms, batched %7.3f ms (%.1fx), add %.1f ns, remove %.1f ns, max error %g %s\n",
+           NumParticles, VirtualMs, BatchedMs, VirtualMs / BatchedMs, AddNs, RemoveNs, MaxError, Passed ? "" : "FAILED");
+}
+
+
+int main(int argc, char* argv[])
+{
+#ifdef __AVX2__
+    printf("AVX2 integrator\n");
+#else
+    printf("4 wide integrator\n");
+#endif
+
+    srand(0);
+
+    int Sizes[] = { 10000, 100000, 1000000 };
+
+    for (int i = 0 ; i < (int)ARRAY_SIZE_IN_ELEMENTS(Sizes) ; i++) {
+        RunSize(Sizes[i]);
+    }
+
+    int ContactSizes[] = { 10000, 100000 };
+
+    for (int i = 0 ; i < (int)ARRAY_SIZE_IN_ELEMENTS(ContactSizes) ; i++) {
+        RunContacts(ContactSizes[i]);
+    }
+
+    RunBridge();
+
+    int PileSizes[] = { 1000, 4000, 100000 };
+
+    for (int i = 0 ; i < (int)ARRAY_SIZE_IN_ELEMENTS(PileSizes) ; i++) {
+        RunPile(PileSizes[i]);
+    }
+
+    int ForceSizes[] = { 10000, 100000, 1000000 };
+
+    for (int i = 0 ; i < (int)ARRAY_SIZE_IN_ELEMENTS(ForceSizes) ; i++) {
+        RunForces(ForceSizes[i]);
+    }
+
+    if (NumFailures > 0) {
+        printf("%d checks failed\n", NumFailures);
+        return 1;
+    }
+
+    return 0;
+}
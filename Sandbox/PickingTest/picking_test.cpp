@@ -0,0 +1,306 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    CPU picking test. Builds the triangle BVHs of a model with two meshes in
+    different nodes, places it with a rotated, scaled and translated object
+    matrix and checks the ray casts against the triangles in the draw order
+    (ObjectMatrix * MeshTransformation) and against a brute force test.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+
+#include "Int/core_triangle_bvh.h"
+
+#define GRID_SIZE 8
+#define NUM_RANDOM_RAYS 10000
+#define EPSILON 1e-3f
+
+static int NumFailures = 0;
+
+
+static void Check(bool Condition, const char* pName)
+{
+    printf("%-60s %s\n", pName, Condition ? "OK" : "FAILED");
+
+    if (!Condition) {
+        NumFailures++;
+    }
+}
+
+
+static float RandomFloat(float Min, float Max)
+{
+    return Min + (Max - Min) * ((float)rand() / (float)RAND_MAX);
+}
+
+
+struct TestMesh {
+    std::vector<Vector3f> Positions;
+    std::vector<uint> Indices;
+    Matrix4f Transformation;    // node transformations from the root down to the mesh
+    TriangleBVH BVH;
+};
+
+
+struct TestModel {
+    TestMesh Meshes[2];
+    Matrix4f ObjectMatrix;
+};
+
+
+// GRID_SIZE x GRID_SIZE quads in the XY plane facing +Z
+static void InitGrid(TestMesh& Mesh)
+{
+    for (int y = 0 ; y <= GRID_SIZE ; y++) {
+        for (int x = 0 ; x <= GRID_SIZE ; x++) {
+            Mesh.Positions.push_back(Vector3f((float)x / GRID_SIZE - 0.5f, (float)y / GRID_SIZE - 0.5f, 0.0f));
+        }
+    }
+
+    for (uint y = 0 ; y < GRID_SIZE ; y++) {
+        for (uint x = 0 ; x < GRID_SIZE ; x++) {
+            uint i0 = y * (GRID_SIZE + 1) + x;
+            uint i1 = i0 + 1;
+            uint i2 = i0 + GRID_SIZE + 1;
+            uint i3 = i2 + 1;
+
+            uint Quad[] = { i0, i1, i2, i2, i1, i3 };
+            Mesh.Indices.insert(Mesh.Indices.end(), Quad, Quad + 6);
+        }
+    }
+
+    Mesh.BVH.Build(Mesh.Positions.data(), (uint)Mesh.Positions.size(), Mesh.Indices.data(), (uint)Mesh.Indices.size());
+}
+
+
+static void InitModel(TestModel& Model)
+{
+    InitGrid(Model.Meshes[0]);
+    InitGrid(Model.Meshes[1]);
+
+    // Root node -> child node -> mesh, the same as CoreModel::TraverseNodeHierarchy
+    Matrix4f Root, Child, Translation, Scale;
+    Root.InitRotateTransform(0.0f, 0.0f, 20.0f);
+
+    Translation.InitTranslationTransform(-3.0f, 0.0f, 0.0f);
+    Child.InitRotateTransform(0.0f, 30.0f, 0.0f);
+    Model.Meshes[0].Transformation = Root * Translation * Child;
+
+    Translation.InitTranslationTransform(3.0f, 1.0f, 0.0f);
+    Child.InitRotateTransform(-40.0f, 0.0f, 0.0f);
+    Scale.InitScaleTransform(2.0f);
+    Model.Meshes[1].Transformation = Root * Translation * Child * Scale;
+
+    Matrix4f ObjectTranslation, ObjectRotation, ObjectScale;
+    ObjectTranslation.InitTranslationTransform(5.0f, -2.0f, 30.0f);
+    ObjectRotation.InitRotateTransform(10.0f, 90.0f, 0.0f);
+    ObjectScale.InitScaleTransform(1.5f);
+    Model.ObjectMatrix = ObjectTranslation * ObjectRotation * ObjectScale;
+}
+
+
+static Matrix4f GetWorldMatrix(const TestModel& Model, uint MeshIndex)
+{
+    return Model.ObjectMatrix * Model.Meshes[MeshIndex].Transformation;
+}
+
+
+// Same as CoreModel::RayCast
+static bool RayCastModel(const TestModel& Model, const Vector3f& Origin, const Vector3f& Dir, float MaxDistance,
+                         uint& MeshIndex, TriangleHit& Hit)
+{
+    bool Found = false;
+    float Closest = MaxDistance;
+
+    for (uint i = 0 ; i < 2 ; i++) {
+        TriangleHit TriHit;
+
+        if (Model.Meshes[i].BVH.RayCast(GetWorldMatrix(Model, i), Origin, Dir, Closest, TriHit)) {
+            Closest = TriHit.Distance;
+            MeshIndex = i;
+            Hit = TriHit;
+            Found = true;
+        }
+    }
+
+    return Found;
+}
+
+
+// Moller-Trumbore against the world space triangles
+static bool RayCastBruteForce(const TestModel& Model, const Vector3f& Origin, const Vector3f& Dir, float MaxDistance,
+                              uint& MeshIndex, TriangleHit& Hit)
+{
+    bool Found = false;
+    float Closest = MaxDistance;
+
+    for (uint i = 0 ; i < 2 ; i++) {
+        const TestMesh& Mesh = Model.Meshes[i];
+        Matrix4f World = GetWorldMatrix(Model, i);
+
+        for (uint t = 0 ; t < Mesh.Indices.size() / 3 ; t++) {
+            Vector3f v0 = (World * Vector4f(Mesh.Positions[Mesh.Indices[t * 3]], 1.0f)).to3f();
+            Vector3f v1 = (World * Vector4f(Mesh.Positions[Mesh.Indices[t * 3 + 1]], 1.0f)).to3f();
+            Vector3f v2 = (World * Vector4f(Mesh.Positions[Mesh.Indices[t * 3 + 2]], 1.0f)).to3f();
+
+            Vector3f e1 = v1 - v0;
+            Vector3f e2 = v2 - v0;
+            Vector3f p = Dir.Cross(e2);
+            float Det = e1.Dot(p);
+
+            if (fabsf(Det) < 1e-12f) {
+                continue;
+            }
+
+            float InvDet = 1.0f / Det;
+            Vector3f s = Origin - v0;
+            float u = s.Dot(p) * InvDet;
+            Vector3f q = s.Cross(e1);
+            float v = Dir.Dot(q) * InvDet;
+            float Distance = e2.Dot(q) * InvDet;
+
+            if ((u >= 0.0f) && (v >= 0.0f) && (u + v <= 1.0f) && (Distance >= 0.0f) && (Distance < Closest)) {
+                Closest = Distance;
+                MeshIndex = i;
+                Hit.Triangle = t;
+                Hit.Distance = Distance;
+                Found = true;
+            }
+        }
+    }
+
+    return Found;
+}
+
+
+static Vector3f GetCentroid(const TestMesh& Mesh, uint Triangle)
+{
+    return (Mesh.Positions[Mesh.Indices[Triangle * 3]] +
+            Mesh.Positions[Mesh.Indices[Triangle * 3 + 1]] +
+            Mesh.Positions[Mesh.Indices[Triangle * 3 + 2]]) / 3.0f;
+}
+
+
+// Casts a short ray at the center of every triangle along the world space normal
+static void TestTriangleCenters(const TestModel& Model)
+{
+    printf("\nRays at the triangle centers\n");
+
+    for (uint i = 0 ; i < 2 ; i++) {
+        const TestMesh& Mesh = Model.Meshes[i];
+        Matrix4f World = GetWorldMatrix(Model, i);
+        Matrix4f WrongWorld = Mesh.Transformation * Model.ObjectMatrix;
+
+        Vector3f Normal = (World * Vector4f(0.0f, 0.0f, 1.0f, 0.0f)).to3f();
+        Normal.Normalize();
+
+        bool AllHit = true;
+        bool WrongOrderMisses = true;
+
+        for (uint t = 0 ; t < Mesh.Indices.size() / 3 ; t++) {
+            Vector3f Center = (World * Vector4f(GetCentroid(Mesh, t), 1.0f)).to3f();
+
+            // Starts one unit in front of the triangle and is two units long
+            Vector3f Origin = Center + Normal;
+            Vector3f Dir = Normal * -2.0f;
+
+            uint MeshIndex = 0;
+            TriangleHit Hit;
+            bool Found = RayCastModel(Model, Origin, Dir, 1.0f, MeshIndex, Hit);
+
+            AllHit = AllHit && Found && (MeshIndex == i) && (Hit.Triangle == t) && (fabsf(Hit.Distance - 0.5f) < EPSILON);
+
+            // The same ray at the point where the other order would put the triangle
+            Vector3f WrongCenter = (WrongWorld * Vector4f(GetCentroid(Mesh, t), 1.0f)).to3f();
+            Found = RayCastModel(Model, WrongCenter + Normal, Dir, 1.0f, MeshIndex, Hit);
+
+            if (Found && (MeshIndex == i) && (Hit.Triangle == t)) {
+                WrongOrderMisses = false;
+            }
+        }
+
+        char Name[64];
+        snprintf(Name, sizeof(Name), "mesh %d: every triangle is picked at its center", i);
+        Check(AllHit, Name);
+        snprintf(Name, sizeof(Name), "mesh %d: nothing is picked in the wrong order", i);
+        Check(WrongOrderMisses, Name);
+    }
+}
+
+
+// Random rays from around the model compared with the brute force test
+static void TestRandomRays(const TestModel& Model)
+{
+    printf("\nRandom rays\n");
+
+    Vector3f Center = (Model.ObjectMatrix * Vector4f(0.0f, 0.0f, 0.0f, 1.0f)).to3f();
+
+    int NumHits = 0;
+    int NumMismatches = 0;
+
+    for (int i = 0 ; i < NUM_RANDOM_RAYS ; i++) {
+        Vector3f Origin = Center + Vector3f(RandomFloat(-20.0f, 20.0f), RandomFloat(-20.0f, 20.0f), RandomFloat(-20.0f, 20.0f));
+        Vector3f Target = Center + Vector3f(RandomFloat(-6.0f, 6.0f), RandomFloat(-6.0f, 6.0f), RandomFloat(-6.0f, 6.0f));
+        Vector3f Dir = Target - Origin;
+
+        uint MeshIndex = 0, RefMeshIndex = 0;
+        TriangleHit Hit, RefHit;
+        bool Found = RayCastModel(Model, Origin, Dir, 2.0f, MeshIndex, Hit);
+        bool RefFound = RayCastBruteForce(Model, Origin, Dir, 2.0f, RefMeshIndex, RefHit);
+
+        if (Found != RefFound) {
+            NumMismatches++;
+        } else if (Found) {
+            NumHits++;
+
+            // Rays through a shared edge may pick either triangle so only the distance is compared
+            if (fabsf(Hit.Distance - RefHit.Distance) > EPSILON) {
+                NumMismatches++;
+            }
+        }
+    }
+
+    printf("%d rays, %d hits, %d mismatches\n", NUM_RANDOM_RAYS, NumHits, NumMismatches);
+
+    // A few rays may graze an edge and be found by only one of the tests
+    Check((NumHits > NUM_RANDOM_RAYS / 100) && (NumMismatches <= NUM_RANDOM_RAYS / 1000), "random rays match the brute force test");
+}
+
+
+int main(int argc, char* argv[])
+{
+    srand(0);
+
+    TestModel Model;
+    InitModel(Model);
+
+    TestTriangleCenters(Model);
+    TestRandomRays(Model);
+
+    if (NumFailures > 0) {
+        printf("\n%d checks failed\n", NumFailures);
+        return 1;
+    }
+
+    printf("\nAll checks passed\n");
+
+    return 0;
+}
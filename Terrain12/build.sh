@@ -12,8 +12,10 @@ SOURCES="terrain_demo12.cpp \
 	midpoint_disp_terrain.cpp \
 	terrain.cpp \
 	lod_manager.cpp \
+	terrain_tile_cache.cpp \
 	$OGLDEV_DIR/Common/ogldev_util.cpp \
 	$OGLDEV_DIR/Common/math_3d.cpp \
+	$OGLDEV_DIR/Common/ogldev_heightmap_generators.cpp \
 	$OGLDEV_DIR/Common/ogldev_basic_glfw_camera.cpp \
 	$OGLDEV_DIR/Common/ogldev_glfw.cpp \
 	$OGLDEV_DIR/Common/ogldev_stb_image.cpp \
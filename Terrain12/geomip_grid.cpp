@@ -23,6 +23,7 @@
 #include "ogldev_math_3d.h"
 #include "geomip_grid.h"
 #include "terrain.h"
+#include "terrain_tile_cache.h"
 
 int gShowPoints = 0;
 
@@ -42,19 +43,74 @@ void GeomipGrid::Destroy()
 {
     if (m_vao > 0) {
         glDeleteVertexArrays(1, &m_vao);
+        m_vao = 0;
     }
 
     if (m_vb > 0) {
         glDeleteBuffers(1, &m_vb);
+        m_vb = 0;
     }
 
     if (m_ib > 0) {
         glDeleteBuffers(1, &m_ib);
+        m_ib = 0;
     }
+
+    m_pTileCache = NULL;
 }
 
 
 void GeomipGrid::CreateGeomipGrid(int Width, int Depth, int PatchSize, const BaseTerrain* pTerrain)
+{
+    InitGridParams(Width, Depth, PatchSize, pTerrain);
+
+    m_numPatchesX = (Width - 1) / (PatchSize - 1);
+    m_numPatchesZ = (Depth - 1) / (PatchSize - 1);
+
+    m_maxLOD = m_lodManager.InitLodManager(PatchSize, m_numPatchesX, m_numPatchesZ, m_worldScale);
+    m_lodInfo.resize(m_maxLOD + 1);
+
+    CreateGLState();
+
+	PopulateBuffers(pTerrain);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+
+void GeomipGrid::CreatePagedGeomipGrid(int TileSize, int PatchSize, const BaseTerrain* pTerrain, TerrainTileCache* pTileCache)
+{
+    // The indices are the same for every tile so the grid is a single tile
+    InitGridParams(TileSize, TileSize, PatchSize, pTerrain);
+
+    m_pTileCache = pTileCache;
+
+    // The LOD manager works on the patches of the entire world
+    int WorldSize = pTileCache->GetWorldSize();
+    m_numPatchesX = (WorldSize - 1) / (PatchSize - 1);
+    m_numPatchesZ = m_numPatchesX;
+
+    m_maxLOD = m_lodManager.InitLodManager(PatchSize, m_numPatchesX, m_numPatchesZ, m_worldScale, false);
+    m_lodInfo.resize(m_maxLOD + 1);
+
+    int NumIndices = CalcNumIndices();
+	std::vector<unsigned int> Indices;
+    Indices.resize(NumIndices);
+
+    NumIndices = InitIndices(Indices);
+
+    // There is no VAO yet so the buffer is filled through the array buffer target.
+    // The tile cache binds it as the element buffer of each tile VAO.
+    glGenBuffers(1, &m_ib);
+    glBindBuffer(GL_ARRAY_BUFFER, m_ib);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Indices[0]) * NumIndices, &Indices[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+void GeomipGrid::InitGridParams(int Width, int Depth, int PatchSize, const BaseTerrain* pTerrain)
 {
     if ((Width - 1) % (PatchSize - 1) != 0) {
         int RecommendedWidth = ((Width - 1 + PatchSize - 1) / (PatchSize - 1)) * (PatchSize - 1) + 1;
@@ -85,23 +141,10 @@ void GeomipGrid::CreateGeomipGrid(int Width, int Depth, int PatchSize, const Bas
     m_patchSize = PatchSize;
     m_pTerrain = pTerrain;
 
-    m_numPatchesX = (Width - 1) / (PatchSize - 1);
-    m_numPatchesZ = (Depth - 1) / (PatchSize - 1);
-
     m_worldScale = pTerrain->GetWorldScale();
-    m_maxLOD = m_lodManager.InitLodManager(PatchSize, m_numPatchesX, m_numPatchesZ, m_worldScale);
-    m_lodInfo.resize(m_maxLOD + 1);
 
     m_patchWorldSize = (m_patchSize - 1) * m_worldScale;  // m_patchSize is in vertices and PatchSize is the actual size (2 vertices --> size 1)
     m_patchWorldHalfSize = m_patchWorldSize / 2.0f;
-
-    CreateGLState();
-
-	PopulateBuffers(pTerrain);
-
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
 
@@ -118,6 +161,12 @@ void GeomipGrid::CreateGLState()
     glGenBuffers(1, &m_ib);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ib);
 
+    InitVertexAttribs();
+}
+
+
+void GeomipGrid::InitVertexAttribs()
+{
     int POS_LOC = 0;
     int TEX_LOC = 1;
 	int NORMAL_LOC = 2;
@@ -385,6 +434,11 @@ void clrscr()
 
 void GeomipGrid::Render(const Vector3f& CameraPos, const Matrix4f& ViewProj)
 {
+    if (m_pTileCache) {
+        RenderPaged(CameraPos, ViewProj);
+        return;
+    }
+
 #ifdef _WIN64
     if (gShowPoints == 3) {
         clrscr();
@@ -447,6 +501,57 @@ void GeomipGrid::Render(const Vector3f& CameraPos, const Matrix4f& ViewProj)
 }
 
 
+void GeomipGrid::RenderPaged(const Vector3f& CameraPos, const Matrix4f& ViewProj)
+{
+    m_pTileCache->Update(CameraPos);
+
+    FrustumCulling fc(ViewProj);
+
+    int TileStep = m_width - 1;
+    int PatchesPerTile = TileStep / (m_patchSize - 1);
+
+    // Tiles that are still loading leave a hole. The closest tiles are loaded first
+    // so the holes are usually far away.
+    for (const TerrainTile* pTile : m_pTileCache->GetResidentTiles()) {
+        glBindVertexArray(pTile->VAO);
+
+        for (int PatchZ = 0 ; PatchZ < PatchesPerTile ; PatchZ++) {
+            for (int PatchX = 0 ; PatchX < PatchesPerTile ; PatchX++) {
+                // Heightmap coordinates in the tile and in the world
+                int x = PatchX * (m_patchSize - 1);
+                int z = PatchZ * (m_patchSize - 1);
+                int WorldX = pTile->TileX * TileStep + x;
+                int WorldZ = pTile->TileZ * TileStep + z;
+
+                if (!IsCameraInPatch(CameraPos, WorldX, WorldZ) &&
+                    !IsPatchInsideViewFrustum_WorldSpace(WorldX, WorldZ, fc) &&
+                    !IsCameraCloseToPatch(CameraPos, WorldX, WorldZ)) {
+                    continue;
+                }
+
+                LodManager::PatchLod plod = m_lodManager.CalcPatchLod(CameraPos,
+                                                                      pTile->TileX * PatchesPerTile + PatchX,
+                                                                      pTile->TileZ * PatchesPerTile + PatchZ);
+                int C = plod.Core;
+                int L = plod.Left;
+                int R = plod.Right;
+                int T = plod.Top;
+                int B = plod.Bottom;
+
+                size_t BaseIndex = sizeof(unsigned int) * m_lodInfo[C].info[L][R][T][B].Start;
+
+                int BaseVertex = z * m_width + x;
+
+                glDrawElementsBaseVertex(GL_TRIANGLES, m_lodInfo[C].info[L][R][T][B].Count,
+                                         GL_UNSIGNED_INT, (void*)BaseIndex, BaseVertex);
+            }
+        }
+    }
+
+    glBindVertexArray(0);
+}
+
+
 bool GeomipGrid::IsPatchInsideViewFrustum_ViewSpace(int X, int Z, const Matrix4f& ViewProj)
 {
     int x0 = X;
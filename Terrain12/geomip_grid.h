@@ -29,6 +29,7 @@
 // this header is included by terrain.h so we have a forward 
 // declaration for BaseTerrain.
 class BaseTerrain;
+class TerrainTileCache;
 
 class GeomipGrid {
  public:
@@ -38,11 +39,15 @@ class GeomipGrid {
 
     void CreateGeomipGrid(int Width, int Depth, int PatchSize, const BaseTerrain* pTerrain);
 
+    // Paged mode - only the index buffer of a single tile is created here. The vertices
+    // of every tile are owned by the tile cache and share this index buffer.
+    void CreatePagedGeomipGrid(int TileSize, int PatchSize, const BaseTerrain* pTerrain, TerrainTileCache* pTileCache);
+
     void Destroy();
 
     void Render(const Vector3f& CameraPos, const Matrix4f& ViewProj);
 
- private:
+    GLuint GetIndexBuffer() const { return m_ib; }
 
     struct Vertex {
         Vector3f Pos;
@@ -52,7 +57,16 @@ class GeomipGrid {
         void InitVertex(const BaseTerrain* pTerrain, int x, int z);
     };
 
+    // Sets the attributes of the Vertex struct for the currently bound VAO and VB
+    static void InitVertexAttribs();
+
+ private:
+
+    void InitGridParams(int Width, int Depth, int PatchSize, const BaseTerrain* pTerrain);
+
     void CreateGLState();
+
+    void RenderPaged(const Vector3f& CameraPos, const Matrix4f& ViewProj);
 	
     void PopulateBuffers(const BaseTerrain* pTerrain);
     
@@ -108,6 +122,7 @@ class GeomipGrid {
     int m_numPatchesZ = 0;
     LodManager m_lodManager;
     const BaseTerrain* m_pTerrain = NULL;
+    TerrainTileCache* m_pTileCache = NULL;
     float m_patchWorldSize = 0.0f;
     float m_patchWorldHalfSize = 0.0f;
 };
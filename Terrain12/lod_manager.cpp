@@ -4,7 +4,7 @@
 #include "demo_config.h"
 
 
-int LodManager::InitLodManager(int PatchSize, int NumPatchesX, int NumPatchesZ, float WorldScale)
+int LodManager::InitLodManager(int PatchSize, int NumPatchesX, int NumPatchesZ, float WorldScale, bool CreateLodMap)
 {
     m_patchSize = PatchSize;
     m_numPatchesX = NumPatchesX;
@@ -13,8 +13,10 @@ int LodManager::InitLodManager(int PatchSize, int NumPatchesX, int NumPatchesZ,
 
     CalcMaxLOD();
 
-    PatchLod Zero;
-    m_map.InitArray2D(NumPatchesX, NumPatchesZ, Zero);
+    if (CreateLodMap) {
+        PatchLod Zero;
+        m_map.InitArray2D(NumPatchesX, NumPatchesZ, Zero);
+    }
 
     m_regions.resize(m_maxLOD + 1);
 
@@ -50,23 +52,27 @@ void LodManager::Update(const Vector3f& CameraPos)
 
 void LodManager::UpdateLodMapPass1(const Vector3f& CameraPos)
 {
-    int CenterStep = m_patchSize / 2;
-
     for (int LodMapZ = 0 ; LodMapZ < m_numPatchesZ ; LodMapZ++) {
         for (int LodMapX = 0 ; LodMapX < m_numPatchesX ; LodMapX++) {
-            int x = LodMapX * (m_patchSize - 1) + CenterStep;
-            int z = LodMapZ * (m_patchSize - 1) + CenterStep;
+            PatchLod* pPatchLOD = m_map.GetAddr(LodMapX, LodMapZ);
+            pPatchLOD->Core = CalcCoreLod(CameraPos, LodMapX, LodMapZ);
+        }
+    }
+}
 
-            Vector3f PatchCenter = Vector3f(x * (float)m_worldScale, 0.0f, z * (float)m_worldScale);
 
-            float DistanceToCamera = CameraPos.Distance(PatchCenter);
+int LodManager::CalcCoreLod(const Vector3f& CameraPos, int PatchX, int PatchZ) const
+{
+    int CenterStep = m_patchSize / 2;
 
-            int CoreLod = DistanceToLod(DistanceToCamera);
+    int x = PatchX * (m_patchSize - 1) + CenterStep;
+    int z = PatchZ * (m_patchSize - 1) + CenterStep;
 
-            PatchLod* pPatchLOD = m_map.GetAddr(LodMapX, LodMapZ);
-            pPatchLOD->Core = CoreLod;
-        }
-    }
+    Vector3f PatchCenter = Vector3f(x * (float)m_worldScale, 0.0f, z * (float)m_worldScale);
+
+    float DistanceToCamera = CameraPos.Distance(PatchCenter);
+
+    return DistanceToLod(DistanceToCamera);
 }
 
 
@@ -139,7 +145,7 @@ void LodManager::PrintLodMap()
 }
 
 
-int LodManager::DistanceToLod(float Distance)
+int LodManager::DistanceToLod(float Distance) const
 {
     int Lod = m_maxLOD;
 
@@ -160,6 +166,32 @@ const LodManager::PatchLod& LodManager::GetPatchLod(int PatchX, int PatchZ) cons
 }
 
 
+LodManager::PatchLod LodManager::CalcPatchLod(const Vector3f& CameraPos, int PatchX, int PatchZ) const
+{
+    PatchLod plod;
+
+    plod.Core = CalcCoreLod(CameraPos, PatchX, PatchZ);
+
+    if (PatchX > 0) {
+        plod.Left = CalcCoreLod(CameraPos, PatchX - 1, PatchZ) > plod.Core ? 1 : 0;
+    }
+
+    if (PatchX < m_numPatchesX - 1) {
+        plod.Right = CalcCoreLod(CameraPos, PatchX + 1, PatchZ) > plod.Core ? 1 : 0;
+    }
+
+    if (PatchZ > 0) {
+        plod.Bottom = CalcCoreLod(CameraPos, PatchX, PatchZ - 1) > plod.Core ? 1 : 0;
+    }
+
+    if (PatchZ < m_numPatchesZ - 1) {
+        plod.Top = CalcCoreLod(CameraPos, PatchX, PatchZ + 1) > plod.Core ? 1 : 0;
+    }
+
+    return plod;
+}
+
+
 void LodManager::CalcLodRegions()
 {
     int Sum = 0;
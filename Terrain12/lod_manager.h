@@ -9,7 +9,8 @@
 class LodManager {
  public:
 
-    int InitLodManager(int PatchSize, int NumPatchesX, int NumPatchesZ, float WorldScale);
+    // The paged terrain does not need the LOD map - the LOD of a patch is calculated when it is rendered
+    int InitLodManager(int PatchSize, int NumPatchesX, int NumPatchesZ, float WorldScale, bool CreateLodMap = true);
 
     void Update(const Vector3f& CameraPos);
 
@@ -23,6 +24,9 @@ class LodManager {
 
     const PatchLod& GetPatchLod(int PatchX, int PatchZ) const;
 
+    // Same result as GetPatchLod() after Update() but without the LOD map
+    PatchLod CalcPatchLod(const Vector3f& CameraPos, int PatchX, int PatchZ) const;
+
     void PrintLodMap();
 
  private:
@@ -31,7 +35,9 @@ class LodManager {
     void UpdateLodMapPass1(const Vector3f& CameraPos);
     void UpdateLodMapPass2(const Vector3f& CameraPos);
 
-    int DistanceToLod(float Distance);
+    int CalcCoreLod(const Vector3f& CameraPos, int PatchX, int PatchZ) const;
+
+    int DistanceToLod(float Distance) const;
 
     int m_maxLOD = 0;
     int m_patchSize = 0;
@@ -27,12 +27,7 @@ class MidpointDispTerrain : public BaseTerrain {
  public:
     MidpointDispTerrain() {}
 
-    void CreateMidpointDisplacement(int Size, int PatchSize, float Roughness, float MinHeight, float MaxHeight);
-
- private:
-    void CreateMidpointDisplacementF32(float Roughness);
-    void DiamondStep(int RectSize, float CurHeight);
-    void SquareStep(int RectSize, float CurHeight);
+    void CreateMidpointDisplacement(int Size, int PatchSize, float Roughness, float MinHeight, float MaxHeight, unsigned int Seed);
 };
 
 #endif
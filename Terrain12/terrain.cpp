@@ -26,6 +26,7 @@
 
 #include "terrain.h"
 #include "texture_config.h"
+#include "demo_config.h"
 #include "3rdparty/stb_image_write.h"
 
 //#define DEBUG_PRINT
@@ -40,6 +41,7 @@ void BaseTerrain::Destroy()
 {
     m_heightMap.Destroy();
     m_geomipGrid.Destroy();
+    SAFE_DELETE(m_pTileCache);
 }
 
 
@@ -76,6 +78,19 @@ void BaseTerrain::Finalize()
 }
 
 
+float BaseTerrain::GetHeight(int x, int z) const
+{
+    if (m_pTileCache) {
+        // Zero until the tile is loaded
+        float Height = 0.0f;
+        m_pTileCache->GetHeight(x, z, Height);
+        return Height;
+    }
+
+    return m_heightMap.Get(x, z);
+}
+
+
 float BaseTerrain::GetHeightInterpolated(float x, float z) const
 {
     float X0Z0Height = GetHeight((int)x, (int)z);
@@ -154,6 +169,48 @@ void BaseTerrain::SaveToFile(const char* pFilename)
 }
 
 
+void BaseTerrain::LoadTiledHeightMap(const char* pFilename, int PatchSize, size_t MemoryBudget)
+{
+    Destroy();
+
+    m_pTileCache = new TerrainTileCache();
+    m_pTileCache->Open(pFilename);
+
+    int TileSize = m_pTileCache->GetTileSize();
+
+    if ((TileSize - 1) % (PatchSize - 1) != 0) {
+        printf("%s:%d - tile size minus 1 (%d) must be divisible by patch size minus 1 (%d)\n", __FILE__, __LINE__, TileSize - 1, PatchSize - 1);
+        exit(0);
+    }
+
+    m_terrainSize = m_pTileCache->GetWorldSize();
+    m_patchSize = PatchSize;
+
+    SetMinMaxHeight(m_pTileCache->GetMinHeight(), m_pTileCache->GetMaxHeight());
+
+    m_geomipGrid.CreatePagedGeomipGrid(TileSize, PatchSize, this, m_pTileCache);
+
+    // Nothing is drawn beyond the far plane so there is no point in loading it
+    m_pTileCache->Start(m_geomipGrid.GetIndexBuffer(), m_worldScale, m_textureScale, Z_FAR, MemoryBudget);
+}
+
+
+void BaseTerrain::SaveToTiledFile(const char* pFilename, int TileSize)
+{
+    if (m_pTileCache) {
+        printf("%s:%d - the terrain is already paged\n", __FILE__, __LINE__);
+        return;
+    }
+
+    if ((TileSize - 1) % (m_patchSize - 1) != 0) {
+        printf("%s:%d - tile size minus 1 (%d) must be divisible by patch size minus 1 (%d)\n", __FILE__, __LINE__, TileSize - 1, m_patchSize - 1);
+        exit(0);
+    }
+
+    TerrainTileCache::WriteTiledHeightMap(pFilename, m_heightMap, m_terrainSize, TileSize, m_minHeight, m_maxHeight);
+}
+
+
 void BaseTerrain::Render(const BasicCamera& Camera)
 {
     Matrix4f VP = Camera.GetViewProjMatrix();
@@ -25,6 +25,7 @@
 #include "ogldev_texture.h"
 
 #include "geomip_grid.h"
+#include "terrain_tile_cache.h"
 #include "terrain_technique.h"
 #include "ogldev_skydome.h"
 
@@ -45,7 +46,15 @@ class BaseTerrain
 
     void SaveToFile(const char* pFilename);
 
-	float GetHeight(int x, int z) const { return m_heightMap.Get(x, z); }
+    // Paged mode. Only the tiles around the camera are in memory (see TerrainTileCache).
+    void LoadTiledHeightMap(const char* pFilename, int PatchSize, size_t MemoryBudget);
+
+    // TileSize minus 1 must divide the terrain size minus 1 and be a multiple of the patch size minus 1
+    void SaveToTiledFile(const char* pFilename, int TileSize);
+
+    const TerrainTileCache* GetTileCache() const { return m_pTileCache; }
+
+	float GetHeight(int x, int z) const;
 	
     float GetHeightInterpolated(float x, float z) const;
 
@@ -92,6 +101,7 @@ private:
     Vector3f m_lightDir;
     float m_cameraHeight = 2.0f;
     Skydome* m_pSkydome = NULL;
+    TerrainTileCache* m_pTileCache = NULL;
 };
 
 #endif
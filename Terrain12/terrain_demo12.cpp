@@ -48,6 +48,12 @@ static void MouseButtonCallback(GLFWwindow* window, int Button, int Action, int
 
 static int g_seed = 0;
 
+// Optional tiled heightmap on the command line - the terrain is paged from it
+static const char* g_pTiledHeightMap = NULL;
+
+#define TILE_CACHE_BUDGET (384 * 1024 * 1024)
+#define SAVED_TILE_SIZE 129
+
 extern int gShowPoints;
 
 
@@ -107,11 +113,21 @@ public:
 
                 if (ImGui::Button("Generate")) {
                     m_terrain.Destroy();
-                    srand(g_seed);
-                    m_terrain.CreateMidpointDisplacement(m_terrainSize, m_patchSize, m_roughness, m_minHeight, m_maxHeight);
+                    m_terrain.CreateMidpointDisplacement(m_terrainSize, m_patchSize, m_roughness, m_minHeight, m_maxHeight, g_seed);
                     m_terrain.SetTextureHeights(Height0, Height1, Height2, Height3);
                 }
 
+                if (ImGui::Button("Save tiled heightmap")) {
+                    m_terrain.SaveToTiledFile("heightmap.tth", SAVED_TILE_SIZE);
+                }
+
+                const TerrainTileCache* pTileCache = m_terrain.GetTileCache();
+
+                if (pTileCache) {
+                    ImGui::Text("Tiles: %d resident (%.1f MB), %d loading", pTileCache->GetNumResidentTiles(),
+                                (float)pTileCache->GetResidentBytes() / (1024.0f * 1024.0f), pTileCache->GetNumPendingTiles());
+                }
+
                 ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
                 ImGui::End();
 
@@ -293,7 +309,11 @@ private:
 
         m_terrain.InitTerrain(WorldScale, TextureScale, TextureFilenames);
 
-        m_terrain.CreateMidpointDisplacement(m_terrainSize, m_patchSize, m_roughness, m_minHeight, m_maxHeight);
+        if (g_pTiledHeightMap) {
+            m_terrain.LoadTiledHeightMap(g_pTiledHeightMap, m_patchSize, TILE_CACHE_BUDGET);
+        } else {
+            m_terrain.CreateMidpointDisplacement(m_terrainSize, m_patchSize, m_roughness, m_minHeight, m_maxHeight, g_seed);
+        }
 
         Vector3f LightDir(0.0f, -1.0f, 0.0f);
 
@@ -373,6 +393,10 @@ int main(int argc, char** argv)
 #endif
     printf("random seed %d\n", g_seed);
 
+    if (argc > 1) {
+        g_pTiledHeightMap = argv[1];
+    }
+
     srand(g_seed);
 
     app = new TerrainDemo12();
@@ -0,0 +1,523 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <algorithm>
+
+#include "terrain_tile_cache.h"
+
+// Uploading a tile is a few MB so spread them over several frames
+#define MAX_TILE_UPLOADS_PER_FRAME 4
+#define MAX_TILE_LOADER_THREADS    4
+
+
+static bool SeekFile(FILE* f, long long Offset)
+{
+#ifdef _WIN32
+    return _fseeki64(f, Offset, SEEK_SET) == 0;
+#else
+    return fseeko(f, (off_t)Offset, SEEK_SET) == 0;
+#endif
+}
+
+
+TerrainTileCache::~TerrainTileCache()
+{
+    Destroy();
+}
+
+
+void TerrainTileCache::Open(const char* pFilename)
+{
+    FILE* f = fopen(pFilename, "rb");
+
+    if (!f) {
+        printf("%s:%d - unable to open '%s'\n", __FILE__, __LINE__, pFilename);
+        exit(0);
+    }
+
+    size_t NumRead = fread(&m_header, sizeof(m_header), 1, f);
+
+    fclose(f);
+
+    if ((NumRead != 1) || (m_header.Magic != TILED_HEIGHTMAP_MAGIC)) {
+        printf("%s:%d - '%s' is not a tiled heightmap\n", __FILE__, __LINE__, pFilename);
+        exit(0);
+    }
+
+    if (m_header.Version != TILED_HEIGHTMAP_VERSION) {
+        printf("%s:%d - '%s' has version %d, expected %d\n", __FILE__, __LINE__, pFilename, m_header.Version, TILED_HEIGHTMAP_VERSION);
+        exit(0);
+    }
+
+    if ((m_header.TileSize < 3) || (m_header.NumTilesX <= 0) || (m_header.NumTilesZ <= 0)) {
+        printf("%s:%d - '%s' has an invalid header\n", __FILE__, __LINE__, pFilename);
+        exit(0);
+    }
+
+    // The terrain is square everywhere else
+    if (m_header.NumTilesX != m_header.NumTilesZ) {
+        printf("%s:%d - '%s' is not square (%dx%d tiles)\n", __FILE__, __LINE__, pFilename, m_header.NumTilesX, m_header.NumTilesZ);
+        exit(0);
+    }
+
+    m_filename = pFilename;
+    m_apronSize = m_header.TileSize + 2;
+
+    printf("Tiled heightmap '%s': %dx%d tiles of %d vertices, world size %d\n", pFilename,
+           m_header.NumTilesX, m_header.NumTilesZ, m_header.TileSize, GetWorldSize());
+}
+
+
+void TerrainTileCache::Start(GLuint IndexBuffer, float WorldScale, float TextureScale, float LoadRadius, size_t MemoryBudget)
+{
+    assert(m_workers.empty());
+
+    m_indexBuffer = IndexBuffer;
+    m_worldScale = WorldScale;
+    m_textureScale = TextureScale;
+    m_loadRadius = LoadRadius;
+    m_memoryBudget = MemoryBudget;
+    m_tileBytes = m_apronSize * m_apronSize * sizeof(float) +
+                  m_header.TileSize * m_header.TileSize * sizeof(GeomipGrid::Vertex);
+    m_quit = false;
+
+    // The loaders mostly wait for the disk so leave a core for the render thread
+    int NumThreads = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+    NumThreads = std::min(NumThreads, MAX_TILE_LOADER_THREADS);
+
+    for (int i = 0 ; i < NumThreads ; i++) {
+        m_workers.push_back(std::thread(&TerrainTileCache::WorkerThread, this));
+    }
+
+    printf("Tile cache: %d loader threads, %.1f MB per tile, budget %.1f MB\n", NumThreads,
+           (float)m_tileBytes / (1024.0f * 1024.0f), (float)m_memoryBudget / (1024.0f * 1024.0f));
+}
+
+
+void TerrainTileCache::Destroy()
+{
+    {
+        std::lock_guard<std::mutex> Lock(m_mutex);
+        m_quit = true;
+    }
+
+    m_cond.notify_all();
+
+    for (std::thread& t : m_workers) {
+        t.join();
+    }
+
+    m_workers.clear();
+    m_requests.clear();
+    m_loaded.clear();
+
+    // Every tile - resident or in flight - is in the map
+    for (auto& it : m_tiles) {
+        FreeTile(it.second);
+    }
+
+    m_tiles.clear();
+    m_lru.clear();
+    m_residentBytes = 0;
+}
+
+
+void TerrainTileCache::WorkerThread()
+{
+    // Each thread has its own file handle so the seeks don't interfere
+    FILE* f = fopen(m_filename.c_str(), "rb");
+
+    if (!f) {
+        printf("%s:%d - unable to open '%s'\n", __FILE__, __LINE__, m_filename.c_str());
+        exit(0);
+    }
+
+    while (true) {
+        TerrainTile* pTile = NULL;
+
+        {
+            std::unique_lock<std::mutex> Lock(m_mutex);
+            m_cond.wait(Lock, [this] { return m_quit || !m_requests.empty(); });
+
+            if (m_quit) {
+                break;
+            }
+
+            pTile = m_requests.front();
+            m_requests.pop_front();
+        }
+
+        // Skip the tiles that the camera moved away from while they were waiting in the queue.
+        // They go back to the main thread empty and are dropped there.
+        if (pTile->Wanted) {
+            LoadTile(f, pTile);
+            InitTileVertices(pTile);
+        }
+
+        std::lock_guard<std::mutex> Lock(m_mutex);
+        m_loaded.push_back(pTile);
+    }
+
+    fclose(f);
+}
+
+
+void TerrainTileCache::LoadTile(FILE* pFile, TerrainTile* pTile)
+{
+    size_t NumFloats = m_apronSize * m_apronSize;
+    long long TileIndex = GetTileKey(pTile->TileX, pTile->TileZ);
+    long long Offset = sizeof(TiledHeightMapHeader) + TileIndex * NumFloats * sizeof(float);
+
+    pTile->Heights.resize(NumFloats);
+
+    if (!SeekFile(pFile, Offset) || (fread(pTile->Heights.data(), sizeof(float), NumFloats, pFile) != NumFloats)) {
+        printf("%s:%d - error reading tile %d,%d from '%s'\n", __FILE__, __LINE__, pTile->TileX, pTile->TileZ, m_filename.c_str());
+        exit(0);
+    }
+}
+
+
+void TerrainTileCache::InitTileVertices(TerrainTile* pTile)
+{
+    int TileSize = m_header.TileSize;
+    int BaseX = pTile->TileX * (TileSize - 1);
+    int BaseZ = pTile->TileZ * (TileSize - 1);
+    float Size = (float)GetWorldSize();
+    const float* pHeights = pTile->Heights.data();
+
+    pTile->Vertices.resize(TileSize * TileSize);
+    pTile->MinHeight = pHeights[m_apronSize + 1];
+    pTile->MaxHeight = pTile->MinHeight;
+
+    int Index = 0;
+
+    for (int z = 0 ; z < TileSize ; z++) {
+        // Row z of the tile is row z + 1 in the apron
+        const float* pRow = pHeights + (z + 1) * m_apronSize + 1;
+
+        for (int x = 0 ; x < TileSize ; x++) {
+            GeomipGrid::Vertex& v = pTile->Vertices[Index++];
+
+            float y = pRow[x];
+
+            pTile->MinHeight = std::min(pTile->MinHeight, y);
+            pTile->MaxHeight = std::max(pTile->MaxHeight, y);
+
+            int WorldX = BaseX + x;
+            int WorldZ = BaseZ + z;
+
+            v.Pos = Vector3f(WorldX * m_worldScale, y, WorldZ * m_worldScale);
+            v.Tex = Vector2f(m_textureScale * (float)WorldX / Size, m_textureScale * (float)WorldZ / Size);
+
+            // Central differences - the apron provides the samples across the tile border
+            float HeightLeft  = pRow[x - 1];
+            float HeightRight = pRow[x + 1];
+            float HeightDown  = pRow[x - m_apronSize];
+            float HeightUp    = pRow[x + m_apronSize];
+
+            v.Normal = Vector3f(HeightLeft - HeightRight, 2.0f * m_worldScale, HeightDown - HeightUp);
+            v.Normal.Normalize();
+        }
+    }
+}
+
+
+void TerrainTileCache::Update(const Vector3f& CameraPos)
+{
+    m_frame++;
+
+    ProcessLoadedTiles();
+
+    RequestTiles(CameraPos);
+
+    EvictTiles();
+}
+
+
+void TerrainTileCache::ProcessLoadedTiles()
+{
+    std::vector<TerrainTile*> Loaded;
+
+    {
+        std::lock_guard<std::mutex> Lock(m_mutex);
+
+        int NumToUpload = std::min((int)m_loaded.size(), MAX_TILE_UPLOADS_PER_FRAME);
+        Loaded.assign(m_loaded.begin(), m_loaded.begin() + NumToUpload);
+        m_loaded.erase(m_loaded.begin(), m_loaded.begin() + NumToUpload);
+    }
+
+    for (TerrainTile* pTile : Loaded) {
+        if (pTile->Heights.empty()) {
+            // Skipped by the loader. If the camera comes back it will be requested again.
+            m_tiles.erase(GetTileKey(pTile->TileX, pTile->TileZ));
+            FreeTile(pTile);
+            continue;
+        }
+
+        UploadTile(pTile);
+
+        pTile->IsResident = true;
+        pTile->LastUsedFrame = m_frame;
+        m_lru.push_front(pTile);
+        pTile->LRUPos = m_lru.begin();
+        m_residentBytes += m_tileBytes;
+    }
+}
+
+
+void TerrainTileCache::UploadTile(TerrainTile* pTile)
+{
+    glGenVertexArrays(1, &pTile->VAO);
+    glBindVertexArray(pTile->VAO);
+
+    glGenBuffers(1, &pTile->VB);
+    glBindBuffer(GL_ARRAY_BUFFER, pTile->VB);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(pTile->Vertices[0]) * pTile->Vertices.size(), pTile->Vertices.data(), GL_STATIC_DRAW);
+
+    // All the tiles have the same layout so they share the index buffer
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+
+    GeomipGrid::InitVertexAttribs();
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // The vertices are in the GPU now. Only the heights stay in RAM for the height queries.
+    std::vector<GeomipGrid::Vertex>().swap(pTile->Vertices);
+}
+
+
+void TerrainTileCache::RequestTiles(const Vector3f& CameraPos)
+{
+    float TileWorldSize = (m_header.TileSize - 1) * m_worldScale;
+
+    int MinTileX = std::max((int)floorf((CameraPos.x - m_loadRadius) / TileWorldSize), 0);
+    int MaxTileX = std::min((int)floorf((CameraPos.x + m_loadRadius) / TileWorldSize), m_header.NumTilesX - 1);
+    int MinTileZ = std::max((int)floorf((CameraPos.z - m_loadRadius) / TileWorldSize), 0);
+    int MaxTileZ = std::min((int)floorf((CameraPos.z + m_loadRadius) / TileWorldSize), m_header.NumTilesZ - 1);
+
+    struct NewTile {
+        int TileX;
+        int TileZ;
+        float Distance;
+    };
+
+    std::vector<NewTile> NewTiles;
+
+    for (int TileZ = MinTileZ ; TileZ <= MaxTileZ ; TileZ++) {
+        for (int TileX = MinTileX ; TileX <= MaxTileX ; TileX++) {
+            // Distance on the XZ plane from the camera to the closest point of the tile
+            float x0 = TileX * TileWorldSize;
+            float z0 = TileZ * TileWorldSize;
+            float dx = std::max(std::max(x0 - CameraPos.x, CameraPos.x - (x0 + TileWorldSize)), 0.0f);
+            float dz = std::max(std::max(z0 - CameraPos.z, CameraPos.z - (z0 + TileWorldSize)), 0.0f);
+            float Distance = sqrtf(dx * dx + dz * dz);
+
+            if (Distance > m_loadRadius) {
+                continue;
+            }
+
+            auto it = m_tiles.find(GetTileKey(TileX, TileZ));
+
+            if (it == m_tiles.end()) {
+                NewTiles.push_back({ TileX, TileZ, Distance });
+                continue;
+            }
+
+            TerrainTile* pTile = it->second;
+            pTile->LastUsedFrame = m_frame;
+            pTile->Wanted = true;
+
+            if (pTile->IsResident) {
+                m_lru.splice(m_lru.begin(), m_lru, pTile->LRUPos);
+            }
+        }
+    }
+
+    // Let the loaders skip the queued tiles that are no longer needed
+    for (auto& it : m_tiles) {
+        if (it.second->LastUsedFrame != m_frame) {
+            it.second->Wanted = false;
+        }
+    }
+
+    if (NewTiles.empty()) {
+        return;
+    }
+
+    // Closest tiles first
+    std::sort(NewTiles.begin(), NewTiles.end(), [](const NewTile& a, const NewTile& b) { return a.Distance < b.Distance; });
+
+    std::lock_guard<std::mutex> Lock(m_mutex);
+
+    for (const NewTile& t : NewTiles) {
+        TerrainTile* pTile = new TerrainTile;
+        pTile->TileX = t.TileX;
+        pTile->TileZ = t.TileZ;
+        pTile->LastUsedFrame = m_frame;
+        m_tiles[GetTileKey(t.TileX, t.TileZ)] = pTile;
+        m_requests.push_back(pTile);
+    }
+
+    m_cond.notify_all();
+}
+
+
+void TerrainTileCache::EvictTiles()
+{
+    while ((m_residentBytes > m_memoryBudget) && !m_lru.empty()) {
+        TerrainTile* pTile = m_lru.back();
+
+        // Everything that is left is in use by the current frame
+        if (pTile->LastUsedFrame == m_frame) {
+            if (!m_budgetWarningPrinted) {
+                printf("Warning: the tiles within the load radius need %.1f MB which is more than the tile cache budget (%.1f MB)\n",
+                       (float)m_residentBytes / (1024.0f * 1024.0f), (float)m_memoryBudget / (1024.0f * 1024.0f));
+                m_budgetWarningPrinted = true;
+            }
+            break;
+        }
+
+        m_lru.pop_back();
+        m_tiles.erase(GetTileKey(pTile->TileX, pTile->TileZ));
+        m_residentBytes -= m_tileBytes;
+        FreeTile(pTile);
+    }
+}
+
+
+void TerrainTileCache::FreeTile(TerrainTile* pTile)
+{
+    if (pTile->VAO > 0) {
+        glDeleteVertexArrays(1, &pTile->VAO);
+    }
+
+    if (pTile->VB > 0) {
+        glDeleteBuffers(1, &pTile->VB);
+    }
+
+    delete pTile;
+}
+
+
+const TerrainTile* TerrainTileCache::GetResidentTile(int TileX, int TileZ) const
+{
+    if ((TileX < 0) || (TileX >= m_header.NumTilesX) || (TileZ < 0) || (TileZ >= m_header.NumTilesZ)) {
+        return NULL;
+    }
+
+    auto it = m_tiles.find(GetTileKey(TileX, TileZ));
+
+    if ((it == m_tiles.end()) || !it->second->IsResident) {
+        return NULL;
+    }
+
+    return it->second;
+}
+
+
+bool TerrainTileCache::GetHeight(int x, int z, float& Height) const
+{
+    int Step = m_header.TileSize - 1;
+    int TileX = std::min(x / Step, m_header.NumTilesX - 1);
+    int TileZ = std::min(z / Step, m_header.NumTilesZ - 1);
+
+    const TerrainTile* pTile = GetResidentTile(TileX, TileZ);
+
+    // A sample on the border of a tile is also in the tiles to the left/bottom
+    // (the apron covers one more sample so the corner works too)
+    if (!pTile && (x % Step == 0) && (TileX > 0)) {
+        TileX--;
+        pTile = GetResidentTile(TileX, TileZ);
+    }
+
+    if (!pTile && (z % Step == 0) && (TileZ > 0)) {
+        TileZ--;
+        pTile = GetResidentTile(TileX, TileZ);
+    }
+
+    if (!pTile) {
+        return false;
+    }
+
+    int LocalX = x - TileX * Step;
+    int LocalZ = z - TileZ * Step;
+
+    Height = pTile->Heights[(LocalZ + 1) * m_apronSize + LocalX + 1];
+
+    return true;
+}
+
+
+void TerrainTileCache::WriteTiledHeightMap(const char* pFilename, const Array2D<float>& HeightMap, int Size,
+                                           int TileSize, float MinHeight, float MaxHeight)
+{
+    if ((TileSize < 3) || ((Size - 1) % (TileSize - 1) != 0)) {
+        printf("%s:%d - terrain size minus 1 (%d) must be divisible by tile size minus 1 (%d)\n", __FILE__, __LINE__, Size - 1, TileSize - 1);
+        exit(0);
+    }
+
+    FILE* f = fopen(pFilename, "wb");
+
+    if (!f) {
+        printf("%s:%d - unable to open '%s' for writing\n", __FILE__, __LINE__, pFilename);
+        exit(0);
+    }
+
+    TiledHeightMapHeader Header;
+    Header.TileSize = TileSize;
+    Header.NumTilesX = (Size - 1) / (TileSize - 1);
+    Header.NumTilesZ = Header.NumTilesX;
+    Header.MinHeight = MinHeight;
+    Header.MaxHeight = MaxHeight;
+
+    fwrite(&Header, sizeof(Header), 1, f);
+
+    int ApronSize = TileSize + 2;
+    std::vector<float> Tile(ApronSize * ApronSize);
+
+    for (int TileZ = 0 ; TileZ < Header.NumTilesZ ; TileZ++) {
+        for (int TileX = 0 ; TileX < Header.NumTilesX ; TileX++) {
+            int BaseX = TileX * (TileSize - 1) - 1;
+            int BaseZ = TileZ * (TileSize - 1) - 1;
+
+            for (int z = 0 ; z < ApronSize ; z++) {
+                for (int x = 0 ; x < ApronSize ; x++) {
+                    // The apron is clamped at the edges of the world
+                    int SrcX = std::min(std::max(BaseX + x, 0), Size - 1);
+                    int SrcZ = std::min(std::max(BaseZ + z, 0), Size - 1);
+                    Tile[z * ApronSize + x] = HeightMap.Get(SrcX, SrcZ);
+                }
+            }
+
+            fwrite(Tile.data(), sizeof(float), Tile.size(), f);
+        }
+    }
+
+    if (ferror(f)) {
+        printf("%s:%d - error writing '%s'\n", __FILE__, __LINE__, pFilename);
+        exit(0);
+    }
+
+    fclose(f);
+
+    printf("Saved %dx%d tiles of %d vertices to '%s'\n", Header.NumTilesX, Header.NumTilesZ, TileSize, pFilename);
+}
@@ -0,0 +1,163 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TERRAIN_TILE_CACHE_H
+#define TERRAIN_TILE_CACHE_H
+
+#include <GL/glew.h>
+#include <vector>
+#include <list>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "ogldev_math_3d.h"
+#include "ogldev_array_2d.h"
+#include "geomip_grid.h"
+
+//
+// Tiled heightmap file
+//
+// The header is followed by NumTilesX * NumTilesZ tiles in row order (Z major).
+// Every tile has (TileSize + 2) * (TileSize + 2) floats - the TileSize * TileSize
+// heights of the tile plus a one sample apron copied from the neighbours so that
+// the normals can be calculated without touching other tiles. Neighbouring tiles
+// share their border vertices so the world is NumTiles * (TileSize - 1) + 1
+// vertices across.
+//
+#define TILED_HEIGHTMAP_MAGIC   0x4d485454   // 'TTHM'
+#define TILED_HEIGHTMAP_VERSION 1
+
+struct TiledHeightMapHeader {
+    int Magic = TILED_HEIGHTMAP_MAGIC;
+    int Version = TILED_HEIGHTMAP_VERSION;
+    int TileSize = 0;       // in vertices
+    int NumTilesX = 0;
+    int NumTilesZ = 0;
+    float MinHeight = 0.0f;
+    float MaxHeight = 0.0f;
+};
+
+
+struct TerrainTile {
+    int TileX = 0;
+    int TileZ = 0;
+    std::vector<float> Heights;                  // including the apron
+    std::vector<GeomipGrid::Vertex> Vertices;    // released once they are in the vertex buffer
+    float MinHeight = 0.0f;
+    float MaxHeight = 0.0f;
+    GLuint VAO = 0;
+    GLuint VB = 0;
+    std::atomic<bool> Wanted { true };           // cleared when the tile leaves the load radius
+    bool IsResident = false;                     // loaded and uploaded to the GPU
+    unsigned int LastUsedFrame = 0;
+    std::list<TerrainTile*>::iterator LRUPos;
+};
+
+
+//
+// Keeps the tiles around the camera in memory. The tiles are read and turned into
+// vertices by background threads. The main thread uploads them and evicts the least
+// recently used ones when the memory budget is exceeded. Nothing in here depends on
+// the size of the world so a huge file costs the same to open as a small one.
+//
+class TerrainTileCache {
+ public:
+    TerrainTileCache() {}
+
+    ~TerrainTileCache();
+
+    // Reads the header. The tiles are not loaded until Start().
+    void Open(const char* pFilename);
+
+    // IndexBuffer is the shared geomip index buffer that goes into the VAO of every tile.
+    // LoadRadius is in world units around the camera. MemoryBudget is in bytes.
+    void Start(GLuint IndexBuffer, float WorldScale, float TextureScale, float LoadRadius, size_t MemoryBudget);
+
+    void Destroy();
+
+    // Called once per frame on the thread that owns the GL context
+    void Update(const Vector3f& CameraPos);
+
+    // x and z are in heightmap coordinates of the entire world.
+    // Returns false if the tile that contains the sample is not resident.
+    bool GetHeight(int x, int z, float& Height) const;
+
+    const std::list<TerrainTile*>& GetResidentTiles() const { return m_lru; }
+
+    int GetTileSize() const { return m_header.TileSize; }
+
+    int GetWorldSize() const { return m_header.NumTilesX * (m_header.TileSize - 1) + 1; }
+
+    float GetMinHeight() const { return m_header.MinHeight; }
+
+    float GetMaxHeight() const { return m_header.MaxHeight; }
+
+    int GetNumResidentTiles() const { return (int)m_lru.size(); }
+
+    size_t GetResidentBytes() const { return m_residentBytes; }
+
+    int GetNumPendingTiles() const { return (int)m_tiles.size() - (int)m_lru.size(); }
+
+    static void WriteTiledHeightMap(const char* pFilename, const Array2D<float>& HeightMap, int Size,
+                                    int TileSize, float MinHeight, float MaxHeight);
+
+ private:
+    void WorkerThread();
+    void LoadTile(FILE* pFile, TerrainTile* pTile);
+    void InitTileVertices(TerrainTile* pTile);
+    void ProcessLoadedTiles();
+    void UploadTile(TerrainTile* pTile);
+    void RequestTiles(const Vector3f& CameraPos);
+    void EvictTiles();
+    void FreeTile(TerrainTile* pTile);
+    const TerrainTile* GetResidentTile(int TileX, int TileZ) const;
+
+    int GetTileKey(int TileX, int TileZ) const { return TileZ * m_header.NumTilesX + TileX; }
+
+    std::string m_filename;
+    TiledHeightMapHeader m_header;
+    int m_apronSize = 0;                 // TileSize + 2
+    float m_worldScale = 1.0f;
+    float m_textureScale = 1.0f;
+    float m_loadRadius = 0.0f;
+    size_t m_memoryBudget = 0;
+    size_t m_tileBytes = 0;              // heights plus the vertex buffer of a single tile
+    size_t m_residentBytes = 0;
+    GLuint m_indexBuffer = 0;
+    unsigned int m_frame = 0;
+    bool m_budgetWarningPrinted = false;
+
+    // Owned by the main thread. Contains every tile that is either resident or in flight.
+    std::unordered_map<int, TerrainTile*> m_tiles;
+    std::list<TerrainTile*> m_lru;       // resident tiles, most recently used first
+
+    // Shared with the workers
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<TerrainTile*> m_requests;
+    std::vector<TerrainTile*> m_loaded;
+    bool m_quit = false;
+};
+
+#endif
@@ -101,7 +101,7 @@ public:
                     m_terrain.Destroy();
                     int Size = 256;
                     float MinHeight = 0.0f;
-                    m_terrain.CreateFaultFormation(Size, Iterations, MinHeight, MaxHeight, Filter);
+                    m_terrain.CreateFaultFormation(Size, Iterations, MinHeight, MaxHeight, Filter, rand());
                 }
 
                 ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
@@ -228,7 +228,7 @@ private:
         float MinHeight = 0.0f;
         float MaxHeight = 300.0f;
         float Filter = 0.5f;
-        m_terrain.CreateFaultFormation(Size, Iterations, MinHeight, MaxHeight, Filter);
+        m_terrain.CreateFaultFormation(Size, Iterations, MinHeight, MaxHeight, Filter, rand());
     }
 
 
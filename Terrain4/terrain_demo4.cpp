@@ -275,22 +275,23 @@ private:
 
         m_terrain.CreateMidpointDisplacement(Size, Roughness, MinHeight, MaxHeight);
 
-        TextureGenerator TexGen;
+        // The generator writes the debug PNG in the background so it must outlive this function
+        m_texGen.SetDebugOutput("texture.png");
 
-        TexGen.LoadTile("../Content/textures/rock02_2.jpg");
-        //TexGen.LoadTile("../Content/textures/IMGP5487_seamless.jpg");
-        //TexGen.LoadTile("../Content/textures/IMGP5525_seamless.jpg");
-        TexGen.LoadTile("../Content/textures/rock01.jpg");
+        m_texGen.LoadTile("../Content/textures/rock02_2.jpg");
+        //m_texGen.LoadTile("../Content/textures/IMGP5487_seamless.jpg");
+        //m_texGen.LoadTile("../Content/textures/IMGP5525_seamless.jpg");
+        m_texGen.LoadTile("../Content/textures/rock01.jpg");
         
-        TexGen.LoadTile("../Content/textures/tilable-IMG_0044-verydark.png");
+        m_texGen.LoadTile("../Content/textures/tilable-IMG_0044-verydark.png");
 
-       // TexGen.LoadTile("../Content/textures/grass1.jpg");
-        //TexGen.LoadTile("../Content/textures/Rock6.png");
+       // m_texGen.LoadTile("../Content/textures/grass1.jpg");
+        //m_texGen.LoadTile("../Content/textures/Rock6.png");
         
-        TexGen.LoadTile("../Content/textures/water.png");
+        m_texGen.LoadTile("../Content/textures/water.png");
         int TextureSize = 1024;
 
-        Texture* pTexture = TexGen.GenerateTexture(TextureSize, &m_terrain, MinHeight, MaxHeight);
+        Texture* pTexture = m_texGen.GenerateTexture(TextureSize, &m_terrain, MinHeight, MaxHeight);
         m_terrain.SetTexture(pTexture);
     }
 
@@ -339,6 +340,7 @@ private:
     BasicCamera* m_pGameCamera = NULL;
     bool m_isWireframe = false;
     MidpointDispTerrain m_terrain;
+    TextureGenerator m_texGen;
     bool m_showGui = false;
     bool m_isPaused = false;
 };
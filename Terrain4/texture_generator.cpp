@@ -19,17 +19,31 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <atomic>
+#include <algorithm>
 
 #include "texture_generator.h"
 #include "terrain.h"
 #include "ogldev_stb_image.h"
+#include "ogldev_util.h"
+#include "ogldev_parallel_for.h"
 
 #include "3rdparty/stb_image_write.h"
 
+#define WEIGHT_TABLE_SIZE 1024
+#define TEXTURE_BLOCK_SIZE 64
+
 TextureGenerator::TextureGenerator()
 {
 }
 
+
+TextureGenerator::~TextureGenerator()
+{
+    WaitForDebugOutput();
+}
+
+
 void TextureGenerator::LoadTile(const char* pFilename)
 {
     if (m_numTextureTiles == MAX_TEXTURE_TILES) {
@@ -38,70 +52,263 @@ void TextureGenerator::LoadTile(const char* pFilename)
     }
 
     m_textureTiles[m_numTextureTiles].Image.Load(pFilename);
+
+    if (m_textureTiles[m_numTextureTiles].Image.m_bpp < 3) {
+        printf("%s:%d: '%s' must have at least three channels\n", __FILE__, __LINE__, pFilename);
+        exit(0);
+    }
+
     m_numTextureTiles++;
 }
 
 
-Texture* TextureGenerator::GenerateTexture(int TextureSize, BaseTerrain* pTerrain, float MinHeight, float MaxHeight)
+Texture* TextureGenerator::GenerateTexture(int TextureSize, BaseTerrain* pTerrain, float MinHeight, float MaxHeight, int NumThreads)
 {
     if (m_numTextureTiles == 0) {
         printf("%s:%d: no texture tiles loaded\n", __FILE__, __LINE__);
         exit(0);
     }
 
+    if (NumThreads <= 0) {
+        NumThreads = std::max((int)std::thread::hardware_concurrency(), 1);
+    }
+
+    long long StartTime = GetCurrentTimeMillis();
+
     CalculateTextureRegions(MinHeight, MaxHeight);
+    CalculateWeightTable(MinHeight, MaxHeight);
+    CalculateSampleCoords(TextureSize, pTerrain->GetSize());
 
     int BPP = 3;
-    int TextureBytes = TextureSize * TextureSize * BPP;
-    unsigned char* pTextureData = (unsigned char*)malloc(TextureBytes);
-    unsigned char* p = pTextureData;
 
-    float HeightMapToTextureRatio = (float)pTerrain->GetSize() / (float)TextureSize;
+    int NumLevels = 1;
 
-    printf("Height map to texture ratio: %f\n", HeightMapToTextureRatio);
+    while ((TextureSize >> NumLevels) > 0) {
+        NumLevels++;
+    }
 
-    for (int y = 0 ; y < TextureSize ; y++) {
-        for (int x = 0 ; x < TextureSize ; x++) {
+    std::vector<std::vector<unsigned char>> Levels(NumLevels);
+    Levels[0].resize((size_t)TextureSize * TextureSize * BPP);
 
-            float InterpolatedHeight = pTerrain->GetHeightInterpolated((float)x * HeightMapToTextureRatio, 
-                                                                       (float)y * HeightMapToTextureRatio);
+    // The blocks are handed out one at a time so a thread that finishes early
+    // simply grabs the next one
+    int NumBlocksPerRow = (TextureSize + TEXTURE_BLOCK_SIZE - 1) / TEXTURE_BLOCK_SIZE;
+    int NumBlocks = NumBlocksPerRow * NumBlocksPerRow;
+    std::atomic<int> NextBlock(0);
+    unsigned char* pTextureData = Levels[0].data();
 
-            float Red = 0.0f;
-            float Green = 0.0f;
-            float Blue = 0.0f;
+    ParallelFor(NumThreads, [&](int, int) {
+        int Block = 0;
 
-            for (int Tile = 0 ; Tile < m_numTextureTiles ; Tile++) {
-                Vector3f Color = m_textureTiles[Tile].Image.GetColor(x, y);
+        while ((Block = NextBlock++) < NumBlocks) {
+            GenerateBlock(Block % NumBlocksPerRow, Block / NumBlocksPerRow, TextureSize, pTerrain, pTextureData);
+        }
+    }, NumThreads);
+
+    long long NumTexels = (long long)TextureSize * TextureSize;
 
-                float BlendFactor = RegionPercent(Tile, InterpolatedHeight);
+    for (int Level = 1 ; Level < NumLevels ; Level++) {
+        int SrcSize = std::max(TextureSize >> (Level - 1), 1);
+        int DstSize = std::max(TextureSize >> Level, 1);
+        Levels[Level].resize((size_t)DstSize * DstSize * BPP);
+        GenerateMipmap(Levels[Level - 1].data(), SrcSize, SrcSize, Levels[Level].data(), DstSize, DstSize, NumThreads);
+        NumTexels += (long long)DstSize * DstSize;
+    }
+
+    long long Duration = std::max(GetCurrentTimeMillis() - StartTime, 1LL);
+
+    printf("Generated a %dx%d texture with %d mip levels on %d threads in %lld ms (%.1f megatexels/s)\n",
+           TextureSize, TextureSize, NumLevels, NumThreads, Duration, (double)NumTexels / ((double)Duration * 1000.0));
+
+    std::vector<const unsigned char*> LevelData(NumLevels);
+
+    for (int Level = 0 ; Level < NumLevels ; Level++) {
+        LevelData[Level] = Levels[Level].data();
+    }
 
-                Red   += BlendFactor * Color.r;
-                Green += BlendFactor * Color.g;
-                Blue  += BlendFactor * Color.b;
+    Texture* pTexture = new Texture(GL_TEXTURE_2D);
+
+    pTexture->LoadRawMipmaps(TextureSize, TextureSize, BPP, NumLevels, LevelData.data());
+
+    if (!m_debugFilename.empty()) {
+        WriteDebugOutput(std::move(Levels[0]), TextureSize);
+    }
+
+    return pTexture;
+}
+
+
+void TextureGenerator::GenerateBlock(int BlockX, int BlockY, int TextureSize, const BaseTerrain* pTerrain, unsigned char* pDst) const
+{
+    const Array2D<float>& HeightMap = pTerrain->GetHeightMap();
+    int HeightMapSize = pTerrain->GetSize();
+
+    int StartX = BlockX * TEXTURE_BLOCK_SIZE;
+    int EndX = std::min(StartX + TEXTURE_BLOCK_SIZE, TextureSize);
+    int StartY = BlockY * TEXTURE_BLOCK_SIZE;
+    int EndY = std::min(StartY + TEXTURE_BLOCK_SIZE, TextureSize);
+
+    const unsigned char* pTileRows[MAX_TEXTURE_TILES] = {};
+
+    for (int y = StartY ; y < EndY ; y++) {
+        for (int Tile = 0 ; Tile < m_numTextureTiles ; Tile++) {
+            const STBImage& Image = m_textureTiles[Tile].Image;
+            pTileRows[Tile] = Image.m_imageData + (size_t)(y % Image.m_height) * Image.m_width * Image.m_bpp;
+        }
+
+        int z = m_sampleIndex[y];
+        float RatioZ = m_sampleFraction[y];
+        bool LastRow = (z + 1 >= HeightMapSize);
+
+        unsigned char* p = pDst + ((size_t)y * TextureSize + StartX) * 3;
+
+        for (int x = StartX ; x < EndX ; x++) {
+            int HeightX = m_sampleIndex[x];
+
+            // Same interpolation as BaseTerrain::GetHeightInterpolated
+            float Height = HeightMap.Get(HeightX, z);
+
+            if (!LastRow && (HeightX + 1 < HeightMapSize)) {
+                float NextXHeight = HeightMap.Get(HeightX + 1, z);
+                float NextZHeight = HeightMap.Get(HeightX, z + 1);
+                float InterpolatedHeightX = (NextXHeight - Height) * m_sampleFraction[x] + Height;
+                float InterpolatedHeightZ = (NextZHeight - Height) * RatioZ + Height;
+                Height = (InterpolatedHeightX + InterpolatedHeightZ) / 2.0f;
             }
 
-            if (Red > 255.0f || Green > 255.0f || Blue > 255.0f) {
-                printf("%d:%d: %f %f %f\n", y, x, Red, Green, Blue);
-                exit(0);
+            int Entry = (int)((Height - m_weightTableMinHeight) * m_weightTableScale + 0.5f);
+            Entry = std::min(std::max(Entry, 0), WEIGHT_TABLE_SIZE - 1);
+
+            const unsigned short* pWeights = &m_weights[Entry * m_numTextureTiles];
+
+            unsigned int Red = 0;
+            unsigned int Green = 0;
+            unsigned int Blue = 0;
+
+            for (int Tile = 0 ; Tile < m_numTextureTiles ; Tile++) {
+                unsigned int Weight = pWeights[Tile];
+
+                if (Weight == 0) {
+                    continue;
+                }
+
+                const unsigned char* pColor = pTileRows[Tile] + m_tileColumnOffsets[Tile][x];
+
+                Red   += Weight * pColor[0];
+                Green += Weight * pColor[1];
+                Blue  += Weight * pColor[2];
             }
 
-            p[0] = (unsigned char)Red;
-            p[1] = (unsigned char)Green;
-            p[2] = (unsigned char)Blue;
+            // The weights of every entry add up to 256 at most so this can't overflow
+            p[0] = (unsigned char)(Red >> 8);
+            p[1] = (unsigned char)(Green >> 8);
+            p[2] = (unsigned char)(Blue >> 8);
 
             p += 3;
         }
     }
+}
 
-    Texture* pTexture = new Texture(GL_TEXTURE_2D);
 
-    stbi_write_png("texture.png", TextureSize, TextureSize, BPP, pTextureData, TextureSize * BPP);
+// 2x2 box filter. The last row/column is repeated when the source has an odd size.
+void TextureGenerator::GenerateMipmap(const unsigned char* pSrc, int SrcWidth, int SrcHeight,
+                                      unsigned char* pDst, int DstWidth, int DstHeight, int NumThreads)
+{
+    int SrcPitch = SrcWidth * 3;
+
+    ParallelFor(DstHeight, [&](int Begin, int End) {
+        for (int y = Begin ; y < End ; y++) {
+            const unsigned char* pRow0 = pSrc + (size_t)std::min(y * 2, SrcHeight - 1) * SrcPitch;
+            const unsigned char* pRow1 = pSrc + (size_t)std::min(y * 2 + 1, SrcHeight - 1) * SrcPitch;
+            unsigned char* p = pDst + (size_t)y * DstWidth * 3;
 
-    pTexture->LoadRaw(TextureSize, TextureSize, BPP, pTextureData);
+            for (int x = 0 ; x < DstWidth ; x++) {
+                int x0 = std::min(x * 2, SrcWidth - 1) * 3;
+                int x1 = std::min(x * 2 + 1, SrcWidth - 1) * 3;
 
-    free(pTextureData);
+                for (int c = 0 ; c < 3 ; c++) {
+                    p[c] = (unsigned char)((pRow0[x0 + c] + pRow0[x1 + c] + pRow1[x0 + c] + pRow1[x1 + c] + 2) >> 2);
+                }
 
-    return pTexture;
+                p += 3;
+            }
+        }
+    }, NumThreads);
+}
+
+
+void TextureGenerator::CalculateWeightTable(float MinHeight, float MaxHeight)
+{
+    m_weights.resize(WEIGHT_TABLE_SIZE * m_numTextureTiles);
+
+    float HeightRange = MaxHeight - MinHeight;
+    float Step = (HeightRange > 0.0f) ? HeightRange / (float)(WEIGHT_TABLE_SIZE - 1) : 0.0f;
+
+    m_weightTableMinHeight = MinHeight;
+    m_weightTableScale = (Step > 0.0f) ? 1.0f / Step : 0.0f;
+
+    for (int Entry = 0 ; Entry < WEIGHT_TABLE_SIZE ; Entry++) {
+        float Height = MinHeight + Step * (float)Entry;
+        unsigned short* pWeights = &m_weights[Entry * m_numTextureTiles];
+        int Sum = 0;
+
+        for (int Tile = 0 ; Tile < m_numTextureTiles ; Tile++) {
+            pWeights[Tile] = (unsigned short)(RegionPercent(Tile, Height) * 256.0f + 0.5f);
+            Sum += pWeights[Tile];
+        }
+
+        // Rounding can push the sum slightly above one
+        while (Sum > 256) {
+            unsigned short* pMax = std::max_element(pWeights, pWeights + m_numTextureTiles);
+            (*pMax)--;
+            Sum--;
+        }
+    }
+}
+
+
+void TextureGenerator::CalculateSampleCoords(int TextureSize, int HeightMapSize)
+{
+    float HeightMapToTextureRatio = (float)HeightMapSize / (float)TextureSize;
+
+    m_sampleIndex.resize(TextureSize);
+    m_sampleFraction.resize(TextureSize);
+
+    for (int i = 0 ; i < TextureSize ; i++) {
+        float Pos = (float)i * HeightMapToTextureRatio;
+        m_sampleIndex[i] = (int)Pos;
+        m_sampleFraction[i] = Pos - floorf(Pos);
+    }
+
+    for (int Tile = 0 ; Tile < m_numTextureTiles ; Tile++) {
+        const STBImage& Image = m_textureTiles[Tile].Image;
+        m_tileColumnOffsets[Tile].resize(TextureSize);
+
+        for (int x = 0 ; x < TextureSize ; x++) {
+            m_tileColumnOffsets[Tile][x] = (x % Image.m_width) * Image.m_bpp;
+        }
+    }
+}
+
+
+void TextureGenerator::WriteDebugOutput(std::vector<unsigned char>&& Data, int TextureSize)
+{
+    WaitForDebugOutput();
+
+    std::string Filename = m_debugFilename;
+
+    m_debugThread = std::thread([Filename, TextureSize](std::vector<unsigned char> Pixels) {
+        int BPP = 3;
+        stbi_write_png(Filename.c_str(), TextureSize, TextureSize, BPP, Pixels.data(), TextureSize * BPP);
+    }, std::move(Data));
+}
+
+
+void TextureGenerator::WaitForDebugOutput()
+{
+    if (m_debugThread.joinable()) {
+        m_debugThread.join();
+    }
 }
 
 
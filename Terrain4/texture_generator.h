@@ -21,6 +21,9 @@
 #define TEXTURE_GENERATOR_H
 
 #include <stdio.h>
+#include <vector>
+#include <string>
+#include <thread>
 
 #include "ogldev_texture.h"
 #include "ogldev_stb_image.h"
@@ -42,13 +45,26 @@ struct TextureTile {
 
 class BaseTerrain;
 
+//
+// Blends the tiles according to the height of the terrain. The texture is split into
+// blocks which are picked up by a pool of worker threads. The blend weights of every
+// tile are precomputed for a table of heights so the inner loop only does 8 bit integer
+// math. The entire mip chain is generated here and uploaded as is.
+//
 class TextureGenerator {
  public:
     TextureGenerator();
 
+    ~TextureGenerator();
+
     void LoadTile(const char* Filename);
 
-    Texture* GenerateTexture(int TextureSize, BaseTerrain* pTerrain, float MinHeight, float MaxHeight);
+    // NumThreads zero means one thread per core
+    Texture* GenerateTexture(int TextureSize, BaseTerrain* pTerrain, float MinHeight, float MaxHeight, int NumThreads = 0);
+
+    // When set the top level of every generated texture is also written to this PNG.
+    // The file is written on a background thread so it doesn't delay the generation.
+    void SetDebugOutput(const char* pFilename) { m_debugFilename = pFilename ? pFilename : ""; }
 
  private:
 
@@ -56,10 +72,38 @@ class TextureGenerator {
 
     float RegionPercent(int Tile, float Height);
 
+    void CalculateWeightTable(float MinHeight, float MaxHeight);
+
+    void CalculateSampleCoords(int TextureSize, int HeightMapSize);
+
+    void GenerateBlock(int BlockX, int BlockY, int TextureSize, const BaseTerrain* pTerrain, unsigned char* pDst) const;
+
+    static void GenerateMipmap(const unsigned char* pSrc, int SrcWidth, int SrcHeight,
+                               unsigned char* pDst, int DstWidth, int DstHeight, int NumThreads);
+
+    void WriteDebugOutput(std::vector<unsigned char>&& Data, int TextureSize);
+
+    void WaitForDebugOutput();
+
     #define MAX_TEXTURE_TILES 4
 
     TextureTile m_textureTiles[MAX_TEXTURE_TILES] = {};
     int m_numTextureTiles = 0;
+
+    // Blend weights in 1/256 units for every entry of the height table, m_numTextureTiles per entry
+    std::vector<unsigned short> m_weights;
+    float m_weightTableMinHeight = 0.0f;
+    float m_weightTableScale = 0.0f;        // height to table entry
+
+    // Height map sample of every texel column and row
+    std::vector<int> m_sampleIndex;
+    std::vector<float> m_sampleFraction;
+
+    // Byte offset of every texel column inside a row of every tile (wrapped)
+    std::vector<int> m_tileColumnOffsets[MAX_TEXTURE_TILES];
+
+    std::string m_debugFilename;
+    std::thread m_debugThread;
 };
 
 #endif
@@ -11,7 +11,7 @@ SOURCES="terrain_demo5.1.cpp \
 	terrain_technique.cpp \
 	midpoint_disp_terrain.cpp \
 	terrain.cpp \
-	slope_lighter.cpp \
+	horizon_map.cpp \
 	$OGLDEV_DIR/Common/ogldev_util.cpp \
 	$OGLDEV_DIR/Common/math_3d.cpp \
 	$OGLDEV_DIR/Common/ogldev_basic_glfw_camera.cpp \
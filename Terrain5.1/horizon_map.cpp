@@ -0,0 +1,266 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include <algorithm>
+
+#include "ogldev_util.h"
+#include "ogldev_parallel_for.h"
+#include "horizon_map.h"
+
+// The horizon angle is in [0, PI / 2] because everything below the horizontal plane
+// is night anyway
+#define HORIZON_ANGLE_TO_BYTE (255.0f / (float)(M_PI / 2.0))
+#define BYTE_TO_HORIZON_ANGLE ((float)(M_PI / 2.0) / 255.0f)
+
+
+void HorizonMap::Generate(const Array2D<float>* pHeightMap, float WorldScale, int NumDirections, int NumThreads)
+{
+    if (NumDirections < 1) {
+        printf("%s:%d - invalid number of directions %d\n", __FILE__, __LINE__, NumDirections);
+        exit(0);
+    }
+
+    long long StartTime = GetCurrentTimeMillis();
+
+    m_pHeightMap = pHeightMap;
+    m_width = pHeightMap->GetWidth();
+    m_depth = pHeightMap->GetHeight();
+    m_worldScale = WorldScale;
+    m_numDirections = NumDirections;
+
+    m_horizons.resize((size_t)m_width * m_depth * m_numDirections);
+    m_directions.resize(m_numDirections);
+
+    for (int Dir = 0 ; Dir < m_numDirections ; Dir++) {
+        InitDirection(Dir);
+        const Direction& d = m_directions[Dir];
+        SweepLines(Dir, d.FirstLine, d.FirstLine + d.NumLines - 1, NumThreads);
+    }
+
+    long long EndTime = GetCurrentTimeMillis();
+
+    printf("Horizon map %dx%d, %d directions: %d ms, %d KB\n", m_width, m_depth, m_numDirections,
+           (int)(EndTime - StartTime), (int)(m_horizons.size() / 1024));
+}
+
+
+void HorizonMap::Destroy()
+{
+    m_pHeightMap = NULL;
+    m_width = 0;
+    m_depth = 0;
+    m_numDirections = 0;
+    m_directions.clear();
+    m_horizons.clear();
+    m_horizons.shrink_to_fit();
+}
+
+
+/*
+    Every direction is processed as a set of parallel lines. A line moves one sample
+    at a time along the major axis of the direction and its minor coordinate is the
+    rounded position of the ideal line, so it is never more than half a sample away
+    from it. Line k visits (m, k + Offsets[m]) for every major coordinate m. For a
+    given m this is one to one between k and the minor coordinate so every sample
+    belongs to exactly one line of every direction.
+*/
+void HorizonMap::InitDirection(int Dir)
+{
+    Direction& d = m_directions[Dir];
+
+    float Azimuth = 2.0f * (float)M_PI * (float)Dir / (float)m_numDirections;
+    d.DirX = cosf(Azimuth);
+    d.DirZ = sinf(Azimuth);
+
+    d.MajorX = fabsf(d.DirX) >= fabsf(d.DirZ);
+
+    float Major = d.MajorX ? d.DirX : d.DirZ;
+    float Minor = d.MajorX ? d.DirZ : d.DirX;
+    d.Forward = Major > 0.0f;
+
+    float Slope = Minor / Major;
+
+    int MajorSize = d.MajorX ? m_width : m_depth;
+    int MinorSize = d.MajorX ? m_depth : m_width;
+
+    d.Offsets.resize(MajorSize);
+
+    for (int m = 0 ; m < MajorSize ; m++) {
+        d.Offsets[m] = (int)floorf((float)m * Slope + 0.5f);
+    }
+
+    int LastOffset = d.Offsets[MajorSize - 1];
+    d.FirstLine = -std::max(LastOffset, 0);
+    d.NumLines = MinorSize + abs(LastOffset);
+}
+
+
+void HorizonMap::SweepLines(int Dir, int FirstLine, int LastLine, int NumThreads)
+{
+    const Direction& d = m_directions[Dir];
+
+    ParallelFor(LastLine - FirstLine + 1, [&](int Begin, int End) {
+        std::vector<HullPoint> Hull;
+        Hull.reserve(std::max(m_width, m_depth));
+
+        for (int Line = FirstLine + Begin ; Line < FirstLine + End ; Line++) {
+            SweepLine(d, Dir, Line, Hull);
+        }
+    }, NumThreads);
+}
+
+
+/*
+    The line is walked starting from the end that is closest to the sun so that when
+    a sample is reached all the samples that can block it have already been visited.
+    The visited samples that can still be the horizon of a later sample form an upper
+    convex hull in the (distance, height) plane. The horizon of the current sample is
+    the point where its tangent touches the hull. Everything between the current sample
+    and the tangent point is below the tangent line and will stay hidden for all the
+    samples that follow, so it is removed. Every sample is pushed and popped at most
+    once which makes the sweep linear in the length of the line.
+*/
+void HorizonMap::SweepLine(const Direction& d, int Dir, int Line, std::vector<HullPoint>& Hull)
+{
+    Hull.clear();
+
+    int MajorSize = d.MajorX ? m_width : m_depth;
+    int MinorSize = d.MajorX ? m_depth : m_width;
+
+    int m = d.Forward ? MajorSize - 1 : 0;
+    int Step = d.Forward ? -1 : 1;
+
+    for (int i = 0 ; i < MajorSize ; i++, m += Step) {
+        int n = Line + d.Offsets[m];
+
+        if ((n < 0) || (n >= MinorSize)) {
+            continue;
+        }
+
+        int x = d.MajorX ? m : n;
+        int z = d.MajorX ? n : m;
+
+        HullPoint p;
+        p.Dist = ((float)x * d.DirX + (float)z * d.DirZ) * m_worldScale;
+        p.Height = m_pHeightMap->Get(x, z);
+
+        while (Hull.size() >= 2) {
+            const HullPoint& a = Hull[Hull.size() - 1];
+            const HullPoint& b = Hull[Hull.size() - 2];
+
+            // Both distances are positive so the slopes are compared without division
+            if ((b.Height - p.Height) * (a.Dist - p.Dist) >= (a.Height - p.Height) * (b.Dist - p.Dist)) {
+                Hull.pop_back();
+            } else {
+                break;
+            }
+        }
+
+        float Angle = 0.0f;
+
+        if (!Hull.empty()) {
+            const HullPoint& a = Hull.back();
+
+            if (a.Height > p.Height) {
+                Angle = atan2f(a.Height - p.Height, a.Dist - p.Dist);
+            }
+        }
+
+        m_horizons[((size_t)z * m_width + x) * m_numDirections + Dir] = (unsigned char)(Angle * HORIZON_ANGLE_TO_BYTE + 0.5f);
+
+        Hull.push_back(p);
+    }
+}
+
+
+void HorizonMap::UpdateRegion(int MinX, int MinZ, int MaxX, int MaxZ, int NumThreads)
+{
+    if (IsEmpty()) {
+        return;
+    }
+
+    MinX = std::max(MinX, 0);
+    MinZ = std::max(MinZ, 0);
+    MaxX = std::min(MaxX, m_width - 1);
+    MaxZ = std::min(MaxZ, m_depth - 1);
+
+    if ((MinX > MaxX) || (MinZ > MaxZ)) {
+        return;
+    }
+
+    for (int Dir = 0 ; Dir < m_numDirections ; Dir++) {
+        const Direction& d = m_directions[Dir];
+
+        int MinMajor = d.MajorX ? MinX : MinZ;
+        int MaxMajor = d.MajorX ? MaxX : MaxZ;
+        int MinMinor = d.MajorX ? MinZ : MinX;
+        int MaxMinor = d.MajorX ? MaxZ : MaxX;
+
+        // The offsets are monotonic so their extremes over the rectangle are at its edges
+        int Offset0 = d.Offsets[MinMajor];
+        int Offset1 = d.Offsets[MaxMajor];
+
+        int FirstLine = std::max(MinMinor - std::max(Offset0, Offset1), d.FirstLine);
+        int LastLine = std::min(MaxMinor - std::min(Offset0, Offset1), d.FirstLine + d.NumLines - 1);
+
+        SweepLines(Dir, FirstLine, LastLine, NumThreads);
+    }
+}
+
+
+void HorizonMap::SetSunDirection(const Vector3f& LightDir, float Softness)
+{
+    Vector3f ToSun = LightDir * -1.0f;
+    ToSun.Normalize();
+
+    m_sunElevation = asinf(ToSun.y);
+
+    float Azimuth = atan2f(ToSun.z, ToSun.x);
+
+    if (Azimuth < 0.0f) {
+        Azimuth += 2.0f * (float)M_PI;
+    }
+
+    float f = Azimuth * (float)m_numDirections / (2.0f * (float)M_PI);
+    int Dir = (int)floorf(f);
+    m_sunFactor = f - (float)Dir;
+    m_sunDir0 = Dir % m_numDirections;
+    m_sunDir1 = (Dir + 1) % m_numDirections;
+
+    m_invSoftness = (Softness > 0.0f) ? 1.0f / ToRadian(Softness) : 1e6f;
+}
+
+
+float HorizonMap::GetSunVisibility(int x, int z) const
+{
+    const unsigned char* p = &m_horizons[((size_t)z * m_width + x) * m_numDirections];
+
+    float Horizon = ((float)p[m_sunDir0] * (1.0f - m_sunFactor) + (float)p[m_sunDir1] * m_sunFactor) * BYTE_TO_HORIZON_ANGLE;
+
+    float t = (m_sunElevation - Horizon) * m_invSoftness + 0.5f;
+    t = std::min(std::max(t, 0.0f), 1.0f);
+
+    return t * t * (3.0f - 2.0f * t);
+}
+
+
+float HorizonMap::GetHorizonAngle(int x, int z, int Dir) const
+{
+    return (float)m_horizons[((size_t)z * m_width + x) * m_numDirections + Dir] * BYTE_TO_HORIZON_ANGLE;
+}
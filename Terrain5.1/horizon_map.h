@@ -0,0 +1,104 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HORIZON_MAP_H
+#define HORIZON_MAP_H
+
+#include <vector>
+
+#include "ogldev_array_2d.h"
+#include "ogldev_math_3d.h"
+
+//
+// Horizon angle map of a heightmap. For every sample and for NumDirections evenly
+// spaced azimuths it stores the elevation angle of the horizon as seen from that
+// sample, quantized to a byte. The directions of a sample are stored next to each
+// other so the shadow of any sun direction costs two byte loads from the same cache
+// line. Direction d looks towards the azimuth 2 * PI * d / NumDirections measured
+// from the +X axis towards +Z.
+//
+class HorizonMap
+{
+public:
+    HorizonMap() {}
+
+    // WorldScale is the distance between two neighbouring samples in the units of the heights
+    void Generate(const Array2D<float>* pHeightMap, float WorldScale, int NumDirections, int NumThreads = 0);
+
+    // Must be called after the heights in [MinX, MaxX] x [MinZ, MaxZ] have been changed.
+    // Only the sweep lines that cross the rectangle are processed again.
+    void UpdateRegion(int MinX, int MinZ, int MaxX, int MaxZ, int NumThreads = 0);
+
+    void Destroy();
+
+    // LightDir points from the sun towards the terrain. Softness is the angle in degrees
+    // over which the sun disappears behind the horizon.
+    void SetSunDirection(const Vector3f& LightDir, float Softness);
+
+    // 0 - fully shadowed, 1 - fully lit by the sun set in SetSunDirection
+    float GetSunVisibility(int x, int z) const;
+
+    // Horizon elevation in radians in the direction 'Dir'
+    float GetHorizonAngle(int x, int z, int Dir) const;
+
+    int GetNumDirections() const { return m_numDirections; }
+
+    bool IsEmpty() const { return m_horizons.empty(); }
+
+    size_t GetSizeInBytes() const { return m_horizons.size(); }
+
+private:
+
+    struct Direction {
+        float DirX = 0.0f;
+        float DirZ = 0.0f;
+        bool MajorX = false;       // the line steps one sample at a time along X
+        bool Forward = false;      // the major component of the direction is positive
+        int FirstLine = 0;
+        int NumLines = 0;
+        std::vector<int> Offsets;  // minor coordinate offset of the line at every major coordinate
+    };
+
+    struct HullPoint {
+        float Dist;
+        float Height;
+    };
+
+    void InitDirection(int Dir);
+
+    void SweepLines(int Dir, int FirstLine, int LastLine, int NumThreads);
+
+    void SweepLine(const Direction& d, int Dir, int Line, std::vector<HullPoint>& Hull);
+
+    const Array2D<float>* m_pHeightMap = NULL;
+    int m_width = 0;
+    int m_depth = 0;
+    float m_worldScale = 1.0f;
+    int m_numDirections = 0;
+    std::vector<Direction> m_directions;
+    std::vector<unsigned char> m_horizons;
+
+    // Set by SetSunDirection
+    int m_sunDir0 = 0;
+    int m_sunDir1 = 0;
+    float m_sunFactor = 0.0f;
+    float m_sunElevation = 0.0f;
+    float m_invSoftness = 0.0f;
+};
+
+#endif
@@ -23,6 +23,7 @@
 #include <sys/stat.h>
 #include <cerrno>
 #include <string.h>
+#include <algorithm>
 
 #include "terrain.h"
 #include "texture_config.h"
@@ -30,6 +31,9 @@
 
 //#define DEBUG_PRINT
 
+#define HORIZON_MAP_DIRECTIONS 16
+#define MIN_BRIGHTNESS 0.4f
+
 BaseTerrain::~BaseTerrain()
 {
     Destroy();
@@ -39,6 +43,7 @@ BaseTerrain::~BaseTerrain()
 void BaseTerrain::Destroy()
 {
     m_heightMap.Destroy();
+    m_horizonMap.Destroy();
     m_triangleList.Destroy();
 }
 
@@ -60,6 +65,8 @@ void BaseTerrain::InitTerrain(float WorldScale, float TextureScale, const std::v
     m_textureScale = TextureScale;
     m_lightDir = LightDir;
     m_lightSoftness = LightSoftness;
+    m_reversedLightDir = LightDir * -1.0f;
+    m_reversedLightDir.Normalize();
 
     for (int i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(m_pTextures) ; i++) {
         m_pTextures[i] = new Texture(GL_TEXTURE_2D);
@@ -176,9 +183,22 @@ void BaseTerrain::SetTextureHeights(float Tex0Height, float Tex1Height, float Te
 }
 
 
-float BaseTerrain::GetSlopeLighting(int x, int z) const
+float BaseTerrain::GetLighting(int x, int z) const
 {
-    return m_slopeLighter.GetLighting(x, z);
+    // Central differences, clamped at the edges of the heightmap
+    float HeightL = m_heightMap.Get(std::max(x - 1, 0), z);
+    float HeightR = m_heightMap.Get(std::min(x + 1, m_terrainSize - 1), z);
+    float HeightD = m_heightMap.Get(x, std::max(z - 1, 0));
+    float HeightU = m_heightMap.Get(x, std::min(z + 1, m_terrainSize - 1));
+
+    Vector3f Normal(HeightL - HeightR, 2.0f * m_worldScale, HeightD - HeightU);
+    Normal.Normalize();
+
+    float Diffuse = std::max(Normal.Dot(m_reversedLightDir), 0.0f);
+
+    float Shadow = m_horizonMap.GetSunVisibility(x, z);
+
+    return MIN_BRIGHTNESS + (1.0f - MIN_BRIGHTNESS) * Diffuse * Shadow;
 }
 
 
@@ -186,12 +206,31 @@ void BaseTerrain::SetLight(const Vector3f& LightDir, float Softness)
 {
     m_lightDir = LightDir;
     m_lightSoftness = Softness;
+
+    m_reversedLightDir = LightDir * -1.0f;
+    m_reversedLightDir.Normalize();
+
+    if (!m_horizonMap.IsEmpty()) {
+        m_horizonMap.SetSunDirection(m_lightDir, m_lightSoftness);
+        m_triangleList.UpdateLighting(this);
+    }
+}
+
+
+void BaseTerrain::UpdateHeightMapRegion(int MinX, int MinZ, int MaxX, int MaxZ)
+{
+    m_horizonMap.UpdateRegion(MinX, MinZ, MaxX, MaxZ);
+    m_triangleList.Destroy();
+    m_triangleList.CreateTriangleList(m_terrainSize, m_terrainSize, this);
 }
 
 
 void BaseTerrain::FinalizeTerrain()
 {
-    m_slopeLighter.InitLighter(m_lightDir, m_terrainSize, m_lightSoftness);
+    m_horizonMap.Generate(&m_heightMap, m_worldScale, HORIZON_MAP_DIRECTIONS);
+    m_horizonMap.SetSunDirection(m_lightDir, m_lightSoftness);
+
+    m_triangleList.Destroy();
     m_triangleList.CreateTriangleList(m_terrainSize, m_terrainSize, this);
 }
 
@@ -25,12 +25,12 @@
 #include "ogldev_texture.h"
 #include "triangle_list.h"
 #include "terrain_technique.h"
-#include "slope_lighter.h"
+#include "horizon_map.h"
 
 class BaseTerrain
 {
  public:
-    BaseTerrain() : m_slopeLighter(&m_heightMap) {}
+    BaseTerrain() {}
 
     ~BaseTerrain();
 
@@ -58,10 +58,16 @@ class BaseTerrain
 	
     void SetTextureHeights(float Tex0Height, float Tex1Height, float Tex2Height, float Tex3Height);
 	
-    float GetSlopeLighting(int x, int z) const;
+    float GetLighting(int x, int z) const;
 
+    // Softness is the angle in degrees over which the sun fades behind the horizon.
+    // After the terrain has been created only the light factors of the vertices are
+    // recalculated and uploaded in place.
     void SetLight(const Vector3f& LightDir, float Softness);
 
+    // Must be called after the heights inside the rectangle have been edited
+    void UpdateHeightMapRegion(int MinX, int MinZ, int MaxX, int MaxZ);
+
  protected:
 
 	void LoadHeightMapFile(const char* pFilename);
@@ -82,8 +88,9 @@ private:
     float m_maxHeight = 0.0f;
     TerrainTechnique m_terrainTech;
     TriangleList m_triangleList;
-    SlopeLighter m_slopeLighter; 
+    HorizonMap m_horizonMap;
     Vector3f m_lightDir;
+    Vector3f m_reversedLightDir;
     float m_lightSoftness = 0.0f;
 };
 
@@ -197,13 +197,11 @@ public:
                 break;
 
             case GLFW_KEY_L:
-                m_terrain.Destroy();
-                srand(g_seed);
+                // The horizon map covers every sun direction so only the vertices are relit
                 m_counter += 0.1f;
                 m_lightDir.x = sinf(m_counter);
                 m_lightDir.z = cosf(m_counter);
                 m_terrain.SetLight(m_lightDir, m_lightSoftness);
-                m_terrain.CreateMidpointDisplacement(m_terrainSize, m_roughness, m_minHeight, m_maxHeight);
                 break;
             }
         }
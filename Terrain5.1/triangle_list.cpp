@@ -49,6 +49,10 @@ void TriangleList::Destroy()
     if (m_ib > 0) {
         glDeleteBuffers(1, &m_ib);
     }
+
+    m_vao = 0;
+    m_vb = 0;
+    m_ib = 0;
 }
 
 
@@ -95,8 +99,7 @@ void TriangleList::CreateGLState()
     NumFloats += 2;
 
     glEnableVertexAttribArray(LIGHT_FACTOR_LOC);
-    glVertexAttribPointer(LIGHT_FACTOR_LOC, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(NumFloats * sizeof(float)));
-    NumFloats++;
+    glVertexAttribPointer(LIGHT_FACTOR_LOC, 1, GL_FLOAT, GL_FALSE, sizeof(float), (const void*)GetLightFactorsOffset());
 }
 
 
@@ -107,12 +110,21 @@ void TriangleList::PopulateBuffers(const BaseTerrain* pTerrain)
 
     InitVertices(pTerrain, Vertices);
 
+    std::vector<float> LightFactors;
+    LightFactors.resize(m_width * m_depth);
+
+    InitLightFactors(pTerrain, LightFactors);
+
 	std::vector<unsigned int> Indices;
     int NumQuads = (m_width - 1) * (m_depth - 1);
     Indices.resize(NumQuads * 6);
     InitIndices(Indices);
 
-    glBufferData(GL_ARRAY_BUFFER, sizeof(Vertices[0]) * Vertices.size(), &Vertices[0], GL_STATIC_DRAW);
+    size_t LightFactorsSize = sizeof(LightFactors[0]) * LightFactors.size();
+
+    glBufferData(GL_ARRAY_BUFFER, GetLightFactorsOffset() + LightFactorsSize, NULL, GL_STATIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(Vertices[0]) * Vertices.size(), &Vertices[0]);
+    glBufferSubData(GL_ARRAY_BUFFER, GetLightFactorsOffset(), LightFactorsSize, &LightFactors[0]);
 
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(Indices[0]) * Indices.size(), &Indices[0], GL_STATIC_DRAW);
 }
@@ -128,8 +140,6 @@ void TriangleList::Vertex::InitVertex(const BaseTerrain* pTerrain, int x, int z)
     float Size = (float)pTerrain->GetSize();
     float TextureScale = pTerrain->GetTextureScale();
     Tex = Vector2f(TextureScale * (float)x / Size, TextureScale * (float)z / Size);	
-	
-    LightFactor = pTerrain->GetSlopeLighting(x, z);
 }
 
 
@@ -149,6 +159,39 @@ void TriangleList::InitVertices(const BaseTerrain* pTerrain, std::vector<Vertex>
 }
 
 
+void TriangleList::InitLightFactors(const BaseTerrain* pTerrain, std::vector<float>& LightFactors)
+{
+    int Index = 0;
+
+    for (int z = 0 ; z < m_depth ; z++) {
+        for (int x = 0 ; x < m_width ; x++) {
+            assert(Index < LightFactors.size());
+            LightFactors[Index] = pTerrain->GetLighting(x, z);
+            Index++;
+        }
+    }
+
+    assert(Index == LightFactors.size());
+}
+
+
+void TriangleList::UpdateLighting(const BaseTerrain* pTerrain)
+{
+    if (m_vb == 0) {
+        return;
+    }
+
+    std::vector<float> LightFactors;
+    LightFactors.resize(m_width * m_depth);
+
+    InitLightFactors(pTerrain, LightFactors);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_vb);
+    glBufferSubData(GL_ARRAY_BUFFER, GetLightFactorsOffset(), sizeof(LightFactors[0]) * LightFactors.size(), &LightFactors[0]);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
 void TriangleList::InitIndices(std::vector<unsigned int>& Indices)
 {
     int Index = 0;
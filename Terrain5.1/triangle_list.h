@@ -37,16 +37,21 @@ class TriangleList {
 
     void CreateTriangleList(int Width, int Depth, const BaseTerrain* pTerrain);
 
+    // Recalculates the light factors and uploads them over the old ones. The positions,
+    // texture coordinates and indices are not touched.
+    void UpdateLighting(const BaseTerrain* pTerrain);
+
     void Destroy();
 
     void Render();
 
  private:
 
+    // The light factors are stored in the same buffer after all the vertices
+    // so they can be updated with a single glBufferSubData
     struct Vertex {
         Vector3f Pos;        
         Vector2f Tex;
-        float LightFactor;
 
         void InitVertex(const BaseTerrain* pTerrain, int x, int z);
     };
@@ -55,6 +60,8 @@ class TriangleList {
 
 	void PopulateBuffers(const BaseTerrain* pTerrain);
     void InitVertices(const BaseTerrain* pTerrain, std::vector<Vertex>& Vertices);
+    void InitLightFactors(const BaseTerrain* pTerrain, std::vector<float>& LightFactors);
+    size_t GetLightFactorsOffset() const { return sizeof(Vertex) * m_width * m_depth; }
     void InitIndices(std::vector<uint>& Indices);
 
     int m_width = 0;
@@ -12,11 +12,17 @@ SOURCES="terrain_water.cpp \
 	midpoint_disp_terrain.cpp \
 	terrain.cpp \
 	lod_manager.cpp \
+	minmax_quadtree.cpp \
+	clipmap_terrain.cpp \
+	clipmap_technique.cpp \
+	compact_terrain_technique.cpp \
+	patch_draw_commands.cpp \
     simple_water.cpp \
     simple_water_technique.cpp
     triangle_list.cpp \
 	$OGLDEV_DIR/Common/ogldev_util.cpp \
 	$OGLDEV_DIR/Common/math_3d.cpp \
+	$OGLDEV_DIR/Common/ogldev_heightmap_sampling.cpp \
 	$OGLDEV_DIR/Common/ogldev_basic_glfw_camera.cpp \
 	$OGLDEV_DIR/Common/ogldev_glfw.cpp \
 	$OGLDEV_DIR/Common/ogldev_stb_image.cpp \
@@ -0,0 +1,94 @@
+/*
+    Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#version 330
+
+layout (location = 0) in vec2 GridPos;     // position inside the level in quads
+
+uniform mat4 gVP;
+uniform float gMinHeight;
+uniform float gMaxHeight;
+uniform vec4 gClipPlane;
+
+uniform sampler2DArray gHeightMap;
+uniform int gRingSize;
+uniform int gTextureMask;
+uniform float gTexScale;
+uniform float gTerrainWorldSize;
+uniform int gLevel;
+uniform ivec2 gLevelOrigin;
+uniform float gQuadSize;
+uniform float gMorphWidth;
+
+out vec4 Color;
+out vec2 Tex;
+out vec3 WorldPos;
+out vec3 Normal;
+
+// The layer of every level is addressed toroidally so the grid coordinates wrap
+float GetHeight(ivec2 Pos)
+{
+    return texelFetch(gHeightMap, ivec3(Pos & gTextureMask, gLevel), 0).r;
+}
+
+
+void main()
+{
+    ivec2 LocalPos = ivec2(GridPos);
+    ivec2 Pos = gLevelOrigin + LocalPos;
+
+    float Height = GetHeight(Pos);
+
+    // Along the border the vertices move to the surface of the next coarser level
+    // so there are no cracks between the levels. The origin of every level is even
+    // so the odd vertices are the ones that don't exist in the coarser level.
+    if (gMorphWidth > 0.0) {
+        ivec2 Odd = Pos & 1;
+        float CoarseHeight = (GetHeight(Pos - Odd) + GetHeight(Pos + Odd)) * 0.5;
+        int BorderDist = min(min(LocalPos.x, LocalPos.y), min(gRingSize - LocalPos.x, gRingSize - LocalPos.y));
+        float Morph = clamp((gMorphWidth - float(BorderDist)) / gMorphWidth, 0.0, 1.0);
+        Height = mix(Height, CoarseHeight, Morph);
+    }
+
+    vec3 Position = vec3(float(Pos.x) * gQuadSize, Height, float(Pos.y) * gQuadSize);
+
+    gl_Position = gVP * vec4(Position, 1.0);
+
+    float DeltaHeight = gMaxHeight - gMinHeight;
+
+    float HeightRatio = (Position.y - gMinHeight) / DeltaHeight;
+
+    float c = HeightRatio * 0.8 + 0.2;
+
+    Color = vec4(c, c, c, 1.0);
+
+    Tex = Position.xz * gTexScale;
+
+    WorldPos = Position;
+
+    float HeightLeft  = GetHeight(Pos - ivec2(1, 0));
+    float HeightRight = GetHeight(Pos + ivec2(1, 0));
+    float HeightDown  = GetHeight(Pos - ivec2(0, 1));
+    float HeightUp    = GetHeight(Pos + ivec2(0, 1));
+
+    Normal = vec3(HeightLeft - HeightRight, 2.0 * gQuadSize, HeightDown - HeightUp);
+
+    gl_ClipDistance[0] = dot(vec4(Position, 1.0), gClipPlane);
+
+    // The outer levels extend beyond the edges of the height map
+    gl_ClipDistance[1] = min(min(Position.x, Position.z), min(gTerrainWorldSize - Position.x, gTerrainWorldSize - Position.z));
+}
@@ -0,0 +1,81 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ogldev_util.h"
+#include "clipmap_technique.h"
+#include "texture_config.h"
+
+
+ClipmapTechnique::ClipmapTechnique()
+{
+}
+
+bool ClipmapTechnique::Init()
+{
+    if (!InitTerrainTechnique("clipmap.vs")) {
+        return false;
+    }
+
+    m_heightMapLoc = GetUniformLocation("gHeightMap");
+    m_ringSizeLoc = GetUniformLocation("gRingSize");
+    m_textureMaskLoc = GetUniformLocation("gTextureMask");
+    m_texScaleLoc = GetUniformLocation("gTexScale");
+    m_terrainWorldSizeLoc = GetUniformLocation("gTerrainWorldSize");
+    m_levelLoc = GetUniformLocation("gLevel");
+    m_levelOriginLoc = GetUniformLocation("gLevelOrigin");
+    m_quadSizeLoc = GetUniformLocation("gQuadSize");
+    m_morphWidthLoc = GetUniformLocation("gMorphWidth");
+
+    if (m_heightMapLoc == INVALID_UNIFORM_LOCATION ||
+        m_ringSizeLoc == INVALID_UNIFORM_LOCATION ||
+        m_textureMaskLoc == INVALID_UNIFORM_LOCATION ||
+        m_texScaleLoc == INVALID_UNIFORM_LOCATION ||
+        m_terrainWorldSizeLoc == INVALID_UNIFORM_LOCATION ||
+        m_levelLoc == INVALID_UNIFORM_LOCATION ||
+        m_levelOriginLoc == INVALID_UNIFORM_LOCATION ||
+        m_quadSizeLoc == INVALID_UNIFORM_LOCATION ||
+        m_morphWidthLoc == INVALID_UNIFORM_LOCATION) {
+        return false;
+    }
+
+    Enable();
+
+    glUniform1i(m_heightMapLoc, CLIPMAP_TEXTURE_UNIT_INDEX);
+
+    glUseProgram(0);
+
+    return true;
+}
+
+
+void ClipmapTechnique::SetClipmapParams(int RingSize, int TextureSize, float TexScale, float TerrainWorldSize)
+{
+    glUniform1i(m_ringSizeLoc, RingSize);
+    glUniform1i(m_textureMaskLoc, TextureSize - 1);
+    glUniform1f(m_texScaleLoc, TexScale);
+    glUniform1f(m_terrainWorldSizeLoc, TerrainWorldSize);
+}
+
+
+void ClipmapTechnique::SetLevel(int Level, int OriginX, int OriginZ, float QuadSize, float MorphWidth)
+{
+    glUniform1i(m_levelLoc, Level);
+    glUniform2i(m_levelOriginLoc, OriginX, OriginZ);
+    glUniform1f(m_quadSizeLoc, QuadSize);
+    glUniform1f(m_morphWidthLoc, MorphWidth);
+}
@@ -0,0 +1,57 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CLIPMAP_TECHNIQUE_H
+#define CLIPMAP_TECHNIQUE_H
+
+#include "terrain_technique.h"
+
+//
+// Same as the terrain technique but the vertices only carry their position inside
+// the level and the height is fetched from the clipmap texture
+//
+class ClipmapTechnique : public TerrainTechnique
+{
+public:
+
+    ClipmapTechnique();
+
+    virtual bool Init();
+
+    // TextureSize is the size of every layer of the height texture (a power of two).
+    // TexScale converts world XZ to the texture coordinates of the color textures.
+    void SetClipmapParams(int RingSize, int TextureSize, float TexScale, float TerrainWorldSize);
+
+    // OriginX/OriginZ are the grid coordinates of the first vertex of the level (in quads
+    // of the level). MorphWidth is the number of quads along the border of the level that
+    // are blended into the next coarser level. Zero disables the blending.
+    void SetLevel(int Level, int OriginX, int OriginZ, float QuadSize, float MorphWidth);
+
+private:
+    GLuint m_heightMapLoc = -1;
+    GLuint m_ringSizeLoc = -1;
+    GLuint m_textureMaskLoc = -1;
+    GLuint m_texScaleLoc = -1;
+    GLuint m_terrainWorldSizeLoc = -1;
+    GLuint m_levelLoc = -1;
+    GLuint m_levelOriginLoc = -1;
+    GLuint m_quadSizeLoc = -1;
+    GLuint m_morphWidthLoc = -1;
+};
+
+#endif  /* CLIPMAP_TECHNIQUE_H */
@@ -0,0 +1,399 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <algorithm>
+
+#include "clipmap_terrain.h"
+#include "terrain.h"
+#include "texture_config.h"
+
+#define MAX_CLIPMAP_RING_SIZE 252
+#define MAX_CLIPMAP_LEVELS 16
+
+// Rounds towards minus infinity unlike the / operator
+static int FloorDiv(int a, int b)
+{
+    return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+
+ClipmapTerrain::~ClipmapTerrain()
+{
+    Destroy();
+}
+
+
+void ClipmapTerrain::Destroy()
+{
+    if (m_vao > 0) {
+        glDeleteVertexArrays(1, &m_vao);
+        m_vao = 0;
+    }
+
+    if (m_vb > 0) {
+        glDeleteBuffers(1, &m_vb);
+        m_vb = 0;
+    }
+
+    if (m_ib > 0) {
+        glDeleteBuffers(1, &m_ib);
+        m_ib = 0;
+    }
+
+    if (m_heightTexture > 0) {
+        glDeleteTextures(1, &m_heightTexture);
+        m_heightTexture = 0;
+    }
+
+    m_levels.clear();
+}
+
+
+int ClipmapTerrain::CalcNumLevels(int RingSize, int TerrainSize)
+{
+    int NumLevels = 1;
+
+    while ((NumLevels < MAX_CLIPMAP_LEVELS) && ((RingSize / 2) * (1 << (NumLevels - 1)) < TerrainSize)) {
+        NumLevels++;
+    }
+
+    return NumLevels;
+}
+
+
+void ClipmapTerrain::CreateClipmap(int RingSize, int NumLevels, const BaseTerrain* pTerrain)
+{
+    if ((RingSize < 8) || (RingSize > MAX_CLIPMAP_RING_SIZE) || (RingSize % 4 != 0)) {
+        printf("%s:%d - invalid clipmap ring size %d\n", __FILE__, __LINE__, RingSize);
+        exit(0);
+    }
+
+    if ((NumLevels < 1) || (NumLevels > MAX_CLIPMAP_LEVELS)) {
+        printf("%s:%d - invalid number of clipmap levels %d\n", __FILE__, __LINE__, NumLevels);
+        exit(0);
+    }
+
+    Destroy();
+
+    m_pTerrain = pTerrain;
+    m_ringSize = RingSize;
+    m_morphWidth = (float)RingSize / 10.0f;
+    m_levels.resize(NumLevels);
+
+    // A level needs one more sample on each side for the normals
+    m_textureSize = 4;
+
+    while (m_textureSize < RingSize + 3) {
+        m_textureSize *= 2;
+    }
+
+    CreateGLState();
+
+    PopulateBuffers();
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    glGenTextures(1, &m_heightTexture);
+    glActiveTexture(CLIPMAP_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_heightTexture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R32F, m_textureSize, m_textureSize, NumLevels, 0, GL_RED, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    printf("Clipmap: %d levels of %dx%d quads, %d KB of heights\n", NumLevels, RingSize, RingSize,
+           (int)(m_textureSize * m_textureSize * NumLevels * sizeof(float) / 1024));
+}
+
+
+void ClipmapTerrain::CreateGLState()
+{
+    glGenVertexArrays(1, &m_vao);
+
+    glBindVertexArray(m_vao);
+
+    glGenBuffers(1, &m_vb);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_vb);
+
+    glGenBuffers(1, &m_ib);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ib);
+
+    int GRID_POS_LOC = 0;
+
+    glEnableVertexAttribArray(GRID_POS_LOC);
+    glVertexAttribPointer(GRID_POS_LOC, 2, GL_FLOAT, GL_FALSE, sizeof(Vector2f), (const void*)0);
+}
+
+
+void ClipmapTerrain::PopulateBuffers()
+{
+    int NumVerticesPerSide = m_ringSize + 1;
+
+    std::vector<Vector2f> Vertices(NumVerticesPerSide * NumVerticesPerSide);
+
+    for (int z = 0 ; z < NumVerticesPerSide ; z++) {
+        for (int x = 0 ; x < NumVerticesPerSide ; x++) {
+            Vertices[z * NumVerticesPerSide + x] = Vector2f((float)x, (float)z);
+        }
+    }
+
+    const int IndicesPerQuad = 6;
+    int HoleSize = m_ringSize / 2;
+
+    m_gridNumIndices = m_ringSize * m_ringSize * IndicesPerQuad;
+    m_ringNumIndices = (m_ringSize * m_ringSize - HoleSize * HoleSize) * IndicesPerQuad;
+
+    std::vector<GLushort> Indices(m_gridNumIndices + m_ringNumIndices * NUM_RING_VARIANTS);
+
+    int Index = 0;
+
+    for (int z = 0 ; z < m_ringSize ; z++) {
+        for (int x = 0 ; x < m_ringSize ; x++) {
+            Index = AddQuad(Index, Indices, x, z);
+        }
+    }
+
+    for (int Variant = 0 ; Variant < NUM_RING_VARIANTS ; Variant++) {
+        int HoleStartX = m_ringSize / 4 + (Variant & 1);
+        int HoleStartZ = m_ringSize / 4 + (Variant >> 1);
+
+        for (int z = 0 ; z < m_ringSize ; z++) {
+            for (int x = 0 ; x < m_ringSize ; x++) {
+                bool IsInHole = (x >= HoleStartX) && (x < HoleStartX + HoleSize) &&
+                                (z >= HoleStartZ) && (z < HoleStartZ + HoleSize);
+
+                if (!IsInHole) {
+                    Index = AddQuad(Index, Indices, x, z);
+                }
+            }
+        }
+    }
+
+    assert(Index == (int)Indices.size());
+
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Vertices[0]) * Vertices.size(), &Vertices[0], GL_STATIC_DRAW);
+
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(Indices[0]) * Indices.size(), &Indices[0], GL_STATIC_DRAW);
+}
+
+
+// Same winding and diagonal as the geomip grid. The vertex shader relies on the
+// diagonal going from (x, z) to (x + 1, z + 1) when it blends into the coarser level.
+int ClipmapTerrain::AddQuad(int Index, std::vector<GLushort>& Indices, int x, int z)
+{
+    int NumVerticesPerSide = m_ringSize + 1;
+
+    GLushort BottomLeft  = (GLushort)(z * NumVerticesPerSide + x);
+    GLushort BottomRight = (GLushort)(BottomLeft + 1);
+    GLushort TopLeft     = (GLushort)(BottomLeft + NumVerticesPerSide);
+    GLushort TopRight    = (GLushort)(TopLeft + 1);
+
+    Indices[Index++] = BottomLeft;
+    Indices[Index++] = TopLeft;
+    Indices[Index++] = TopRight;
+
+    Indices[Index++] = BottomLeft;
+    Indices[Index++] = TopRight;
+    Indices[Index++] = BottomRight;
+
+    return Index;
+}
+
+
+void ClipmapTerrain::Update(const Vector3f& CameraPos)
+{
+    m_numUploadedTexels = 0;
+
+    float WorldScale = m_pTerrain->GetWorldScale();
+
+    int CameraX = (int)floorf(CameraPos.x / WorldScale);
+    int CameraZ = (int)floorf(CameraPos.z / WorldScale);
+
+    glActiveTexture(CLIPMAP_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_heightTexture);
+
+    // The origin of every level is snapped to the quads of the next level so that
+    // the hole of the next level is aligned with it
+    for (int Level = 0 ; Level < (int)m_levels.size() ; Level++) {
+        int NextLevelQuad = 2 << Level;
+        int OriginX = FloorDiv(CameraX, NextLevelQuad) * 2 - m_ringSize / 2;
+        int OriginZ = FloorDiv(CameraZ, NextLevelQuad) * 2 - m_ringSize / 2;
+
+        UpdateLevel(Level, OriginX, OriginZ);
+    }
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+
+void ClipmapTerrain::UpdateLevel(int Level, int OriginX, int OriginZ)
+{
+    ClipmapLevel& l = m_levels[Level];
+
+    // The layer holds the vertices of the level plus a border of one sample
+    int Size = m_ringSize + 3;
+    int NewX = OriginX - 1;
+    int NewZ = OriginZ - 1;
+    int OldX = l.OriginX - 1;
+    int OldZ = l.OriginZ - 1;
+    int DeltaX = NewX - OldX;
+    int DeltaZ = NewZ - OldZ;
+
+    if (!l.IsValid || (abs(DeltaX) >= Size) || (abs(DeltaZ) >= Size)) {
+        UploadRegion(Level, NewX, NewZ, Size, Size);
+    } else {
+        if (DeltaX > 0) {
+            UploadRegion(Level, OldX + Size, NewZ, DeltaX, Size);
+        } else if (DeltaX < 0) {
+            UploadRegion(Level, NewX, NewZ, -DeltaX, Size);
+        }
+
+        if (DeltaZ > 0) {
+            UploadRegion(Level, NewX, OldZ + Size, Size, DeltaZ);
+        } else if (DeltaZ < 0) {
+            UploadRegion(Level, NewX, NewZ, Size, -DeltaZ);
+        }
+    }
+
+    l.OriginX = OriginX;
+    l.OriginZ = OriginZ;
+    l.IsValid = true;
+}
+
+
+// Splits the region where it wraps around the edges of the layer
+void ClipmapTerrain::UploadRegion(int Level, int x, int z, int Width, int Depth)
+{
+    int Mask = m_textureSize - 1;
+
+    int Width0 = std::min(Width, m_textureSize - (x & Mask));
+    int Depth0 = std::min(Depth, m_textureSize - (z & Mask));
+
+    UploadRect(Level, x, z, Width0, Depth0);
+
+    if (Width0 < Width) {
+        UploadRect(Level, x + Width0, z, Width - Width0, Depth0);
+    }
+
+    if (Depth0 < Depth) {
+        UploadRect(Level, x, z + Depth0, Width0, Depth - Depth0);
+
+        if (Width0 < Width) {
+            UploadRect(Level, x + Width0, z + Depth0, Width - Width0, Depth - Depth0);
+        }
+    }
+}
+
+
+void ClipmapTerrain::UploadRect(int Level, int x, int z, int Width, int Depth)
+{
+    const Array2D<float>& HeightMap = m_pTerrain->GetHeightMap();
+    int MaxCoord = m_pTerrain->GetSize() - 1;
+    int Step = 1 << Level;
+
+    m_uploadBuffer.resize(Width * Depth);
+
+    float* p = m_uploadBuffer.data();
+
+    // Point sampled so that the vertices that two levels share have the same height.
+    // Beyond the edges of the height map the border is repeated.
+    for (int j = 0 ; j < Depth ; j++) {
+        int HeightMapZ = std::min(std::max((z + j) * Step, 0), MaxCoord);
+
+        for (int i = 0 ; i < Width ; i++) {
+            int HeightMapX = std::min(std::max((x + i) * Step, 0), MaxCoord);
+            *p++ = HeightMap.Get(HeightMapX, HeightMapZ);
+        }
+    }
+
+    int Mask = m_textureSize - 1;
+
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, x & Mask, z & Mask, Level, Width, Depth, 1, GL_RED, GL_FLOAT, m_uploadBuffer.data());
+
+    m_numUploadedTexels += Width * Depth;
+}
+
+
+int ClipmapTerrain::GetRingVariant(int Level) const
+{
+    assert(Level > 0);
+
+    const ClipmapLevel& Fine = m_levels[Level - 1];
+    const ClipmapLevel& Coarse = m_levels[Level];
+
+    // The origins are even so the division is exact
+    int HoleX = Fine.OriginX / 2 - Coarse.OriginX - m_ringSize / 4;
+    int HoleZ = Fine.OriginZ / 2 - Coarse.OriginZ - m_ringSize / 4;
+
+    assert((HoleX == 0) || (HoleX == 1));
+    assert((HoleZ == 0) || (HoleZ == 1));
+
+    return HoleZ * 2 + HoleX;
+}
+
+
+void ClipmapTerrain::Render(ClipmapTechnique& Tech)
+{
+    if (m_levels.empty() || !m_levels[0].IsValid) {
+        return;
+    }
+
+    float WorldScale = m_pTerrain->GetWorldScale();
+    float TerrainWorldSize = (float)(m_pTerrain->GetSize() - 1) * WorldScale;
+
+    // Same texture coordinates as the vertices of the geomip grid
+    float TexScale = m_pTerrain->GetTextureScale() / ((float)m_pTerrain->GetSize() * WorldScale);
+
+    Tech.SetClipmapParams(m_ringSize, m_textureSize, TexScale, TerrainWorldSize);
+
+    glBindVertexArray(m_vao);
+
+    glActiveTexture(CLIPMAP_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_heightTexture);
+
+    glEnable(GL_CLIP_DISTANCE1);
+
+    int NumLevels = (int)m_levels.size();
+
+    for (int Level = 0 ; Level < NumLevels ; Level++) {
+        const ClipmapLevel& l = m_levels[Level];
+
+        float QuadSize = WorldScale * (float)(1 << Level);
+        float MorphWidth = (Level == NumLevels - 1) ? 0.0f : m_morphWidth;
+
+        Tech.SetLevel(Level, l.OriginX, l.OriginZ, QuadSize, MorphWidth);
+
+        if (Level == 0) {
+            glDrawElements(GL_TRIANGLES, m_gridNumIndices, GL_UNSIGNED_SHORT, (void*)0);
+        } else {
+            size_t FirstIndex = m_gridNumIndices + GetRingVariant(Level) * m_ringNumIndices;
+            glDrawElements(GL_TRIANGLES, m_ringNumIndices, GL_UNSIGNED_SHORT, (void*)(FirstIndex * sizeof(GLushort)));
+        }
+    }
+
+    glDisable(GL_CLIP_DISTANCE1);
+
+    glBindVertexArray(0);
+}
@@ -0,0 +1,114 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CLIPMAP_TERRAIN_H
+#define CLIPMAP_TERRAIN_H
+
+#include <GL/glew.h>
+#include <vector>
+
+#include "ogldev_math_3d.h"
+#include "clipmap_technique.h"
+
+// this header is included by terrain.h so we have a forward
+// declaration for BaseTerrain.
+class BaseTerrain;
+
+//
+// Geometry clipmap
+//
+// A stack of nested square levels centered on the camera. Every level has RingSize
+// quads along each side and its quads are twice as large as the ones of the previous
+// level. Level zero is a full grid at the resolution of the height map and the others
+// are rings around the hole that the previous level covers. All the levels share a
+// single vertex buffer of grid positions - the heights come from a texture array with
+// a layer per level. When the camera moves only the rows and columns that enter a level
+// are written to its layer (the layers are addressed toroidally) so the cost of the
+// clipmap depends on the ring size and the number of levels rather than on the size
+// of the height map.
+//
+class ClipmapTerrain {
+ public:
+    ClipmapTerrain() {}
+
+    ~ClipmapTerrain();
+
+    // RingSize must be a multiple of four and not larger than 252 so that a level
+    // with its one sample border fits in a 256x256 layer and 16 bit indices
+    void CreateClipmap(int RingSize, int NumLevels, const BaseTerrain* pTerrain);
+
+    void Destroy();
+
+    // Moves the levels with the camera and uploads the heights that came into view.
+    // Call once per frame before the render passes.
+    void Update(const Vector3f& CameraPos);
+
+    // The technique must be enabled
+    void Render(ClipmapTechnique& Tech);
+
+    int GetNumLevels() const { return (int)m_levels.size(); }
+
+    // Number of height samples written by the last Update
+    int GetNumUploadedTexels() const { return m_numUploadedTexels; }
+
+    // The smallest number of levels that covers the entire height map from any camera position on it
+    static int CalcNumLevels(int RingSize, int TerrainSize);
+
+ private:
+
+    struct ClipmapLevel {
+        int OriginX = 0;        // grid coordinates of the first vertex (in quads of the level)
+        int OriginZ = 0;
+        bool IsValid = false;   // false until the layer is uploaded for the first time
+    };
+
+    void CreateGLState();
+
+    void PopulateBuffers();
+
+    int AddQuad(int Index, std::vector<GLushort>& Indices, int x, int z);
+
+    void UpdateLevel(int Level, int OriginX, int OriginZ);
+
+    void UploadRegion(int Level, int x, int z, int Width, int Depth);
+
+    void UploadRect(int Level, int x, int z, int Width, int Depth);
+
+    int GetRingVariant(int Level) const;
+
+    const BaseTerrain* m_pTerrain = NULL;
+    int m_ringSize = 0;
+    int m_textureSize = 0;          // of a single layer
+    float m_morphWidth = 0.0f;
+    std::vector<ClipmapLevel> m_levels;
+    std::vector<float> m_uploadBuffer;
+    int m_numUploadedTexels = 0;
+
+    // The index buffer holds the full grid followed by the four rings. The hole of
+    // a ring is either centered or one quad off along each axis - see GetRingVariant.
+    #define NUM_RING_VARIANTS 4
+    int m_gridNumIndices = 0;
+    int m_ringNumIndices = 0;
+
+    GLuint m_vao = 0;
+    GLuint m_vb = 0;
+    GLuint m_ib = 0;
+    GLuint m_heightTexture = 0;
+};
+
+#endif
@@ -0,0 +1,61 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ogldev_util.h"
+#include "compact_terrain_technique.h"
+
+
+CompactTerrainTechnique::CompactTerrainTechnique()
+{
+}
+
+bool CompactTerrainTechnique::Init()
+{
+    if (!InitTerrainTechnique("terrain_compact.vs")) {
+        return false;
+    }
+
+    m_patchSizeLoc = GetUniformLocation("gPatchSize");
+    m_numPatchesXLoc = GetUniformLocation("gNumPatchesX");
+    m_worldScaleLoc = GetUniformLocation("gWorldScale");
+    m_heightBaseLoc = GetUniformLocation("gHeightBase");
+    m_heightRangeLoc = GetUniformLocation("gHeightRange");
+    m_texScaleLoc = GetUniformLocation("gTexScale");
+
+    if (m_patchSizeLoc == INVALID_UNIFORM_LOCATION ||
+        m_numPatchesXLoc == INVALID_UNIFORM_LOCATION ||
+        m_worldScaleLoc == INVALID_UNIFORM_LOCATION ||
+        m_heightBaseLoc == INVALID_UNIFORM_LOCATION ||
+        m_heightRangeLoc == INVALID_UNIFORM_LOCATION ||
+        m_texScaleLoc == INVALID_UNIFORM_LOCATION) {
+        return false;
+    }
+
+    return true;
+}
+
+
+void CompactTerrainTechnique::SetGridParams(int PatchSize, int NumPatchesX, float WorldScale, float HeightBase, float HeightRange, float TexScale)
+{
+    glUniform1i(m_patchSizeLoc, PatchSize);
+    glUniform1i(m_numPatchesXLoc, NumPatchesX);
+    glUniform1f(m_worldScaleLoc, WorldScale);
+    glUniform1f(m_heightBaseLoc, HeightBase);
+    glUniform1f(m_heightRangeLoc, HeightRange);
+    glUniform1f(m_texScaleLoc, TexScale);
+}
@@ -0,0 +1,49 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COMPACT_TERRAIN_TECHNIQUE_H
+#define COMPACT_TERRAIN_TECHNIQUE_H
+
+#include "terrain_technique.h"
+
+//
+// Terrain technique for the compact vertices of the geomip grid. The position and
+// the texture coordinates are calculated from gl_VertexID.
+//
+class CompactTerrainTechnique : public TerrainTechnique
+{
+public:
+
+    CompactTerrainTechnique();
+
+    virtual bool Init();
+
+    // See GeomipGrid::GetHeightQuantization. TexScale converts height map coordinates
+    // to the texture coordinates of the color textures.
+    void SetGridParams(int PatchSize, int NumPatchesX, float WorldScale, float HeightBase, float HeightRange, float TexScale);
+
+private:
+    GLuint m_patchSizeLoc = -1;
+    GLuint m_numPatchesXLoc = -1;
+    GLuint m_worldScaleLoc = -1;
+    GLuint m_heightBaseLoc = -1;
+    GLuint m_heightRangeLoc = -1;
+    GLuint m_texScaleLoc = -1;
+};
+
+#endif  /* COMPACT_TERRAIN_TECHNIQUE_H */
@@ -18,9 +18,12 @@
 
 
 #include <stdio.h>
+#include <stddef.h>
 #include <vector>
+#include <algorithm>
 
 #include "ogldev_math_3d.h"
+#include "ogldev_heightmap_sampling.h"
 #include "geomip_grid.h"
 #include "terrain.h"
 
@@ -42,19 +45,24 @@ void GeomipGrid::Destroy()
 {
     if (m_vao > 0) {
         glDeleteVertexArrays(1, &m_vao);
+        m_vao = 0;
     }
 
     if (m_vb > 0) {
         glDeleteBuffers(1, &m_vb);
+        m_vb = 0;
     }
 
     if (m_ib > 0) {
         glDeleteBuffers(1, &m_ib);
+        m_ib = 0;
     }
+
+    DestroyIndirectBuffer();
 }
 
 
-void GeomipGrid::CreateGeomipGrid(int Width, int Depth, int PatchSize, const BaseTerrain* pTerrain)
+void GeomipGrid::CreateGeomipGrid(int Width, int Depth, int PatchSize, const BaseTerrain* pTerrain, bool CompactVertices)
 {
     if ((Width - 1) % (PatchSize - 1) != 0) {
         int RecommendedWidth = ((Width - 1 + PatchSize - 1) / (PatchSize - 1)) * (PatchSize - 1) + 1;
@@ -80,10 +88,26 @@ void GeomipGrid::CreateGeomipGrid(int Width, int Depth, int PatchSize, const Bas
         exit(0);
     }
 
+    Destroy();
+
     m_width = Width;
     m_depth = Depth;
     m_patchSize = PatchSize;
     m_pTerrain = pTerrain;
+    m_compactVertices = CompactVertices;
+
+    // The compact vertices of a patch are stored together so the indices only need to
+    // reach the end of a single patch
+    m_indexStride = CompactVertices ? PatchSize : Width;
+    int MaxIndex = (PatchSize - 1) * m_indexStride + PatchSize - 1;
+
+    if (MaxIndex <= 0xffff) {
+        m_indexType = GL_UNSIGNED_SHORT;
+        m_indexSize = sizeof(GLushort);
+    } else {
+        m_indexType = GL_UNSIGNED_INT;
+        m_indexSize = sizeof(unsigned int);
+    }
 
     m_numPatchesX = (Width - 1) / (PatchSize - 1);
     m_numPatchesZ = (Depth - 1) / (PatchSize - 1);
@@ -92,6 +116,8 @@ void GeomipGrid::CreateGeomipGrid(int Width, int Depth, int PatchSize, const Bas
     m_maxLOD = m_lodManager.InitLodManager(PatchSize, m_numPatchesX, m_numPatchesZ, m_worldScale);
     m_lodInfo.resize(m_maxLOD + 1);
 
+    m_quadtree.Build(pTerrain, m_numPatchesX, m_numPatchesZ, PatchSize, m_maxLOD);
+
     CreateGLState();
 
 	PopulateBuffers(pTerrain);
@@ -99,6 +125,65 @@ void GeomipGrid::CreateGeomipGrid(int Width, int Depth, int PatchSize, const Bas
     glBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    CreateIndirectBuffer();
+
+    printf("Geomip grid: vertex buffer %.2f MB, index buffer %.2f MB (%d bit indices)\n",
+           (float)m_vertexBufferSize / (1024.0f * 1024.0f), (float)m_indexBufferSize / (1024.0f * 1024.0f),
+           (int)m_indexSize * 8);
+}
+
+
+void GeomipGrid::CreateIndirectBuffer()
+{
+    DestroyIndirectBuffer();
+
+    int NumPatches = m_numPatchesX * m_numPatchesZ;
+
+    m_commands.resize(NumPatches);
+
+    m_isMultiDrawSupported = GLEW_ARB_multi_draw_indirect && GLEW_ARB_buffer_storage;
+
+    if (!m_isMultiDrawSupported) {
+        printf("Multi draw indirect or buffer storage is not supported - drawing one patch at a time\n");
+        return;
+    }
+
+    GLsizeiptr Size = sizeof(DrawElementsIndirectCommand) * NumPatches * NUM_INDIRECT_REGIONS;
+    GLbitfield Flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glGenBuffers(1, &m_indirectBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+    glBufferStorage(GL_DRAW_INDIRECT_BUFFER, Size, NULL, Flags);
+    m_pIndirectCommands = (DrawElementsIndirectCommand*)glMapBufferRange(GL_DRAW_INDIRECT_BUFFER, 0, Size, Flags);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    if (!m_pIndirectCommands) {
+        printf("Error mapping the indirect buffer\n");
+        exit(0);
+    }
+}
+
+
+void GeomipGrid::DestroyIndirectBuffer()
+{
+    for (int i = 0 ; i < NUM_INDIRECT_REGIONS ; i++) {
+        if (m_indirectFences[i]) {
+            glDeleteSync(m_indirectFences[i]);
+            m_indirectFences[i] = 0;
+        }
+    }
+
+    if (m_indirectBuffer > 0) {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+        glUnmapBuffer(GL_DRAW_INDIRECT_BUFFER);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glDeleteBuffers(1, &m_indirectBuffer);
+        m_indirectBuffer = 0;
+        m_pIndirectCommands = NULL;
+    }
+
+    m_curIndirectRegion = 0;
 }
 
 
@@ -115,6 +200,19 @@ void GeomipGrid::CreateGLState()
     glGenBuffers(1, &m_ib);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ib);
 
+    if (m_compactVertices) {
+        int HEIGHT_LOC = 0;
+        int NORMAL_LOC = 1;
+
+        glEnableVertexAttribArray(HEIGHT_LOC);
+        glVertexAttribPointer(HEIGHT_LOC, 1, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(CompactVertex), (const void*)offsetof(CompactVertex, Height));
+
+        glEnableVertexAttribArray(NORMAL_LOC);
+        glVertexAttribPointer(NORMAL_LOC, 2, GL_SHORT, GL_TRUE, sizeof(CompactVertex), (const void*)offsetof(CompactVertex, Normal));
+
+        return;
+    }
+
     int POS_LOC = 0;
     int TEX_LOC = 1;
 	int NORMAL_LOC = 2;
@@ -137,10 +235,19 @@ void GeomipGrid::CreateGLState()
 
 void GeomipGrid::PopulateBuffers(const BaseTerrain* pTerrain)
 {
-    std::vector<Vertex> Vertices;
-    Vertices.resize(m_width * m_depth);
-    printf("Preparing space for %zu vertices\n", Vertices.size());
-    InitVertices(pTerrain, Vertices);
+    if (m_compactVertices) {
+        PopulateCompactVertices(pTerrain);
+    } else {
+        std::vector<Vertex> Vertices;
+        Vertices.resize(m_width * m_depth);
+        printf("Preparing space for %zu vertices\n", Vertices.size());
+        InitVertices(pTerrain, Vertices);
+
+        CalcNormals(pTerrain, Vertices);
+
+        m_vertexBufferSize = sizeof(Vertices[0]) * Vertices.size();
+        glBufferData(GL_ARRAY_BUFFER, m_vertexBufferSize, &Vertices[0], GL_STATIC_DRAW);
+    }
 
     int NumIndices = CalcNumIndices();
 	std::vector<unsigned int> Indices;
@@ -149,11 +256,79 @@ void GeomipGrid::PopulateBuffers(const BaseTerrain* pTerrain)
     NumIndices = InitIndices(Indices);
     printf("Final number of indices %d\n", NumIndices);
 
-    CalcNormals(Vertices, Indices);
+    m_indexBufferSize = m_indexSize * NumIndices;
+
+    if (m_indexType == GL_UNSIGNED_SHORT) {
+        std::vector<GLushort> ShortIndices(Indices.begin(), Indices.begin() + NumIndices);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indexBufferSize, &ShortIndices[0], GL_STATIC_DRAW);
+    } else {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indexBufferSize, &Indices[0], GL_STATIC_DRAW);
+    }
+}
 
-    glBufferData(GL_ARRAY_BUFFER, sizeof(Vertices[0]) * Vertices.size(), &Vertices[0], GL_STATIC_DRAW);
 
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(Indices[0]) * NumIndices, &Indices[0], GL_STATIC_DRAW);
+static void EncodeOctahedral(const Vector3f& Normal, GLshort* pEncoded)
+{
+    float Sum = fabsf(Normal.x) + fabsf(Normal.y) + fabsf(Normal.z);
+    float u = Normal.x / Sum;
+    float v = Normal.z / Sum;
+
+    // Fold the lower hemisphere over the diagonals
+    if (Normal.y < 0.0f) {
+        float FoldedU = (1.0f - fabsf(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+        float FoldedV = (1.0f - fabsf(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+        u = FoldedU;
+        v = FoldedV;
+    }
+
+    pEncoded[0] = (GLshort)roundf(u * 32767.0f);
+    pEncoded[1] = (GLshort)roundf(v * 32767.0f);
+}
+
+
+void GeomipGrid::PopulateCompactVertices(const BaseTerrain* pTerrain)
+{
+    const Array2D<float>& HeightMap = pTerrain->GetHeightMap();
+
+    std::vector<Vector3f> Normals(m_width * m_depth);
+    CalcHeightMapNormals(HeightMap, m_worldScale, Normals.data());
+
+    m_heightBase = HeightMap.Get(0, 0);
+    float MaxHeight = m_heightBase;
+
+    for (int i = 0 ; i < m_width * m_depth ; i++) {
+        m_heightBase = std::min(m_heightBase, HeightMap.Get(i));
+        MaxHeight = std::max(MaxHeight, HeightMap.Get(i));
+    }
+
+    m_heightRange = MaxHeight - m_heightBase;
+    float HeightToUnorm = (m_heightRange > 0.0f) ? 65535.0f / m_heightRange : 0.0f;
+
+    // The vertices on the border of a patch are duplicated in its neighbors
+    int PatchVertexCount = m_patchSize * m_patchSize;
+    std::vector<CompactVertex> Vertices(m_numPatchesX * m_numPatchesZ * PatchVertexCount);
+    printf("Preparing space for %zu compact vertices\n", Vertices.size());
+
+    CompactVertex* p = Vertices.data();
+
+    for (int PatchZ = 0 ; PatchZ < m_numPatchesZ ; PatchZ++) {
+        for (int PatchX = 0 ; PatchX < m_numPatchesX ; PatchX++) {
+            for (int z = 0 ; z < m_patchSize ; z++) {
+                for (int x = 0 ; x < m_patchSize ; x++) {
+                    int HeightMapX = PatchX * (m_patchSize - 1) + x;
+                    int HeightMapZ = PatchZ * (m_patchSize - 1) + z;
+
+                    float Height = (HeightMap.Get(HeightMapX, HeightMapZ) - m_heightBase) * HeightToUnorm;
+                    p->Height = (GLushort)(Height + 0.5f);
+                    EncodeOctahedral(Normals[HeightMapZ * m_width + HeightMapX], p->Normal);
+                    p++;
+                }
+            }
+        }
+    }
+
+    m_vertexBufferSize = sizeof(Vertices[0]) * Vertices.size();
+    glBufferData(GL_ARRAY_BUFFER, m_vertexBufferSize, &Vertices[0], GL_STATIC_DRAW);
 }
 
 
@@ -267,18 +442,18 @@ uint GeomipGrid::CreateTriangleFan(int Index, std::vector<unsigned int>& Indices
     int StepBottom = powi(2, lodBottom);
     int StepCenter = powi(2, lodCore);
 
-    uint IndexCenter = (z + StepCenter) * m_width + x + StepCenter;
+    uint IndexCenter = (z + StepCenter) * m_indexStride + x + StepCenter;
 
     // first up
-    uint IndexTemp1 = z * m_width + x;
-    uint IndexTemp2 = (z + StepLeft) * m_width + x;
+    uint IndexTemp1 = z * m_indexStride + x;
+    uint IndexTemp2 = (z + StepLeft) * m_indexStride + x;
 
     Index = AddTriangle(Index, Indices, IndexCenter, IndexTemp1, IndexTemp2);
 
     // second up
     if (lodLeft == lodCore) {
         IndexTemp1 = IndexTemp2;
-        IndexTemp2 += StepLeft * m_width;
+        IndexTemp2 += StepLeft * m_indexStride;
 
         Index = AddTriangle(Index, Indices, IndexCenter, IndexTemp1, IndexTemp2);
     }
@@ -299,14 +474,14 @@ uint GeomipGrid::CreateTriangleFan(int Index, std::vector<unsigned int>& Indices
 
     // first down
     IndexTemp1 = IndexTemp2;
-    IndexTemp2 -= StepRight * m_width;
+    IndexTemp2 -= StepRight * m_indexStride;
 
     Index = AddTriangle(Index, Indices, IndexCenter, IndexTemp1, IndexTemp2);
 
     // second down
     if (lodRight == lodCore) {
         IndexTemp1 = IndexTemp2;
-        IndexTemp2 -= StepRight * m_width;
+        IndexTemp2 -= StepRight * m_indexStride;
 
         Index = AddTriangle(Index, Indices, IndexCenter, IndexTemp1, IndexTemp2);
     }
@@ -342,85 +517,126 @@ uint GeomipGrid::AddTriangle(uint Index, std::vector<uint>& Indices, uint v1, ui
 }
 
 
-void GeomipGrid::CalcNormals(std::vector<Vertex>& Vertices, std::vector<uint>& Indices)
+void GeomipGrid::CalcNormals(const BaseTerrain* pTerrain, std::vector<Vertex>& Vertices)
 {
-    unsigned int Index = 0;
-
-    // Accumulate each triangle normal into each of the triangle vertices
-    for (int z = 0 ; z < m_depth - 1 ; z += (m_patchSize - 1)) {
-        for (int x = 0 ; x < m_width - 1; x += (m_patchSize - 1)) {
-            int BaseVertex = z * m_width + x;
-            //printf("Base index %d\n", BaseVertex);
-            int NumIndices = m_lodInfo[0].info[0][0][0][0].Count;
-            for (int i = 0 ; i < NumIndices ; i += 3) {
-                unsigned int Index0 = BaseVertex + Indices[i];
-                unsigned int Index1 = BaseVertex + Indices[i + 1];
-                unsigned int Index2 = BaseVertex + Indices[i + 2];
-		        Vector3f v1 = Vertices[Index1].Pos - Vertices[Index0].Pos;
-		        Vector3f v2 = Vertices[Index2].Pos - Vertices[Index0].Pos;
-		        Vector3f Normal = v1.Cross(v2);
-		        Normal.Normalize();
-
-		        Vertices[Index0].Normal += Normal;
-		        Vertices[Index1].Normal += Normal;
-		        Vertices[Index2].Normal += Normal;
-    		}
-        }
-    }
+    std::vector<Vector3f> Normals(Vertices.size());
 
-    // Normalize all the vertex normals
-    for (unsigned int i = 0 ; i < Vertices.size() ; i++) {
-        Vertices[i].Normal.Normalize();
+    CalcHeightMapNormals(pTerrain->GetHeightMap(), m_worldScale, Normals.data());
+
+    for (size_t i = 0 ; i < Vertices.size() ; i++) {
+        Vertices[i].Normal = Normals[i];
     }
 }
 
 
-void GeomipGrid::Render(const Vector3f& CameraPos, const Matrix4f& ViewProj)
+void GeomipGrid::SetScreenSpaceError(float ProjScale, float MaxPixelError)
 {
-    m_lodManager.Update(CameraPos);
+    int NumPatches = m_numPatchesX * m_numPatchesZ;
+    std::vector<float> GeometricErrors(NumPatches * (m_maxLOD + 1));
+    std::vector<float> PatchRadius(NumPatches);
+
+    float HalfPatchSize = ((float)m_patchSize - 1.0f) * m_worldScale / 2.0f;
+
+    for (int Patch = 0 ; Patch < NumPatches ; Patch++) {
+        for (int Lod = 0 ; Lod <= m_maxLOD ; Lod++) {
+            GeometricErrors[Patch * (m_maxLOD + 1) + Lod] = m_quadtree.GetGeometricError(Patch, Lod);
+        }
+
+        float MinHeight, MaxHeight;
+        m_quadtree.GetPatchHeightRange(Patch, MinHeight, MaxHeight);
+        float MaxAbsHeight = std::max(fabsf(MinHeight), fabsf(MaxHeight));
+
+        PatchRadius[Patch] = sqrtf(2.0f * HalfPatchSize * HalfPatchSize + MaxAbsHeight * MaxAbsHeight);
+    }
 
+    m_lodManager.SetScreenSpaceError(GeometricErrors, PatchRadius, ProjScale, MaxPixelError);
+}
+
+
+void GeomipGrid::Render(const Matrix4f& ViewProj)
+{
     FrustumCulling fc(ViewProj);
 
     glBindVertexArray(m_vao);
 
     if (gShowPoints > 0) {
-        glDrawElementsBaseVertex(GL_POINTS, m_lodInfo[0].info[0][0][0][0].Count, GL_UNSIGNED_INT, (void*)0, 0);
+        glDrawElementsBaseVertex(GL_POINTS, m_lodInfo[0].info[0][0][0][0].Count, m_indexType, (void*)0, 0);
     }
 
     if (gShowPoints != 2) {
-        float PatchSize = ((float)m_patchSize - 1.0f) * m_worldScale;  // m_patchSize is in vertices and PatchSize is the actual size (2 vertices --> size 1)
-        float HalfPatchSize =  PatchSize / 2.0f;
+        m_visiblePatches.clear();
+        m_quadtree.GetVisiblePatches(fc, m_visiblePatches);
 
-        for (int PatchZ = 0 ; PatchZ < m_numPatchesZ ; PatchZ++) {
-            for (int PatchX = 0 ; PatchX < m_numPatchesX ; PatchX++) {
+        RenderPatches();
+    }
 
-                int x = PatchX * (m_patchSize - 1);
-                int z = PatchZ * (m_patchSize - 1);
-            
-                if (!IsPatchInsideViewFrustum_WorldSpace(x, z, fc)) {
-                    continue;
-                }
+    glBindVertexArray(0);
+}
+
+
+void GeomipGrid::RenderPatches()
+{
+    if (m_visiblePatches.empty()) {
+        m_numDrawCalls = 0;
+        return;
+    }
+
+    int PatchVertexCount = m_compactVertices ? m_patchSize * m_patchSize : 0;
 
-                const LodManager::PatchLod& plod = m_lodManager.GetPatchLod(PatchX, PatchZ);
-                int C = plod.Core;
-                int L = plod.Left;
-                int R = plod.Right;
-                int T = plod.Top;
-                int B = plod.Bottom;
+    if (m_isMultiDrawSupported && m_multiDrawEnabled) {
+        int Region = m_curIndirectRegion;
+        m_curIndirectRegion = (m_curIndirectRegion + 1) % NUM_INDIRECT_REGIONS;
 
-                size_t BaseIndex = sizeof(unsigned int) * m_lodInfo[C].info[L][R][T][B].Start;
+        int NumCommands = BuildPatchDrawCommands(m_visiblePatches, m_lodManager, m_lodInfo, m_numPatchesX,
+                                                 m_patchSize, m_width, PatchVertexCount, GetIndirectRegion(Region));
 
-                int BaseVertex = z * m_width + x;
+        size_t Offset = sizeof(DrawElementsIndirectCommand) * m_numPatchesX * m_numPatchesZ * Region;
 
-                glDrawElementsBaseVertex(GL_TRIANGLES, m_lodInfo[C].info[L][R][T][B].Count, 
-                                         GL_UNSIGNED_INT, (void*)BaseIndex, BaseVertex);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, m_indexType, (const void*)Offset, NumCommands, 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+        m_indirectFences[Region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        m_numDrawCalls = 1;
+    } else {
+        int NumCommands = BuildPatchDrawCommands(m_visiblePatches, m_lodManager, m_lodInfo, m_numPatchesX,
+                                                 m_patchSize, m_width, PatchVertexCount, m_commands.data());
+
+        for (int i = 0 ; i < NumCommands ; i++) {
+            const DrawElementsIndirectCommand& Cmd = m_commands[i];
+            size_t BaseIndex = m_indexSize * Cmd.FirstIndex;
+
+            glDrawElementsBaseVertex(GL_TRIANGLES, Cmd.Count, m_indexType, (void*)BaseIndex, Cmd.BaseVertex);
+        }
+
+        m_numDrawCalls = NumCommands;
+    }
+}
+
+
+// Waits until the GPU is done with the commands that were previously written into the region
+DrawElementsIndirectCommand* GeomipGrid::GetIndirectRegion(int Region)
+{
+    GLsync& Fence = m_indirectFences[Region];
+
+    if (Fence) {
+        GLenum Status = glClientWaitSync(Fence, 0, 0);
+
+        while ((Status != GL_ALREADY_SIGNALED) && (Status != GL_CONDITION_SATISFIED)) {
+            if (Status == GL_WAIT_FAILED) {
+                printf("Error waiting for the indirect buffer fence\n");
+                exit(0);
             }
 
-            //printf("\n");
+            Status = glClientWaitSync(Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
         }
+
+        glDeleteSync(Fence);
+        Fence = 0;
     }
 
-    glBindVertexArray(0);
+    return m_pIndirectCommands + m_numPatchesX * m_numPatchesZ * Region;
 }
 
 
@@ -444,45 +660,3 @@ bool GeomipGrid::IsPatchInsideViewFrustum_ViewSpace(int X, int Z, const Matrix4f
 
     return InsideViewFrustum;
 }
-
-
-bool GeomipGrid::IsPatchInsideViewFrustum_WorldSpace(int X, int Z, const FrustumCulling& fc)
-{
-    int x0 = X;
-    int x1 = X + m_patchSize - 1;
-    int z0 = Z;
-    int z1 = Z + m_patchSize - 1;
-
-    float h00 = m_pTerrain->GetHeight(x0, z0);
-    float h01 = m_pTerrain->GetHeight(x0, z1);
-    float h10 = m_pTerrain->GetHeight(x1, z0);
-    float h11 = m_pTerrain->GetHeight(x1, z1);
-
-    float MinHeight = std::min(h00, std::min(h01, std::min(h10, h11)));
-    float MaxHeight = std::max(h00, std::max(h01, std::max(h10, h11)));
-
-    Vector3f p00_low((float)x0 * m_worldScale, MinHeight, (float)z0 * m_worldScale);
-    Vector3f p01_low((float)x0 * m_worldScale, MinHeight, (float)z1 * m_worldScale);
-    Vector3f p10_low((float)x1 * m_worldScale, MinHeight, (float)z0 * m_worldScale);
-    Vector3f p11_low((float)x1 * m_worldScale, MinHeight, (float)z1 * m_worldScale);
-
-    Vector3f p00_high((float)x0 * m_worldScale, MaxHeight, (float)z0 * m_worldScale);
-    Vector3f p01_high((float)x0 * m_worldScale, MaxHeight, (float)z1 * m_worldScale);
-    Vector3f p10_high((float)x1 * m_worldScale, MaxHeight, (float)z0 * m_worldScale);
-    Vector3f p11_high((float)x1 * m_worldScale, MaxHeight, (float)z1 * m_worldScale);
-
-    bool InsideViewFrustm = 
-        fc.IsPointInsideViewFrustum(p00_low) ||
-        fc.IsPointInsideViewFrustum(p01_low) ||
-        fc.IsPointInsideViewFrustum(p10_low) ||
-        fc.IsPointInsideViewFrustum(p11_low) ||
-        fc.IsPointInsideViewFrustum(p00_high) ||
-        fc.IsPointInsideViewFrustum(p01_high) ||
-        fc.IsPointInsideViewFrustum(p10_high) ||
-        fc.IsPointInsideViewFrustum(p11_high);
-
-    return InsideViewFrustm;
-}
-
-
-
@@ -25,6 +25,8 @@
 
 #include "ogldev_math_3d.h"
 #include "lod_manager.h"
+#include "minmax_quadtree.h"
+#include "patch_draw_commands.h"
 
 // this header is included by terrain.h so we have a forward 
 // declaration for BaseTerrain.
@@ -36,11 +38,52 @@ class GeomipGrid {
 
     ~GeomipGrid();
 
-    void CreateGeomipGrid(int Width, int Depth, int PatchSize, const BaseTerrain* pTerrain);
+    // With CompactVertices every vertex is a 16 bit height and an octahedral normal and
+    // the vertices of every patch are stored together so that the indices are local to
+    // the patch (16 bit when they fit). X/Z and the texture coordinates are calculated
+    // in the vertex shader. Requires CompactTerrainTechnique.
+    void CreateGeomipGrid(int Width, int Depth, int PatchSize, const BaseTerrain* pTerrain, bool CompactVertices = false);
 
     void Destroy();
 
-    void Render(const Vector3f& CameraPos, const Matrix4f& ViewProj);
+    // Calculates the LOD of the patches. Call once per frame before the render passes -
+    // every pass of the frame uses the same LOD map.
+    void UpdateLod(const Vector3f& CameraPos) { m_lodManager.Update(CameraPos); }
+
+    const LodManager::UpdateStats& GetLodStats() const { return m_lodManager.GetStats(); }
+
+    // Switches the LOD selection from distance bands to screen space error.
+    // See LodManager::SetScreenSpaceError.
+    void SetScreenSpaceError(float ProjScale, float MaxPixelError);
+
+    void Render(const Matrix4f& ViewProj);
+
+    // Number of patches that passed the frustum test in the last Render call
+    int GetNumVisiblePatches() const { return (int)m_visiblePatches.size(); }
+
+    // Number of draw calls made by the last Render call
+    int GetNumDrawCalls() const { return m_numDrawCalls; }
+
+    // Submit all the patches with a single glMultiDrawElementsIndirect (when supported)
+    // or with one glDrawElementsBaseVertex per patch
+    void EnableMultiDraw(bool Enable) { m_multiDrawEnabled = Enable; }
+
+    bool IsMultiDrawSupported() const { return m_isMultiDrawSupported; }
+
+    int GetNumPatches() const { return m_numPatchesX * m_numPatchesZ; }
+
+    int GetNumPatchesX() const { return m_numPatchesX; }
+
+    int GetPatchSize() const { return m_patchSize; }
+
+    bool IsCompact() const { return m_compactVertices; }
+
+    // The compact heights are HeightBase + Height / 65535 * HeightRange
+    void GetHeightQuantization(float& HeightBase, float& HeightRange) const { HeightBase = m_heightBase; HeightRange = m_heightRange; }
+
+    size_t GetVertexBufferSize() const { return m_vertexBufferSize; }
+
+    size_t GetIndexBufferSize() const { return m_indexBufferSize; }
 
  private:
 
@@ -52,11 +95,27 @@ class GeomipGrid {
         void InitVertex(const BaseTerrain* pTerrain, int x, int z);
     };
 
+    struct CompactVertex {
+        GLushort Height = 0;
+        GLushort Padding = 0;
+        GLshort Normal[2] = { 0, 0 };    // octahedral, Y up
+    };
+
     void CreateGLState();
+
+    void CreateIndirectBuffer();
+
+    void DestroyIndirectBuffer();
+
+    DrawElementsIndirectCommand* GetIndirectRegion(int Region);
+
+    void RenderPatches();
 	
     void PopulateBuffers(const BaseTerrain* pTerrain);
     
     void InitVertices(const BaseTerrain* pTerrain, std::vector<Vertex>& Vertices);
+
+    void PopulateCompactVertices(const BaseTerrain* pTerrain);
    
     int InitIndices(std::vector<uint>& Indices);
     
@@ -64,7 +123,7 @@ class GeomipGrid {
     
     int InitIndicesLODSingle(int Index, std::vector<uint>& Indices, int lodCore, int lodLeft, int lodRight, int lodTop, int lodBottom);
     
-    void CalcNormals(std::vector<Vertex>& Vertices, std::vector<uint>& Indices);
+    void CalcNormals(const BaseTerrain* pTerrain, std::vector<Vertex>& Vertices);
     
     uint AddTriangle(uint Index, std::vector<uint>& Indices, uint v1, uint v2, uint v3);
     
@@ -74,8 +133,6 @@ class GeomipGrid {
 
     bool IsPatchInsideViewFrustum_ViewSpace(int X, int Z, const Matrix4f& ViewProj);
 
-    bool IsPatchInsideViewFrustum_WorldSpace(int X, int Z, const FrustumCulling& FC);
-
     int m_width = 0;
     int m_depth = 0;
     int m_patchSize = 0;
@@ -84,25 +141,35 @@ class GeomipGrid {
     GLuint m_vb = 0;
     GLuint m_ib = 0;
     float m_worldScale = 1.0f;
+    bool m_compactVertices = false;
+    int m_indexStride = 0;              // distance between the vertices of consecutive rows of a patch
+    GLenum m_indexType = GL_UNSIGNED_INT;
+    size_t m_indexSize = sizeof(unsigned int);
+    size_t m_vertexBufferSize = 0;
+    size_t m_indexBufferSize = 0;
+    float m_heightBase = 0.0f;
+    float m_heightRange = 0.0f;
 
-    struct SingleLodInfo {
-        int Start = 0;
-        int Count = 0;
-    };
-	
-    #define LEFT   2
-    #define RIGHT  2
-    #define TOP    2
-    #define BOTTOM 2
-	
-    struct LodInfo {
-        SingleLodInfo info[LEFT][RIGHT][TOP][BOTTOM];
-    };
-	
     std::vector<LodInfo> m_lodInfo;
     int m_numPatchesX = 0;
     int m_numPatchesZ = 0;
     LodManager m_lodManager;
+    MinMaxQuadtree m_quadtree;
+    std::vector<int> m_visiblePatches;
+    int m_numDrawCalls = 0;
+
+    // The indirect buffer is persistently mapped and split into regions that are used
+    // round robin, one per Render call. Every pass of a frame writes a different region
+    // and a fence keeps the CPU from overwriting a region that the GPU has yet to read.
+    #define NUM_INDIRECT_REGIONS 6
+
+    bool m_isMultiDrawSupported = false;
+    bool m_multiDrawEnabled = true;
+    GLuint m_indirectBuffer = 0;
+    DrawElementsIndirectCommand* m_pIndirectCommands = NULL;
+    GLsync m_indirectFences[NUM_INDIRECT_REGIONS] = { 0 };
+    int m_curIndirectRegion = 0;
+    std::vector<DrawElementsIndirectCommand> m_commands;    // used when multi draw is off
     const BaseTerrain* m_pTerrain = NULL;
 };
 
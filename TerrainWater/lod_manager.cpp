@@ -1,4 +1,6 @@
 #include <stdio.h>
+#include <float.h>
+#include <algorithm>
 
 #include "lod_manager.h"
 #include "demo_config.h"
@@ -20,6 +22,13 @@ int LodManager::InitLodManager(int PatchSize, int NumPatchesX, int NumPatchesZ,
 
     CalcLodRegions();
 
+    m_patchRegions.clear();
+    m_expiryQueue = decltype(m_expiryQueue)();
+    m_cameraTravel = 0.0;
+    m_isInitialized = false;
+    m_neighborStamp.assign(NumPatchesX * NumPatchesZ, 0);
+    m_updateCounter = 0;
+
     return m_maxLOD;
 }
 
@@ -43,85 +52,218 @@ void LodManager::CalcMaxLOD()
 
 void LodManager::Update(const Vector3f& CameraPos)
 {
-    UpdateLodMapPass1(CameraPos);
-    UpdateLodMapPass2(CameraPos);
+    if (!m_isInitialized) {
+        m_stats = UpdateStats();
+        UpdateLodMapPass1(CameraPos);
+        UpdateLodMapPass2(CameraPos);
+        m_lastCameraPos = CameraPos;
+        m_isInitialized = true;
+        return;
+    }
+
+    float Movement = CameraPos.Distance(m_lastCameraPos);
+
+    if (Movement == 0.0f) {
+        return;
+    }
+
+    m_lastCameraPos = CameraPos;
+    m_cameraTravel += Movement;
+
+    UpdateIncremental(CameraPos);
 }
 
 
 void LodManager::UpdateLodMapPass1(const Vector3f& CameraPos)
+{
+    m_expiryQueue = decltype(m_expiryQueue)();
+
+    for (int Patch = 0 ; Patch < m_numPatchesX * m_numPatchesZ ; Patch++) {
+        EvaluatePatch(CameraPos, Patch);
+    }
+}
+
+
+void LodManager::UpdateIncremental(const Vector3f& CameraPos)
+{
+    m_stats = UpdateStats();
+    m_changedPatches.clear();
+    m_updateCounter++;
+
+    // Evaluating a patch pushes it back with an expiry that is not before the
+    // current travel so the loop ends
+    while (!m_expiryQueue.empty() && (m_expiryQueue.top().Travel < m_cameraTravel)) {
+        int Patch = m_expiryQueue.top().Patch;
+        m_expiryQueue.pop();
+        EvaluatePatch(CameraPos, Patch);
+    }
+
+    // The flags of a patch depend on its own core LOD and on the core LOD of its neighbors
+    for (int Patch : m_changedPatches) {
+        int LodMapX = Patch % m_numPatchesX;
+        int LodMapZ = Patch / m_numPatchesX;
+
+        UpdateNeighborFlags(LodMapX, LodMapZ);
+
+        if (LodMapX > 0) {
+            UpdateNeighborFlags(LodMapX - 1, LodMapZ);
+        }
+
+        if (LodMapX < m_numPatchesX - 1) {
+            UpdateNeighborFlags(LodMapX + 1, LodMapZ);
+        }
+
+        if (LodMapZ > 0) {
+            UpdateNeighborFlags(LodMapX, LodMapZ - 1);
+        }
+
+        if (LodMapZ < m_numPatchesZ - 1) {
+            UpdateNeighborFlags(LodMapX, LodMapZ + 1);
+        }
+    }
+}
+
+
+void LodManager::EvaluatePatch(const Vector3f& CameraPos, int Patch)
 {
     int CenterStep = m_patchSize / 2;
 
-    for (int LodMapZ = 0 ; LodMapZ < m_numPatchesZ ; LodMapZ++) {
-        for (int LodMapX = 0 ; LodMapX < m_numPatchesX ; LodMapX++) {
-            int x = LodMapX * (m_patchSize - 1) + CenterStep;
-            int z = LodMapZ * (m_patchSize - 1) + CenterStep;
+    int LodMapX = Patch % m_numPatchesX;
+    int LodMapZ = Patch / m_numPatchesX;
+
+    int x = LodMapX * (m_patchSize - 1) + CenterStep;
+    int z = LodMapZ * (m_patchSize - 1) + CenterStep;
+
+    Vector3f PatchCenter = Vector3f(x * (float)m_worldScale, 0.0f, z * (float)m_worldScale);
+
+    float DistanceToCamera = CameraPos.Distance(PatchCenter);
+
+    int CoreLod = DistanceToLod(DistanceToCamera, Patch);
+
+    PatchLod* pPatchLOD = m_map.GetAddr(LodMapX, LodMapZ);
+
+    if (pPatchLOD->Core != CoreLod) {
+        pPatchLOD->Core = CoreLod;
+        m_changedPatches.push_back(Patch);
+        m_stats.NumCoreChanges++;
+    }
+
+    m_stats.NumPatchesEvaluated++;
+
+    PatchExpiry Expiry;
+    Expiry.Travel = m_cameraTravel + DistanceToRegionBorder(DistanceToCamera, Patch);
+    Expiry.Patch = Patch;
+    m_expiryQueue.push(Expiry);
+}
+
 
-            Vector3f PatchCenter = Vector3f(x * (float)m_worldScale, 0.0f, z * (float)m_worldScale);
+float LodManager::DistanceToRegionBorder(float Distance, int Patch) const
+{
+    float MinDistance = FLT_MAX;
+
+    if (m_patchRegions.empty()) {
+        for (int i = 0 ; i <= m_maxLOD ; i++) {
+            MinDistance = std::min(MinDistance, fabsf(Distance - (float)m_regions[i]));
+        }
+    } else {
+        const float* pRegions = &m_patchRegions[Patch * m_maxLOD];
 
-            float DistanceToCamera = CameraPos.Distance(PatchCenter);
+        for (int i = 0 ; i < m_maxLOD ; i++) {
+            MinDistance = std::min(MinDistance, fabsf(Distance - pRegions[i]));
+        }
+    }
 
-            int CoreLod = DistanceToLod(DistanceToCamera);
+    // Leave some room for the rounding of the distance
+    return std::max(MinDistance - 0.01f, 0.0f);
+}
 
-            PatchLod* pPatchLOD = m_map.GetAddr(LodMapX, LodMapZ);
-            pPatchLOD->Core = CoreLod;
+
+void LodManager::SetScreenSpaceError(const std::vector<float>& GeometricErrors, const std::vector<float>& PatchRadius,
+                                     float ProjScale, float MaxPixelError)
+{
+    int NumPatches = m_numPatchesX * m_numPatchesZ;
+
+    m_patchRegions.resize(NumPatches * m_maxLOD);
+
+    for (int Patch = 0 ; Patch < NumPatches ; Patch++) {
+        for (int Lod = 1 ; Lod <= m_maxLOD ; Lod++) {
+            float Error = GeometricErrors[Patch * (m_maxLOD + 1) + Lod];
+            m_patchRegions[Patch * m_maxLOD + Lod - 1] = Error * ProjScale / MaxPixelError + PatchRadius[Patch];
         }
     }
+
+    // Start over on the next update
+    m_isInitialized = false;
 }
 
 
 void LodManager::UpdateLodMapPass2(const Vector3f& CameraPos)
 {
-    int Step = m_patchSize / 2;
+    m_updateCounter++;
 
     for (int LodMapZ = 0 ; LodMapZ < m_numPatchesZ ; LodMapZ++) {
         for (int LodMapX = 0 ; LodMapX < m_numPatchesX ; LodMapX++) {
-            int CoreLod = m_map.Get(LodMapX, LodMapZ).Core;
-
-            int IndexLeft   = LodMapX;
-            int IndexRight  = LodMapX;
-            int IndexTop    = LodMapZ;
-            int IndexBottom = LodMapZ;
-
-            if (LodMapX > 0) {
-                IndexLeft--;
-
-                if (m_map.Get(IndexLeft, LodMapZ).Core > CoreLod) {
-                    m_map.At(LodMapX, LodMapZ).Left = 1;
-                } else {
-                    m_map.At(LodMapX, LodMapZ).Left = 0;
-                }
-            }
-
-            if (LodMapX < m_numPatchesX - 1) {
-                IndexRight++;
-
-                if (m_map.Get(IndexRight, LodMapZ).Core > CoreLod) {
-                    m_map.At(LodMapX, LodMapZ).Right = 1;
-                } else {
-                    m_map.At(LodMapX, LodMapZ).Right = 0;
-                }
-            }
-
-            if (LodMapZ > 0) {
-                IndexBottom--;
-
-                if (m_map.Get(LodMapX, IndexBottom).Core > CoreLod) {
-                    m_map.At(LodMapX, LodMapZ).Bottom = 1;
-                } else {
-                    m_map.At(LodMapX, LodMapZ).Bottom = 0;
-                }
-            }
-
-            if (LodMapZ < m_numPatchesZ - 1) {
-                IndexTop++;
-
-                if (m_map.Get(LodMapX, IndexTop).Core > CoreLod) {
-                    m_map.At(LodMapX, LodMapZ).Top = 1;
-                } else {
-                    m_map.At(LodMapX, LodMapZ).Top = 0;
-                }
-            }
+            UpdateNeighborFlags(LodMapX, LodMapZ);
+        }
+    }
+}
+
+
+void LodManager::UpdateNeighborFlags(int LodMapX, int LodMapZ)
+{
+    int& Stamp = m_neighborStamp[LodMapZ * m_numPatchesX + LodMapX];
+
+    if (Stamp == m_updateCounter) {
+        return;
+    }
+
+    Stamp = m_updateCounter;
+    m_stats.NumNeighborUpdates++;
+
+    int CoreLod = m_map.Get(LodMapX, LodMapZ).Core;
+
+    int IndexLeft   = LodMapX;
+    int IndexRight  = LodMapX;
+    int IndexTop    = LodMapZ;
+    int IndexBottom = LodMapZ;
+
+    if (LodMapX > 0) {
+        IndexLeft--;
+
+        if (m_map.Get(IndexLeft, LodMapZ).Core > CoreLod) {
+            m_map.At(LodMapX, LodMapZ).Left = 1;
+        } else {
+            m_map.At(LodMapX, LodMapZ).Left = 0;
+        }
+    }
+
+    if (LodMapX < m_numPatchesX - 1) {
+        IndexRight++;
+
+        if (m_map.Get(IndexRight, LodMapZ).Core > CoreLod) {
+            m_map.At(LodMapX, LodMapZ).Right = 1;
+        } else {
+            m_map.At(LodMapX, LodMapZ).Right = 0;
+        }
+    }
+
+    if (LodMapZ > 0) {
+        IndexBottom--;
+
+        if (m_map.Get(LodMapX, IndexBottom).Core > CoreLod) {
+            m_map.At(LodMapX, LodMapZ).Bottom = 1;
+        } else {
+            m_map.At(LodMapX, LodMapZ).Bottom = 0;
+        }
+    }
+
+    if (LodMapZ < m_numPatchesZ - 1) {
+        IndexTop++;
+
+        if (m_map.Get(LodMapX, IndexTop).Core > CoreLod) {
+            m_map.At(LodMapX, LodMapZ).Top = 1;
+        } else {
+            m_map.At(LodMapX, LodMapZ).Top = 0;
         }
     }
 }
@@ -139,8 +281,20 @@ void LodManager::PrintLodMap()
 }
 
 
-int LodManager::DistanceToLod(float Distance)
+int LodManager::DistanceToLod(float Distance, int Patch) const
 {
+    if (!m_patchRegions.empty()) {
+        const float* pRegions = &m_patchRegions[Patch * m_maxLOD];
+
+        int Lod = 0;
+
+        while ((Lod < m_maxLOD) && (Distance >= pRegions[Lod])) {
+            Lod++;
+        }
+
+        return Lod;
+    }
+
     int Lod = m_maxLOD;
 
     for (int i = 0 ; i <= m_maxLOD ; i++) {
@@ -2,6 +2,8 @@
 #define LOD_REGIONS_H
 
 #include <vector>
+#include <queue>
+#include <functional>
 
 #include "ogldev_math_3d.h"
 #include "ogldev_array_2d.h"
@@ -11,8 +13,33 @@ class LodManager {
 
     int InitLodManager(int PatchSize, int NumPatchesX, int NumPatchesZ, float WorldScale);
 
+    // Replaces the fixed distance bands of CalcLodRegions with per patch distances.
+    // A patch switches to a coarser LOD once the projected geometric error of that
+    // LOD drops below MaxPixelError:
+    //
+    //     Error * ProjScale / Distance <= MaxPixelError
+    //
+    // GeometricErrors holds MaxLOD + 1 entries per patch. ProjScale is the viewport height
+    // divided by 2 * tan(FOV / 2). The distance is measured to the center of the patch at
+    // zero height so PatchRadius (the distance from that point to the furthest corner of
+    // the bounding box of the patch) is added to keep it conservative.
+    void SetScreenSpaceError(const std::vector<float>& GeometricErrors, const std::vector<float>& PatchRadius,
+                             float ProjScale, float MaxPixelError);
+
+    // Only the patches that may have crossed into another LOD region since the previous
+    // call are evaluated. A repeated call with the same camera position does nothing so
+    // all the passes of a frame share the result.
     void Update(const Vector3f& CameraPos);
 
+    struct UpdateStats {
+        int NumPatchesEvaluated = 0;   // core LOD recalculated
+        int NumCoreChanges = 0;
+        int NumNeighborUpdates = 0;    // patches whose neighbor flags were recalculated
+    };
+
+    // Counters of the last call that did any work
+    const UpdateStats& GetStats() const { return m_stats; }
+
     struct PatchLod {
         int Core   = 0;
         int Left   = 0;
@@ -30,8 +57,13 @@ class LodManager {
     void CalcMaxLOD();
     void UpdateLodMapPass1(const Vector3f& CameraPos);
     void UpdateLodMapPass2(const Vector3f& CameraPos);
+    void UpdateIncremental(const Vector3f& CameraPos);
+    void EvaluatePatch(const Vector3f& CameraPos, int Patch);
+    void UpdateNeighborFlags(int LodMapX, int LodMapZ);
+
+    int DistanceToLod(float Distance, int Patch) const;
 
-    int DistanceToLod(float Distance);
+    float DistanceToRegionBorder(float Distance, int Patch) const;
 
     int m_maxLOD = 0;
     int m_patchSize = 0;
@@ -41,6 +73,26 @@ class LodManager {
 
     Array2D<PatchLod> m_map;
     std::vector<int> m_regions;
+    std::vector<float> m_patchRegions;    // MaxLOD per patch - the distance where LOD 1, 2, ... begins
+
+    // A patch is evaluated again once the camera has travelled further than the distance
+    // from the patch to the closest region border. The queue is ordered by that point
+    // along the path of the camera.
+    struct PatchExpiry {
+        double Travel = 0.0;
+        int Patch = 0;
+
+        bool operator>(const PatchExpiry& e) const { return Travel > e.Travel; }
+    };
+
+    std::priority_queue<PatchExpiry, std::vector<PatchExpiry>, std::greater<PatchExpiry>> m_expiryQueue;
+    double m_cameraTravel = 0.0;
+    Vector3f m_lastCameraPos;
+    bool m_isInitialized = false;
+    std::vector<int> m_changedPatches;
+    std::vector<int> m_neighborStamp;      // last update that refreshed the flags of the patch
+    int m_updateCounter = 0;
+    UpdateStats m_stats;
 };
 
 
@@ -0,0 +1,223 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include <algorithm>
+
+#include "minmax_quadtree.h"
+#include "terrain.h"
+
+
+void MinMaxQuadtree::Build(const BaseTerrain* pTerrain, int NumPatchesX, int NumPatchesZ, int PatchSize, int MaxLOD)
+{
+    m_numPatchesX = NumPatchesX;
+    m_numPatchesZ = NumPatchesZ;
+    m_patchSize = PatchSize;
+    m_maxLOD = MaxLOD;
+    m_worldScale = pTerrain->GetWorldScale();
+
+    m_levels.clear();
+    m_errors.resize(NumPatchesX * NumPatchesZ * (MaxLOD + 1));
+
+    Level Patches;
+    Patches.Width = NumPatchesX;
+    Patches.Depth = NumPatchesZ;
+    Patches.Nodes.resize(NumPatchesX * NumPatchesZ);
+    m_levels.push_back(Patches);
+
+    for (int PatchZ = 0 ; PatchZ < NumPatchesZ ; PatchZ++) {
+        for (int PatchX = 0 ; PatchX < NumPatchesX ; PatchX++) {
+            CalcPatch(pTerrain, PatchX, PatchZ);
+        }
+    }
+
+    // Every level halves the previous one (rounding up) until a single root is left
+    while ((m_levels.back().Width > 1) || (m_levels.back().Depth > 1)) {
+        const Level& Child = m_levels.back();
+
+        Level Parent;
+        Parent.Width = (Child.Width + 1) / 2;
+        Parent.Depth = (Child.Depth + 1) / 2;
+        Parent.Nodes.resize(Parent.Width * Parent.Depth);
+
+        for (int Z = 0 ; Z < Parent.Depth ; Z++) {
+            for (int X = 0 ; X < Parent.Width ; X++) {
+                Node& n = Parent.Nodes[Z * Parent.Width + X];
+                n.MinHeight = FLT_MAX;
+                n.MaxHeight = -FLT_MAX;
+
+                for (int ChildZ = Z * 2 ; ChildZ < std::min(Z * 2 + 2, Child.Depth) ; ChildZ++) {
+                    for (int ChildX = X * 2 ; ChildX < std::min(X * 2 + 2, Child.Width) ; ChildX++) {
+                        const Node& c = Child.Nodes[ChildZ * Child.Width + ChildX];
+                        n.MinHeight = std::min(n.MinHeight, c.MinHeight);
+                        n.MaxHeight = std::max(n.MaxHeight, c.MaxHeight);
+                    }
+                }
+            }
+        }
+
+        m_levels.push_back(Parent);
+    }
+}
+
+
+void MinMaxQuadtree::CalcPatch(const BaseTerrain* pTerrain, int PatchX, int PatchZ)
+{
+    int x0 = PatchX * (m_patchSize - 1);
+    int z0 = PatchZ * (m_patchSize - 1);
+
+    Node& n = m_levels[0].Nodes[PatchZ * m_numPatchesX + PatchX];
+    n.MinHeight = FLT_MAX;
+    n.MaxHeight = -FLT_MAX;
+
+    for (int z = z0 ; z < z0 + m_patchSize ; z++) {
+        for (int x = x0 ; x < x0 + m_patchSize ; x++) {
+            float Height = pTerrain->GetHeight(x, z);
+            n.MinHeight = std::min(n.MinHeight, Height);
+            n.MaxHeight = std::max(n.MaxHeight, Height);
+        }
+    }
+
+    // LOD zero renders every vertex of the patch
+    float* pErrors = &m_errors[(PatchZ * m_numPatchesX + PatchX) * (m_maxLOD + 1)];
+    pErrors[0] = 0.0f;
+
+    for (int Lod = 1 ; Lod <= m_maxLOD ; Lod++) {
+        int Step = powi(2, Lod);
+        float Error = 0.0f;
+
+        for (int z = z0 ; z < z0 + m_patchSize - 1 ; z += Step * 2) {
+            for (int x = x0 ; x < x0 + m_patchSize - 1 ; x += Step * 2) {
+                Error = std::max(Error, CalcFanError(pTerrain, x, z, Step));
+            }
+        }
+
+        // A coarser LOD must never be reported as more accurate than a finer one
+        pErrors[Lod] = std::max(Error, pErrors[Lod - 1]);
+    }
+}
+
+
+// The largest vertical distance between the heightmap and a triangle fan of
+// GeomipGrid::CreateTriangleFan (the one without stitching to the neighbors)
+float MinMaxQuadtree::CalcFanError(const BaseTerrain* pTerrain, int x, int z, int Step) const
+{
+    int CenterX = x + Step;
+    int CenterZ = z + Step;
+    float CenterHeight = pTerrain->GetHeight(CenterX, CenterZ);
+
+    float MaxError = 0.0f;
+
+    for (int dz = -Step ; dz <= Step ; dz++) {
+        for (int dx = -Step ; dx <= Step ; dx++) {
+            int SignX = (dx < 0) ? -1 : 1;
+            int SignZ = (dz < 0) ? -1 : 1;
+
+            // The point is inside the triangle of the center, the middle of the closest
+            // edge of the fan and the corner on its side. Walk from the center to the edge
+            // and then along the edge.
+            float EdgeHeight, CornerHeight, a, b;
+
+            if (abs(dx) >= abs(dz)) {
+                EdgeHeight = pTerrain->GetHeight(CenterX + SignX * Step, CenterZ);
+                a = (float)abs(dx) / (float)Step;
+                b = (float)abs(dz) / (float)Step;
+            } else {
+                EdgeHeight = pTerrain->GetHeight(CenterX, CenterZ + SignZ * Step);
+                a = (float)abs(dz) / (float)Step;
+                b = (float)abs(dx) / (float)Step;
+            }
+
+            CornerHeight = pTerrain->GetHeight(CenterX + SignX * Step, CenterZ + SignZ * Step);
+
+            float Height = CenterHeight + a * (EdgeHeight - CenterHeight) + b * (CornerHeight - EdgeHeight);
+
+            MaxError = std::max(MaxError, fabsf(Height - pTerrain->GetHeight(CenterX + dx, CenterZ + dz)));
+        }
+    }
+
+    return MaxError;
+}
+
+
+void MinMaxQuadtree::GetPatchHeightRange(int Patch, float& MinHeight, float& MaxHeight) const
+{
+    const Node& n = m_levels[0].Nodes[Patch];
+    MinHeight = n.MinHeight;
+    MaxHeight = n.MaxHeight;
+}
+
+
+void MinMaxQuadtree::GetVisiblePatches(const FrustumCulling& FC, std::vector<int>& Patches) const
+{
+    if (m_levels.empty()) {
+        return;
+    }
+
+    VisitNode((int)m_levels.size() - 1, 0, 0, FC, Patches);
+}
+
+
+void MinMaxQuadtree::VisitNode(int LevelIndex, int X, int Z, const FrustumCulling& FC, std::vector<int>& Patches) const
+{
+    const Level& l = m_levels[LevelIndex];
+    const Node& n = l.Nodes[Z * l.Width + X];
+
+    // The range of patches under the node. Nodes on the far edges can cover less.
+    int PatchX0 = X << LevelIndex;
+    int PatchZ0 = Z << LevelIndex;
+    int PatchX1 = std::min((X + 1) << LevelIndex, m_numPatchesX);
+    int PatchZ1 = std::min((Z + 1) << LevelIndex, m_numPatchesZ);
+
+    float PatchWorldSize = (float)(m_patchSize - 1) * m_worldScale;
+
+    Vector3f Min(PatchX0 * PatchWorldSize, n.MinHeight, PatchZ0 * PatchWorldSize);
+    Vector3f Max(PatchX1 * PatchWorldSize, n.MaxHeight, PatchZ1 * PatchWorldSize);
+
+    bool FullyInside = false;
+
+    if (!FC.IsBoxInsideViewFrustum(Min, Max, FullyInside)) {
+        return;
+    }
+
+    if (FullyInside || (LevelIndex == 0)) {
+        AddAllPatches(LevelIndex, X, Z, Patches);
+        return;
+    }
+
+    const Level& Child = m_levels[LevelIndex - 1];
+
+    for (int ChildZ = Z * 2 ; ChildZ < std::min(Z * 2 + 2, Child.Depth) ; ChildZ++) {
+        for (int ChildX = X * 2 ; ChildX < std::min(X * 2 + 2, Child.Width) ; ChildX++) {
+            VisitNode(LevelIndex - 1, ChildX, ChildZ, FC, Patches);
+        }
+    }
+}
+
+
+void MinMaxQuadtree::AddAllPatches(int LevelIndex, int X, int Z, std::vector<int>& Patches) const
+{
+    int PatchX1 = std::min((X + 1) << LevelIndex, m_numPatchesX);
+    int PatchZ1 = std::min((Z + 1) << LevelIndex, m_numPatchesZ);
+
+    for (int PatchZ = Z << LevelIndex ; PatchZ < PatchZ1 ; PatchZ++) {
+        for (int PatchX = X << LevelIndex ; PatchX < PatchX1 ; PatchX++) {
+            Patches.push_back(PatchZ * m_numPatchesX + PatchX);
+        }
+    }
+}
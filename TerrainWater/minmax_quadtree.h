@@ -0,0 +1,78 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MINMAX_QUADTREE_H
+#define MINMAX_QUADTREE_H
+
+#include <vector>
+
+#include "ogldev_math_3d.h"
+
+class BaseTerrain;
+
+//
+// Quadtree over the patches of the geomip grid. Every node holds the height range
+// of the patches below it so the frustum can reject (or accept) a whole subtree with
+// a single box test. The leaves also keep the geometric error of every LOD of the
+// patch - the largest vertical distance between the full resolution heightmap and
+// the triangles that are rendered at that LOD.
+//
+class MinMaxQuadtree {
+ public:
+    MinMaxQuadtree() {}
+
+    void Build(const BaseTerrain* pTerrain, int NumPatchesX, int NumPatchesZ, int PatchSize, int MaxLOD);
+
+    // Appends the index (PatchZ * NumPatchesX + PatchX) of every patch that intersects the frustum
+    void GetVisiblePatches(const FrustumCulling& FC, std::vector<int>& Patches) const;
+
+    float GetGeometricError(int Patch, int Lod) const { return m_errors[Patch * (m_maxLOD + 1) + Lod]; }
+
+    void GetPatchHeightRange(int Patch, float& MinHeight, float& MaxHeight) const;
+
+ private:
+
+    struct Node {
+        float MinHeight = 0.0f;
+        float MaxHeight = 0.0f;
+    };
+
+    struct Level {
+        int Width = 0;      // in nodes
+        int Depth = 0;
+        std::vector<Node> Nodes;
+    };
+
+    void CalcPatch(const BaseTerrain* pTerrain, int PatchX, int PatchZ);
+
+    float CalcFanError(const BaseTerrain* pTerrain, int x, int z, int Step) const;
+
+    void VisitNode(int LevelIndex, int X, int Z, const FrustumCulling& FC, std::vector<int>& Patches) const;
+
+    void AddAllPatches(int LevelIndex, int X, int Z, std::vector<int>& Patches) const;
+
+    int m_numPatchesX = 0;
+    int m_numPatchesZ = 0;
+    int m_patchSize = 0;
+    int m_maxLOD = 0;
+    float m_worldScale = 1.0f;
+    std::vector<Level> m_levels;    // the patches are level zero, the root is the last level
+    std::vector<float> m_errors;    // MaxLOD + 1 per patch
+};
+
+#endif
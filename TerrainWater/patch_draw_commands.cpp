@@ -0,0 +1,47 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "patch_draw_commands.h"
+
+
+int BuildPatchDrawCommands(const std::vector<int>& Patches, const LodManager& Lods, const std::vector<LodInfo>& LodInfos,
+                           int NumPatchesX, int PatchSize, int Width, int PatchVertexCount,
+                           DrawElementsIndirectCommand* pCommands)
+{
+    int NumCommands = 0;
+
+    for (int Patch : Patches) {
+        int PatchX = Patch % NumPatchesX;
+        int PatchZ = Patch / NumPatchesX;
+
+        int x = PatchX * (PatchSize - 1);
+        int z = PatchZ * (PatchSize - 1);
+
+        const LodManager::PatchLod& plod = Lods.GetPatchLod(PatchX, PatchZ);
+        const SingleLodInfo& Info = LodInfos[plod.Core].info[plod.Left][plod.Right][plod.Top][plod.Bottom];
+
+        DrawElementsIndirectCommand& Cmd = pCommands[NumCommands++];
+        Cmd.Count = Info.Count;
+        Cmd.InstanceCount = 1;
+        Cmd.FirstIndex = Info.Start;
+        Cmd.BaseVertex = (PatchVertexCount > 0) ? Patch * PatchVertexCount : z * Width + x;
+        Cmd.BaseInstance = 0;
+    }
+
+    return NumCommands;
+}
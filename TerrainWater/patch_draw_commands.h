@@ -0,0 +1,61 @@
+/*
+
+        Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PATCH_DRAW_COMMANDS_H
+#define PATCH_DRAW_COMMANDS_H
+
+#include <vector>
+
+#include "lod_manager.h"
+
+struct SingleLodInfo {
+    int Start = 0;
+    int Count = 0;
+};
+
+#define LEFT   2
+#define RIGHT  2
+#define TOP    2
+#define BOTTOM 2
+
+// The index range of every combination of neighbor LODs of a single core LOD
+struct LodInfo {
+    SingleLodInfo info[LEFT][RIGHT][TOP][BOTTOM];
+};
+
+// Same layout as the command that glMultiDrawElementsIndirect reads
+struct DrawElementsIndirectCommand {
+    unsigned int Count = 0;
+    unsigned int InstanceCount = 0;
+    unsigned int FirstIndex = 0;
+    int BaseVertex = 0;
+    unsigned int BaseInstance = 0;
+};
+
+//
+// Writes one draw command for every patch in Patches (PatchZ * NumPatchesX + PatchX)
+// into pCommands, which must have room for all of them. No GL calls are made so this
+// can run against a mapped buffer or a plain array. Returns the number of commands.
+// PatchVertexCount is zero when the vertex buffer is a single grid of Width columns
+// and the size of a patch when the vertices of every patch are stored together.
+//
+int BuildPatchDrawCommands(const std::vector<int>& Patches, const LodManager& Lods, const std::vector<LodInfo>& LodInfos,
+                           int NumPatchesX, int PatchSize, int Width, int PatchVertexCount,
+                           DrawElementsIndirectCommand* pCommands);
+
+#endif
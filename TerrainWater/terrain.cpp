@@ -26,11 +26,14 @@
 
 #include "demo_config.h"
 #include "terrain.h"
+#include "ogldev_heightmap_sampling.h"
 #include "texture_config.h"
 #include "3rdparty/stb_image_write.h"
 
 //#define DEBUG_PRINT
 
+#define CLIPMAP_RING_SIZE 252
+
 BaseTerrain::~BaseTerrain()
 {
     Destroy();
@@ -41,6 +44,7 @@ void BaseTerrain::Destroy()
 {
     m_heightMap.Destroy();
     m_geomipGrid.Destroy();
+    m_clipmap.Destroy();
 }
 
 
@@ -50,6 +54,16 @@ void BaseTerrain::InitTerrain(float WorldScale, float TextureScale, const std::v
         printf("Error initializing tech\n");
         exit(0);
     }
+
+    if (!m_clipmapTech.Init()) {
+        printf("Error initializing clipmap tech\n");
+        exit(0);
+    }
+
+    if (!m_compactTech.Init()) {
+        printf("Error initializing compact terrain tech\n");
+        exit(0);
+    }
 	
     if (TextureFilenames.size() != ARRAY_SIZE_IN_ELEMENTS(m_pTextures)) {
         printf("%s:%d - number of provided textures (%zu) is not equal to the size of the texture array (%zu)\n",
@@ -79,12 +93,69 @@ void BaseTerrain::InitTerrain(float WorldScale, float TextureScale, const std::v
 
 void BaseTerrain::Finalize()
 {
-    m_geomipGrid.CreateGeomipGrid(m_terrainSize, m_terrainSize, m_patchSize, this);
+    CreateGeomipGrid();
+
+    int NumClipmapLevels = ClipmapTerrain::CalcNumLevels(CLIPMAP_RING_SIZE, m_terrainSize);
+    m_clipmap.CreateClipmap(CLIPMAP_RING_SIZE, NumClipmapLevels, this);
 
     m_water.Init(m_terrainSize, m_worldScale);
 }
 
 
+void BaseTerrain::CreateGeomipGrid()
+{
+    m_geomipGrid.CreateGeomipGrid(m_terrainSize, m_terrainSize, m_patchSize, this, m_compactVertices);
+
+    if (m_lodMaxPixelError > 0.0f) {
+        m_geomipGrid.SetScreenSpaceError(m_lodProjScale, m_lodMaxPixelError);
+    }
+
+    if (m_compactVertices) {
+        float HeightBase, HeightRange;
+        m_geomipGrid.GetHeightQuantization(HeightBase, HeightRange);
+
+        m_compactTech.Enable();
+        m_compactTech.SetGridParams(m_patchSize, m_geomipGrid.GetNumPatchesX(), m_worldScale, HeightBase, HeightRange,
+                                    m_textureScale / (float)m_terrainSize);
+    }
+}
+
+
+void BaseTerrain::EnableCompactVertices(bool Enable)
+{
+    if (Enable == m_compactVertices) {
+        return;
+    }
+
+    m_compactVertices = Enable;
+
+    // Nothing to rebuild if the terrain hasn't been created yet
+    if (m_geomipGrid.GetNumPatches() > 0) {
+        CreateGeomipGrid();
+    }
+}
+
+
+void BaseTerrain::SetLodScreenSpaceError(float MaxPixelError, const PersProjInfo& ProjInfo)
+{
+    if (MaxPixelError <= 0.0f) {
+        printf("%s:%d - the max pixel error must be positive (%f)\n", __FILE__, __LINE__, MaxPixelError);
+        exit(0);
+    }
+
+    m_lodMaxPixelError = MaxPixelError;
+    m_lodProjScale = ProjInfo.Height / (2.0f * tanf(ToRadian(ProjInfo.FOV / 2.0f)));
+
+    m_geomipGrid.SetScreenSpaceError(m_lodProjScale, m_lodMaxPixelError);
+}
+
+
+void BaseTerrain::GetHeightsAndNormals(int Count, const Vector2f* pPositions, float* pHeights, Vector3f* pNormals) const
+{
+    ::GetHeightsAndNormals(m_heightMap, m_worldScale, Count, pPositions, pHeights, pNormals);
+}
+
+
 float BaseTerrain::GetHeightInterpolated(float x, float z) const
 {
     float X0Z0Height = GetHeight((int)x, (int)z);
@@ -180,7 +251,9 @@ void BaseTerrain::RenderTerrain(const BasicCamera& Camera)
     Matrix4f VP = Camera.GetViewProjMatrix();
     Matrix4f View = Camera.GetMatrix();
 
-    m_terrainTech.Enable();
+    TerrainTechnique& Tech = GetTerrainTech();
+
+    Tech.Enable();
 
     for (int i = 0; i < ARRAY_SIZE_IN_ELEMENTS(m_pTextures); i++) {
         if (m_pTextures[i]) {
@@ -188,7 +261,15 @@ void BaseTerrain::RenderTerrain(const BasicCamera& Camera)
         }
     }
 
-    m_terrainTech.SetLightDir(m_lightDir);
+    Tech.SetLightDir(m_lightDir);
+
+    // The reflection pass uses the LOD of the main camera as well. The mirrored
+    // camera is at a different height so it would need a different LOD map every frame.
+    if (m_clipmapEnabled) {
+        m_clipmap.Update(Camera.GetPos());
+    } else {
+        m_geomipGrid.UpdateLod(Camera.GetPos());
+    }
 
     RenderTerrainReflectionPass(Camera);
 
@@ -223,12 +304,12 @@ void BaseTerrain::RenderTerrainReflectionPass(const BasicCamera& Camera)
 
     Vector3f PlaneNormal(0, 1.0f, 0.0f);
     Vector3f PointOnPlane(0.0f, m_water.GetWaterHeight() + 0.5f, 0.0f);
-    m_terrainTech.SetClipPlane(PlaneNormal, PointOnPlane);
+    GetTerrainTech().SetClipPlane(PlaneNormal, PointOnPlane);
 
-    m_terrainTech.SetVP(CameraUnderWater.GetViewProjMatrix());
-    m_geomipGrid.Render(CameraUnderWater.GetPos(), CameraUnderWater.GetViewProjMatrix());
+    GetTerrainTech().SetVP(CameraUnderWater.GetViewProjMatrix());
+    RenderTerrainGeometry(CameraUnderWater.GetViewProjMatrix());
     m_pSkydome->Render(CameraUnderWater);
-    m_terrainTech.Enable();
+    GetTerrainTech().Enable();
     m_water.EndReflectionPass();
 }
 
@@ -238,9 +319,9 @@ void BaseTerrain::RenderTerrainRefractionPass(const BasicCamera& Camera)
 
     Vector3f PlaneNormal(0, -1.0f, 0.0f);
     Vector3f PointOnPlane(0.0f, m_water.GetWaterHeight() + 0.5f, 0.0f);
-    m_terrainTech.SetClipPlane(PlaneNormal, PointOnPlane);
-    m_terrainTech.SetVP(Camera.GetViewProjMatrix());
-    m_geomipGrid.Render(Camera.GetPos(), Camera.GetViewProjMatrix());
+    GetTerrainTech().SetClipPlane(PlaneNormal, PointOnPlane);
+    GetTerrainTech().SetVP(Camera.GetViewProjMatrix());
+    RenderTerrainGeometry(Camera.GetViewProjMatrix());
     m_water.EndRefractionPass();
 }
 
@@ -249,10 +330,34 @@ void BaseTerrain::RenderTerrainDefaultPass(const BasicCamera& Camera)
 {
     Vector3f PlaneNormal(0, 1.0f, 0.0f);
     Vector3f PointOnPlane(0.0f, 0.0f, 0.0f);
-    m_terrainTech.SetClipPlane(PlaneNormal, PointOnPlane);
+    GetTerrainTech().SetClipPlane(PlaneNormal, PointOnPlane);
+
+    GetTerrainTech().SetVP(Camera.GetViewProjMatrix());
+    RenderTerrainGeometry(Camera.GetViewProjMatrix());
+}
+
 
-    m_terrainTech.SetVP(Camera.GetViewProjMatrix());
-    m_geomipGrid.Render(Camera.GetPos(), Camera.GetViewProjMatrix());
+void BaseTerrain::RenderTerrainGeometry(const Matrix4f& VP)
+{
+    if (m_clipmapEnabled) {
+        m_clipmap.Render(m_clipmapTech);
+    } else {
+        m_geomipGrid.Render(VP);
+    }
+}
+
+
+TerrainTechnique& BaseTerrain::GetTerrainTech()
+{
+    if (m_clipmapEnabled) {
+        return m_clipmapTech;
+    }
+
+    if (m_compactVertices) {
+        return m_compactTech;
+    }
+
+    return m_terrainTech;
 }
 
 
@@ -269,12 +374,25 @@ void BaseTerrain::SetMinMaxHeight(float MinHeight, float MaxHeight)
 
     m_terrainTech.Enable();
     m_terrainTech.SetMinMaxHeight(MinHeight, MaxHeight);
+
+    m_clipmapTech.Enable();
+    m_clipmapTech.SetMinMaxHeight(MinHeight, MaxHeight);
+
+    m_compactTech.Enable();
+    m_compactTech.SetMinMaxHeight(MinHeight, MaxHeight);
 }
 
 
 void BaseTerrain::SetTextureHeights(float Tex0Height, float Tex1Height, float Tex2Height, float Tex3Height)
 {
+    m_terrainTech.Enable();
     m_terrainTech.SetTextureHeights(Tex0Height, Tex1Height, Tex2Height, Tex3Height); 
+
+    m_clipmapTech.Enable();
+    m_clipmapTech.SetTextureHeights(Tex0Height, Tex1Height, Tex2Height, Tex3Height);
+
+    m_compactTech.Enable();
+    m_compactTech.SetTextureHeights(Tex0Height, Tex1Height, Tex2Height, Tex3Height);
 }
 
 
@@ -26,7 +26,10 @@
 #include "ogldev_gui_texture.h"
 
 #include "geomip_grid.h"
+#include "clipmap_terrain.h"
 #include "terrain_technique.h"
+#include "clipmap_technique.h"
+#include "compact_terrain_technique.h"
 #include "ogldev_skydome.h"
 #include "simple_water.h"
 
@@ -51,12 +54,53 @@ class BaseTerrain
 	
     float GetHeightInterpolated(float x, float z) const;
 
+    // Heights and normals at Count world XZ positions (pNormals may be NULL)
+    void GetHeightsAndNormals(int Count, const Vector2f* pPositions, float* pHeights, Vector3f* pNormals) const;
+
+    const Array2D<float>& GetHeightMap() const { return m_heightMap; }
+
 	float GetWorldScale() const { return m_worldScale; }
 
     float GetTextureScale() const { return m_textureScale; }
 
     int GetSize() const { return m_terrainSize; }
 
+    const LodManager::UpdateStats& GetLodStats() const { return m_geomipGrid.GetLodStats(); }
+
+    // The LOD of a patch is the coarsest one whose error on the screen is not larger than
+    // MaxPixelError. Without this call the LOD is chosen by the fixed distance bands.
+    void SetLodScreenSpaceError(float MaxPixelError, const PersProjInfo& ProjInfo);
+
+    int GetNumVisiblePatches() const { return m_geomipGrid.GetNumVisiblePatches(); }
+
+    int GetNumPatches() const { return m_geomipGrid.GetNumPatches(); }
+
+    int GetNumDrawCalls() const { return m_geomipGrid.GetNumDrawCalls(); }
+
+    void EnableMultiDraw(bool Enable) { m_geomipGrid.EnableMultiDraw(Enable); }
+
+    bool IsMultiDrawSupported() const { return m_geomipGrid.IsMultiDrawSupported(); }
+
+    // Renders the terrain with the geometry clipmap instead of the geomip grid
+    void EnableClipmap(bool Enable) { m_clipmapEnabled = Enable; }
+
+    bool IsClipmapEnabled() const { return m_clipmapEnabled; }
+
+    int GetClipmapNumLevels() const { return m_clipmap.GetNumLevels(); }
+
+    int GetClipmapUploadedTexels() const { return m_clipmap.GetNumUploadedTexels(); }
+
+    // Rebuilds the geomip grid with (or without) the compact vertex format.
+    // See GeomipGrid::CreateGeomipGrid.
+    void EnableCompactVertices(bool Enable);
+
+    bool IsCompactVerticesEnabled() const { return m_compactVertices; }
+
+    // Memory used by the geomip grid in bytes
+    size_t GetVertexBufferSize() const { return m_geomipGrid.GetVertexBufferSize(); }
+
+    size_t GetIndexBufferSize() const { return m_geomipGrid.GetIndexBufferSize(); }
+
     void SetTexture(Texture* pTexture) { m_pTextures[0] = pTexture; }
 	
     void SetTextureHeights(float Tex0Height, float Tex1Height, float Tex2Height, float Tex3Height);
@@ -96,8 +140,16 @@ private:
     void RenderTerrainRefractionPass(const BasicCamera& Camera);
     void RenderTerrainDefaultPass(const BasicCamera& Camera);
     void RenderWater(const BasicCamera& Camera);
+    void RenderTerrainGeometry(const Matrix4f& VP);
+    void CreateGeomipGrid();
+    TerrainTechnique& GetTerrainTech();
 
     GeomipGrid m_geomipGrid;
+    ClipmapTerrain m_clipmap;
+    ClipmapTechnique m_clipmapTech;
+    bool m_clipmapEnabled = false;
+    CompactTerrainTechnique m_compactTech;
+    bool m_compactVertices = false;
     float m_minHeight = 0.0f;
     float m_maxHeight = 0.0f;
     TerrainTechnique m_terrainTech;
@@ -108,6 +160,8 @@ private:
     GUITexture m_guiTexture1;
     GUITexture m_guiTexture2;
     bool m_guiEnabled = true;
+    float m_lodMaxPixelError = 0.0f;    // zero when the distance bands are used
+    float m_lodProjScale = 0.0f;
 };
 
 #endif
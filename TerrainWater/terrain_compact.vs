@@ -0,0 +1,82 @@
+/*
+    Copyright 2025 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#version 330
+
+layout (location = 0) in float InHeight;    // 16 bit unorm
+layout (location = 1) in vec2 InNormal;     // octahedral
+
+uniform mat4 gVP;
+uniform float gMinHeight;
+uniform float gMaxHeight;
+uniform vec4 gClipPlane;
+
+uniform int gPatchSize;
+uniform int gNumPatchesX;
+uniform float gWorldScale;
+uniform float gHeightBase;
+uniform float gHeightRange;
+uniform float gTexScale;
+
+out vec4 Color;
+out vec2 Tex;
+out vec3 WorldPos;
+out vec3 Normal;
+
+vec3 DecodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e.x, 1.0 - abs(e.x) - abs(e.y), e.y);
+
+    float t = max(-n.y, 0.0);
+    n.x += (n.x >= 0.0) ? -t : t;
+    n.z += (n.z >= 0.0) ? -t : t;
+
+    return normalize(n);
+}
+
+
+void main()
+{
+    // The vertices of every patch are stored together and gl_VertexID includes the
+    // base vertex of the patch
+    int PatchVertexCount = gPatchSize * gPatchSize;
+    int Patch = gl_VertexID / PatchVertexCount;
+    int Local = gl_VertexID - Patch * PatchVertexCount;
+
+    int x = (Patch % gNumPatchesX) * (gPatchSize - 1) + Local % gPatchSize;
+    int z = (Patch / gNumPatchesX) * (gPatchSize - 1) + Local / gPatchSize;
+
+    vec3 Position = vec3(float(x) * gWorldScale, gHeightBase + InHeight * gHeightRange, float(z) * gWorldScale);
+
+    gl_Position = gVP * vec4(Position, 1.0);
+
+    float DeltaHeight = gMaxHeight - gMinHeight;
+
+    float HeightRatio = (Position.y - gMinHeight) / DeltaHeight;
+
+    float c = HeightRatio * 0.8 + 0.2;
+
+    Color = vec4(c, c, c, 1.0);
+
+    Tex = vec2(float(x), float(z)) * gTexScale;
+
+    WorldPos = Position;
+
+    Normal = DecodeOctahedral(InNormal);
+
+    gl_ClipDistance[0] = dot(vec4(Position, 1.0), gClipPlane);
+}
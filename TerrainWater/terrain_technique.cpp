@@ -25,12 +25,18 @@ TerrainTechnique::TerrainTechnique()
 }
 
 bool TerrainTechnique::Init()
+{
+    return InitTerrainTechnique("terrain.vs");
+}
+
+
+bool TerrainTechnique::InitTerrainTechnique(const char* pVSFilename)
 {
     if (!Technique::Init()) {
         return false;
     }
 
-    if (!AddShader(GL_VERTEX_SHADER, "terrain.vs")) {
+    if (!AddShader(GL_VERTEX_SHADER, pVSFilename)) {
         return false;
     }
 
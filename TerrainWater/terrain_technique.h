@@ -38,7 +38,11 @@ public:
     void SetLightDir(const Vector3f& Dir);
 
     void SetClipPlane(const Vector3f& Normal, const Vector3f& PointOnPlane);
-	
+
+protected:
+    // Every terrain vertex shader is paired with terrain.fs
+    bool InitTerrainTechnique(const char* pVSFilename);
+
 private:
     GLuint m_VPLoc = -1;
     GLuint m_minHeightLoc = -1;
@@ -93,6 +93,37 @@ public:
 
                 m_terrain.SetWaterHeight(m_waterHeight);
 
+                if (ImGui::Checkbox("Geometry clipmap", &this->m_clipmap)) {
+                    m_terrain.EnableClipmap(m_clipmap);
+                }
+
+                if (m_clipmap) {
+                    ImGui::Text("Clipmap levels %d, texels uploaded %d", m_terrain.GetClipmapNumLevels(),
+                                m_terrain.GetClipmapUploadedTexels());
+                } else {
+                    if (ImGui::SliderFloat("LOD max pixel error", &this->m_lodMaxPixelError, 0.5f, 32.0f, "%.1f", ImGuiSliderFlags_AlwaysClamp)) {
+                        m_terrain.SetLodScreenSpaceError(m_lodMaxPixelError, m_pGameCamera->GetPersProjInfo());
+                    }
+
+                    const LodManager::UpdateStats& LodStats = m_terrain.GetLodStats();
+                    ImGui::Text("LOD patches evaluated %d, changed %d, neighbor updates %d",
+                                LodStats.NumPatchesEvaluated, LodStats.NumCoreChanges, LodStats.NumNeighborUpdates);
+                    if (m_terrain.IsMultiDrawSupported() && ImGui::Checkbox("Multi draw indirect", &this->m_multiDraw)) {
+                        m_terrain.EnableMultiDraw(m_multiDraw);
+                    }
+
+                    ImGui::Text("Visible patches %d of %d, draw calls %d", m_terrain.GetNumVisiblePatches(),
+                                m_terrain.GetNumPatches(), m_terrain.GetNumDrawCalls());
+
+                    if (ImGui::Checkbox("Compact vertices", &this->m_compactVertices)) {
+                        m_terrain.EnableCompactVertices(m_compactVertices);
+                    }
+
+                    ImGui::Text("Vertex buffer %.2f MB, index buffer %.2f MB",
+                                (float)m_terrain.GetVertexBufferSize() / (1024.0f * 1024.0f),
+                                (float)m_terrain.GetIndexBufferSize() / (1024.0f * 1024.0f));
+                }
+
                 ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
                 ImGui::End();
 
@@ -286,6 +317,8 @@ private:
         m_terrain.SetWaterHeight(m_waterHeight);
 
         m_terrain.ControlGUI(m_guiEnabled);
+
+        m_terrain.SetLodScreenSpaceError(m_lodMaxPixelError, m_pGameCamera->GetPersProjInfo());
     }
 
 
@@ -324,6 +357,10 @@ private:
     float m_minHeight = 0.0f;
     float m_maxHeight = 556.0f;
     int m_patchSize = 33;
+    float m_lodMaxPixelError = 4.0f;
+    bool m_multiDraw = true;
+    bool m_clipmap = false;
+    bool m_compactVertices = false;
     float m_counter = 0.0f;
     bool m_constrainCamera = false;	
     float m_waterHeight = m_maxHeight * 0.5f;
@@ -26,6 +26,10 @@
 #define SKYDOME_TEXTURE_UNIT          GL_TEXTURE9
 #define SKYDOME_TEXTURE_UNIT_INDEX    9
 
+// Clipmap height levels
+#define CLIPMAP_TEXTURE_UNIT          GL_TEXTURE10
+#define CLIPMAP_TEXTURE_UNIT_INDEX    10
+
 
 
 #endif
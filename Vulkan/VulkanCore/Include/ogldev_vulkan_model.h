@@ -62,9 +62,9 @@ protected:
 
 	virtual void InitGeometryPost() { /* Nothing to do here */ }
 
-	virtual void PopulateBuffersSkinned(vector<SkinnedVertex>& Vertices) { assert(0); }
+	virtual void PopulateBuffersSkinned(const SkinnedVertex* pVertices, uint NumVertices, const uint* pIndices, uint NumIndices) { assert(0); }
 
-	virtual void PopulateBuffers(vector<Vertex>& Vertices);
+	virtual void PopulateBuffers(const Vertex* pVertices, uint NumVertices, const uint* pIndices, uint NumIndices);
 
 private:
 	VulkanCore* m_pVulkanCore = NULL;
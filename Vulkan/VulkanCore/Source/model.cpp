@@ -39,11 +39,11 @@ Texture* VkModel::AllocTexture2D()
 }
 
 
-void VkModel::PopulateBuffers(vector<Vertex>& Vertices)
+void VkModel::PopulateBuffers(const Vertex* pVertices, uint NumVertices, const uint* pIndices, uint NumIndices)
 {
-	m_vb = m_pVulkanCore->CreateVertexBuffer(Vertices.data(), ARRAY_SIZE_IN_BYTES(Vertices));
+	m_vb = m_pVulkanCore->CreateVertexBuffer(pVertices, sizeof(Vertex) * NumVertices);
     //	printf("%d\n", sizeof(Vertices[0]));
-	m_ib = m_pVulkanCore->CreateVertexBuffer(m_Indices.data(), ARRAY_SIZE_IN_BYTES(m_Indices));
+	m_ib = m_pVulkanCore->CreateVertexBuffer(pIndices, sizeof(uint) * NumIndices);
 }
 
 